@@ -0,0 +1,130 @@
+#include <aho_corasick.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Building an Aho-Corasick automaton from random DNA
+// patterns against loading one we have written to disk.
+// The Scan lines scan 1M letters, which for the mapped
+// automaton includes faulting in the pages it touches. We
+// use wall-clock time since reading and mapping is mostly
+// waiting for the file. Each line is
+//   NAME patterns time
+
+#define PATTERN_LENGTH 31
+#define TEXT_LENGTH 1000000
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t count_matches(
+    const struct ac_automaton *ac,
+    const uint8_t *x,
+    uint32_t n
+) {
+    struct ac_automaton_iter iter;
+    struct ac_match match;
+    uint32_t hits = 0;
+    init_ac_automaton_iter(&iter, ac, x, n);
+    while (next_ac_automaton_match(&iter, &match)) hits++;
+    dealloc_ac_automaton_iter(&iter);
+    return hits;
+}
+
+static void profile(uint32_t no_patterns, const uint8_t *x, const char *fname)
+{
+    enum error_codes err;
+    double begin, end;
+    uint8_t p[PATTERN_LENGTH + 1];
+
+    begin = now();
+    struct compact_trie *trie = alloc_compact_trie();
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        // every tenth pattern is from the text, so we get hits
+        if (i % 10 == 0) memcpy(p, x + rand() % (TEXT_LENGTH - PATTERN_LENGTH), PATTERN_LENGTH);
+        else for (uint32_t k = 0; k < PATTERN_LENGTH; ++k) p[k] = "acgt"[rand() % 4];
+        p[PATTERN_LENGTH] = '\0';
+        if (string_in_compact_trie(trie, p)) continue;
+        add_string_to_compact_trie(trie, p, (int)i);
+    }
+    struct ac_automaton *ac = alloc_ac_automaton_from_compact_trie(trie, AC_AUTO_LAYOUT);
+    free_compact_trie(trie);
+    end = now();
+    printf("Build %u %f\n", no_patterns, end - begin);
+
+    begin = now();
+    uint32_t expected = count_matches(ac, x, TEXT_LENGTH);
+    end = now();
+    printf("Scan %u %f\n", no_patterns, end - begin);
+
+    begin = now();
+    if (!write_ac_automaton_fname(fname, ac, &err)) {
+        printf("Cannot write %s\n", fname);
+        exit(EXIT_FAILURE);
+    }
+    end = now();
+    printf("Write %u %f\n", no_patterns, end - begin);
+    free_ac_automaton(ac);
+
+    begin = now();
+    ac = read_ac_automaton_fname(fname, false, &err);
+    end = now();
+    printf("Read %u %f\n", no_patterns, end - begin);
+    free_ac_automaton(ac);
+
+    begin = now();
+    ac = read_ac_automaton_fname(fname, true, &err);
+    end = now();
+    printf("Read-verify %u %f\n", no_patterns, end - begin);
+    free_ac_automaton(ac);
+
+    begin = now();
+    ac = map_ac_automaton_fname(fname, false, &err);
+    end = now();
+    printf("Map %u %f\n", no_patterns, end - begin);
+    begin = now();
+    uint32_t hits = count_matches(ac, x, TEXT_LENGTH);
+    end = now();
+    printf("Map-scan %u %f\n", no_patterns, end - begin);
+    if (hits != expected) {
+        printf("The mapped automaton found %u matches, not %u\n", hits, expected);
+        exit(EXIT_FAILURE);
+    }
+    free_ac_automaton(ac);
+
+    begin = now();
+    ac = map_ac_automaton_fname(fname, true, &err);
+    end = now();
+    printf("Map-verify %u %f\n", no_patterns, end - begin);
+    free_ac_automaton(ac);
+}
+
+int main(int argc, const char **argv)
+{
+    srand(time(NULL));
+    char fname[] = "/tmp/ac.XXXXXX";
+    int fd = mkstemp(fname);
+    if (fd < 0) return EXIT_FAILURE;
+    close(fd);
+
+    uint8_t *x = malloc(TEXT_LENGTH + 1);
+    for (uint32_t i = 0; i < TEXT_LENGTH; ++i)
+        x[i] = "acgt"[rand() % 4];
+    x[TEXT_LENGTH] = '\0';
+
+    uint32_t sizes[] = { 10000, 100000, 1000000 };
+    for (uint32_t k = 0; k < sizeof(sizes) / sizeof(*sizes); ++k) {
+        profile(sizes[k], x, fname);
+    }
+
+    free(x);
+    remove(fname);
+    return EXIT_SUCCESS;
+}
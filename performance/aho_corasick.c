@@ -0,0 +1,119 @@
+#include <aho_corasick.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Screening a random DNA text against many short random
+// patterns, with the trie iterator and the compiled automaton
+// in both layouts. A tenth of the patterns are planted in the
+// text so we also report some hits. Each line is
+//   NAME patterns n time hits
+// and the build lines are
+//   Build-NAME patterns time
+
+#define TEXT_LENGTH 10000000
+#define MIN_LENGTH 20
+#define MAX_LENGTH 40
+
+static double seconds(clock_t begin, clock_t end)
+{
+    return (double)(end - begin) / CLOCKS_PER_SEC;
+}
+
+static void random_dna(uint8_t *s, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; ++i)
+        s[i] = "acgt"[rand() % 4];
+}
+
+static void scan(
+    const char *name,
+    const struct ac_automaton *ac,
+    uint32_t no_patterns,
+    const uint8_t *x,
+    uint32_t n
+) {
+    struct ac_automaton_iter iter;
+    struct ac_match match;
+    uint32_t hits = 0;
+    clock_t begin = clock();
+    init_ac_automaton_iter(&iter, ac, x, n);
+    while (next_ac_automaton_match(&iter, &match)) hits++;
+    dealloc_ac_automaton_iter(&iter);
+    clock_t end = clock();
+    printf("%s %u %u %f %u\n", name, no_patterns, n, seconds(begin, end), hits);
+}
+
+static void profile(uint32_t no_patterns, const uint8_t *x, uint32_t n)
+{
+    uint8_t **patterns = malloc(no_patterns * sizeof(*patterns));
+    uint32_t *lengths = malloc(no_patterns * sizeof(*lengths));
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        uint32_t m = MIN_LENGTH + rand() % (MAX_LENGTH - MIN_LENGTH + 1);
+        patterns[i] = malloc(m + 1);
+        if (i % 10 == 0) memcpy(patterns[i], x + rand() % (n - m), m);
+        else random_dna(patterns[i], m);
+        patterns[i][m] = '\0';
+        lengths[i] = m;
+    }
+
+    clock_t begin = clock();
+    struct trie *trie = alloc_trie();
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        // planted patterns can collide, in principle
+        struct trie *v = get_trie_node(trie, patterns[i]);
+        if (v && v->string_label >= 0) continue;
+        add_string_to_trie(trie, patterns[i], (int)i);
+    }
+    compute_failure_links(trie);
+    clock_t end = clock();
+    printf("Build-Trie %u %f\n", no_patterns, seconds(begin, end));
+
+    begin = clock();
+    struct ac_automaton *dense = alloc_ac_automaton(trie, AC_DENSE_LAYOUT);
+    end = clock();
+    printf("Build-Dense %u %f\n", no_patterns, seconds(begin, end));
+
+    begin = clock();
+    struct ac_automaton *sparse = alloc_ac_automaton(trie, AC_SPARSE_LAYOUT);
+    end = clock();
+    printf("Build-Sparse %u %f\n", no_patterns, seconds(begin, end));
+
+    struct ac_iter iter;
+    struct ac_match match;
+    uint32_t hits = 0;
+    begin = clock();
+    init_ac_iter(&iter, x, n, lengths, trie);
+    while (next_ac_match(&iter, &match)) hits++;
+    dealloc_ac_iter(&iter);
+    end = clock();
+    printf("Trie %u %u %f %u\n", no_patterns, n, seconds(begin, end), hits);
+
+    scan("Dense", dense, no_patterns, x, n);
+    scan("Sparse", sparse, no_patterns, x, n);
+
+    free_ac_automaton(dense);
+    free_ac_automaton(sparse);
+    free_trie(trie);
+    for (uint32_t i = 0; i < no_patterns; ++i)
+        free(patterns[i]);
+    free(patterns);
+    free(lengths);
+}
+
+int main(int argc, const char **argv)
+{
+    srand(1);
+    uint8_t *x = malloc(TEXT_LENGTH + 1);
+    random_dna(x, TEXT_LENGTH);
+    x[TEXT_LENGTH] = '\0';
+
+    uint32_t sizes[] = { 1000, 10000, 100000 };
+    for (uint32_t i = 0; i < sizeof(sizes) / sizeof(*sizes); ++i)
+        profile(sizes[i], x, TEXT_LENGTH);
+
+    free(x);
+    return EXIT_SUCCESS;
+}
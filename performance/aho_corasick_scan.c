@@ -0,0 +1,144 @@
+#include <aho_corasick.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Scanning throughput of the Aho-Corasick matchers on a
+// random DNA text. "Rare" has long patterns and few hits, so
+// it measures the transitions; "Frequent" has short patterns
+// that hit almost everywhere, so it measures the cost of
+// reporting matches. The parallel scans report wall time.
+// Each line is
+//   NAME case patterns n time GB/s hits
+
+#define TEXT_LENGTH 100000000
+#define BUFFER_SIZE 1024
+
+static double seconds(clock_t begin, clock_t end)
+{
+    return (double)(end - begin) / CLOCKS_PER_SEC;
+}
+
+static void report(
+    const char *name, const char *test_case,
+    uint32_t no_patterns, uint32_t n,
+    clock_t begin, clock_t end, uint64_t hits
+) {
+    double time = seconds(begin, end);
+    printf("%s %s %u %u %f %f %lu\n",
+           name, test_case, no_patterns, n, time,
+           (double)n / time / 1e9, (unsigned long)hits);
+}
+
+static void count_match(const struct ac_match *match, void *data)
+{
+    uint64_t *hits = data;
+    // use the match so the call isn't trivial
+    *hits += 1 + (match->index & 0);
+}
+
+static void profile(
+    const char *test_case,
+    uint32_t no_patterns,
+    uint32_t min_length,
+    uint32_t max_length,
+    const uint8_t *x,
+    uint32_t n
+) {
+    struct trie *trie = alloc_trie();
+    uint32_t *lengths = malloc(no_patterns * sizeof(*lengths));
+    uint8_t *p = malloc(max_length + 1);
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        uint32_t m = min_length + rand() % (max_length - min_length + 1);
+        for (uint32_t k = 0; k < m; ++k)
+            p[k] = "acgt"[rand() % 4];
+        p[m] = '\0';
+        lengths[i] = m;
+        struct trie *v = get_trie_node(trie, p);
+        if (v && v->string_label >= 0) continue;
+        add_string_to_trie(trie, p, (int)i);
+    }
+    free(p);
+    compute_failure_links(trie);
+    struct ac_automaton *ac = alloc_ac_automaton(trie, AC_AUTO_LAYOUT);
+
+    clock_t begin, end;
+    uint64_t hits;
+    struct ac_match match;
+
+    hits = 0;
+    begin = clock();
+    struct ac_iter trie_iter;
+    init_ac_iter(&trie_iter, x, n, lengths, trie);
+    while (next_ac_match(&trie_iter, &match)) hits++;
+    dealloc_ac_iter(&trie_iter);
+    end = clock();
+    report("Trie", test_case, no_patterns, n, begin, end, hits);
+
+    hits = 0;
+    begin = clock();
+    struct ac_automaton_iter iter;
+    init_ac_automaton_iter(&iter, ac, x, n);
+    while (next_ac_automaton_match(&iter, &match)) hits++;
+    dealloc_ac_automaton_iter(&iter);
+    end = clock();
+    report("Iter", test_case, no_patterns, n, begin, end, hits);
+
+    hits = 0;
+    struct ac_match *buffer = malloc(BUFFER_SIZE * sizeof(*buffer));
+    begin = clock();
+    init_ac_automaton_iter(&iter, ac, x, n);
+    uint32_t got;
+    while ((got = next_ac_automaton_matches(&iter, buffer, BUFFER_SIZE)))
+        hits += got;
+    dealloc_ac_automaton_iter(&iter);
+    end = clock();
+    report("Bulk", test_case, no_patterns, n, begin, end, hits);
+    free(buffer);
+
+    hits = 0;
+    begin = clock();
+    ac_automaton_scan(ac, x, n, count_match, &hits);
+    end = clock();
+    report("Callback", test_case, no_patterns, n, begin, end, hits);
+
+    uint32_t threads[] = { 1, 2, 4, 8 };
+    for (uint32_t t = 0; t < sizeof(threads) / sizeof(*threads); ++t) {
+        char name[32];
+        sprintf(name, "Parallel-%u", threads[t]);
+        uint32_t no_matches;
+        // clock() adds up the threads, so we want the wall time.
+        struct timespec wall_begin, wall_end;
+        clock_gettime(CLOCK_MONOTONIC, &wall_begin);
+        struct ac_match *matches =
+            parallel_ac_scan(ac, x, n, threads[t], &no_matches);
+        clock_gettime(CLOCK_MONOTONIC, &wall_end);
+        free(matches);
+        double time = (double)(wall_end.tv_sec - wall_begin.tv_sec)
+            + (double)(wall_end.tv_nsec - wall_begin.tv_nsec) / 1e9;
+        printf("%s %s %u %u %f %f %u\n",
+               name, test_case, no_patterns, n, time,
+               (double)n / time / 1e9, no_matches);
+    }
+
+    free_ac_automaton(ac);
+    free_trie(trie);
+    free(lengths);
+}
+
+int main(int argc, const char **argv)
+{
+    srand(1);
+    uint8_t *x = malloc(TEXT_LENGTH + 1);
+    for (uint32_t i = 0; i < TEXT_LENGTH; ++i)
+        x[i] = "acgt"[rand() % 4];
+    x[TEXT_LENGTH] = '\0';
+
+    profile("Rare", 10000, 20, 40, x, TEXT_LENGTH);
+    profile("Frequent", 1000, 4, 8, x, TEXT_LENGTH);
+
+    free(x);
+    return EXIT_SUCCESS;
+}
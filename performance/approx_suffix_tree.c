@@ -0,0 +1,103 @@
+#include <suffix_tree.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Approximate search in suffix trees: the edit script
+// enumeration in st_approx_match_iter against the banded
+// edit distance columns in st_banded_approx_iter, with and
+// without asking for the CIGARs. The patterns are pieces of
+// the string with one substitution. Each line is
+//   NAME n m edits time
+
+#define NO_PATTERNS 200
+
+static uint8_t *build_random(uint32_t size, const char *alphabet)
+{
+    uint32_t k = (uint32_t)strlen(alphabet);
+    uint8_t *s = malloc(size + 1);
+    for (uint32_t i = 0; i < size; ++i) {
+        s[i] = alphabet[rand() % k];
+    }
+    s[size] = '\0';
+    return s;
+}
+
+static double seconds(clock_t begin, clock_t end)
+{
+    return (double)(end - begin) / CLOCKS_PER_SEC;
+}
+
+static void profile(struct suffix_tree *st, uint32_t n, uint32_t m, uint32_t edits)
+{
+    uint8_t **patterns = malloc(NO_PATTERNS * sizeof(*patterns));
+    for (uint32_t i = 0; i < NO_PATTERNS; ++i) {
+        uint32_t j = rand() % (n - m);
+        patterns[i] = malloc(m + 1);
+        memcpy(patterns[i], st->string + j, m);
+        patterns[i][rand() % m] = "ACGT"[rand() % 4];
+        patterns[i][m] = '\0';
+    }
+    uint64_t count = 0;
+    clock_t begin, end;
+
+    begin = clock();
+    for (uint32_t i = 0; i < NO_PATTERNS; ++i) {
+        struct st_approx_match_iter iter;
+        struct st_approx_match match;
+        init_st_approx_iter(&iter, st, patterns[i], (int)edits);
+        while (next_st_approx_match(&iter, &match))
+            count++;
+        dealloc_st_approx_iter(&iter);
+    }
+    end = clock();
+    printf("Scripts %u %u %u %f\n", n, m, edits, seconds(begin, end));
+
+    struct st_banded_approx_iter iter;
+    struct st_banded_approx_match match;
+    init_st_banded_approx_iter(&iter, st, patterns[0], edits);
+    begin = clock();
+    for (uint32_t i = 0; i < NO_PATTERNS; ++i) {
+        reset_st_banded_approx_iter(&iter, patterns[i]);
+        while (next_st_banded_approx_match(&iter, &match))
+            count++;
+    }
+    end = clock();
+    printf("Banded %u %u %u %f\n", n, m, edits, seconds(begin, end));
+
+    char *cigar = malloc(2 * (m + edits) + 1);
+    begin = clock();
+    for (uint32_t i = 0; i < NO_PATTERNS; ++i) {
+        reset_st_banded_approx_iter(&iter, patterns[i]);
+        while (next_st_banded_approx_match(&iter, &match))
+            count += strlen(st_banded_approx_cigar(&iter, cigar));
+    }
+    end = clock();
+    printf("Banded-CIGAR %u %u %u %f\n", n, m, edits, seconds(begin, end));
+    free(cigar);
+    dealloc_st_banded_approx_iter(&iter);
+
+    if (count == 42) printf("\n");
+    for (uint32_t i = 0; i < NO_PATTERNS; ++i)
+        free(patterns[i]);
+    free(patterns);
+}
+
+int main(int argc, const char **argv)
+{
+    srand(time(NULL));
+    uint32_t n = 1000000;
+    uint8_t *s = build_random(n, "ACGT");
+    struct suffix_tree *st = mccreight_suffix_tree(s);
+    uint32_t lengths[] = { 20, 50, 100 };
+    for (uint32_t k = 0; k < sizeof(lengths) / sizeof(*lengths); ++k) {
+        for (uint32_t edits = 1; edits <= 3; ++edits) {
+            profile(st, n, lengths[k], edits);
+        }
+    }
+    free_suffix_tree(st);
+    free(s);
+    return EXIT_SUCCESS;
+}
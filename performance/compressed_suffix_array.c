@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <suffix_array.h>
+#include <compressed_suffix_array.h>
+#include <remap.h>
+#include <string_utils.h>
+
+// Memory against query time for the plain and the compressed
+// suffix array. Each line is
+//   NAME alphabet n sample-rate bytes/char search-time
+// where the search time is for finding and locating all
+// occurrences of no_patterns patterns sampled from the string.
+
+static uint8_t *build_random(uint32_t size)
+{
+    const uint8_t *alphabet = (uint8_t *)"ACGT";
+    int n = strlen((char *)alphabet);
+    uint8_t *s = malloc(sizeof(uint8_t)*(size + 1));
+
+    for (uint32_t i = 0; i < size; ++i) {
+        s[i] = alphabet[rand() % n];
+    }
+    s[size] = '\0';
+
+    return s;
+}
+
+static uint8_t *build_random_large(uint32_t size)
+{
+    uint8_t *s = malloc(size + 1);
+    for (uint32_t i = 0; i < size; ++i) {
+        char random_letter = rand();
+        if (random_letter == 0) {
+            random_letter = 1; // avoid the sentinel
+        }
+        s[i] = random_letter;
+    }
+    s[size] = '\0';
+
+    return s;
+}
+
+static uint8_t **sample_patterns(const uint8_t *s, uint32_t n,
+                                 uint32_t no_patterns, uint32_t m)
+{
+    uint8_t **patterns = malloc(no_patterns * sizeof(*patterns));
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        uint32_t offset = rand() % (n - m);
+        patterns[i] = str_copy_n(s + offset, m);
+    }
+    return patterns;
+}
+
+static double sa_time(struct suffix_array *sa,
+                      uint8_t **patterns, uint32_t no_patterns)
+{
+    struct sa_match_iter iter;
+    struct sa_match match;
+    clock_t begin = clock();
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        init_sa_match_iter(&iter, patterns[i], sa);
+        while (next_sa_match(&iter, &match)) {
+
+        }
+        dealloc_sa_match_iter(&iter);
+    }
+    clock_t end = clock();
+    return (double)(end - begin) / CLOCKS_PER_SEC;
+}
+
+static double csa_time(struct compressed_suffix_array *csa,
+                       uint8_t **patterns, uint32_t no_patterns)
+{
+    struct csa_match_iter iter;
+    struct sa_match match;
+    clock_t begin = clock();
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        init_csa_match_iter(&iter, patterns[i], csa);
+        while (next_csa_match(&iter, &match)) {
+
+        }
+        dealloc_csa_match_iter(&iter);
+    }
+    clock_t end = clock();
+    return (double)(end - begin) / CLOCKS_PER_SEC;
+}
+
+static void profile(const char *alphabet_name,
+                    uint8_t *s, uint32_t n,
+                    bool remap_string,
+                    uint32_t no_patterns, uint32_t m)
+{
+    struct remap_table remap_table;
+    uint8_t *x = s;
+    uint32_t alphabet_size = 256;
+    if (remap_string) {
+        init_remap_table(&remap_table, s);
+        x = malloc(n + 1);
+        remap(x, s, &remap_table);
+        alphabet_size = remap_table.alphabet_size;
+    }
+
+    uint8_t **patterns = sample_patterns(x, n, no_patterns, m);
+    struct suffix_array *sa = sa_is_construction(x, alphabet_size);
+
+    double time = sa_time(sa, patterns, no_patterns);
+    // we count the string for the suffix array since it needs it
+    double bytes = (double)(sa->length * (sizeof(*sa->array) + 1));
+    printf("SA %s %u %u %.3f %f\n", alphabet_name, n, 1, bytes / n, time);
+
+    uint32_t sample_rates[] = { 4, 16, 32, 64 };
+    for (uint32_t k = 0; k < sizeof(sample_rates)/sizeof(*sample_rates); ++k) {
+        struct compressed_suffix_array *csa =
+            csa_construction(sa, alphabet_size, sample_rates[k]);
+        time = csa_time(csa, patterns, no_patterns);
+        bytes = (double)csa_bytes(csa);
+        printf("CSA %s %u %u %.3f %f\n", alphabet_name, n, sample_rates[k],
+               bytes / n, time);
+        free_compressed_suffix_array(csa);
+    }
+
+    free_suffix_array(sa);
+    for (uint32_t i = 0; i < no_patterns; ++i)
+        free(patterns[i]);
+    free(patterns);
+    if (remap_string) free(x);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t no_patterns = 1000;
+    uint32_t m = 20;
+
+    for (uint32_t n = 1000000; n <= 8000000; n *= 2) {
+        uint8_t *s = build_random(n);
+        profile("DNA", s, n, true, no_patterns, m);
+        free(s);
+
+        s = build_random_large(n);
+        profile("BYTE", s, n, false, no_patterns, m);
+        free(s);
+    }
+
+    return EXIT_SUCCESS;
+}
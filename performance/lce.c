@@ -0,0 +1,110 @@
+#include <lce.h>
+#include <suffix_tree.h>
+#include <suffix_array.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Random longest common extension queries, answered by
+// comparing the suffixes, by LCA in the suffix tree, and by
+// RMQ over the LCP array. The periodic string has long
+// extensions, which is where the direct comparison hurts.
+// Each line is
+//   NAME string n queries time
+// and the build lines are
+//   Build-NAME string n time
+
+#define NO_QUERIES 5000000
+#define NO_NAIVE_QUERIES 10000
+
+static uint8_t *build_random(uint32_t size, const char *alphabet)
+{
+    uint32_t k = (uint32_t)strlen(alphabet);
+    uint8_t *s = malloc(size + 1);
+    for (uint32_t i = 0; i < size; ++i) {
+        s[i] = alphabet[rand() % k];
+    }
+    s[size] = '\0';
+    return s;
+}
+
+static uint8_t *build_periodic(uint32_t size, uint32_t period)
+{
+    uint8_t *s = malloc(size + 1);
+    for (uint32_t i = 0; i < size; ++i) {
+        s[i] = (i < period) ? "ACGT"[rand() % 4] : s[i - period];
+    }
+    s[size] = '\0';
+    return s;
+}
+
+static double seconds(clock_t begin, clock_t end)
+{
+    return (double)(end - begin) / CLOCKS_PER_SEC;
+}
+
+static void profile(const char *name, uint8_t *s, uint32_t n)
+{
+    uint32_t *queries = malloc(2 * NO_QUERIES * sizeof(*queries));
+    for (uint32_t q = 0; q < 2 * NO_QUERIES; ++q)
+        queries[q] = rand() % n;
+    uint64_t checksum = 0;
+    clock_t begin, end;
+
+    begin = clock();
+    for (uint32_t q = 0; q < NO_NAIVE_QUERIES; ++q) {
+        const uint8_t *x = s + queries[2 * q], *y = s + queries[2 * q + 1];
+        uint32_t l = 0;
+        while (x[l] && x[l] == y[l]) l++;
+        checksum += l;
+    }
+    end = clock();
+    printf("Naive %s %u %u %f\n", name, n, NO_NAIVE_QUERIES, seconds(begin, end));
+
+    begin = clock();
+    struct suffix_tree *st = mccreight_suffix_tree(s);
+    struct st_lca *lca = alloc_st_lca(st);
+    end = clock();
+    printf("Build-ST %s %u %f\n", name, n, seconds(begin, end));
+    begin = clock();
+    for (uint32_t q = 0; q < NO_QUERIES; ++q)
+        checksum += st_lce(lca, queries[2 * q], queries[2 * q + 1]);
+    end = clock();
+    printf("ST %s %u %u %f\n", name, n, NO_QUERIES, seconds(begin, end));
+    free_st_lca(lca);
+    free_suffix_tree(st);
+
+    begin = clock();
+    struct suffix_array *sa = skew_sa_construction(s);
+    struct sa_lce *lce = alloc_sa_lce(sa);
+    end = clock();
+    printf("Build-SA %s %u %f\n", name, n, seconds(begin, end));
+    begin = clock();
+    for (uint32_t q = 0; q < NO_QUERIES; ++q)
+        checksum += sa_lce(lce, queries[2 * q], queries[2 * q + 1]);
+    end = clock();
+    printf("SA %s %u %u %f\n", name, n, NO_QUERIES, seconds(begin, end));
+    free_sa_lce(lce);
+    free_suffix_array(sa);
+
+    // Keep the compiler from throwing the queries away.
+    if (checksum == 42) printf("\n");
+    free(queries);
+}
+
+int main(int argc, const char **argv)
+{
+    srand(time(NULL));
+    uint32_t sizes[] = { 100000, 1000000 };
+    for (uint32_t k = 0; k < sizeof(sizes) / sizeof(*sizes); ++k) {
+        uint8_t *s = build_random(sizes[k], "ACGT");
+        profile("DNA", s, sizes[k]);
+        free(s);
+        s = build_periodic(sizes[k], 10);
+        profile("periodic", s, sizes[k]);
+        free(s);
+    }
+    return EXIT_SUCCESS;
+}
@@ -27,6 +27,23 @@ static uint8_t *build_random(uint32_t size)
     return s;
 }
 
+// A short repeat unit over the DNA letters, like a satellite
+// repeat. Since the unit is fixed, patterns built the same way
+// occur at every period, which is the worst case for BM without
+// the Galil rule.
+static uint8_t *build_periodic(uint32_t size)
+{
+    const uint8_t unit[] = { 1, 2, 3, 1, 4, 2, 1 };
+    uint32_t period = sizeof(unit);
+    uint8_t *s = malloc(size + 1);
+    for (uint32_t i = 0; i < size; ++i) {
+        s[i] = unit[i % period];
+    }
+    s[size] = '\0';
+    
+    return s;
+}
+
 static uint8_t *build_random_large(uint32_t size)
 {
     uint8_t *s = malloc(size + 1);
@@ -71,6 +88,22 @@ PROFILE(profile_bmh, "BMH", struct bmh_match_iter,
         init_bmh_match_iter, next_bmh_match, dealloc_bmh_match_iter);
 PROFILE(profile_bm, "BM", struct bm_match_iter,
         init_bm_match_iter, next_bm_match, dealloc_bm_match_iter);
+PROFILE(profile_bmh_flat, "BMH-flat", struct bmh_flat_match_iter,
+        init_bmh_flat_match_iter, next_bmh_flat_match,
+        dealloc_bmh_flat_match_iter);
+PROFILE(profile_bm_flat, "BM-flat", struct bm_flat_match_iter,
+        init_bm_flat_match_iter, next_bm_flat_match,
+        dealloc_bm_flat_match_iter);
+PROFILE(profile_bm_galil, "BM-Galil", struct bm_galil_match_iter,
+        init_bm_galil_match_iter, next_bm_galil_match,
+        dealloc_bm_galil_match_iter);
+PROFILE(profile_simd, "SIMD", struct simd_match_iter,
+        init_simd_match_iter, next_simd_match, dealloc_simd_match_iter);
+PROFILE(profile_shift_or, "Shift-Or", struct shift_or_match_iter,
+        init_shift_or_match_iter, next_shift_or_match,
+        dealloc_shift_or_match_iter);
+PROFILE(profile_bndm, "BNDM", struct bndm_match_iter,
+        init_bndm_match_iter, next_bndm_match, dealloc_bndm_match_iter);
 
 
 static void profile(const char *alphabet,
@@ -81,6 +114,12 @@ static void profile(const char *alphabet,
     profile_kmp(alphabet, x, n, p, m);
     profile_bmh(alphabet, x, n, p, m);
     profile_bm(alphabet, x, n, p, m);
+    profile_bmh_flat(alphabet, x, n, p, m);
+    profile_bm_flat(alphabet, x, n, p, m);
+    profile_bm_galil(alphabet, x, n, p, m);
+    profile_simd(alphabet, x, n, p, m);
+    profile_shift_or(alphabet, x, n, p, m);
+    profile_bndm(alphabet, x, n, p, m);
 }
 
 #define PROFILE_LOOPS(ALPHABET, builder) \
@@ -105,6 +144,7 @@ int main(int argc, const char **argv)
     uint32_t reps = 5;
     
     PROFILE_LOOPS("EQUAL", build_equal);
+    PROFILE_LOOPS("PERIODIC", build_periodic);
     PROFILE_LOOPS("DNA", build_random);
     PROFILE_LOOPS("ASCII", build_random_large);
 
@@ -0,0 +1,115 @@
+#include <suffix_tree.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Matching statistics for a read against a reference,
+// computed with suffix links against searching from the
+// root at each position (which is what you get with
+// st_search). The read is a piece of the reference with 1%
+// substitutions. Each line is
+//   NAME n m time
+
+static uint8_t *build_random(uint32_t size, const char *alphabet)
+{
+    uint32_t k = (uint32_t)strlen(alphabet);
+    uint8_t *s = malloc(size + 1);
+    for (uint32_t i = 0; i < size; ++i) {
+        s[i] = alphabet[rand() % k];
+    }
+    s[size] = '\0';
+    return s;
+}
+
+static uint8_t *sample_read(const uint8_t *x, uint32_t n, uint32_t m)
+{
+    uint8_t *read = malloc(m + 1);
+    uint32_t start = rand() % (n - m);
+    for (uint32_t i = 0; i < m; ++i) {
+        read[i] = (rand() % 100 == 0) ? "ACGT"[rand() % 4] : x[start + i];
+    }
+    read[m] = '\0';
+    return read;
+}
+
+static double seconds(clock_t begin, clock_t end)
+{
+    return (double)(end - begin) / CLOCKS_PER_SEC;
+}
+
+// The longest prefix of p in the tree, searching from the root.
+static uint32_t root_scan(const struct suffix_tree *st, const uint8_t *p)
+{
+    struct suffix_tree_node *v = st->root;
+    uint32_t l = 0;
+    for (;;) {
+        struct suffix_tree_node *w = st_find_child(st, v, p[l]);
+        if (!p[l] || !w) return l;
+        const uint8_t *s = w->range.from, *t = w->range.to;
+        for (; s != t; ++s, ++l)
+            if (!p[l] || *s != p[l]) return l;
+        v = w;
+    }
+}
+
+static void profile(uint32_t n, uint32_t m)
+{
+    uint8_t *x = build_random(n, "ACGT");
+    uint8_t *read = sample_read(x, n, m);
+    struct suffix_tree *st = mccreight_suffix_tree(x);
+    uint64_t checksum = 0;
+    clock_t begin, end;
+
+    begin = clock();
+    for (uint32_t i = 0; i < m; ++i)
+        checksum += root_scan(st, read + i);
+    end = clock();
+    printf("Root-scan %u %u %f\n", n, m, seconds(begin, end));
+
+    struct st_ms_iter ms_iter;
+    struct st_matching_statistic ms;
+    begin = clock();
+    init_st_ms_iter(&ms_iter, st, read);
+    while (next_st_ms(&ms_iter, &ms))
+        checksum -= ms.length;
+    dealloc_st_ms_iter(&ms_iter);
+    end = clock();
+    printf("Suffix-links %u %u %f\n", n, m, seconds(begin, end));
+    if (checksum != 0) printf("The matching statistics differ!\n");
+
+    struct st_smem_iter smem_iter;
+    begin = clock();
+    init_st_smem_iter(&smem_iter, st, read, 20);
+    while (next_st_smem(&smem_iter, &ms))
+        checksum += ms.length;
+    dealloc_st_smem_iter(&smem_iter);
+    end = clock();
+    printf("SMEM %u %u %f\n", n, m, seconds(begin, end));
+
+    struct st_mem_iter mem_iter;
+    struct st_mem mem;
+    begin = clock();
+    init_st_mem_iter(&mem_iter, st, read, 20);
+    while (next_st_mem(&mem_iter, &mem))
+        checksum += mem.length;
+    dealloc_st_mem_iter(&mem_iter);
+    end = clock();
+    printf("MEM %u %u %f\n", n, m, seconds(begin, end));
+
+    if (checksum == 42) printf("\n");
+    free_suffix_tree(st);
+    free(read);
+    free(x);
+}
+
+int main(int argc, const char **argv)
+{
+    srand(time(NULL));
+    uint32_t sizes[] = { 100000, 1000000, 4000000 };
+    for (uint32_t k = 0; k < sizeof(sizes) / sizeof(*sizes); ++k) {
+        profile(sizes[k], 50000);
+    }
+    return EXIT_SUCCESS;
+}
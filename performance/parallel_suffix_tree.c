@@ -0,0 +1,86 @@
+#include <suffix_tree.h>
+#include <edge_array_suffix_tree.h>
+#include <suffix_array.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Sequential against parallel construction from SA and LCP.
+// We use wall-clock time here since clock() adds up the time
+// of all the threads. Each line is
+//   NAME alphabet n threads time
+
+static uint8_t *build_random(uint32_t size, const char *alphabet)
+{
+    uint32_t k = (uint32_t)strlen(alphabet);
+    uint8_t *s = malloc(size + 1);
+    for (uint32_t i = 0; i < size; ++i) {
+        s[i] = alphabet[rand() % k];
+    }
+    s[size] = '\0';
+    return s;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void profile(const char *alphabet_name, uint8_t *s, uint32_t n)
+{
+    struct suffix_array *sa = skew_sa_construction(s);
+    compute_lcp(sa);
+    double begin, end;
+
+    begin = now();
+    struct suffix_tree *st = lcp_suffix_tree(s, sa->array, sa->lcp);
+    end = now();
+    printf("LCP %s %u %u %f\n", alphabet_name, n, 1, end - begin);
+    free_suffix_tree(st);
+
+    begin = now();
+    struct ea_suffix_tree *east = lcp_ea_suffix_tree(256, s, sa->array, sa->lcp);
+    end = now();
+    printf("EA-LCP %s %u %u %f\n", alphabet_name, n, 1, end - begin);
+    free_ea_suffix_tree(east);
+
+    uint32_t threads[] = { 2, 4, 8 };
+    for (uint32_t k = 0; k < sizeof(threads) / sizeof(*threads); ++k) {
+        begin = now();
+        st = parallel_lcp_suffix_tree(s, sa->array, sa->lcp, threads[k]);
+        end = now();
+        printf("Parallel-LCP %s %u %u %f\n",
+               alphabet_name, n, threads[k], end - begin);
+        free_suffix_tree(st);
+
+        begin = now();
+        east = parallel_lcp_ea_suffix_tree(256, s, sa->array, sa->lcp, threads[k]);
+        end = now();
+        printf("Parallel-EA-LCP %s %u %u %f\n",
+               alphabet_name, n, threads[k], end - begin);
+        free_ea_suffix_tree(east);
+    }
+
+    free_suffix_array(sa);
+}
+
+int main(int argc, const char **argv)
+{
+    srand(time(NULL));
+    // The edge array tree uses 256 pointers per node, so
+    // we can't make the strings very long.
+    uint32_t sizes[] = { 100000, 500000, 1000000 };
+    for (uint32_t k = 0; k < sizeof(sizes) / sizeof(*sizes); ++k) {
+        uint8_t *s = build_random(sizes[k], "ACGT");
+        profile("DNA", s, sizes[k]);
+        free(s);
+        s = build_random(sizes[k], "abcdefghijklmnopqrstuvwxyz");
+        profile("letters", s, sizes[k]);
+        free(s);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+#include <suffix_array.h>
+#include <sparse_suffix_array.h>
+#include <remap.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Construction time for the full suffix array against
+// sparse suffix arrays with different strides. Each line is
+//   NAME alphabet n stride no-suffixes time
+
+static uint8_t *build_random(uint32_t size, const char *alphabet)
+{
+    uint32_t k = (uint32_t)strlen(alphabet);
+    uint8_t *s = malloc(size + 1);
+    for (uint32_t i = 0; i < size; ++i) {
+        s[i] = alphabet[rand() % k];
+    }
+    s[size] = '\0';
+    return s;
+}
+
+static void profile(const char *alphabet_name, uint8_t *s, uint32_t n)
+{
+    clock_t begin, end;
+
+    uint8_t *x = malloc(n + 1);
+    uint32_t alphabet_size = remap_string(x, s);
+    begin = clock();
+    struct suffix_array *sa = sa_is_construction(x, alphabet_size);
+    end = clock();
+    printf("SA-IS %s %u %u %u %f\n", alphabet_name, n, 1, sa->length,
+           (double)(end - begin) / CLOCKS_PER_SEC);
+    free_suffix_array(sa);
+    free(x);
+
+    uint32_t strides[] = { 2, 3, 8, 32 };
+    for (uint32_t k = 0; k < sizeof(strides) / sizeof(*strides); ++k) {
+        begin = clock();
+        struct sparse_suffix_array *ssa =
+            sparse_sa_stride_construction(s, strides[k]);
+        end = clock();
+        printf("Sparse %s %u %u %u %f\n", alphabet_name, n, strides[k],
+               ssa->no_suffixes, (double)(end - begin) / CLOCKS_PER_SEC);
+        free_sparse_suffix_array(ssa);
+    }
+
+    // Every 8th position, but through the position interface
+    uint32_t no_positions = n / 8;
+    uint32_t *positions = malloc(no_positions * sizeof(*positions));
+    for (uint32_t i = 0; i < no_positions; ++i)
+        positions[i] = 8 * i;
+    begin = clock();
+    struct sparse_suffix_array *ssa =
+        sparse_sa_positions_construction(s, no_positions, positions);
+    end = clock();
+    printf("Sparse-positions %s %u %u %u %f\n", alphabet_name, n, 8,
+           ssa->no_suffixes, (double)(end - begin) / CLOCKS_PER_SEC);
+    free_sparse_suffix_array(ssa);
+    free(positions);
+}
+
+int main(int argc, const char **argv)
+{
+    for (uint32_t n = 1000000; n <= 8000000; n *= 2) {
+        uint8_t *s = build_random(n, "ACGT");
+        profile("DNA", s, n);
+        free(s);
+        s = build_random(n, "abcdefghijklmnopqrstuvwxyz");
+        profile("Letters", s, n);
+        free(s);
+    }
+    return EXIT_SUCCESS;
+}
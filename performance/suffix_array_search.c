@@ -31,8 +31,12 @@ static uint8_t *sample_string(const uint8_t *string, uint32_t n, uint32_t m)
     return p;
 }
 
+// With relayout false, the nodes are in the order McCreight's
+// algorithm created them, otherwise we move them to the layout
+// before we search.
 static double st_performance(uint8_t *s, uint32_t n,
-                             uint32_t no_patterns, uint32_t m)
+                             uint32_t no_patterns, uint32_t m,
+                             bool relayout, enum st_layout layout)
 {
     clock_t search_begin, search_end;
     struct st_search_iter iter;
@@ -40,6 +44,7 @@ static double st_performance(uint8_t *s, uint32_t n,
     
     
     struct suffix_tree *st = mccreight_suffix_tree(s);
+    if (relayout) st_relayout(st, layout);
     
     search_begin = clock();
 
@@ -105,6 +110,63 @@ static double sa_performance(uint8_t *s, uint32_t n,
     return (double)(search_end - search_begin);
 }
 
+// Compares the scalar search, one pattern at a time, with the
+// batched search and reports queries per second for both. We
+// only time finding the intervals since reporting the hits
+// is the same for the two.
+static void sa_batch_performance(uint8_t *s, uint32_t n,
+                                 uint32_t no_patterns, uint32_t m)
+{
+    clock_t begin, end;
+    struct remap_table remap_table;
+    struct sa_match_iter iter;
+    
+    init_remap_table(&remap_table, s);
+    uint8_t *rs = malloc(n + 1);
+    remap(rs, s, &remap_table);
+    
+    struct suffix_array *sa = sa_is_construction(rs, remap_table.alphabet_size);
+    
+    const uint8_t **patterns = malloc(no_patterns * sizeof(*patterns));
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        uint8_t *p = sample_string(s, n, m);
+        remap(p, p, &remap_table);
+        patterns[i] = p;
+    }
+    struct sa_interval *intervals = malloc(no_patterns * sizeof(*intervals));
+    
+    uint32_t checksum = 0;
+    begin = clock();
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        init_sa_match_iter(&iter, patterns[i], sa);
+        checksum += iter.L;
+        dealloc_sa_match_iter(&iter);
+    }
+    end = clock();
+    double time = (double)(end - begin) / CLOCKS_PER_SEC;
+    printf("SA-scalar %u %u %f %.0f\n", n, m, time, no_patterns / time);
+    
+    begin = clock();
+    sa_batch_search(sa, no_patterns, patterns, intervals);
+    end = clock();
+    time = (double)(end - begin) / CLOCKS_PER_SEC;
+    printf("SA-batch %u %u %f %.0f\n", n, m, time, no_patterns / time);
+    
+    // Both should find the same intervals.
+    for (uint32_t i = 0; i < no_patterns; ++i)
+        checksum -= intervals[i].L;
+    if (checksum != 0) {
+        printf("batched and scalar search disagree!\n");
+    }
+    
+    for (uint32_t i = 0; i < no_patterns; ++i)
+        free((uint8_t *)patterns[i]);
+    free(patterns);
+    free(intervals);
+    free_suffix_array(sa);
+    free(rs);
+}
+
 static double bwt_performance(uint8_t *s, uint32_t n,
                               uint32_t no_patterns, uint32_t m)
 {
@@ -162,7 +224,7 @@ int main(int argc, char **argv)
                 printf("SA %u %u %f\n", n, m, time / CLOCKS_PER_SEC);
                 time = bwt_performance(s, n, no_patterns, m);
                 printf("BWT %u %u %f\n", n, m, time / CLOCKS_PER_SEC);
-                time = st_performance(s, n, no_patterns, m);
+                time = st_performance(s, n, no_patterns, m, false, 0);
                 printf("ST %u %u %f\n", n, m, time / CLOCKS_PER_SEC);
                 free(s);
             }
@@ -179,7 +241,7 @@ int main(int argc, char **argv)
                 printf("SA %u %u %f\n", n, m, time / CLOCKS_PER_SEC);
                 time = bwt_performance(s, n, no_patterns, m);
                 printf("BWT %u %u %f\n", n, m, time / CLOCKS_PER_SEC);
-                time = st_performance(s, n, no_patterns, m);
+                time = st_performance(s, n, no_patterns, m, false, 0);
                 printf("ST %u %u %f\n", n, m, time / CLOCKS_PER_SEC);
                 free(s);
             }
@@ -203,12 +265,22 @@ int main(int argc, char **argv)
         if (strcmp(alg, "SA") == 0) {
             time = sa_performance(s, n, no_patterns, m);
             printf("SA %u %u %f\n", n, m, time / CLOCKS_PER_SEC);
+        } else if (strcmp(alg, "SA-BATCH") == 0) {
+            // we need many more queries to get a stable
+            // number of queries per second.
+            sa_batch_performance(s, n, 1000 * no_patterns, m);
         } else if (strcmp(alg, "BWT") == 0) {
             time = bwt_performance(s, n, no_patterns, m);
             printf("BWT %u %u %f\n", n, m, time / CLOCKS_PER_SEC);
         } else if (strcmp(alg, "ST") == 0) {
-            time = st_performance(s, n, no_patterns, m);
+            time = st_performance(s, n, no_patterns, m, false, 0);
             printf("ST %u %u %f\n", n, m, time / CLOCKS_PER_SEC);
+        } else if (strcmp(alg, "ST-PREORDER") == 0) {
+            time = st_performance(s, n, no_patterns, m, true, ST_LAYOUT_PREORDER);
+            printf("ST-PREORDER %u %u %f\n", n, m, time / CLOCKS_PER_SEC);
+        } else if (strcmp(alg, "ST-FAMILIES") == 0) {
+            time = st_performance(s, n, no_patterns, m, true, ST_LAYOUT_FAMILIES);
+            printf("ST-FAMILIES %u %u %f\n", n, m, time / CLOCKS_PER_SEC);
         } else {
             printf("unknow algorithm!\n");
             return EXIT_FAILURE;
@@ -0,0 +1,97 @@
+#include <suffix_tree.h>
+#include <edge_array_suffix_tree.h>
+#include <string_utils.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Child lookup on byte alphabets: sibling lists, the child
+// index, and edge arrays. Each line is
+//   NAME n search-time bytes-per-char
+// where the bytes are for the child representation (the
+// pointers in the nodes for the list, the index on top of
+// that, and the child arrays for the edge array tree).
+
+static uint8_t *build_random_large(uint32_t size)
+{
+    uint8_t *s = malloc(size + 1);
+    for (uint32_t i = 0; i < size; ++i) {
+        s[i] = 1 + rand() % 255; // avoid the sentinel
+    }
+    s[size] = '\0';
+    return s;
+}
+
+#define NO_SEARCHES 1000000
+#define PATTERN_LENGTH 8
+
+static uint8_t **sample_patterns(const uint8_t *s, uint32_t n)
+{
+    uint8_t **patterns = malloc(NO_SEARCHES * sizeof(*patterns));
+    for (uint32_t i = 0; i < NO_SEARCHES; ++i) {
+        uint32_t j = rand() % (n - PATTERN_LENGTH);
+        patterns[i] = str_copy_n(s + j, PATTERN_LENGTH);
+    }
+    return patterns;
+}
+
+static double search_time(struct suffix_tree *st, uint8_t **patterns)
+{
+    clock_t begin = clock();
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < NO_SEARCHES; ++i)
+        found += st_search(st, patterns[i]) != 0;
+    clock_t end = clock();
+    if (found != NO_SEARCHES) printf("Missing patterns!\n");
+    return (double)(end - begin) / CLOCKS_PER_SEC;
+}
+
+static void profile(uint32_t n, bool with_edge_arrays)
+{
+    uint8_t *s = build_random_large(n);
+    uint8_t **patterns = sample_patterns(s, n);
+
+    struct suffix_tree *st = mccreight_suffix_tree(s);
+    double no_nodes = (double)(st->pool.next_node - st->pool.nodes);
+    double list_bytes = no_nodes * 2 * sizeof(struct suffix_tree_node *);
+    printf("List %u %f %.2f\n", n, search_time(st, patterns), list_bytes / n);
+
+    st_build_child_index(st);
+    printf("Index %u %f %.2f\n", n, search_time(st, patterns),
+           (list_bytes + st_child_index_bytes(st)) / n);
+    free_suffix_tree(st);
+
+    if (with_edge_arrays) {
+        struct ea_suffix_tree *east = mccreight_ea_suffix_tree(256, s);
+        double ea_nodes = (double)(east->node_pool.next_node - east->node_pool.nodes);
+        double ea_bytes = ea_nodes * 256 * sizeof(struct ea_suffix_tree_node *);
+        clock_t begin = clock();
+        uint32_t found = 0;
+        for (uint32_t i = 0; i < NO_SEARCHES; ++i)
+            found += ea_st_search(east, patterns[i]) != 0;
+        clock_t end = clock();
+        if (found != NO_SEARCHES) printf("Missing patterns!\n");
+        printf("EA %u %f %.2f\n", n,
+               (double)(end - begin) / CLOCKS_PER_SEC, ea_bytes / n);
+        free_ea_suffix_tree(east);
+    }
+
+    for (uint32_t i = 0; i < NO_SEARCHES; ++i)
+        free(patterns[i]);
+    free(patterns);
+    free(s);
+}
+
+int main(int argc, const char **argv)
+{
+    srand(time(NULL));
+    // The edge arrays use 4K per node, so we only
+    // build them for the small strings.
+    uint32_t sizes[] = { 10000, 50000, 100000, 500000, 1000000 };
+    for (uint32_t k = 0; k < sizeof(sizes) / sizeof(*sizes); ++k) {
+        profile(sizes[k], sizes[k] <= 100000);
+    }
+    return EXIT_SUCCESS;
+}
@@ -59,7 +59,74 @@ static uint8_t *build_random_large(uint32_t size)
 
 
 
+// The compact trees. The last column is the number of nodes,
+// like for the other trees, counting the implicit leaves.
+static void get_compact_performance(const char *type, uint8_t *s, uint32_t size)
+{
+    clock_t begin, end;
+    struct compact_suffix_tree *cst;
 
+    begin = clock();
+    cst = mccreight_compact_suffix_tree(s);
+    end = clock();
+    printf("Compact-McCreight %s %u %f %u\n",
+           type, size, (double)(end - begin) / CLOCKS_PER_SEC,
+           cst->no_inner_nodes + cst->length);
+    free_compact_suffix_tree(cst);
+
+    struct suffix_array *sa = skew_sa_construction(s);
+    compute_lcp(sa);
+    begin = clock();
+    cst = lcp_compact_suffix_tree(s, sa->array, sa->lcp);
+    end = clock();
+    printf("Compact-LCP %s %u %f %u\n",
+           type, size, (double)(end - begin) / CLOCKS_PER_SEC,
+           cst->no_inner_nodes + cst->length);
+    free_compact_suffix_tree(cst);
+    free_suffix_array(sa);
+}
+
+// Ukkonen's algorithm, appending the string in 4K chunks,
+// with and without knowing the length up front.
+static void get_online_performance(const char *type, uint8_t *s, uint32_t size)
+{
+    const uint32_t chunk = 4096;
+    uint32_t hints[] = { size + 1, 0 };
+    const char *names[] = { "Ukkonen", "Ukkonen-growing" };
+    for (int k = 0; k < 2; ++k) {
+        clock_t begin = clock();
+        struct online_suffix_tree *ost = alloc_online_suffix_tree(hints[k]);
+        for (uint32_t i = 0; i < size; i += chunk) {
+            uint32_t n = (size - i < chunk) ? size - i : chunk;
+            online_suffix_tree_append(ost, s + i, n);
+        }
+        struct suffix_tree *st = finish_online_suffix_tree(ost);
+        clock_t end = clock();
+        printf("%s %s %u %f\n",
+               names[k], type, size, (double)(end - begin) / CLOCKS_PER_SEC);
+        free_complete_suffix_tree(st);
+    }
+}
+
+// Memory usage, in bytes per character (not counting
+// the string). For the pointer tree we report both the
+// nodes we allocate and the nodes we use.
+static void get_memory_usage(const char *type, uint8_t *s, uint32_t size)
+{
+    struct suffix_tree *st = mccreight_suffix_tree(s);
+    uint32_t pool_size = st->length == 1 ? 2 : (2 * st->length - 1);
+    double allocated = (double)pool_size * sizeof(struct suffix_tree_node);
+    double used = (double)(st->pool.next_node - st->pool.nodes)
+        * sizeof(struct suffix_tree_node);
+    printf("Bytes-allocated %s %u %.2f\n", type, size, allocated / st->length);
+    printf("Bytes-used %s %u %.2f\n", type, size, used / st->length);
+    free_suffix_tree(st);
+
+    struct compact_suffix_tree *cst = mccreight_compact_suffix_tree(s);
+    printf("Bytes-compact %s %u %.2f\n", type, size,
+           (double)cst_bytes(cst) / cst->length);
+    free_compact_suffix_tree(cst);
+}
 
 static void get_performance(uint32_t size)
 {
@@ -77,7 +144,8 @@ static void get_performance(uint32_t size)
 
 #if EQUAL
     s = build_equal(size);
-    
+    get_compact_performance("equal", s, size);
+    get_online_performance("equal", s, size);
 
     begin = clock();
     st = mccreight_suffix_tree(s);
@@ -157,7 +225,8 @@ static void get_performance(uint32_t size)
 #if RANDOM
     if (s) free(s);
     s = build_random(size);
-    
+    get_compact_performance("random", s, size);
+    get_online_performance("random", s, size);
     
     begin = clock();
     st = mccreight_suffix_tree(s);
@@ -226,6 +295,9 @@ static void get_performance(uint32_t size)
     if (s) free(s);
     s = build_random_large(size);
     
+    get_compact_performance("random_large", s, size);
+    get_online_performance("random_large", s, size);
+
     // warmup
     east = mccreight_ea_suffix_tree(256, s);
     free_ea_suffix_tree(east);
@@ -540,6 +612,15 @@ int main(int argc, const char **argv)
     //return 0;
     
 #if PERFORMANCE
+    for (uint32_t m = 250000; m <= 1000000; m *= 2) {
+        uint8_t *s = build_random(m);
+        get_memory_usage("random", s, m);
+        free(s);
+        s = build_random_large(m);
+        get_memory_usage("random_large", s, m);
+        free(s);
+    }
+
     uint32_t n = 1000;
     for (; n < 11000; n += 1000) {
         for (int rep = 0; rep < 5; ++rep) {
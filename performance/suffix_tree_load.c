@@ -0,0 +1,97 @@
+#include <suffix_tree.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Building a suffix tree against loading one we have
+// written to disk. We use wall-clock time since reading
+// and mapping is mostly waiting for the file. Each line is
+//   NAME n time
+
+static uint8_t *build_random(uint32_t size, const char *alphabet)
+{
+    uint32_t k = (uint32_t)strlen(alphabet);
+    uint8_t *s = malloc(size + 1);
+    for (uint32_t i = 0; i < size; ++i) {
+        s[i] = alphabet[rand() % k];
+    }
+    s[size] = '\0';
+    return s;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void profile(uint32_t n, const char *fname)
+{
+    uint8_t *s = build_random(n, "ACGT");
+    enum error_codes err;
+    double begin, end;
+
+    begin = now();
+    struct suffix_tree *st = mccreight_suffix_tree(s);
+    end = now();
+    printf("Build %u %f\n", n, end - begin);
+
+    begin = now();
+    if (!write_suffix_tree_fname(fname, st, &err)) {
+        printf("Cannot write %s\n", fname);
+        exit(EXIT_FAILURE);
+    }
+    end = now();
+    printf("Write %u %f\n", n, end - begin);
+    free_suffix_tree(st);
+
+    begin = now();
+    st = read_suffix_tree_fname(fname, false, &err);
+    end = now();
+    printf("Read %u %f\n", n, end - begin);
+    free_complete_suffix_tree(st);
+
+    begin = now();
+    st = read_suffix_tree_fname(fname, true, &err);
+    end = now();
+    printf("Read-verify %u %f\n", n, end - begin);
+    free_complete_suffix_tree(st);
+
+    // Mapping is only half the story; the first search also
+    // pays for the pages it touches.
+    begin = now();
+    struct mapped_suffix_tree *mst = map_suffix_tree_fname(fname, false, &err);
+    mapped_st_search(mst, s + n / 2 - 10);
+    end = now();
+    printf("Map %u %f\n", n, end - begin);
+    unmap_suffix_tree(mst);
+
+    begin = now();
+    mst = map_suffix_tree_fname(fname, true, &err);
+    end = now();
+    printf("Map-verify %u %f\n", n, end - begin);
+    unmap_suffix_tree(mst);
+
+    free(s);
+}
+
+int main(int argc, const char **argv)
+{
+    srand(time(NULL));
+    char fname[] = "/tmp/st.XXXXXX";
+    int fd = mkstemp(fname);
+    if (fd < 0) return EXIT_FAILURE;
+    close(fd);
+
+    uint32_t sizes[] = { 100000, 500000, 1000000, 2000000 };
+    for (uint32_t k = 0; k < sizeof(sizes) / sizeof(*sizes); ++k) {
+        profile(sizes[k], fname);
+    }
+
+    remove(fname);
+    return EXIT_SUCCESS;
+}
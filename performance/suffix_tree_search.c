@@ -0,0 +1,186 @@
+#include <suffix_tree.h>
+#include <edge_array_suffix_tree.h>
+#include <remap.h>
+#include <string_utils.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Search and enumerate all occurrences of frequent patterns.
+// We compare the leaf iterators with the original iterators
+// that allocated a stack frame for every node they visited
+// (copied here as the baseline). Each line is
+//   NAME tree n m occurrences time
+
+/// MARK: Baseline -- a linked list of frames
+struct frame {
+    struct frame *next;
+    void *node;
+};
+static struct frame *push(struct frame *stack, void *node)
+{
+    struct frame *frame = malloc(sizeof(struct frame));
+    frame->node = node;
+    frame->next = stack;
+    return frame;
+}
+static struct frame *reverse_push(struct frame *stack, struct suffix_tree_node *child)
+{
+    if (child->sibling) stack = reverse_push(stack, child->sibling);
+    return push(stack, child);
+}
+
+static uint32_t frames_st_count(struct suffix_tree_node *v)
+{
+    uint32_t count = 0;
+    struct frame *stack = v ? push(0, v) : 0;
+    while (stack) {
+        struct frame *frame = stack;
+        stack = frame->next;
+        struct suffix_tree_node *node = frame->node;
+        if (node->child) stack = reverse_push(stack, node->child);
+        else count++;
+        free(frame);
+    }
+    return count;
+}
+
+static uint32_t frames_ea_count(struct ea_suffix_tree *st, struct ea_suffix_tree_node *v)
+{
+    uint32_t count = 0;
+    struct frame *stack = v ? push(0, v) : 0;
+    while (stack) {
+        struct frame *frame = stack;
+        stack = frame->next;
+        struct ea_suffix_tree_node *node = frame->node;
+        if (node->leaf_label == UINT32_MAX) { // inner node
+            for (uint32_t i = st->alphabet_size; i > 0; --i) {
+                if (node->children[i - 1])
+                    stack = push(stack, node->children[i - 1]);
+            }
+        } else {
+            count++;
+        }
+        free(frame);
+    }
+    return count;
+}
+
+/// MARK: Profiling
+static uint8_t *build_random(uint32_t size)
+{
+    uint8_t *s = malloc(size + 1);
+    for (uint32_t i = 0; i < size; ++i) {
+        s[i] = "acgt"[rand() % 4];
+    }
+    s[size] = '\0';
+    return s;
+}
+
+static double seconds(clock_t begin, clock_t end)
+{
+    return (double)(end - begin) / CLOCKS_PER_SEC;
+}
+
+static void profile(uint8_t *s, uint32_t n, uint32_t m, uint32_t no_patterns)
+{
+    uint8_t **patterns = malloc(no_patterns * sizeof(*patterns));
+    for (uint32_t i = 0; i < no_patterns; ++i)
+        patterns[i] = str_copy_n(s + rand() % (n - m), m);
+
+    clock_t begin, end;
+    uint32_t count;
+
+    struct suffix_tree *st = mccreight_suffix_tree(s);
+
+    count = 0;
+    begin = clock();
+    for (uint32_t i = 0; i < no_patterns; ++i)
+        count += frames_st_count(st_search(st, patterns[i]));
+    end = clock();
+    printf("Frames ST %u %u %u %f\n", n, m, count, seconds(begin, end));
+
+    struct st_search_iter iter;
+    struct st_search_match match;
+    count = 0;
+    begin = clock();
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        init_st_search_iter(&iter, st, patterns[i]);
+        while (next_st_match(&iter, &match))
+            count++;
+        dealloc_st_search_iter(&iter);
+    }
+    end = clock();
+    printf("Vector ST %u %u %u %f\n", n, m, count, seconds(begin, end));
+
+    count = 0;
+    begin = clock();
+    init_st_search_iter(&iter, st, (uint8_t *)"");
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        reset_st_search_iter(&iter, st, patterns[i]);
+        while (next_st_match(&iter, &match))
+            count++;
+    }
+    dealloc_st_search_iter(&iter);
+    end = clock();
+    printf("Reused ST %u %u %u %f\n", n, m, count, seconds(begin, end));
+
+    free_suffix_tree(st);
+
+    // The edge array tree wants a remapped string
+    struct remap_table remap_table;
+    init_remap_table(&remap_table, s);
+    uint8_t *x = malloc(n + 1);
+    remap(x, s, &remap_table);
+    uint8_t **remapped_patterns = malloc(no_patterns * sizeof(*patterns));
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        remapped_patterns[i] = malloc(m + 1);
+        remap(remapped_patterns[i], patterns[i], &remap_table);
+    }
+    struct ea_suffix_tree *east =
+        mccreight_ea_suffix_tree(remap_table.alphabet_size, x);
+
+    count = 0;
+    begin = clock();
+    for (uint32_t i = 0; i < no_patterns; ++i)
+        count += frames_ea_count(east, ea_st_search(east, remapped_patterns[i]));
+    end = clock();
+    printf("Frames EA %u %u %u %f\n", n, m, count, seconds(begin, end));
+
+    struct ea_st_search_iter ea_iter;
+    struct ea_st_search_match ea_match;
+    count = 0;
+    begin = clock();
+    init_ea_st_search_iter(&ea_iter, east, (uint8_t *)"");
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        reset_ea_st_search_iter(&ea_iter, east, remapped_patterns[i]);
+        while (next_ea_st_match(&ea_iter, &ea_match))
+            count++;
+    }
+    dealloc_ea_st_search_iter(&ea_iter);
+    end = clock();
+    printf("Reused EA %u %u %u %f\n", n, m, count, seconds(begin, end));
+
+    free_ea_suffix_tree(east);
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        free(patterns[i]);
+        free(remapped_patterns[i]);
+    }
+    free(patterns);
+    free(remapped_patterns);
+    free(x);
+    dealloc_remap_table(&remap_table);
+}
+
+int main(int argc, const char **argv)
+{
+    uint32_t n = 1000000;
+    uint8_t *s = build_random(n);
+    for (uint32_t m = 2; m <= 10; m += 2) {
+        profile(s, n, m, 200);
+    }
+    free(s);
+    return EXIT_SUCCESS;
+}
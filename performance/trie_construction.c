@@ -0,0 +1,120 @@
+#include <trie.h>
+#include <aho_corasick.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Building tries of many random DNA k-mers: the pointer
+// trie, the compact trie with one string at a time, and the
+// compact trie from sorted patterns. Memory is the bytes the
+// nodes take; for the pointer trie that doesn't count the
+// malloc overhead per node. Each line is
+//   NAME patterns length nodes time bytes
+
+#define PATTERN_LENGTH 31
+
+static double seconds(clock_t begin, clock_t end)
+{
+    return (double)(end - begin) / CLOCKS_PER_SEC;
+}
+
+static int cmp_strings(const void *a, const void *b)
+{
+    return strcmp(*(const char **)a, *(const char **)b);
+}
+
+static void profile(uint32_t no_patterns)
+{
+    uint8_t *buffer = malloc((size_t)no_patterns * (PATTERN_LENGTH + 1));
+    const uint8_t **patterns = malloc(no_patterns * sizeof(*patterns));
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        uint8_t *p = buffer + (size_t)i * (PATTERN_LENGTH + 1);
+        for (uint32_t k = 0; k < PATTERN_LENGTH; ++k)
+            p[k] = "acgt"[rand() % 4];
+        p[PATTERN_LENGTH] = '\0';
+        patterns[i] = p;
+    }
+    // Random 31-mers are unique for all practical purposes,
+    // but the tries insist, so we sort and remove duplicates
+    // before we start the clock.
+    qsort(patterns, no_patterns, sizeof(*patterns), cmp_strings);
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        if (n == 0 || strcmp((char *)patterns[n - 1], (char *)patterns[i]))
+            patterns[n++] = patterns[i];
+    }
+    no_patterns = n;
+    // and shuffle them again for the incremental builds
+    const uint8_t **shuffled = malloc(no_patterns * sizeof(*shuffled));
+    memcpy(shuffled, patterns, no_patterns * sizeof(*shuffled));
+    for (uint32_t i = no_patterns; i > 1; --i) {
+        uint32_t j = rand() % i;
+        const uint8_t *tmp = shuffled[i - 1];
+        shuffled[i - 1] = shuffled[j];
+        shuffled[j] = tmp;
+    }
+
+    clock_t begin, end;
+
+    begin = clock();
+    struct compact_trie *incremental = alloc_compact_trie();
+    for (uint32_t i = 0; i < no_patterns; ++i)
+        add_string_to_compact_trie(incremental, shuffled[i], (int)i);
+    end = clock();
+    uint32_t no_nodes = incremental->no_nodes;
+    printf("Compact %u %u %u %f %zu\n", no_patterns, PATTERN_LENGTH,
+           no_nodes, seconds(begin, end), compact_trie_memory(incremental));
+    free_compact_trie(incremental);
+
+    begin = clock();
+    struct trie *trie = alloc_trie();
+    for (uint32_t i = 0; i < no_patterns; ++i)
+        add_string_to_trie(trie, shuffled[i], (int)i);
+    end = clock();
+    printf("Pointer %u %u %u %f %zu\n", no_patterns, PATTERN_LENGTH,
+           no_nodes, seconds(begin, end), (size_t)no_nodes * sizeof(struct trie));
+    begin = clock();
+    free_trie(trie);
+    end = clock();
+    printf("Pointer-free %u %u %u %f 0\n", no_patterns, PATTERN_LENGTH,
+           no_nodes, seconds(begin, end));
+
+    // Sorting is part of what you pay for the bulk build,
+    // if your patterns don't come sorted.
+    begin = clock();
+    qsort(shuffled, no_patterns, sizeof(*shuffled), cmp_strings);
+    end = clock();
+    printf("Sort %u %u %u %f 0\n", no_patterns, PATTERN_LENGTH,
+           no_nodes, seconds(begin, end));
+
+    begin = clock();
+    struct compact_trie *bulk = build_compact_trie(shuffled, no_patterns);
+    end = clock();
+    printf("Bulk %u %u %u %f %zu\n", no_patterns, PATTERN_LENGTH,
+           bulk->no_nodes, seconds(begin, end), compact_trie_memory(bulk));
+
+    begin = clock();
+    struct ac_automaton *ac =
+        alloc_ac_automaton_from_compact_trie(bulk, AC_AUTO_LAYOUT);
+    end = clock();
+    printf("Automaton %u %u %u %f %zu\n", no_patterns, PATTERN_LENGTH,
+           ac->no_states, seconds(begin, end),
+           (size_t)ac->no_states * ac->alphabet_size * sizeof(uint32_t));
+    free_ac_automaton(ac);
+
+    free_compact_trie(bulk);
+    free(shuffled);
+    free(patterns);
+    free(buffer);
+}
+
+int main(int argc, const char **argv)
+{
+    srand(1);
+    uint32_t sizes[] = { 10000, 100000, 1000000 };
+    for (uint32_t i = 0; i < sizeof(sizes) / sizeof(*sizes); ++i)
+        profile(sizes[i]);
+    return EXIT_SUCCESS;
+}
@@ -2,6 +2,10 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <string.h>
 
 
 
@@ -103,42 +107,978 @@ bool next_ac_match(
     assert(iter);
     assert(match);
     
-    if (iter->hits) {
-        match->string_label = iter->hits->string_label;
-        // For the index here, we shouldn't add one as in the direct loop.
-        // We have already increased j by one before we get here.
-        match->index = iter->j - iter->pattern_lengths[match->string_label];
-        iter->hits = iter->hits->next;
-        return true;
-    }
-    
-    if (iter->nested) {
-        iter->w = out_link(iter->v, iter->x[iter->j]);
-        if (iter->w) {
-            iter->hits = iter->w->output;
-            iter->v = iter->w;
-            iter->j++;
-            iter->w = out_link(iter->v, iter->x[iter->j]);
-            return next_ac_match(iter, match);
-        } else {
+    // We loop until we have a hit or run out of text, so
+    // long texts without hits don't grow the stack.
+    for (;;) {
+        if (iter->hits) {
+            match->string_label = iter->hits->string_label;
+            // For the index here, we shouldn't add one as in the direct loop.
+            // We have already increased j by one before we get here.
+            match->index = iter->j - iter->pattern_lengths[match->string_label];
+            iter->hits = iter->hits->next;
+            return true;
+        }
+
+        if (iter->nested) {
+            iter->w = (iter->j < iter->n) ? out_link(iter->v, iter->x[iter->j]) : 0;
+            if (iter->w) {
+                iter->hits = iter->w->output;
+                iter->v = iter->w;
+                iter->j++;
+                continue;
+            }
             iter->nested = false;
         }
-    }
-    
-    if (iter->j < iter->n) {
+
+        if (iter->j >= iter->n) return false;
+
         if (is_trie_root(iter->v)) {
             iter->j++;
         } else {
             iter->v = iter->v->failure_link;
         }
         iter->nested = true;
-        return next_ac_match(iter, match);
     }
-    
-    return false;
 }
 
 void dealloc_ac_iter(struct ac_iter *iter)
 {
     // nop
 }
+
+
+/// MARK: Compiled automaton
+
+// In the sparse layout, edge e goes to state e + 1. The
+// states are in breadth first order and the children of a
+// state are consecutive, so the edges out of state s are
+// the states from edge_start[s] + 1 to edge_start[s + 1] + 1.
+static inline uint32_t with_output_flag(
+    const struct ac_automaton *ac,
+    uint32_t s
+) {
+    bool output = ac->output_start[s + 1] > ac->output_start[s];
+    return output ? (s | AC_OUTPUT_FLAG) : s;
+}
+
+static uint32_t sparse_step(
+    const struct ac_automaton *ac,
+    uint32_t s,
+    uint8_t c
+) {
+    for (;;) {
+        if (s == 0) return ac->transitions[c];
+        uint32_t end = ac->edge_start[s + 1];
+        for (uint32_t e = ac->edge_start[s]; e < end; ++e) {
+            if (ac->edge_class[e] == c)
+                return with_output_flag(ac, e + 1);
+            if (ac->edge_class[e] > c)
+                break;
+        }
+        s = ac->failure[s];
+    }
+}
+
+static inline uint32_t ac_step(
+    const struct ac_automaton *ac,
+    uint32_t s,
+    uint8_t c
+) {
+    if (ac->dense)
+        return ac->transitions[(size_t)s * ac->alphabet_size + c];
+    return sparse_step(ac, s, c);
+}
+
+// Breadth first order of a trie, with the children of each
+// node consecutive and sorted by their labels. We record where
+// the children of each node start in child_start. This is
+// all we need from the trie, so we can compile both kinds.
+struct bfs_order {
+    uint32_t no_nodes;
+    uint32_t size;
+    uint8_t *in_edge_label;
+    int *string_label;
+    uint32_t *child_start;
+};
+
+static void init_bfs_order(
+    struct bfs_order *order
+) {
+    order->no_nodes = 0;
+    order->size = 256;
+    order->in_edge_label = malloc(order->size * sizeof(*order->in_edge_label));
+    order->string_label = malloc(order->size * sizeof(*order->string_label));
+    order->child_start = malloc((order->size + 1) * sizeof(*order->child_start));
+}
+
+static void dealloc_bfs_order(
+    struct bfs_order *order
+) {
+    free(order->in_edge_label);
+    free(order->string_label);
+    free(order->child_start);
+}
+
+// Makes room for one more node and returns the number of
+// nodes we have room for, so the caller can grow its own
+// arrays along with ours.
+static uint32_t reserve_bfs_node(
+    struct bfs_order *order
+) {
+    if (order->no_nodes == order->size) {
+        order->size *= 2;
+        order->in_edge_label = realloc(order->in_edge_label,
+            order->size * sizeof(*order->in_edge_label));
+        order->string_label = realloc(order->string_label,
+            order->size * sizeof(*order->string_label));
+        order->child_start = realloc(order->child_start,
+            (order->size + 1) * sizeof(*order->child_start));
+    }
+    return order->size;
+}
+
+static void bfs_trie_order(
+    const struct trie *trie,
+    struct bfs_order *order
+) {
+    init_bfs_order(order);
+    uint32_t size = order->size, n = 0;
+    const struct trie **nodes = malloc(size * sizeof(*nodes));
+    nodes[n++] = trie;
+    order->no_nodes = 1;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t start = order->child_start[i] = n;
+        for (const struct trie *w = nodes[i]->children; w; w = w->sibling) {
+            if (reserve_bfs_node(order) != size) {
+                size = order->size;
+                nodes = realloc(nodes, size * sizeof(*nodes));
+            }
+            // insertion sort on the labels
+            uint32_t k = n++;
+            order->no_nodes = n;
+            while (k > start && nodes[k - 1]->in_edge_label > w->in_edge_label) {
+                nodes[k] = nodes[k - 1];
+                k--;
+            }
+            nodes[k] = w;
+        }
+    }
+    order->child_start[n] = n;
+    for (uint32_t i = 0; i < n; ++i) {
+        order->in_edge_label[i] = nodes[i]->in_edge_label;
+        order->string_label[i] = nodes[i]->string_label;
+    }
+    free(nodes);
+}
+
+static void bfs_compact_trie_order(
+    const struct compact_trie *trie,
+    struct bfs_order *order
+) {
+    init_bfs_order(order);
+    uint32_t size = order->size, n = 0;
+    uint32_t *nodes = malloc(size * sizeof(*nodes));
+    nodes[n++] = 0;
+    order->no_nodes = 1;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t start = order->child_start[i] = n;
+        uint32_t v = nodes[i];
+        for (uint32_t w = trie->children[v]; w != TRIE_NO_NODE; w = trie->sibling[w]) {
+            if (reserve_bfs_node(order) != size) {
+                size = order->size;
+                nodes = realloc(nodes, size * sizeof(*nodes));
+            }
+            // the bulk builder gives us sorted children,
+            // so this only moves nodes for the other tries.
+            uint32_t k = n++;
+            order->no_nodes = n;
+            uint8_t a = trie->in_edge_label[w];
+            while (k > start && trie->in_edge_label[nodes[k - 1]] > a) {
+                nodes[k] = nodes[k - 1];
+                k--;
+            }
+            nodes[k] = w;
+        }
+    }
+    order->child_start[n] = n;
+    for (uint32_t i = 0; i < n; ++i) {
+        order->in_edge_label[i] = trie->in_edge_label[nodes[i]];
+        order->string_label[i] = trie->string_label[nodes[i]];
+    }
+    free(nodes);
+}
+
+static struct ac_automaton *compile_ac_automaton(
+    const struct bfs_order *order,
+    enum ac_layout layout
+) {
+    uint32_t n = order->no_nodes;
+    const uint32_t *child_start = order->child_start;
+    const uint8_t *in_edge_label = order->in_edge_label;
+    const int *string_label = order->string_label;
+    assert(n < AC_OUTPUT_FLAG);
+
+    struct ac_automaton *ac = malloc(sizeof(struct ac_automaton));
+    ac->no_states = n;
+    ac->map = 0;
+
+    bool used[256] = { false };
+    for (uint32_t s = 1; s < n; ++s)
+        used[in_edge_label[s]] = true;
+    uint32_t k = 1;
+    for (uint32_t a = 0; a < 256; ++a)
+        ac->classes[a] = used[a] ? (uint8_t)k++ : 0;
+    ac->alphabet_size = k;
+
+    switch (layout) {
+        case AC_DENSE_LAYOUT:  ac->dense = true; break;
+        case AC_SPARSE_LAYOUT: ac->dense = false; break;
+        case AC_AUTO_LAYOUT:
+            ac->dense = (size_t)n * k <= AC_DENSE_LIMIT;
+            break;
+    }
+
+    size_t no_transitions = ac->dense ? (size_t)n * k : k;
+    ac->transitions = calloc(no_transitions, sizeof(*ac->transitions));
+    ac->failure = malloc(n * sizeof(*ac->failure));
+    uint32_t *depth = malloc(n * sizeof(*depth));
+    uint32_t *no_outputs = malloc(n * sizeof(*no_outputs));
+    if (ac->dense) {
+        ac->edge_start = 0;
+        ac->edge_class = 0;
+    } else {
+        ac->edge_start = malloc((n + 1) * sizeof(*ac->edge_start));
+        ac->edge_class = malloc(n * sizeof(*ac->edge_class));
+        for (uint32_t s = 0; s <= n; ++s)
+            ac->edge_start[s] = child_start[s] - 1;
+        for (uint32_t s = 1; s < n; ++s)
+            ac->edge_class[s - 1] = ac->classes[in_edge_label[s]];
+    }
+    // We need the output flags while we build the transitions,
+    // so output_start holds the counts until we are done.
+    ac->output_start = calloc(n + 1, sizeof(*ac->output_start));
+
+    ac->failure[0] = 0;
+    depth[0] = 0;
+    no_outputs[0] = 0;
+    for (uint32_t s = 0; s < n; ++s) {
+        uint32_t *row = ac->dense ? ac->transitions + (size_t)s * k : 0;
+        if (ac->dense && s > 0) {
+            const uint32_t *fail_row = ac->transitions + (size_t)ac->failure[s] * k;
+            memcpy(row, fail_row, k * sizeof(*row));
+        }
+        for (uint32_t t = child_start[s]; t < child_start[s + 1]; ++t) {
+            uint8_t c = ac->classes[in_edge_label[t]];
+            // The failure state is shallower than t, so we have
+            // all its transitions already. The output flags are
+            // not right yet in the sparse layout, but we don't
+            // need them here.
+            uint32_t f = 0;
+            if (s > 0) f = AC_STATE(ac_step(ac, ac->failure[s], c));
+            ac->failure[t] = f;
+            depth[t] = depth[s] + 1;
+            no_outputs[t] = (string_label[t] >= 0) + no_outputs[f];
+            ac->output_start[t + 1] = no_outputs[t];
+
+            uint32_t target = no_outputs[t] ? (t | AC_OUTPUT_FLAG) : t;
+            if (ac->dense) row[c] = target;
+            else if (s == 0) ac->transitions[c] = target;
+        }
+    }
+
+    for (uint32_t s = 0; s < n; ++s)
+        ac->output_start[s + 1] += ac->output_start[s];
+    uint32_t total = ac->output_start[n];
+    ac->outputs = malloc((total ? total : 1) * sizeof(*ac->outputs));
+    ac->max_length = 0;
+    for (uint32_t s = 1; s < n; ++s) {
+        struct ac_output *out = ac->outputs + ac->output_start[s];
+        if (string_label[s] >= 0) {
+            out->string_label = string_label[s];
+            out->length = depth[s];
+            if (depth[s] > ac->max_length) ac->max_length = depth[s];
+            out++;
+        }
+        uint32_t f = ac->failure[s];
+        memcpy(out, ac->outputs + ac->output_start[f],
+               no_outputs[f] * sizeof(*out));
+    }
+
+    if (ac->dense) {
+        // We only need failure links to fill the table.
+        free(ac->failure);
+        ac->failure = 0;
+    }
+    free(no_outputs);
+    free(depth);
+    return ac;
+}
+
+struct ac_automaton *alloc_ac_automaton(
+    const struct trie *patterns_trie,
+    enum ac_layout layout
+) {
+    struct bfs_order order;
+    bfs_trie_order(patterns_trie, &order);
+    struct ac_automaton *ac = compile_ac_automaton(&order, layout);
+    dealloc_bfs_order(&order);
+    return ac;
+}
+
+struct ac_automaton *alloc_ac_automaton_from_compact_trie(
+    const struct compact_trie *patterns_trie,
+    enum ac_layout layout
+) {
+    struct bfs_order order;
+    bfs_compact_trie_order(patterns_trie, &order);
+    struct ac_automaton *ac = compile_ac_automaton(&order, layout);
+    dealloc_bfs_order(&order);
+    return ac;
+}
+
+void free_ac_automaton(
+    struct ac_automaton *ac
+) {
+    if (ac->map) {
+        // the arrays are in the mapping
+        unmap_container(ac->map);
+        free(ac->map);
+        free(ac);
+        return;
+    }
+    free(ac->transitions);
+    free(ac->failure);
+    free(ac->edge_start);
+    free(ac->edge_class);
+    free(ac->output_start);
+    free(ac->outputs);
+    free(ac);
+}
+
+void init_ac_automaton_iter(
+    struct ac_automaton_iter *iter,
+    const struct ac_automaton *ac,
+    const uint8_t *x,
+    uint32_t n
+) {
+    iter->ac = ac;
+    iter->x = x;
+    iter->n = n;
+    iter->j = 0;
+    iter->state = 0;
+    iter->out = iter->out_end = 0;
+}
+
+// Scan until we hit a state with output and set the output
+// range. We keep the state in locals so they can live in
+// registers. Returns false if we reach the end of the text.
+static inline bool scan_to_output(
+    struct ac_automaton_iter *iter
+) {
+    const struct ac_automaton *ac = iter->ac;
+    const uint8_t *x = iter->x;
+    const uint8_t *classes = ac->classes;
+    uint32_t j = iter->j, n = iter->n;
+    uint32_t s = iter->state;
+    if (ac->dense) {
+        const uint32_t *trans = ac->transitions;
+        uint32_t k = ac->alphabet_size;
+        while (j < n) {
+            s = trans[(size_t)s * k + classes[x[j++]]];
+            if (s & AC_OUTPUT_FLAG) break;
+        }
+    } else {
+        while (j < n) {
+            s = sparse_step(ac, s, classes[x[j++]]);
+            if (s & AC_OUTPUT_FLAG) break;
+        }
+    }
+    iter->j = j;
+    iter->state = AC_STATE(s);
+    if (!(s & AC_OUTPUT_FLAG)) return false;
+    iter->out = ac->outputs + ac->output_start[iter->state];
+    iter->out_end = ac->outputs + ac->output_start[iter->state + 1];
+    return true;
+}
+
+bool next_ac_automaton_match(
+    struct ac_automaton_iter *iter,
+    struct ac_match *match
+) {
+    if (iter->out == iter->out_end && !scan_to_output(iter))
+        return false;
+    match->string_label = iter->out->string_label;
+    match->index = iter->j - iter->out->length;
+    iter->out++;
+    return true;
+}
+
+uint32_t next_ac_automaton_matches(
+    struct ac_automaton_iter *iter,
+    struct ac_match *matches,
+    uint32_t max_matches
+) {
+    uint32_t no_matches = 0;
+    while (no_matches < max_matches) {
+        if (iter->out == iter->out_end && !scan_to_output(iter))
+            break;
+        uint32_t j = iter->j;
+        const struct ac_output *out = iter->out;
+        const struct ac_output *end = iter->out_end;
+        for (; out != end && no_matches < max_matches; ++out) {
+            matches[no_matches].string_label = out->string_label;
+            matches[no_matches].index = j - out->length;
+            no_matches++;
+        }
+        iter->out = out;
+    }
+    return no_matches;
+}
+
+void dealloc_ac_automaton_iter(
+    struct ac_automaton_iter *iter
+) {
+    // nop
+}
+
+static inline void report_outputs(
+    const struct ac_automaton *ac,
+    uint32_t s,
+    uint32_t j,
+    void (*callback)(const struct ac_match *match, void *data),
+    void *data
+) {
+    const struct ac_output *out = ac->outputs + ac->output_start[s];
+    const struct ac_output *end = ac->outputs + ac->output_start[s + 1];
+    struct ac_match match;
+    for (; out != end; ++out) {
+        match.string_label = out->string_label;
+        match.index = j - out->length;
+        callback(&match, data);
+    }
+}
+
+void ac_automaton_scan(
+    const struct ac_automaton *ac,
+    const uint8_t *x,
+    uint32_t n,
+    void (*callback)(const struct ac_match *match, void *data),
+    void *data
+) {
+    const uint8_t *classes = ac->classes;
+    uint32_t s = 0;
+    if (ac->dense) {
+        const uint32_t *trans = ac->transitions;
+        uint32_t k = ac->alphabet_size;
+        for (uint32_t j = 0; j < n; ++j) {
+            s = trans[(size_t)AC_STATE(s) * k + classes[x[j]]];
+            if (s & AC_OUTPUT_FLAG)
+                report_outputs(ac, AC_STATE(s), j + 1, callback, data);
+        }
+    } else {
+        for (uint32_t j = 0; j < n; ++j) {
+            s = sparse_step(ac, AC_STATE(s), classes[x[j]]);
+            if (s & AC_OUTPUT_FLAG)
+                report_outputs(ac, AC_STATE(s), j + 1, callback, data);
+        }
+    }
+}
+
+/// MARK: Serialisation
+
+#define AC_HEADER_TAG  CONTAINER_TAG('A','C','H','D')
+#define AC_CLASSES_TAG CONTAINER_TAG('A','C','C','L')
+
+struct ac_file_header {
+    uint32_t no_states;
+    uint32_t alphabet_size;
+    uint32_t max_length;
+    uint32_t dense;
+    uint32_t no_outputs;
+    uint32_t reserved[3];
+};
+
+// The arrays, in the order we write them. The sparse layout
+// has all of them; the dense only the transitions and the
+// outputs.
+enum ac_file_array {
+    AC_TRANSITIONS,
+    AC_FAILURE,
+    AC_EDGE_START,
+    AC_EDGE_CLASS,
+    AC_OUTPUT_START,
+    AC_OUTPUTS,
+    AC_NO_ARRAYS
+};
+static const uint32_t ac_array_tags[AC_NO_ARRAYS] = {
+    CONTAINER_TAG('A','C','T','R'),
+    CONTAINER_TAG('A','C','F','L'),
+    CONTAINER_TAG('A','C','E','S'),
+    CONTAINER_TAG('A','C','E','C'),
+    CONTAINER_TAG('A','C','O','S'),
+    CONTAINER_TAG('A','C','O','U')
+};
+
+// The size of each array in bytes. Zero means that we don't
+// write the array.
+static void ac_array_sizes(
+    const struct ac_file_header *header,
+    uint64_t sizes[AC_NO_ARRAYS]
+) {
+    uint64_t n = header->no_states;
+    uint64_t k = header->alphabet_size;
+    bool sparse = !header->dense;
+    sizes[AC_TRANSITIONS] = (header->dense ? n * k : k) * sizeof(uint32_t);
+    sizes[AC_FAILURE] = sparse ? n * sizeof(uint32_t) : 0;
+    sizes[AC_EDGE_START] = sparse ? (n + 1) * sizeof(uint32_t) : 0;
+    sizes[AC_EDGE_CLASS] = sparse ? (n - 1) * sizeof(uint8_t) : 0;
+    sizes[AC_OUTPUT_START] = (n + 1) * sizeof(uint32_t);
+    sizes[AC_OUTPUTS] = header->no_outputs * sizeof(struct ac_output);
+}
+
+static const void *get_ac_array(
+    const struct ac_automaton *ac,
+    enum ac_file_array a
+) {
+    switch (a) {
+        case AC_TRANSITIONS:  return ac->transitions;
+        case AC_FAILURE:      return ac->failure;
+        case AC_EDGE_START:   return ac->edge_start;
+        case AC_EDGE_CLASS:   return ac->edge_class;
+        case AC_OUTPUT_START: return ac->output_start;
+        case AC_OUTPUTS:      return ac->outputs;
+        default:              return 0;
+    }
+}
+
+// When we map a file, data points into the read-only
+// mapping, but we never write to the arrays.
+static void set_ac_array(
+    struct ac_automaton *ac,
+    enum ac_file_array a,
+    const void *data
+) {
+    switch (a) {
+        case AC_TRANSITIONS:  ac->transitions = (uint32_t *)data; break;
+        case AC_FAILURE:      ac->failure = (uint32_t *)data; break;
+        case AC_EDGE_START:   ac->edge_start = (uint32_t *)data; break;
+        case AC_EDGE_CLASS:   ac->edge_class = (uint8_t *)data; break;
+        case AC_OUTPUT_START: ac->output_start = (uint32_t *)data; break;
+        case AC_OUTPUTS:      ac->outputs = (struct ac_output *)data; break;
+        default: break;
+    }
+}
+
+static bool valid_ac_file_header(
+    const struct ac_file_header *header
+) {
+    return header->no_states > 0
+        && header->no_states < AC_OUTPUT_FLAG
+        && header->alphabet_size > 0
+        && header->alphabet_size <= 256
+        && header->dense <= 1;
+}
+
+static bool valid_ac_transition(
+    const struct ac_automaton *ac,
+    uint32_t t
+) {
+    uint32_t s = AC_STATE(t);
+    if (s >= ac->no_states) return false;
+    bool output = ac->output_start[s + 1] > ac->output_start[s];
+    return output == ((t & AC_OUTPUT_FLAG) != 0);
+}
+
+// Checks that the scans stay inside the arrays and that the
+// sparse layout's failure links always get us closer to the
+// root. We don't check that this is the automaton for any
+// particular patterns.
+static bool valid_ac_automaton(
+    const struct ac_automaton *ac,
+    uint32_t no_outputs
+) {
+    uint32_t n = ac->no_states, k = ac->alphabet_size;
+    for (uint32_t a = 0; a < 256; ++a)
+        if (ac->classes[a] >= k) return false;
+
+    if (ac->output_start[0] != 0 || ac->output_start[n] != no_outputs)
+        return false;
+    for (uint32_t s = 0; s < n; ++s)
+        if (ac->output_start[s] > ac->output_start[s + 1]) return false;
+    for (uint32_t i = 0; i < no_outputs; ++i) {
+        uint32_t length = ac->outputs[i].length;
+        if (length == 0 || length > ac->max_length) return false;
+    }
+
+    size_t no_transitions = ac->dense ? (size_t)n * k : k;
+    for (size_t i = 0; i < no_transitions; ++i)
+        if (!valid_ac_transition(ac, ac->transitions[i])) return false;
+
+    if (!ac->dense) {
+        if (ac->failure[0] != 0) return false;
+        for (uint32_t s = 1; s < n; ++s)
+            if (ac->failure[s] >= s) return false;
+        if (ac->edge_start[0] != 0 || ac->edge_start[n] != n - 1)
+            return false;
+        for (uint32_t s = 0; s < n; ++s)
+            if (ac->edge_start[s] > ac->edge_start[s + 1]) return false;
+        for (uint32_t e = 0; e + 1 < n; ++e)
+            if (ac->edge_class[e] >= k) return false;
+    }
+    return true;
+}
+
+bool write_ac_automaton(
+    FILE *f,
+    const struct ac_automaton *ac,
+    enum error_codes *err
+) {
+    struct ac_file_header header;
+    memset(&header, 0, sizeof(header));
+    header.no_states = ac->no_states;
+    header.alphabet_size = ac->alphabet_size;
+    header.max_length = ac->max_length;
+    header.dense = ac->dense;
+    header.no_outputs = ac->output_start[ac->no_states];
+
+    uint64_t sizes[AC_NO_ARRAYS];
+    ac_array_sizes(&header, sizes);
+
+    struct container_writer w;
+    init_container_writer(&w, f, AC_AUTOMATON_KIND);
+    write_container_section(&w, AC_HEADER_TAG, &header, sizeof(header));
+    write_container_section(&w, AC_CLASSES_TAG, ac->classes, sizeof(ac->classes));
+    for (uint32_t a = 0; a < AC_NO_ARRAYS; ++a) {
+        if (sizes[a] == 0) continue;
+        write_container_section(&w, ac_array_tags[a], get_ac_array(ac, a), sizes[a]);
+    }
+    return finish_container(&w, err);
+}
+
+bool write_ac_automaton_fname(
+    const char *fname,
+    const struct ac_automaton *ac,
+    enum error_codes *err
+) {
+    FILE *f = fopen(fname, "wb");
+    if (!f) {
+        if (err) *err = CANNOT_OPEN_FILE;
+        return false;
+    }
+    bool ok = write_ac_automaton(f, ac, err);
+    if (fclose(f) != 0 && ok) {
+        if (err) *err = CANNOT_WRITE_FILE;
+        ok = false;
+    }
+    return ok;
+}
+
+static struct ac_automaton *
+new_ac_automaton_from_header(
+    const struct ac_file_header *header
+) {
+    struct ac_automaton *ac = calloc(1, sizeof(struct ac_automaton));
+    ac->no_states = header->no_states;
+    ac->alphabet_size = header->alphabet_size;
+    ac->max_length = header->max_length;
+    ac->dense = header->dense;
+    return ac;
+}
+
+struct ac_automaton *
+read_ac_automaton(
+    FILE *f,
+    bool verify,
+    enum error_codes *err
+) {
+    struct container_reader r;
+    struct ac_file_header header;
+    struct ac_automaton *ac = 0;
+
+    if (!init_container_reader(&r, f, AC_AUTOMATON_KIND, verify))
+        goto done;
+    if (!read_container_section(&r, AC_HEADER_TAG, &header, sizeof(header)))
+        goto done;
+    if (!valid_ac_file_header(&header)) {
+        r.error = MALFORMED_FILE;
+        goto done;
+    }
+    ac = new_ac_automaton_from_header(&header);
+    if (!read_container_section(&r, AC_CLASSES_TAG, ac->classes, sizeof(ac->classes)))
+        goto done;
+    uint64_t sizes[AC_NO_ARRAYS];
+    ac_array_sizes(&header, sizes);
+    for (uint32_t a = 0; a < AC_NO_ARRAYS; ++a) {
+        if (sizes[a] == 0) continue;
+        uint64_t size;
+        void *data = read_container_section_alloc(&r, ac_array_tags[a], &size);
+        set_ac_array(ac, a, data);
+        if (!data) goto done;
+        if (size != sizes[a]) {
+            r.error = MALFORMED_FILE;
+            goto done;
+        }
+    }
+    if (!valid_ac_automaton(ac, header.no_outputs)) {
+        r.error = MALFORMED_FILE;
+        goto done;
+    }
+
+done:
+    if (!finish_container_reader(&r, err)) {
+        if (ac) free_ac_automaton(ac);
+        return 0;
+    }
+    return ac;
+}
+
+struct ac_automaton *
+read_ac_automaton_fname(
+    const char *fname,
+    bool verify,
+    enum error_codes *err
+) {
+    FILE *f = fopen(fname, "rb");
+    if (!f) {
+        if (err) *err = CANNOT_OPEN_FILE;
+        return 0;
+    }
+    struct ac_automaton *ac = read_ac_automaton(f, verify, err);
+    fclose(f);
+    return ac;
+}
+
+struct ac_automaton *
+map_ac_automaton_fname(
+    const char *fname,
+    bool verify,
+    enum error_codes *err
+) {
+    struct container_map *map = malloc(sizeof(struct container_map));
+    if (!map_container_fname(map, fname, AC_AUTOMATON_KIND, verify, err)) {
+        free(map);
+        return 0;
+    }
+
+    uint64_t header_size, classes_size;
+    const struct ac_file_header *header =
+        container_map_section(map, AC_HEADER_TAG, &header_size);
+    const uint8_t *classes = container_map_section(map, AC_CLASSES_TAG, &classes_size);
+    bool ok = header && classes
+        && header_size == sizeof(*header)
+        && classes_size == 256
+        && valid_ac_file_header(header);
+
+    struct ac_automaton *ac = 0;
+    if (ok) {
+        ac = new_ac_automaton_from_header(header);
+        ac->map = map;
+        // the classes are small, so we might as well copy them
+        memcpy(ac->classes, classes, 256);
+        uint64_t sizes[AC_NO_ARRAYS];
+        ac_array_sizes(header, sizes);
+        for (uint32_t a = 0; ok && a < AC_NO_ARRAYS; ++a) {
+            if (sizes[a] == 0) continue;
+            uint64_t size;
+            const void *data = container_map_section(map, ac_array_tags[a], &size);
+            ok = data && size == sizes[a];
+            set_ac_array(ac, a, data);
+        }
+    }
+    if (ok && verify)
+        ok = valid_ac_automaton(ac, header->no_outputs);
+    if (!ok) {
+        if (err) *err = MALFORMED_FILE;
+        if (ac) {
+            free_ac_automaton(ac); // this unmaps as well
+        } else {
+            unmap_container(map);
+            free(map);
+        }
+        return 0;
+    }
+    return ac;
+}
+
+
+/// MARK: Streaming
+
+void init_ac_stream(
+    struct ac_stream *stream,
+    const struct ac_automaton *ac
+) {
+    init_ac_automaton_iter(&stream->iter, ac, 0, 0);
+    stream->offset = 0;
+}
+
+void reset_ac_stream(
+    struct ac_stream *stream
+) {
+    init_ac_automaton_iter(&stream->iter, stream->iter.ac, 0, 0);
+    stream->offset = 0;
+}
+
+void feed_ac_stream(
+    struct ac_stream *stream,
+    const uint8_t *x,
+    uint32_t n
+) {
+    struct ac_automaton_iter *iter = &stream->iter;
+    assert(iter->j == iter->n && iter->out == iter->out_end);
+    stream->offset += iter->n;
+    iter->x = x;
+    iter->n = n;
+    iter->j = 0;
+}
+
+bool next_ac_stream_match(
+    struct ac_stream *stream,
+    struct ac_stream_match *match
+) {
+    struct ac_automaton_iter *iter = &stream->iter;
+    if (iter->out == iter->out_end && !scan_to_output(iter))
+        return false;
+    match->string_label = iter->out->string_label;
+    // The match can start in an earlier chunk, so we
+    // must add the offset before we subtract the length.
+    match->index = stream->offset + iter->j - iter->out->length;
+    iter->out++;
+    return true;
+}
+
+void dealloc_ac_stream(
+    struct ac_stream *stream
+) {
+    dealloc_ac_automaton_iter(&stream->iter);
+}
+
+/// MARK: Parallel scan
+
+struct ac_piece {
+    uint32_t no_matches;
+    uint32_t size;
+    struct ac_match *matches;
+};
+
+struct ac_scan_data {
+    const struct ac_automaton *ac;
+    const uint8_t *x;
+    uint32_t n;
+    uint32_t piece_length;
+    uint32_t no_pieces;
+    struct ac_piece *pieces;
+    atomic_uint next_piece;
+};
+
+static void scan_piece(
+    struct ac_scan_data *data,
+    uint32_t p
+) {
+    uint32_t start = p * data->piece_length;
+    uint32_t end = start + data->piece_length;
+    if (end > data->n || p == data->no_pieces - 1) end = data->n;
+    uint32_t overlap = data->ac->max_length ? data->ac->max_length - 1 : 0;
+    uint32_t warmup = start > overlap ? start - overlap : 0;
+
+    // Get the state right before the piece. The matches we
+    // see here end before the piece, so they belong to the
+    // piece before us.
+    struct ac_automaton_iter iter;
+    struct ac_match match;
+    init_ac_automaton_iter(&iter, data->ac, data->x, start);
+    iter.j = warmup;
+    while (next_ac_automaton_match(&iter, &match))
+        ;
+
+    struct ac_piece *piece = &data->pieces[p];
+    piece->no_matches = 0;
+    piece->size = 1024;
+    piece->matches = malloc(piece->size * sizeof(*piece->matches));
+    iter.n = end;
+    for (;;) {
+        if (piece->no_matches == piece->size) {
+            piece->size *= 2;
+            piece->matches = realloc(piece->matches,
+                                     piece->size * sizeof(*piece->matches));
+        }
+        uint32_t got = next_ac_automaton_matches(
+            &iter,
+            piece->matches + piece->no_matches,
+            piece->size - piece->no_matches
+        );
+        if (got == 0) break;
+        piece->no_matches += got;
+    }
+    dealloc_ac_automaton_iter(&iter);
+}
+
+static void *ac_scan_worker(void *arg)
+{
+    struct ac_scan_data *data = arg;
+    for (;;) {
+        uint32_t p = atomic_fetch_add(&data->next_piece, 1);
+        if (p >= data->no_pieces) break;
+        scan_piece(data, p);
+    }
+    return 0;
+}
+
+struct ac_match *
+parallel_ac_scan(
+    const struct ac_automaton *ac,
+    const uint8_t *x,
+    uint32_t n,
+    uint32_t no_threads,
+    uint32_t *no_matches
+) {
+    // A few pieces per thread evens out the load if some
+    // parts of the text have many more hits than others.
+    uint32_t no_pieces = 1;
+    if (no_threads >= 2 && n >= PARALLEL_AC_MIN_LENGTH)
+        no_pieces = 4 * no_threads;
+
+    struct ac_scan_data data = {
+        .ac = ac, .x = x, .n = n,
+        .piece_length = n / no_pieces,
+        .no_pieces = no_pieces
+    };
+    data.pieces = malloc(no_pieces * sizeof(*data.pieces));
+    atomic_init(&data.next_piece, 0);
+
+    uint32_t no_started = 0;
+    pthread_t *threads = 0;
+    if (no_pieces > 1) {
+        threads = malloc(no_threads * sizeof(*threads));
+        for (; no_started < no_threads; ++no_started) {
+            if (pthread_create(&threads[no_started], 0, ac_scan_worker, &data))
+                break;
+        }
+    }
+    // If we couldn't start any threads we do the work here.
+    if (no_started == 0) ac_scan_worker(&data);
+    for (uint32_t i = 0; i < no_started; ++i)
+        pthread_join(threads[i], 0);
+    free(threads);
+
+    if (no_pieces == 1) {
+        *no_matches = data.pieces[0].no_matches;
+        struct ac_match *matches = data.pieces[0].matches;
+        free(data.pieces);
+        return matches;
+    }
+
+    uint32_t total = 0;
+    for (uint32_t p = 0; p < no_pieces; ++p)
+        total += data.pieces[p].no_matches;
+    struct ac_match *matches = malloc((total ? total : 1) * sizeof(*matches));
+    struct ac_match *next = matches;
+    for (uint32_t p = 0; p < no_pieces; ++p) {
+        memcpy(next, data.pieces[p].matches,
+               data.pieces[p].no_matches * sizeof(*next));
+        next += data.pieces[p].no_matches;
+        free(data.pieces[p].matches);
+    }
+    free(data.pieces);
+    *no_matches = total;
+    return matches;
+}
@@ -2,9 +2,11 @@
 #define AHO_CORASICK_H
 
 #include "trie.h"
+#include "container.h"
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 /**
  
@@ -112,4 +114,305 @@ void dealloc_ac_iter(
 );
 
 
+/**
+ 
+ Compiled Aho-Corasick automaton.
+ 
+ The trie based iterator finds each transition by walking
+ the sibling list of a heap allocated node and then follows
+ failure links when it mismatches. Here, we compile the
+ trie into flat arrays instead. States are numbered in
+ breadth first order, with the root as state zero, and
+ letters are mapped to byte classes: class zero for the
+ letters that are not in any pattern and one class for
+ each letter that is.
+ 
+ With a dense layout we have the full DFA, one row of
+ alphabet_size transitions per state, so there are no
+ failure links to follow when we scan. If that table is too
+ large (see AC_DENSE_LIMIT), we use a sparse layout with
+ the trie edges of each state in a contiguous row, sorted
+ by class, and failure links; the root still gets a full row.
+ 
+ The output set of each state is a contiguous range in
+ `outputs`, so the total size is the sum of the output set
+ sizes. That is usually close to the number of patterns,
+ but it can be quadratic for patterns that are suffixes of
+ each other, like a, aa, aaa, ...
+ 
+ The automaton doesn't refer to the trie, so you can free
+ the trie once you have compiled it.
+ 
+ */
+
+// We use the top bit of a target state to tell if it
+// has any output, so we don't have to look it up when
+// we scan.
+#define AC_OUTPUT_FLAG (1u << 31)
+#define AC_STATE(s) ((s) & ~AC_OUTPUT_FLAG)
+
+// The largest number of transitions we allow in a dense
+// table before we automatically pick the sparse layout.
+#define AC_DENSE_LIMIT (1u << 24)
+
+enum ac_layout {
+    AC_AUTO_LAYOUT,
+    AC_DENSE_LAYOUT,
+    AC_SPARSE_LAYOUT
+};
+
+struct ac_output {
+    int string_label;
+    uint32_t length;
+};
+
+struct ac_automaton {
+    uint32_t no_states;
+    uint32_t alphabet_size;
+    uint32_t max_length; // the longest pattern
+    uint8_t classes[256];
+    bool dense;
+
+    // Dense: no_states * alphabet_size transitions.
+    // Sparse: just the row for the root.
+    uint32_t *transitions;
+
+    // Sparse only: the edges out of state s are at
+    // edge_start[s] to edge_start[s + 1].
+    uint32_t *failure;
+    uint32_t *edge_start;
+    uint8_t *edge_class;
+    uint32_t *edge_target;
+
+    // The outputs of state s are at
+    // output_start[s] to output_start[s + 1].
+    uint32_t *output_start;
+    struct ac_output *outputs;
+
+    // If we mapped the automaton from a file, the arrays
+    // point into the read-only mapping; otherwise this is null.
+    struct container_map *map;
+};
+
+/**
+ Compile a trie into an automaton.
+ 
+ The trie doesn't need failure links; we compute what we
+ need directly on the flat arrays.
+ 
+ @param patterns_trie A trie that holds all the patterns.
+ @param layout        The transition layout, or AC_AUTO_LAYOUT
+                      to pick dense when it is small enough.
+ */
+struct ac_automaton *alloc_ac_automaton(
+    const struct trie *patterns_trie,
+    enum ac_layout layout
+);
+// The same for a compact trie.
+struct ac_automaton *alloc_ac_automaton_from_compact_trie(
+    const struct compact_trie *patterns_trie,
+    enum ac_layout layout
+);
+void free_ac_automaton(
+    struct ac_automaton *ac
+);
+
+/**
+ Iterator over matches with a compiled automaton.
+ 
+ It reports the same matches as the trie iterator and in the
+ same order. You don't need the pattern lengths here since the
+ automaton knows them.
+ */
+struct ac_automaton_iter {
+    const struct ac_automaton *ac;
+    const uint8_t *x;
+    uint32_t n;
+
+    uint32_t j;
+    uint32_t state;
+    const struct ac_output *out, *out_end;
+};
+
+void init_ac_automaton_iter(
+    struct ac_automaton_iter *iter,
+    const struct ac_automaton *ac,
+    const uint8_t *x,
+    uint32_t n
+);
+bool next_ac_automaton_match(
+    struct ac_automaton_iter *iter,
+    struct ac_match *ac_match
+);
+void dealloc_ac_automaton_iter(
+    struct ac_automaton_iter *iter
+);
+
+/**
+ Get up to max_matches matches at a time.
+ 
+ This continues where the iterator is, so you can mix it with
+ next_ac_automaton_match, and you call it again until it
+ returns zero. It saves a function call per match.
+ 
+ @return The number of matches written to matches.
+ */
+uint32_t next_ac_automaton_matches(
+    struct ac_automaton_iter *iter,
+    struct ac_match *matches,
+    uint32_t max_matches
+);
+
+/**
+ Scan a whole text and call callback for each match.
+ 
+ The matches come in the same order as from the iterator. The
+ match you get is only valid during the call.
+ */
+void ac_automaton_scan(
+    const struct ac_automaton *ac,
+    const uint8_t *x,
+    uint32_t n,
+    void (*callback)(const struct ac_match *match, void *data),
+    void *data
+);
+
+
+
+/**
+ 
+ Streaming search with a compiled automaton.
+ 
+ The automaton state is all we need to remember between two
+ pieces of text, so you can feed a stream the text a chunk at
+ a time and only keep the current chunk in memory. Matches
+ that span a chunk boundary are reported with the chunk where
+ they end. Positions are global, counted from the start of the
+ stream, so they are 64 bits.
+ 
+ */
+struct ac_stream_match {
+    int string_label;
+    uint64_t index;
+};
+
+struct ac_stream {
+    // The iterator over the current chunk. Its state carries
+    // over to the next chunk.
+    struct ac_automaton_iter iter;
+    // The global position of the start of the current chunk.
+    uint64_t offset;
+};
+
+void init_ac_stream(
+    struct ac_stream *stream,
+    const struct ac_automaton *ac
+);
+// Start over, as if we hadn't seen any text.
+void reset_ac_stream(
+    struct ac_stream *stream
+);
+/**
+ Give the stream the next chunk of text.
+ 
+ You must have gotten all matches from the previous chunk,
+ i.e., next_ac_stream_match returned false, before you feed
+ it the next. The chunk must stay alive until then as well.
+ */
+void feed_ac_stream(
+    struct ac_stream *stream,
+    const uint8_t *x,
+    uint32_t n
+);
+bool next_ac_stream_match(
+    struct ac_stream *stream,
+    struct ac_stream_match *match
+);
+void dealloc_ac_stream(
+    struct ac_stream *stream
+);
+
+
+/**
+ 
+ Parallel scan of a single text.
+ 
+ We split the text into pieces and scan them in separate
+ threads over the same automaton. A thread starts
+ max_length - 1 letters before its piece, so it is in the
+ right state when it gets there, and it only reports the
+ matches that end inside its piece. That way we see every
+ match exactly once. We then concatenate the matches from
+ the pieces, so you get them in the same order as from the
+ iterator: by the position where they end.
+ 
+ For short texts, or with a single thread, we just scan
+ sequentially.
+ 
+ @param no_matches The number of matches we found.
+ @return A malloc'ed array of the matches. You must free it.
+ */
+#define PARALLEL_AC_MIN_LENGTH (1 << 16)
+struct ac_match *
+parallel_ac_scan(
+    const struct ac_automaton *ac,
+    const uint8_t *x,
+    uint32_t n,
+    uint32_t no_threads,
+    uint32_t *no_matches
+);
+
+
+/**
+ 
+ Serialising automata.
+ 
+ We write the arrays of a compiled automaton to a container
+ (see container.h), so you can compile a large pattern set
+ once and load it later. The container's arrays are aligned,
+ so we can also memory map it and use the arrays in place.
+ Then loading is instant, and processes that map the same
+ file share the memory. A mapped automaton is a normal
+ automaton that you use with all the functions above and
+ free with free_ac_automaton.
+ 
+ When we read a file, we always check that the states,
+ classes and output ranges are in bounds, so a corrupt file
+ can't make the scans read outside the arrays. When we map
+ one, we only do that if verify is true, since it means
+ reading all of the file, so only map files you trust
+ without it.
+ 
+ */
+#define AC_AUTOMATON_KIND CONTAINER_TAG('A','C','A','U')
+
+bool write_ac_automaton(
+    FILE *f,
+    const struct ac_automaton *ac,
+    enum error_codes *err
+);
+bool write_ac_automaton_fname(
+    const char *fname,
+    const struct ac_automaton *ac,
+    enum error_codes *err
+);
+struct ac_automaton *
+read_ac_automaton(
+    FILE *f,
+    bool verify,
+    enum error_codes *err
+);
+struct ac_automaton *
+read_ac_automaton_fname(
+    const char *fname,
+    bool verify,
+    enum error_codes *err
+);
+struct ac_automaton *
+map_ac_automaton_fname(
+    const char *fname,
+    bool verify,
+    enum error_codes *err
+);
+
 #endif
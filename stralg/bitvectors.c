@@ -0,0 +1,32 @@
+#include "bitvectors.h"
+
+void init_rank_bitvector(
+    struct rank_bitvector *bv,
+    uint32_t length
+) {
+    // We always allocate one word more than we strictly
+    // need so rank(length) can look at the word after the
+    // last bit.
+    uint32_t no_words = length / 64 + 1;
+    bv->length = length;
+    bv->words = calloc(no_words, sizeof(*bv->words));
+    bv->ranks = calloc(no_words, sizeof(*bv->ranks));
+}
+
+void dealloc_rank_bitvector(
+    struct rank_bitvector *bv
+) {
+    free(bv->words);
+    free(bv->ranks);
+}
+
+void build_rank_bitvector(
+    struct rank_bitvector *bv
+) {
+    uint32_t no_words = bv->length / 64 + 1;
+    uint32_t rank = 0;
+    for (uint32_t i = 0; i < no_words; ++i) {
+        bv->ranks[i] = rank;
+        rank += popcount64(bv->words[i]);
+    }
+}
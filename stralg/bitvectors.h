@@ -0,0 +1,75 @@
+#ifndef BITVECTORS_H
+#define BITVECTORS_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/// MARK: Bit vectors with constant time rank
+// You set the bits you need, then call
+// build_rank_bitvector() before you use rank. After
+// that, you shouldn't change the bits any more.
+// The rank table uses one 32-bit counter per 64-bit
+// word, so the whole thing takes 1.5 bits per bit.
+struct rank_bitvector {
+    uint32_t length;
+    uint64_t *words;
+    uint32_t *ranks;
+};
+
+void init_rank_bitvector(
+    struct rank_bitvector *bv,
+    uint32_t length
+);
+void dealloc_rank_bitvector(
+    struct rank_bitvector *bv
+);
+void build_rank_bitvector(
+    struct rank_bitvector *bv
+);
+
+static inline void set_bit(
+    struct rank_bitvector *bv,
+    uint32_t i
+) {
+    bv->words[i / 64] |= (uint64_t)1 << (i % 64);
+}
+static inline bool get_bit(
+    const struct rank_bitvector *bv,
+    uint32_t i
+) {
+    return (bv->words[i / 64] >> (i % 64)) & 1;
+}
+
+static inline uint32_t popcount64(uint64_t w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (uint32_t)__builtin_popcountll(w);
+#else
+    uint32_t count = 0;
+    for (; w; w &= w - 1) count++;
+    return count;
+#endif
+}
+
+// Number of set bits in positions [0,i).
+static inline uint32_t bitvector_rank(
+    const struct rank_bitvector *bv,
+    uint32_t i
+) {
+    uint32_t word = i / 64;
+    uint32_t bit = i % 64;
+    uint32_t rank = bv->ranks[word];
+    if (bit) rank += popcount64(bv->words[word] << (64 - bit));
+    return rank;
+}
+
+// Memory usage in bytes, not counting the struct itself.
+static inline size_t rank_bitvector_bytes(
+    const struct rank_bitvector *bv
+) {
+    size_t no_words = bv->length / 64 + 1;
+    return no_words * (sizeof(*bv->words) + sizeof(*bv->ranks));
+}
+
+#endif
@@ -462,24 +462,26 @@ struct bwt_table *read_bwt_table(
     
     bwt_table->c_table = malloc(sizeof(*bwt_table->c_table) * c_table_length);
     bwt_table->o_table = malloc(sizeof(*bwt_table->o_table) * o_table_length);
-    fread(bwt_table->c_table, sizeof(*bwt_table->c_table), c_table_length, f);
-    fread(bwt_table->o_table, sizeof(*bwt_table->o_table), o_table_length, f);
+    bwt_table->ro_table = 0;
+    bwt_table->ro_indices = 0;
+    bwt_table->o_indices = 0;
+    bool has_ro_table;
+    if (fread(bwt_table->c_table, sizeof(*bwt_table->c_table), c_table_length, f) != c_table_length ||
+        fread(bwt_table->o_table, sizeof(*bwt_table->o_table), o_table_length, f) != o_table_length ||
+        fread(&has_ro_table, sizeof(bool), 1, f) != 1)
+        goto error;
     
     bwt_table->o_indices = malloc(sizeof(*bwt_table->o_indices) * (sa->length + 1));
     for (uint32_t i = 0; i < sa->length + 1; i++) {
         bwt_table->o_indices[i] = bwt_table->o_table + i * remap_table->alphabet_size;
     }
     
-    bwt_table->ro_table = 0;
-    bwt_table->ro_indices = 0;
-    bool has_ro_table;
-    fread(&has_ro_table, sizeof(bool), 1, f);
-
     if (has_ro_table) {
-            bwt_table->ro_table = malloc(sizeof(*bwt_table->ro_table) * o_table_length);
-            fread(bwt_table->ro_table,
-              sizeof(*bwt_table->ro_table),
-              o_table_length, f);
+        bwt_table->ro_table = malloc(sizeof(*bwt_table->ro_table) * o_table_length);
+        if (fread(bwt_table->ro_table,
+                  sizeof(*bwt_table->ro_table),
+                  o_table_length, f) != o_table_length)
+            goto error;
         bwt_table->ro_indices = malloc(sizeof(bwt_table->ro_indices) * (sa->length + 1));
         for (uint32_t i = 0; i < sa->length + 1; i++) {
             bwt_table->ro_indices[i] = bwt_table->ro_table + i * remap_table->alphabet_size;
@@ -488,6 +490,11 @@ struct bwt_table *read_bwt_table(
     }
     
     return bwt_table;
+    
+error:
+    dealloc_bwt_table(bwt_table);
+    free(bwt_table);
+    return 0;
 }
 
 struct bwt_table *
@@ -497,6 +504,7 @@ read_bwt_table_fname(
     struct remap_table  *remap_table
 ) {
     FILE *f = fopen(fname, "rb");
+    if (!f) return 0;
     struct bwt_table *bwt_table = read_bwt_table(f, sa, remap_table);
     fclose(f);
     return bwt_table;
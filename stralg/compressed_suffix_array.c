@@ -0,0 +1,340 @@
+#include "compressed_suffix_array.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/// MARK: Bit streams and gamma codes
+
+// Bits are stored most significant first in each word.
+// We always keep a zero word after the last bit so we can
+// read a full 64-bit window anywhere in the stream.
+struct bit_writer {
+    uint64_t *words;
+    uint64_t no_words;
+    uint64_t no_bits;
+};
+
+static void init_bit_writer(struct bit_writer *w)
+{
+    w->no_words = 64;
+    w->words = calloc(w->no_words, sizeof(*w->words));
+    w->no_bits = 0;
+}
+
+static void write_bits(
+    struct bit_writer *w,
+    uint64_t value,
+    uint32_t no_bits
+) {
+    // Make room for the bits plus the padding word
+    uint64_t needed = (w->no_bits + no_bits) / 64 + 2;
+    if (needed > w->no_words) {
+        uint64_t new_size = 2 * w->no_words;
+        if (new_size < needed) new_size = needed;
+        w->words = realloc(w->words, new_size * sizeof(*w->words));
+        memset(w->words + w->no_words, 0,
+               (new_size - w->no_words) * sizeof(*w->words));
+        w->no_words = new_size;
+    }
+    if (no_bits == 0) return;
+
+    uint64_t word = w->no_bits / 64;
+    uint32_t offset = w->no_bits % 64;
+    if (offset + no_bits <= 64) {
+        w->words[word] |= value << (64 - offset - no_bits);
+    } else {
+        uint32_t spill = offset + no_bits - 64;
+        w->words[word] |= value >> spill;
+        w->words[word + 1] |= value << (64 - spill);
+    }
+    w->no_bits += no_bits;
+}
+
+static inline uint32_t leading_zeros64(uint64_t w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return w ? (uint32_t)__builtin_clzll(w) : 64;
+#else
+    uint32_t n = 0;
+    for (uint64_t mask = (uint64_t)1 << 63; mask && !(w & mask); mask >>= 1)
+        n++;
+    return n;
+#endif
+}
+
+static void write_gamma(
+    struct bit_writer *w,
+    uint32_t value
+) {
+    assert(value > 0);
+    uint32_t n = 63 - leading_zeros64(value);
+    write_bits(w, 0, n);
+    write_bits(w, value, n + 1);
+}
+
+static inline uint64_t peek_bits(
+    const uint64_t *words,
+    uint64_t pos
+) {
+    uint64_t word = pos / 64;
+    uint32_t offset = pos % 64;
+    uint64_t w = words[word] << offset;
+    if (offset) w |= words[word + 1] >> (64 - offset);
+    return w;
+}
+
+static inline uint32_t read_gamma(
+    const uint64_t *words,
+    uint64_t *pos
+) {
+    // A 32-bit value takes at most 63 bits, so it always
+    // fits in one window.
+    uint64_t w = peek_bits(words, *pos);
+    uint32_t n = leading_zeros64(w);
+    uint32_t len = 2 * n + 1;
+    *pos += len;
+    return (uint32_t)(w >> (64 - len));
+}
+
+/// MARK: Construction
+
+struct compressed_suffix_array *
+csa_construction(
+    struct suffix_array *sa,
+    uint32_t alphabet_size,
+    uint32_t sample_rate
+) {
+    assert(sample_rate > 0);
+    struct compressed_suffix_array *csa = malloc(sizeof(*csa));
+    uint32_t n = sa->length;
+    csa->length = n;
+    csa->alphabet_size = alphabet_size;
+    csa->sample_rate = sample_rate;
+
+    csa->C = calloc(alphabet_size + 1, sizeof(*csa->C));
+    for (uint32_t i = 0; i < n; ++i) {
+        assert(sa->string[i] < alphabet_size);
+        csa->C[sa->string[i] + 1]++;
+    }
+    for (uint32_t a = 1; a <= alphabet_size; ++a) {
+        csa->C[a] += csa->C[a - 1];
+    }
+
+    bool had_inverse = sa->inverse != 0;
+    compute_inverse(sa);
+
+    uint32_t no_blocks = (n + CSA_PSI_BLOCK - 1) / CSA_PSI_BLOCK;
+    csa->psi_samples = malloc(no_blocks * sizeof(*csa->psi_samples));
+    csa->psi_offsets = malloc(no_blocks * sizeof(*csa->psi_offsets));
+
+    struct bit_writer w;
+    init_bit_writer(&w);
+    uint32_t prev = 0;
+    uint32_t next_bucket = 0; // first row of the next letter
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t pos = sa->array[i] + 1;
+        uint32_t psi = sa->inverse[pos == n ? 0 : pos];
+
+        bool new_bucket = false;
+        if (i == next_bucket) {
+            new_bucket = true;
+            uint8_t a = sa->string[sa->array[i]];
+            next_bucket = csa->C[a + 1];
+        }
+        if (i % CSA_PSI_BLOCK == 0) {
+            csa->psi_samples[i / CSA_PSI_BLOCK] = psi;
+            csa->psi_offsets[i / CSA_PSI_BLOCK] = w.no_bits;
+        } else if (new_bucket) {
+            write_gamma(&w, psi + 1);
+        } else {
+            assert(psi > prev);
+            write_gamma(&w, psi - prev);
+        }
+        prev = psi;
+    }
+    // shrink to what we use (plus the padding word)
+    uint64_t used_words = w.no_bits / 64 + 2;
+    csa->psi_bits = realloc(w.words, used_words * sizeof(*w.words));
+    csa->psi_no_bits = w.no_bits;
+
+    // Sample the suffix array. We also sample the sentinel
+    // suffix so we never have to walk around the end of
+    // the string.
+    init_rank_bitvector(&csa->sampled_rows, n);
+    uint32_t no_samples = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t pos = sa->array[i];
+        if (pos % sample_rate == 0 || pos == n - 1) {
+            set_bit(&csa->sampled_rows, i);
+            no_samples++;
+        }
+    }
+    build_rank_bitvector(&csa->sampled_rows);
+    csa->samples = malloc(no_samples * sizeof(*csa->samples));
+    for (uint32_t i = 0, j = 0; i < n; ++i) {
+        if (get_bit(&csa->sampled_rows, i))
+            csa->samples[j++] = sa->array[i];
+    }
+
+    if (!had_inverse) {
+        free(sa->inverse);
+        sa->inverse = 0;
+    }
+
+    return csa;
+}
+
+void free_compressed_suffix_array(
+    struct compressed_suffix_array *csa
+) {
+    free(csa->C);
+    free(csa->psi_samples);
+    free(csa->psi_offsets);
+    free(csa->psi_bits);
+    dealloc_rank_bitvector(&csa->sampled_rows);
+    free(csa->samples);
+    free(csa);
+}
+
+size_t csa_bytes(
+    const struct compressed_suffix_array *csa
+) {
+    uint32_t no_blocks = (csa->length + CSA_PSI_BLOCK - 1) / CSA_PSI_BLOCK;
+    uint32_t no_samples = bitvector_rank(&csa->sampled_rows, csa->length);
+    return sizeof(*csa)
+        + (csa->alphabet_size + 1) * sizeof(*csa->C)
+        + no_blocks * (sizeof(*csa->psi_samples) + sizeof(*csa->psi_offsets))
+        + (csa->psi_no_bits / 64 + 2) * sizeof(*csa->psi_bits)
+        + rank_bitvector_bytes(&csa->sampled_rows)
+        + no_samples * sizeof(*csa->samples);
+}
+
+/// MARK: Access
+
+uint8_t csa_row_letter(
+    const struct compressed_suffix_array *csa,
+    uint32_t i
+) {
+    // Find the largest a with C[a] <= i. Letters that do not
+    // occur have the same C value as the next letter, so we
+    // get the letter that actually occurs.
+    uint32_t lo = 0, hi = csa->alphabet_size;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (csa->C[mid] <= i) lo = mid;
+        else hi = mid;
+    }
+    return (uint8_t)lo;
+}
+
+uint32_t csa_psi(
+    const struct compressed_suffix_array *csa,
+    uint32_t i
+) {
+    uint32_t block = i / CSA_PSI_BLOCK;
+    uint32_t row = block * CSA_PSI_BLOCK;
+    uint32_t psi = csa->psi_samples[block];
+    if (row == i) return psi;
+
+    uint64_t pos = csa->psi_offsets[block];
+    uint32_t next_bucket = csa->C[csa_row_letter(csa, row) + 1];
+    for (++row; row <= i; ++row) {
+        uint32_t code = read_gamma(csa->psi_bits, &pos);
+        if (row == next_bucket) {
+            psi = code - 1;
+            next_bucket = csa->C[csa_row_letter(csa, row) + 1];
+        } else {
+            psi += code;
+        }
+    }
+    return psi;
+}
+
+uint32_t csa_lookup(
+    const struct compressed_suffix_array *csa,
+    uint32_t i
+) {
+    uint32_t steps = 0;
+    while (!get_bit(&csa->sampled_rows, i)) {
+        i = csa_psi(csa, i);
+        steps++;
+    }
+    return csa->samples[bitvector_rank(&csa->sampled_rows, i)] - steps;
+}
+
+/// MARK: Searching
+
+// Compares the pattern against the first m letters of the
+// suffix in row i, like strncmp(pattern, suffix, m).
+static int compare_row(
+    const struct compressed_suffix_array *csa,
+    uint32_t i,
+    const uint8_t *pattern,
+    uint32_t m
+) {
+    for (uint32_t k = 0; k < m; ++k) {
+        uint8_t a = csa_row_letter(csa, i);
+        // The sentinel is less than any letter in the
+        // pattern, so we never move past it.
+        if (pattern[k] != a)
+            return (pattern[k] < a) ? -1 : 1;
+        if (k + 1 < m) i = csa_psi(csa, i);
+    }
+    return 0;
+}
+
+void init_csa_match_iter(
+    struct csa_match_iter *iter,
+    const uint8_t *pattern,
+    const struct compressed_suffix_array *csa
+) {
+    uint32_t m = (uint32_t)strlen((char *)pattern);
+    iter->csa = csa;
+
+    // The first letter gives us the initial interval for free
+    uint32_t L = 0, R = csa->length;
+    if (m > 0) {
+        if (pattern[0] >= csa->alphabet_size) {
+            iter->L = iter->R = iter->i = 0;
+            return;
+        }
+        L = csa->C[pattern[0]];
+        R = csa->C[pattern[0] + 1];
+    }
+
+    uint32_t lo = L, hi = R;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (compare_row(csa, mid, pattern, m) <= 0) hi = mid;
+        else lo = mid + 1;
+    }
+    L = lo;
+    hi = R;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (compare_row(csa, mid, pattern, m) < 0) hi = mid;
+        else lo = mid + 1;
+    }
+    R = lo;
+
+    iter->L = L;
+    iter->R = R;
+    iter->i = L;
+}
+
+bool next_csa_match(
+    struct csa_match_iter *iter,
+    struct sa_match *match
+) {
+    if (iter->i >= iter->R)
+        return false;
+    match->position = csa_lookup(iter->csa, iter->i++);
+    return true;
+}
+
+void dealloc_csa_match_iter(
+    struct csa_match_iter *iter
+) {
+    // nothing to be done here
+}
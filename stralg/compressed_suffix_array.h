@@ -0,0 +1,101 @@
+#ifndef COMPRESSED_SUFFIX_ARRAY_H
+#define COMPRESSED_SUFFIX_ARRAY_H
+
+#include <suffix_array.h>
+#include <bitvectors.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * A compressed suffix array represents the suffix array
+ * through the function Psi[i] = ISA[SA[i] + 1], where suffix
+ * n - 1 (the sentinel) wraps around to suffix 0.
+ *
+ * Psi is increasing inside each block of suffixes that
+ * start with the same letter, so we store it as Elias-gamma
+ * coded differences with an absolute sample every
+ * CSA_PSI_BLOCK entries. Together with the C table, Psi lets
+ * us read the suffix at any row, and that is all we need for
+ * binary search. To get positions back, we keep SA[i] for the
+ * rows where SA[i] is a multiple of sample_rate and walk
+ * along Psi from the other rows until we hit a sampled one.
+ *
+ * The index does not need the string once it is built.
+ **/
+
+#define CSA_PSI_BLOCK 32
+
+struct compressed_suffix_array {
+    uint32_t length; // including the sentinel
+    uint32_t alphabet_size;
+    uint32_t *C; // alphabet_size + 1 entries
+
+    // Psi, in blocks of CSA_PSI_BLOCK entries
+    uint32_t *psi_samples;
+    uint64_t *psi_offsets;
+    uint64_t *psi_bits;
+    uint64_t psi_no_bits;
+
+    // Sampled suffix array
+    uint32_t sample_rate;
+    struct rank_bitvector sampled_rows;
+    uint32_t *samples;
+};
+
+// Builds the compressed suffix array from a suffix array,
+// e.g. from sa_is_construction(). The alphabet size must be
+// the one you used to build the suffix array (or 256 if you
+// didn't remap the string). You can free the suffix
+// array afterwards.
+struct compressed_suffix_array *
+csa_construction(
+    struct suffix_array *sa,
+    uint32_t alphabet_size,
+    uint32_t sample_rate
+);
+void free_compressed_suffix_array(
+    struct compressed_suffix_array *csa
+);
+
+uint32_t csa_psi(
+    const struct compressed_suffix_array *csa,
+    uint32_t i
+);
+// The first letter of the suffix in row i
+uint8_t csa_row_letter(
+    const struct compressed_suffix_array *csa,
+    uint32_t i
+);
+// The suffix array value in row i
+uint32_t csa_lookup(
+    const struct compressed_suffix_array *csa,
+    uint32_t i
+);
+
+// Memory usage in bytes
+size_t csa_bytes(
+    const struct compressed_suffix_array *csa
+);
+
+struct csa_match_iter {
+    const struct compressed_suffix_array *csa;
+    uint32_t L;
+    uint32_t R;
+    uint32_t i;
+};
+void init_csa_match_iter(
+    struct csa_match_iter *iter,
+    const uint8_t *pattern,
+    const struct compressed_suffix_array *csa
+);
+bool next_csa_match(
+    struct csa_match_iter *iter,
+    struct sa_match *match
+);
+void dealloc_csa_match_iter(
+    struct csa_match_iter *iter
+);
+
+#endif
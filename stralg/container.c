@@ -0,0 +1,716 @@
+#include "container.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/// MARK: XXH64
+
+#define XXH_P1 11400714785074694791ULL
+#define XXH_P2 14029467366897019727ULL
+#define XXH_P3  1609587929392839161ULL
+#define XXH_P4  9650029242287828579ULL
+#define XXH_P5  2870177450012600261ULL
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+static inline uint64_t read64(const uint8_t *p)
+{
+    uint64_t x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+static inline uint64_t xxh64_round(uint64_t acc, uint64_t input)
+{
+    acc += input * XXH_P2;
+    acc = rotl64(acc, 31);
+    return acc * XXH_P1;
+}
+static inline uint64_t xxh64_merge(uint64_t acc, uint64_t val)
+{
+    acc ^= xxh64_round(0, val);
+    return acc * XXH_P1 + XXH_P4;
+}
+
+void init_xxh64(
+    struct xxh64_state *state,
+    uint64_t seed
+) {
+    state->total_length = 0;
+    state->seed = seed;
+    state->v[0] = seed + XXH_P1 + XXH_P2;
+    state->v[1] = seed + XXH_P2;
+    state->v[2] = seed;
+    state->v[3] = seed - XXH_P1;
+    state->buffered = 0;
+}
+
+static inline void xxh64_stripe(
+    uint64_t *v,
+    const uint8_t *p
+) {
+    v[0] = xxh64_round(v[0], read64(p));
+    v[1] = xxh64_round(v[1], read64(p + 8));
+    v[2] = xxh64_round(v[2], read64(p + 16));
+    v[3] = xxh64_round(v[3], read64(p + 24));
+}
+
+void update_xxh64(
+    struct xxh64_state *state,
+    const void *data,
+    size_t length
+) {
+    const uint8_t *p = data;
+    const uint8_t *end = p + length;
+    state->total_length += length;
+
+    // Fill up the buffer from last time first
+    if (state->buffered) {
+        size_t missing = 32 - state->buffered;
+        if (length < missing) {
+            memcpy(state->buffer + state->buffered, p, length);
+            state->buffered += (uint32_t)length;
+            return;
+        }
+        memcpy(state->buffer + state->buffered, p, missing);
+        xxh64_stripe(state->v, state->buffer);
+        p += missing;
+        state->buffered = 0;
+    }
+    for (; p + 32 <= end; p += 32) {
+        xxh64_stripe(state->v, p);
+    }
+    if (p < end) {
+        memcpy(state->buffer, p, end - p);
+        state->buffered = (uint32_t)(end - p);
+    }
+}
+
+uint64_t digest_xxh64(
+    const struct xxh64_state *state
+) {
+    uint64_t h;
+    const uint64_t *v = state->v;
+    if (state->total_length >= 32) {
+        h = rotl64(v[0], 1) + rotl64(v[1], 7) + rotl64(v[2], 12) + rotl64(v[3], 18);
+        h = xxh64_merge(h, v[0]);
+        h = xxh64_merge(h, v[1]);
+        h = xxh64_merge(h, v[2]);
+        h = xxh64_merge(h, v[3]);
+    } else {
+        h = state->seed + XXH_P5;
+    }
+    h += state->total_length;
+
+    const uint8_t *p = state->buffer;
+    const uint8_t *end = p + state->buffered;
+    for (; p + 8 <= end; p += 8) {
+        h ^= xxh64_round(0, read64(p));
+        h = rotl64(h, 27) * XXH_P1 + XXH_P4;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t)read32(p) * XXH_P1;
+        h = rotl64(h, 23) * XXH_P2 + XXH_P3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        h ^= (*p) * XXH_P5;
+        h = rotl64(h, 11) * XXH_P1;
+    }
+
+    h ^= h >> 33;
+    h *= XXH_P2;
+    h ^= h >> 29;
+    h *= XXH_P3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t xxh64(
+    const void *data,
+    size_t length,
+    uint64_t seed
+) {
+    struct xxh64_state state;
+    init_xxh64(&state, seed);
+    update_xxh64(&state, data, length);
+    return digest_xxh64(&state);
+}
+
+/// MARK: File layout
+
+#define ALIGNMENT 16
+#define TABLE_TAG 0
+#define BYTE_ORDER_MARK 0x01020304
+
+static const char magic[8] = { 'S', 'T', 'R', 'A', 'L', 'G', 'C', 'F' };
+
+struct file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t kind;
+    uint32_t reserved[3];
+};
+struct section_header {
+    uint32_t tag;
+    uint32_t reserved;
+    uint64_t size;
+};
+struct section_trailer {
+    uint64_t checksum;
+    uint64_t reserved;
+};
+struct table_entry {
+    uint32_t tag;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t checksum;
+};
+struct file_footer {
+    uint64_t table_offset;
+    uint32_t no_sections;
+    uint32_t reserved;
+    uint64_t table_checksum;
+    char magic[8];
+};
+
+static struct container_section *
+add_section(
+    struct container_section **sections,
+    uint32_t *no_sections,
+    uint32_t *sections_size
+) {
+    if (*no_sections == *sections_size) {
+        *sections_size = *sections_size ? 2 * *sections_size : 8;
+        *sections = realloc(*sections, *sections_size * sizeof(**sections));
+    }
+    return &(*sections)[(*no_sections)++];
+}
+
+static void table_entry_from_section(
+    struct table_entry *entry,
+    const struct container_section *section
+) {
+    memset(entry, 0, sizeof(*entry));
+    entry->tag = section->tag;
+    entry->offset = section->offset;
+    entry->size = section->size;
+    entry->checksum = section->checksum;
+}
+
+/// MARK: Writing
+
+static void write_raw(
+    struct container_writer *w,
+    const void *data,
+    uint64_t size
+) {
+    if (w->error != NO_ERROR || size == 0) return;
+    if (fwrite(data, 1, size, w->f) != size) {
+        w->error = CANNOT_WRITE_FILE;
+        return;
+    }
+    w->offset += size;
+}
+
+static void write_padding(struct container_writer *w)
+{
+    static const uint8_t zeros[ALIGNMENT] = { 0 };
+    uint64_t rem = w->offset % ALIGNMENT;
+    if (rem) write_raw(w, zeros, ALIGNMENT - rem);
+}
+
+void init_container_writer(
+    struct container_writer *w,
+    FILE *f,
+    uint32_t kind
+) {
+    w->f = f;
+    w->offset = 0;
+    w->error = f ? NO_ERROR : CANNOT_OPEN_FILE;
+    w->sections = 0;
+    w->no_sections = 0;
+    w->sections_size = 0;
+    w->in_section = false;
+    w->remaining = 0;
+
+    struct file_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, magic, sizeof(magic));
+    header.version = CONTAINER_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.kind = kind;
+    write_raw(w, &header, sizeof(header));
+}
+
+void begin_container_section(
+    struct container_writer *w,
+    uint32_t tag,
+    uint64_t size
+) {
+    assert(!w->in_section);
+    assert(tag != TABLE_TAG);
+    w->in_section = true;
+    w->remaining = size;
+
+    struct section_header header;
+    memset(&header, 0, sizeof(header));
+    header.tag = tag;
+    header.size = size;
+    write_raw(w, &header, sizeof(header));
+
+    struct container_section *section =
+        add_section(&w->sections, &w->no_sections, &w->sections_size);
+    section->tag = tag;
+    section->offset = w->offset;
+    section->size = size;
+    section->checksum = 0;
+    init_xxh64(&w->hash, 0);
+}
+
+void write_container_data(
+    struct container_writer *w,
+    const void *data,
+    uint64_t size
+) {
+    assert(w->in_section);
+    assert(size <= w->remaining);
+    w->remaining -= size;
+    update_xxh64(&w->hash, data, size);
+    write_raw(w, data, size);
+}
+
+void end_container_section(
+    struct container_writer *w
+) {
+    assert(w->in_section);
+    assert(w->remaining == 0);
+    w->in_section = false;
+    write_padding(w);
+
+    struct container_section *section = &w->sections[w->no_sections - 1];
+    section->checksum = digest_xxh64(&w->hash);
+
+    struct section_trailer trailer;
+    memset(&trailer, 0, sizeof(trailer));
+    trailer.checksum = section->checksum;
+    write_raw(w, &trailer, sizeof(trailer));
+}
+
+void write_container_section(
+    struct container_writer *w,
+    uint32_t tag,
+    const void *data,
+    uint64_t size
+) {
+    begin_container_section(w, tag, size);
+    write_container_data(w, data, size);
+    end_container_section(w);
+}
+
+bool finish_container(
+    struct container_writer *w,
+    enum error_codes *err
+) {
+    assert(!w->in_section);
+
+    struct section_header header;
+    memset(&header, 0, sizeof(header));
+    header.tag = TABLE_TAG;
+    header.size = w->no_sections * sizeof(struct table_entry);
+    write_raw(w, &header, sizeof(header));
+
+    struct file_footer footer;
+    memset(&footer, 0, sizeof(footer));
+    footer.table_offset = w->offset;
+    footer.no_sections = w->no_sections;
+
+    struct xxh64_state table_hash;
+    init_xxh64(&table_hash, 0);
+    for (uint32_t i = 0; i < w->no_sections; ++i) {
+        struct table_entry entry;
+        table_entry_from_section(&entry, &w->sections[i]);
+        update_xxh64(&table_hash, &entry, sizeof(entry));
+        write_raw(w, &entry, sizeof(entry));
+    }
+
+    footer.table_checksum = digest_xxh64(&table_hash);
+    memcpy(footer.magic, magic, sizeof(magic));
+    write_raw(w, &footer, sizeof(footer));
+
+    if (w->error == NO_ERROR && fflush(w->f) != 0)
+        w->error = CANNOT_WRITE_FILE;
+
+    free(w->sections);
+    w->sections = 0;
+
+    if (err) *err = w->error;
+    return w->error == NO_ERROR;
+}
+
+/// MARK: Reading
+
+static bool read_raw(
+    struct container_reader *r,
+    void *buffer,
+    uint64_t size
+) {
+    if (r->error != NO_ERROR) return false;
+    if (size == 0) return true;
+    if (fread(buffer, 1, size, r->f) != size) {
+        r->error = TRUNCATED_FILE;
+        return false;
+    }
+    r->offset += size;
+    return true;
+}
+
+static bool skip_padding(struct container_reader *r)
+{
+    uint8_t buffer[ALIGNMENT];
+    uint64_t rem = r->offset % ALIGNMENT;
+    if (rem == 0) return r->error == NO_ERROR;
+    return read_raw(r, buffer, ALIGNMENT - rem);
+}
+
+static bool reader_error(
+    struct container_reader *r,
+    enum error_codes error
+) {
+    if (r->error == NO_ERROR) r->error = error;
+    return false;
+}
+
+bool init_container_reader(
+    struct container_reader *r,
+    FILE *f,
+    uint32_t kind,
+    bool verify
+) {
+    r->f = f;
+    r->verify = verify;
+    r->offset = 0;
+    r->error = f ? NO_ERROR : CANNOT_OPEN_FILE;
+    r->sections = 0;
+    r->no_sections = 0;
+    r->sections_size = 0;
+    r->in_section = false;
+    r->remaining = 0;
+
+    struct file_header header;
+    if (!read_raw(r, &header, sizeof(header)))
+        return false;
+    if (memcmp(header.magic, magic, sizeof(magic)) != 0)
+        return reader_error(r, MALFORMED_FILE);
+    // A file written on a machine with a different byte order
+    // will have the mark reversed. We don't convert.
+    if (header.byte_order != BYTE_ORDER_MARK)
+        return reader_error(r, MALFORMED_FILE);
+    if (header.version > CONTAINER_VERSION)
+        return reader_error(r, UNSUPPORTED_FILE_VERSION);
+    if (kind != 0 && header.kind != kind)
+        return reader_error(r, MALFORMED_FILE);
+
+    r->kind = header.kind;
+    r->version = header.version;
+    return true;
+}
+
+bool begin_read_container_section(
+    struct container_reader *r,
+    uint32_t tag,
+    uint64_t *size
+) {
+    assert(!r->in_section);
+    struct section_header header;
+    if (!read_raw(r, &header, sizeof(header)))
+        return false;
+    if (header.tag != tag)
+        return reader_error(r, MALFORMED_FILE);
+
+    r->in_section = true;
+    r->remaining = header.size;
+    if (size) *size = header.size;
+
+    struct container_section *section =
+        add_section(&r->sections, &r->no_sections, &r->sections_size);
+    section->tag = tag;
+    section->offset = r->offset;
+    section->size = header.size;
+    section->checksum = 0;
+    if (r->verify) init_xxh64(&r->hash, 0);
+    return true;
+}
+
+bool read_container_data(
+    struct container_reader *r,
+    void *buffer,
+    uint64_t size
+) {
+    assert(r->in_section);
+    if (size > r->remaining)
+        return reader_error(r, MALFORMED_FILE);
+    if (!read_raw(r, buffer, size))
+        return false;
+    r->remaining -= size;
+    if (r->verify) update_xxh64(&r->hash, buffer, size);
+    return true;
+}
+
+bool end_read_container_section(
+    struct container_reader *r
+) {
+    assert(r->in_section);
+    r->in_section = false;
+    if (r->remaining != 0)
+        return reader_error(r, MALFORMED_FILE);
+    if (!skip_padding(r))
+        return false;
+
+    struct section_trailer trailer;
+    if (!read_raw(r, &trailer, sizeof(trailer)))
+        return false;
+    struct container_section *section = &r->sections[r->no_sections - 1];
+    section->checksum = trailer.checksum;
+    if (r->verify && digest_xxh64(&r->hash) != trailer.checksum)
+        return reader_error(r, CHECKSUM_MISMATCH);
+    return true;
+}
+
+bool read_container_section(
+    struct container_reader *r,
+    uint32_t tag,
+    void *buffer,
+    uint64_t expected_size
+) {
+    uint64_t size;
+    if (!begin_read_container_section(r, tag, &size))
+        return false;
+    if (size != expected_size) {
+        r->in_section = false;
+        return reader_error(r, MALFORMED_FILE);
+    }
+    return read_container_data(r, buffer, size)
+        && end_read_container_section(r);
+}
+
+void *read_container_section_alloc(
+    struct container_reader *r,
+    uint32_t tag,
+    uint64_t *size
+) {
+    uint64_t section_size;
+    if (!begin_read_container_section(r, tag, &section_size))
+        return 0;
+    // Allocate at least one byte so we can tell an empty
+    // section from an error.
+    void *buffer = malloc(section_size ? section_size : 1);
+    if (!buffer) {
+        r->in_section = false;
+        reader_error(r, MALFORMED_FILE);
+        return 0;
+    }
+    if (!read_container_data(r, buffer, section_size) ||
+        !end_read_container_section(r)) {
+        free(buffer);
+        return 0;
+    }
+    if (size) *size = section_size;
+    return buffer;
+}
+
+static bool check_table(struct container_reader *r)
+{
+    uint64_t table_size;
+    if (!begin_read_container_section(r, TABLE_TAG, &table_size))
+        return false;
+    // The table is not a real section, so take it out again
+    r->in_section = false;
+    r->no_sections--;
+
+    if (table_size != r->no_sections * sizeof(struct table_entry))
+        return reader_error(r, MALFORMED_FILE);
+
+    uint64_t table_offset = r->offset;
+    struct xxh64_state table_hash;
+    init_xxh64(&table_hash, 0);
+    for (uint32_t i = 0; i < r->no_sections; ++i) {
+        struct table_entry entry, expected;
+        if (!read_raw(r, &entry, sizeof(entry)))
+            return false;
+        update_xxh64(&table_hash, &entry, sizeof(entry));
+        table_entry_from_section(&expected, &r->sections[i]);
+        if (memcmp(&entry, &expected, sizeof(entry)) != 0)
+            return reader_error(r, MALFORMED_FILE);
+    }
+
+    struct file_footer footer;
+    if (!read_raw(r, &footer, sizeof(footer)))
+        return false;
+    if (memcmp(footer.magic, magic, sizeof(magic)) != 0 ||
+        footer.table_offset != table_offset ||
+        footer.no_sections != r->no_sections)
+        return reader_error(r, MALFORMED_FILE);
+    if (r->verify && footer.table_checksum != digest_xxh64(&table_hash))
+        return reader_error(r, CHECKSUM_MISMATCH);
+
+    return true;
+}
+
+bool finish_container_reader(
+    struct container_reader *r,
+    enum error_codes *err
+) {
+    if (r->error == NO_ERROR && !r->in_section)
+        check_table(r);
+    else if (r->in_section)
+        reader_error(r, MALFORMED_FILE);
+
+    free(r->sections);
+    r->sections = 0;
+
+    if (err) *err = r->error;
+    return r->error == NO_ERROR;
+}
+
+/// MARK: Memory mapped containers
+
+static bool map_error(
+    struct container_map *map,
+    enum error_codes error,
+    enum error_codes *err
+) {
+    unmap_container(map);
+    if (err) *err = error;
+    return false;
+}
+
+bool map_container_fname(
+    struct container_map *map,
+    const char *fname,
+    uint32_t kind,
+    bool verify,
+    enum error_codes *err
+) {
+    map->data = 0;
+    map->size = 0;
+    map->sections = 0;
+    map->no_sections = 0;
+
+    int fd = open(fname, O_RDONLY);
+    if (fd < 0) return map_error(map, CANNOT_OPEN_FILE, err);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return map_error(map, CANNOT_OPEN_FILE, err);
+    }
+    size_t size = (size_t)st.st_size;
+    if (size < sizeof(struct file_header) + sizeof(struct file_footer)) {
+        close(fd);
+        return map_error(map, TRUNCATED_FILE, err);
+    }
+    void *data = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if (data == MAP_FAILED)
+        return map_error(map, CANNOT_OPEN_FILE, err);
+    map->data = data;
+    map->size = size;
+
+    struct file_header header;
+    memcpy(&header, map->data, sizeof(header));
+    if (memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+        header.byte_order != BYTE_ORDER_MARK)
+        return map_error(map, MALFORMED_FILE, err);
+    if (header.version > CONTAINER_VERSION)
+        return map_error(map, UNSUPPORTED_FILE_VERSION, err);
+    if (kind != 0 && header.kind != kind)
+        return map_error(map, MALFORMED_FILE, err);
+    map->kind = header.kind;
+    map->version = header.version;
+
+    // We find the table through the footer, which must be
+    // the last thing in the file. If it isn't there, the
+    // file was probably cut short.
+    struct file_footer footer;
+    memcpy(&footer, map->data + size - sizeof(footer), sizeof(footer));
+    if (memcmp(footer.magic, magic, sizeof(magic)) != 0)
+        return map_error(map, TRUNCATED_FILE, err);
+    uint64_t table_size = (uint64_t)footer.no_sections * sizeof(struct table_entry);
+    if (footer.table_offset > size ||
+        table_size != size - sizeof(footer) - footer.table_offset)
+        return map_error(map, MALFORMED_FILE, err);
+    const uint8_t *table = map->data + footer.table_offset;
+    if (verify && xxh64(table, table_size, 0) != footer.table_checksum)
+        return map_error(map, CHECKSUM_MISMATCH, err);
+
+    map->sections = malloc((footer.no_sections ? footer.no_sections : 1)
+                           * sizeof(*map->sections));
+    map->no_sections = footer.no_sections;
+    for (uint32_t i = 0; i < footer.no_sections; ++i) {
+        struct table_entry entry;
+        memcpy(&entry, table + i * sizeof(entry), sizeof(entry));
+        struct container_section *section = &map->sections[i];
+        section->tag = entry.tag;
+        section->offset = entry.offset;
+        section->size = entry.size;
+        section->checksum = entry.checksum;
+
+        // The section must be inside the file, before the
+        // table, and have a header that agrees with the table.
+        if (entry.offset < sizeof(struct file_header) + sizeof(struct section_header) ||
+            entry.offset > footer.table_offset ||
+            entry.size > footer.table_offset - entry.offset ||
+            entry.offset % ALIGNMENT != 0)
+            return map_error(map, MALFORMED_FILE, err);
+        struct section_header section_header;
+        memcpy(&section_header,
+               map->data + entry.offset - sizeof(section_header),
+               sizeof(section_header));
+        if (section_header.tag != entry.tag || section_header.size != entry.size)
+            return map_error(map, MALFORMED_FILE, err);
+        if (verify && xxh64(map->data + entry.offset, entry.size, 0) != entry.checksum)
+            return map_error(map, CHECKSUM_MISMATCH, err);
+    }
+
+    if (err) *err = NO_ERROR;
+    return true;
+}
+
+const void *container_map_section(
+    const struct container_map *map,
+    uint32_t tag,
+    uint64_t *size
+) {
+    for (uint32_t i = 0; i < map->no_sections; ++i) {
+        if (map->sections[i].tag == tag) {
+            if (size) *size = map->sections[i].size;
+            return map->data + map->sections[i].offset;
+        }
+    }
+    return 0;
+}
+
+void unmap_container(
+    struct container_map *map
+) {
+    if (map->data) munmap((void *)map->data, map->size);
+    free(map->sections);
+    map->data = 0;
+    map->size = 0;
+    map->sections = 0;
+    map->no_sections = 0;
+}
@@ -0,0 +1,227 @@
+#ifndef CONTAINER_H
+#define CONTAINER_H
+
+#include <error.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * A simple container format for serialising index structures.
+ *
+ * A container starts with a header (magic, format version, a
+ * byte order mark, and a tag saying what kind of data is in
+ * the file), followed by a sequence of sections. Each section
+ * has a tag, a size, its data, and a checksum of the data.
+ * The container ends with a table of all the sections (tag,
+ * offset, size and checksum) and a footer that points to the
+ * table. All section data is aligned on 16 bytes relative to
+ * the start of the container, so a container can be memory
+ * mapped and its arrays used in place.
+ *
+ * Sections are written as a stream. You need to know the
+ * size of a section when you start it, but the data can be
+ * written in as many pieces as you want and is never
+ * buffered by the writer. Offsets are counted from the start
+ * of the container, so you can write more than one container
+ * to the same file, and you can write to a pipe.
+ *
+ * Readers read the sections back in the order they were
+ * written and can optionally verify the checksums.
+ *
+ * Both writers and readers remember the first error they
+ * see. After an error, all operations do nothing (and the
+ * read functions return false), and the error is reported
+ * when you finish the container.
+ **/
+
+#define CONTAINER_VERSION 1
+#define CONTAINER_TAG(a,b,c,d) \
+    ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+/// MARK: Checksums
+// This is the XXH64 hash function. We implement it here so
+// we do not depend on an external library.
+struct xxh64_state {
+    uint64_t total_length;
+    uint64_t v[4];
+    uint8_t buffer[32];
+    uint32_t buffered;
+    uint64_t seed;
+};
+void init_xxh64(
+    struct xxh64_state *state,
+    uint64_t seed
+);
+void update_xxh64(
+    struct xxh64_state *state,
+    const void *data,
+    size_t length
+);
+uint64_t digest_xxh64(
+    const struct xxh64_state *state
+);
+uint64_t xxh64(
+    const void *data,
+    size_t length,
+    uint64_t seed
+);
+
+/// MARK: Writing
+struct container_section {
+    uint32_t tag;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t checksum;
+};
+struct container_writer {
+    FILE *f;
+    uint64_t offset; // bytes written so far
+    enum error_codes error;
+
+    struct container_section *sections;
+    uint32_t no_sections;
+    uint32_t sections_size;
+
+    // The section we are currently writing
+    bool in_section;
+    uint64_t remaining;
+    struct xxh64_state hash;
+};
+
+void init_container_writer(
+    struct container_writer *w,
+    FILE *f,
+    uint32_t kind
+);
+void begin_container_section(
+    struct container_writer *w,
+    uint32_t tag,
+    uint64_t size
+);
+void write_container_data(
+    struct container_writer *w,
+    const void *data,
+    uint64_t size
+);
+void end_container_section(
+    struct container_writer *w
+);
+// Writes a whole section from one buffer.
+void write_container_section(
+    struct container_writer *w,
+    uint32_t tag,
+    const void *data,
+    uint64_t size
+);
+// Writes the section table and the footer and frees the
+// writer's resources. Returns false, and sets err, if
+// anything went wrong while writing the container.
+bool finish_container(
+    struct container_writer *w,
+    enum error_codes *err
+);
+
+/// MARK: Reading
+struct container_reader {
+    FILE *f;
+    bool verify;
+    uint32_t kind;
+    uint32_t version;
+    uint64_t offset; // bytes read so far
+    enum error_codes error;
+
+    struct container_section *sections;
+    uint32_t no_sections;
+    uint32_t sections_size;
+
+    // The section we are currently reading
+    bool in_section;
+    uint64_t remaining;
+    struct xxh64_state hash;
+};
+
+// Reads the header. If kind is not zero, the container
+// must have been written with that kind.
+bool init_container_reader(
+    struct container_reader *r,
+    FILE *f,
+    uint32_t kind,
+    bool verify
+);
+// Reads the header of the next section, which must have
+// the given tag. The size of the section is put in size.
+bool begin_read_container_section(
+    struct container_reader *r,
+    uint32_t tag,
+    uint64_t *size
+);
+bool read_container_data(
+    struct container_reader *r,
+    void *buffer,
+    uint64_t size
+);
+// The section must have been read completely before you
+// end it. This is where we verify the checksum.
+bool end_read_container_section(
+    struct container_reader *r
+);
+// Reads a section of exactly the expected size into buffer.
+bool read_container_section(
+    struct container_reader *r,
+    uint32_t tag,
+    void *buffer,
+    uint64_t expected_size
+);
+// Reads a section into a newly allocated buffer. Returns
+// null if it fails.
+void *read_container_section_alloc(
+    struct container_reader *r,
+    uint32_t tag,
+    uint64_t *size
+);
+// Reads the section table and the footer, checks them
+// against the sections we have read, and frees the reader's
+// resources. Returns false, and sets err, if anything went
+// wrong while reading the container.
+bool finish_container_reader(
+    struct container_reader *r,
+    enum error_codes *err
+);
+
+/// MARK: Memory mapped containers
+// A read-only view of a container file. We map the whole
+// file and find the sections through the section table at
+// the end, so nothing is copied and the sections you don't
+// touch are never read from disk. The container must start
+// at the beginning of the file. If verify is true, we check
+// all the checksums, which means reading the whole file.
+struct container_map {
+    const uint8_t *data;
+    size_t size;
+    uint32_t kind;
+    uint32_t version;
+    struct container_section *sections;
+    uint32_t no_sections;
+};
+bool map_container_fname(
+    struct container_map *map,
+    const char *fname,
+    uint32_t kind,
+    bool verify,
+    enum error_codes *err
+);
+// The data of the first section with the given tag, or null
+// if there is no such section. The size goes in size.
+const void *container_map_section(
+    const struct container_map *map,
+    uint32_t tag,
+    uint64_t *size
+);
+void unmap_container(
+    struct container_map *map
+);
+
+#endif
@@ -1,7 +1,10 @@
 #include "edge_array_suffix_tree.h"
+#include "suffix_tree_internal.h"
 #include "cigar.h"
 
 #include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
 #include <string.h>
 #include <stdio.h>
 #include <assert.h>
@@ -219,21 +222,14 @@ struct ea_suffix_tree *naive_ea_suffix_tree(
     return st;
 }
 
-static struct ea_suffix_tree_node *
-lcp_insert(
+// Moves length_up letters up from the end of v's edge and
+// hangs w there, splitting an edge if we end up inside it.
+static void lcp_attach(
     struct ea_suffix_tree *st,
-    uint32_t i,
-    uint32_t *sa,
-    uint32_t *lcp,
-    struct ea_suffix_tree_node *v
+    struct ea_suffix_tree_node *v,
+    uint32_t length_up,
+    struct ea_suffix_tree_node *w
 ) {
-    struct ea_suffix_tree_node *new_leaf =
-        new_node(st,
-                 st->string + sa[i] + lcp[i],
-                 st->string + st->length);
-    
-    new_leaf->leaf_label = sa[i];
-    uint32_t length_up = st->length - sa[i-1] - lcp[i];
     uint32_t v_edge_len = ea_edge_length(v);
     
     while ((length_up >= v_edge_len)
@@ -243,16 +239,34 @@ lcp_insert(
         v_edge_len = ea_edge_length(v);
     }
     if (length_up == 0) {
-        insert_child(v, new_leaf);
+        insert_child(v, w);
     } else {
         struct ea_suffix_tree_node *u =
             split_edge(st, v, v->range.to - length_up);
-        // Append leaf to the new node
+        // Append w to the new node
         // (it has exactly one other child)
         //u->child->sibling = new_leaf;
         //new_leaf->parent = u;
-        insert_child(u, new_leaf);
+        insert_child(u, w);
     }
+}
+
+static struct ea_suffix_tree_node *
+lcp_insert(
+    struct ea_suffix_tree *st,
+    uint32_t i,
+    uint32_t *sa,
+    uint32_t *lcp,
+    struct ea_suffix_tree_node *v
+) {
+    struct ea_suffix_tree_node *new_leaf =
+        new_node(st,
+                 st->string + sa[i] + lcp[i],
+                 st->string + st->length);
+    
+    new_leaf->leaf_label = sa[i];
+    uint32_t length_up = st->length - sa[i-1] - lcp[i];
+    lcp_attach(st, v, length_up, new_leaf);
     
     return new_leaf;
 }
@@ -280,6 +294,142 @@ lcp_ea_suffix_tree(
     return st;
 }
 
+#pragma mark Parallel LCP construction
+
+struct lcp_build_data {
+    struct ea_suffix_tree *st;
+    uint32_t *sa;
+    uint32_t *lcp;
+    const struct lcp_partition_ *partition;
+    struct ea_suffix_tree_node **slices;
+    struct ea_suffix_tree_node **tops;
+    atomic_uint next_task;
+};
+
+// Builds the subtree for a bucket under a temporary root.
+// The thread gets its own copy of the tree so new_node
+// takes nodes (and child arrays) from the bucket's slice
+// of the pools. The caller gives us the temporary root's
+// child array, and we leave it empty again.
+static void lcp_build_bucket(
+    struct lcp_build_data *data,
+    uint32_t b,
+    struct ea_suffix_tree_node **root_children
+) {
+    uint32_t L = data->partition->buckets[b];
+    uint32_t R = data->partition->buckets[b + 1];
+    uint32_t *sa = data->sa;
+
+    struct ea_suffix_tree local = *data->st;
+    local.node_pool.next_node = data->slices[b];
+    local.children_pool.next_array = local.children_pool.children +
+        (data->slices[b] - local.node_pool.nodes) * local.alphabet_size;
+    struct ea_suffix_tree_node root = {
+        .leaf_label = ~0, .range = { 0, 0 },
+        .parent = &root, .children = root_children
+    };
+    local.root = &root;
+
+    struct ea_suffix_tree_node *v =
+        new_node(&local, local.string + sa[L],
+                 local.string + local.length);
+    v->leaf_label = sa[L];
+    insert_child(&root, v);
+    for (uint32_t i = L + 1; i < R; ++i) {
+        v = lcp_insert(&local, i, sa, data->lcp, v);
+    }
+
+    // All the suffixes share their first letter, so there
+    // is a single node below the temporary root.
+    uint8_t a = local.string[sa[L]];
+    data->tops[b] = root_children[a];
+    root_children[a] = 0;
+}
+
+static void *lcp_build_worker(void *arg)
+{
+    struct lcp_build_data *data = arg;
+    const struct lcp_partition_ *partition = data->partition;
+    struct ea_suffix_tree_node **root_children =
+        calloc(data->st->alphabet_size, sizeof(*root_children));
+    for (;;) {
+        uint32_t t = atomic_fetch_add(&data->next_task, 1);
+        if (t >= partition->no_tasks) break;
+        for (uint32_t b = partition->tasks[t]; b < partition->tasks[t + 1]; ++b)
+            lcp_build_bucket(data, b, root_children);
+    }
+    free(root_children);
+    return 0;
+}
+
+struct ea_suffix_tree *
+parallel_lcp_ea_suffix_tree(
+    uint32_t alphabet_size,
+    const uint8_t *string,
+    uint32_t *sa,
+    uint32_t *lcp,
+    uint32_t no_threads
+) {
+    uint32_t n = (uint32_t)strlen((char *)string) + 1;
+    if (no_threads < 2 || n < PARALLEL_LCP_MIN_LENGTH)
+        return lcp_ea_suffix_tree(alphabet_size, string, sa, lcp);
+
+    struct ea_suffix_tree *st = alloc_suffix_tree(alphabet_size, string);
+    struct lcp_partition_ partition;
+    init_lcp_partition_(&partition, n, lcp, no_threads);
+    uint32_t no_buckets = partition.no_buckets;
+
+    // The node slices are laid out as for the pointer
+    // based tree; see suffix_tree.c.
+    struct ea_suffix_tree_node **slices = malloc(no_buckets * sizeof(*slices));
+    struct ea_suffix_tree_node **tops = malloc(no_buckets * sizeof(*tops));
+    struct ea_suffix_tree_node *next = st->node_pool.next_node;
+    for (uint32_t b = 0; b < no_buckets; ++b) {
+        slices[b] = next;
+        next += 2 * (partition.buckets[b + 1] - partition.buckets[b]) - 1;
+    }
+
+    struct lcp_build_data data = {
+        .st = st, .sa = sa, .lcp = lcp,
+        .partition = &partition,
+        .slices = slices, .tops = tops
+    };
+    atomic_init(&data.next_task, 0);
+    pthread_t *threads = malloc(no_threads * sizeof(*threads));
+    uint32_t no_started = 0;
+    for (; no_started < no_threads; ++no_started) {
+        if (pthread_create(&threads[no_started], 0, lcp_build_worker, &data))
+            break;
+    }
+    if (no_started == 0) lcp_build_worker(&data);
+    for (uint32_t i = 0; i < no_started; ++i)
+        pthread_join(threads[i], 0);
+    free(threads);
+
+    // Stitch the subtrees together at the top of the tree.
+    st->node_pool.next_node = next;
+    st->children_pool.next_array = st->children_pool.children +
+        (next - st->node_pool.nodes) * st->alphabet_size;
+    struct ea_suffix_tree_node *v = tops[0];
+    insert_child(st->root, v);
+    uint32_t v_depth = ea_edge_length(v);
+    for (uint32_t b = 1; b < no_buckets; ++b) {
+        struct ea_suffix_tree_node *w = tops[b];
+        uint32_t w_depth = ea_edge_length(w);
+        uint32_t branch_depth = lcp[partition.buckets[b]];
+        w->range.from += branch_depth;
+        lcp_attach(st, v, v_depth - branch_depth, w);
+        v = w;
+        v_depth = w_depth;
+    }
+    assert(st->node_pool.next_node <= st->node_pool.nodes + 2 * n - 1);
+
+    free(slices);
+    free(tops);
+    dealloc_lcp_partition_(&partition);
+    return st;
+}
+
 static struct ea_suffix_tree_node *
 fast_scan(
     struct ea_suffix_tree *st,
@@ -431,6 +581,169 @@ void free_ea_suffix_tree(
     free(st);
 }
 
+void free_complete_ea_suffix_tree(
+    struct ea_suffix_tree *st
+) {
+    free((uint8_t *)st->string);
+    free_ea_suffix_tree(st);
+}
+
+
+#pragma mark Serialisation
+
+// We number the nodes family by family, as the families
+// layout for pointer trees, so the siblings are consecutive
+// in the file.
+static struct st_file_node *
+ea_st_file_nodes(
+    const struct ea_suffix_tree *st,
+    uint32_t *no_nodes
+) {
+    struct ea_suffix_tree_node *pool = st->node_pool.nodes;
+    uint32_t pool_size = (uint32_t)(st->node_pool.next_node - pool);
+    uint32_t *index = malloc(pool_size * sizeof(*index));
+    struct ea_suffix_tree_node **order = malloc(pool_size * sizeof(*order));
+    struct st_file_node *nodes = malloc(pool_size * sizeof(*nodes));
+    uint32_t sigma = st->alphabet_size;
+
+    // We fill in the siblings when we number a family, so we
+    // clear the nodes first.
+    memset(nodes, 0, pool_size * sizeof(*nodes));
+    for (uint32_t i = 0; i < pool_size; ++i)
+        nodes[i].child = nodes[i].sibling = ST_FILE_NIL;
+
+    uint32_t n = 0;
+    index[st->root - pool] = n;
+    order[n++] = st->root;
+    for (uint32_t i = 0; i < n; ++i) {
+        struct ea_suffix_tree_node *v = order[i];
+        struct st_file_node *u = &nodes[i];
+        if (v != st->root) {
+            u->from = (uint32_t)(v->range.from - st->string);
+            u->to = (uint32_t)(v->range.to - st->string);
+        }
+        if (is_leaf(v)) {
+            u->leaf_label = v->leaf_label;
+            continue;
+        }
+        for (uint32_t a = 0; a < sigma; ++a) {
+            struct ea_suffix_tree_node *w = v->children[a];
+            if (!w) continue;
+            if (u->child == ST_FILE_NIL) u->child = n;
+            else nodes[n - 1].sibling = n;
+            index[w - pool] = n;
+            order[n++] = w;
+        }
+    }
+
+    // Now all the reachable nodes have an index.
+    for (uint32_t i = 0; i < n; ++i) {
+        struct ea_suffix_tree_node *v = order[i];
+        nodes[i].parent = index[v->parent - pool];
+        nodes[i].suffix_link =
+            v->suffix_link ? index[v->suffix_link - pool] : ST_FILE_NIL;
+    }
+
+    free(order);
+    free(index);
+    *no_nodes = n;
+    return nodes;
+}
+
+bool write_ea_suffix_tree(
+    FILE *f,
+    const struct ea_suffix_tree *st,
+    enum error_codes *err
+) {
+    uint32_t no_nodes;
+    struct st_file_node *nodes = ea_st_file_nodes(st, &no_nodes);
+    bool ok = write_st_file_(f, st->string, st->length, no_nodes, nodes, err);
+    free(nodes);
+    return ok;
+}
+
+bool write_ea_suffix_tree_fname(
+    const char *fname,
+    const struct ea_suffix_tree *st,
+    enum error_codes *err
+) {
+    FILE *f = fopen(fname, "wb");
+    if (!f) {
+        if (err) *err = CANNOT_OPEN_FILE;
+        return false;
+    }
+    bool ok = write_ea_suffix_tree(f, st, err);
+    if (fclose(f) != 0 && ok) {
+        if (err) *err = CANNOT_WRITE_FILE;
+        ok = false;
+    }
+    return ok;
+}
+
+struct ea_suffix_tree *
+read_ea_suffix_tree(
+    FILE *f,
+    uint32_t alphabet_size,
+    bool verify,
+    enum error_codes *err
+) {
+    uint8_t *string;
+    uint32_t length, no_nodes;
+    struct st_file_node *file_nodes;
+    if (!read_st_file_(f, verify, &string, &length, &no_nodes, &file_nodes, err))
+        return 0;
+    for (uint32_t i = 0; i < length; ++i) {
+        if (string[i] >= alphabet_size) {
+            free(string);
+            free(file_nodes);
+            if (err) *err = MALFORMED_FILE;
+            return 0;
+        }
+    }
+
+    // read_st_file_ checked that the nodes fit in the pool.
+    struct ea_suffix_tree *st = alloc_suffix_tree(alphabet_size, string);
+    for (uint32_t i = 1; i < no_nodes; ++i)
+        new_node(st, 0, 0);
+
+    struct ea_suffix_tree_node *nodes = st->node_pool.nodes;
+    for (uint32_t i = 0; i < no_nodes; ++i) {
+        const struct st_file_node *u = &file_nodes[i];
+        struct ea_suffix_tree_node *v = &nodes[i];
+        if (i != 0) {
+            v->range.from = string + u->from;
+            v->range.to = string + u->to;
+        }
+        v->leaf_label = (u->child == ST_FILE_NIL) ? u->leaf_label : ~0;
+        v->parent = nodes + u->parent;
+        v->suffix_link =
+            (u->suffix_link == ST_FILE_NIL) ? 0 : nodes + u->suffix_link;
+        for (uint32_t w = u->child; w != ST_FILE_NIL; w = file_nodes[w].sibling) {
+            v->children[string[file_nodes[w].from]] = nodes + w;
+        }
+    }
+
+    free(file_nodes);
+    return st;
+}
+
+struct ea_suffix_tree *
+read_ea_suffix_tree_fname(
+    const char *fname,
+    uint32_t alphabet_size,
+    bool verify,
+    enum error_codes *err
+) {
+    FILE *f = fopen(fname, "rb");
+    if (!f) {
+        if (err) *err = CANNOT_OPEN_FILE;
+        return 0;
+    }
+    struct ea_suffix_tree *st = read_ea_suffix_tree(f, alphabet_size, verify, err);
+    fclose(f);
+    return st;
+}
+
 
 #pragma mark API
 
@@ -490,70 +803,44 @@ void get_ea_path_string(
 
 // Iteration
 
-struct ea_st_leaf_iter_frame {
-    struct ea_st_leaf_iter_frame *next;
-    struct ea_suffix_tree_node *node;
-};
-static struct ea_st_leaf_iter_frame *
-new_frame(struct ea_suffix_tree_node *node)
-{
-    struct ea_st_leaf_iter_frame *frame =
-        malloc(sizeof(struct ea_st_leaf_iter_frame));
-    frame->node = node;
-    frame->next = 0;
-    return frame;
-}
-
 void init_ea_st_leaf_iter(
     struct ea_st_leaf_iter *iter,
     struct ea_suffix_tree *st,
     struct ea_suffix_tree_node *node
 ) {
     iter->st = st;
-    if (node) iter->stack = new_frame(node);
-    else iter->stack = 0;
+    init_pointer_vector(&iter->stack, 16);
+    reset_ea_st_leaf_iter(iter, node);
 }
 
-static void reverse_push_children(
+void reset_ea_st_leaf_iter(
     struct ea_st_leaf_iter *iter,
-    struct ea_suffix_tree_node *v
+    struct ea_suffix_tree_node *node
 ) {
-    for (uint32_t i = iter->st->alphabet_size; i > 0; --i) {
-        struct ea_suffix_tree_node *w = v->children[i - 1];
-        if (!w) continue;
-        struct ea_st_leaf_iter_frame *child_frame = new_frame(w);
-        child_frame->next = iter->stack;
-        iter->stack = child_frame;
-    }
+    iter->stack.used = 0;
+    if (node) pointer_vector_append(&iter->stack, (void *)node);
 }
 
 bool next_ea_st_leaf(
     struct ea_st_leaf_iter *iter,
     struct ea_st_leaf_iter_result *res
 ) {
-    struct ea_st_leaf_iter_frame *frame = iter->stack;
-    while (frame) {
-        // pop the frame
-        iter->stack = frame->next;
-        struct ea_suffix_tree_node *node = frame->node;
+    struct pointer_vector *stack = &iter->stack;
+    while (stack->used > 0) {
+        struct ea_suffix_tree_node *node = stack->data[--stack->used];
         
         if (is_inner_node(node)) {
             // we have to push in reverse order to get
             // an in-order depth-first traversal
-            reverse_push_children(iter, node);
-            
+            for (uint32_t i = iter->st->alphabet_size; i > 0; --i) {
+                struct ea_suffix_tree_node *w = node->children[i - 1];
+                if (w) pointer_vector_append(stack, (void *)w);
+            }
         } else {
-            // leaf
-            // clean up and return result
             assert(is_leaf(node));
-            free(frame);
             res->leaf = node;
             return true;
         }
-        
-        // get rid of the frame and pop the next
-        free(frame);
-        frame = iter->stack;
     }
     return false;
 }
@@ -561,12 +848,7 @@ bool next_ea_st_leaf(
 void dealloc_ea_st_leaf_iter(
     struct ea_st_leaf_iter *iter
 ) {
-    struct ea_st_leaf_iter_frame *frame = iter->stack;
-    while (frame) {
-        struct ea_st_leaf_iter_frame *next = frame->next;
-        free(frame);
-        frame = next;
-    }
+    dealloc_pointer_vector(&iter->stack);
 }
 
 // Searching
@@ -614,6 +896,14 @@ void init_ea_st_search_iter(
     init_ea_st_leaf_iter(&iter->leaf_iter, st, match);
 }
 
+void reset_ea_st_search_iter(
+    struct ea_st_search_iter *iter,
+    struct ea_suffix_tree *st,
+    const uint8_t *p
+) {
+    reset_ea_st_leaf_iter(&iter->leaf_iter, ea_st_search(st, p));
+}
+
 bool next_ea_st_match(
     struct ea_st_search_iter *iter,
     struct ea_st_search_match *match
@@ -636,7 +926,7 @@ void dealloc_ea_st_search_iter(
 #pragma mark Approximative
 /// ----------------------Aproximative matching ---------------------------------------------------------
 static void push_frame(
-    struct ea_st_approx_frame *sentinel,
+    struct internal_ea_st_approx_iter *iter,
     struct ea_suffix_tree_node *v,
     bool leading,
     const uint8_t *x, const uint8_t *end,
@@ -645,7 +935,12 @@ static void push_frame(
     char cigar_op, char *cigar,
     int edit
 ) {
-    struct ea_st_approx_frame *frame = malloc(sizeof(struct ea_st_approx_frame));
+    if (iter->no_frames == iter->frames_size) {
+        iter->frames_size *= 2;
+        iter->frames = realloc(iter->frames,
+                               iter->frames_size * sizeof(*iter->frames));
+    }
+    struct ea_st_approx_frame *frame = &iter->frames[iter->no_frames++];
     frame->v = v;
     frame->leading = leading;
     frame->x = x;
@@ -655,12 +950,10 @@ static void push_frame(
     frame->cigar_op = cigar_op;
     frame->cigar = cigar;
     frame->edit = edit;
-    frame->next = sentinel->next;
-    sentinel->next = frame;
 }
 
 static void pop_frame(
-    struct ea_st_approx_frame *sentinel,
+    struct internal_ea_st_approx_iter *iter,
     struct ea_suffix_tree_node **v,
     bool *leading,
     const uint8_t **x, const uint8_t **end,
@@ -670,8 +963,7 @@ static void pop_frame(
     char **cigar,
     int *edit
 ) {
-    struct ea_st_approx_frame *frame = sentinel->next;
-    sentinel->next = frame->next;
+    struct ea_st_approx_frame *frame = &iter->frames[--iter->no_frames];
     *v = frame->v;
     *leading = frame->leading;
     *x = frame->x;
@@ -681,8 +973,6 @@ static void pop_frame(
     *cigar_op = frame->cigar_op;
     *cigar = frame->cigar;
     *edit = frame->edit;
-
-    free(frame);
 }
 
 
@@ -701,7 +991,7 @@ static void push_children(
         if (!child) continue;
         const uint8_t *x = child->range.from;
         const uint8_t *end = child->range.to;
-        push_frame(&iter->sentinel, child,
+        push_frame(iter, child,
                    leading,
                    x, end, match_depth,
                    p, '\0', cigar, edits);
@@ -717,7 +1007,9 @@ void init_internal_ea_st_approx_iter(
     // one edit can max cost four characters
     uint32_t m = (uint32_t)(strlen((char *)p) + 4*edits + 1);
     iter->st = st;
-    iter->sentinel.next = 0;
+    iter->frames_size = 16;
+    iter->frames = malloc(iter->frames_size * sizeof(*iter->frames));
+    iter->no_frames = 0;
     iter->full_cigar_buf = malloc(m + 1);
     iter->full_cigar_buf[0] = '\0';
     iter->cigar_buf = malloc(m + 1);
@@ -732,6 +1024,7 @@ void dealloc_internal_ea_st_approx_iter(
 ) {
     free(iter->full_cigar_buf);
     free(iter->cigar_buf);
+    free(iter->frames);
 }
 
 
@@ -753,8 +1046,8 @@ bool next_internal_ea_st_approx_match(
     // of the string (and access memory we shouldn't)
     const uint8_t *string_end = iter->st->string + iter->st->length;
     
-    while (iter->sentinel.next) {
-        pop_frame(&iter->sentinel, &v,
+    while (iter->no_frames > 0) {
+        pop_frame(iter, &v,
                   &leading,
                   &x, &end,
                   &match_depth, &p, &cigar_op, &cigar, &edit);
@@ -791,19 +1084,19 @@ bool next_internal_ea_st_approx_match(
         
         // recursion
         int match_cost = *p != *x;
-        push_frame(&iter->sentinel, v,
+        push_frame(iter, v,
                    false,
                    x + 1, end,
                    match_depth + 1, p + 1, 'M', cigar + 1,
                    edit - match_cost);
         if (!leading) {
-            push_frame(&iter->sentinel, v,
+            push_frame(iter, v,
                        false,
                        x + 1, end,
                        match_depth + 1, p, 'D', cigar + 1,
                        edit - 1);
         }
-        push_frame(&iter->sentinel, v,
+        push_frame(iter, v,
                    false,
                    x, end,
                    match_depth, p + 1, 'I', cigar + 1,
@@ -822,10 +1115,11 @@ void init_ea_st_approx_iter(
     
     iter->approx_iter = malloc(sizeof(struct internal_ea_st_approx_iter));
     init_internal_ea_st_approx_iter(iter->approx_iter, st, pattern, edits);
+    // We reuse the leaf iterator for all the hits
     iter->leaf_iter = malloc(sizeof(struct ea_st_leaf_iter));
+    init_ea_st_leaf_iter(iter->leaf_iter, st, 0);
     
     iter->outer = true;
-    iter->has_inner = false;
 }
 
 bool next_ea_st_approx_match(struct ea_st_approx_match_iter *iter,
@@ -835,18 +1129,12 @@ bool next_ea_st_approx_match(struct ea_st_approx_match_iter *iter,
     struct ea_st_leaf_iter_result inner_match;
     
     if (iter->outer) {
-        if (iter->has_inner) {
-            dealloc_ea_st_leaf_iter(iter->leaf_iter);
-            iter->has_inner = false;
-        }
         if (next_internal_ea_st_approx_match(iter->approx_iter, &outer_match)) {
             match->cigar = outer_match.cigar;
             match->match_depth = outer_match.match_depth;
             match->root = outer_match.match_root;
             
-            init_ea_st_leaf_iter(iter->leaf_iter, iter->st,
-                                 outer_match.match_root);
-            iter->has_inner = true;
+            reset_ea_st_leaf_iter(iter->leaf_iter, outer_match.match_root);
             
             iter->outer = false;
             return next_ea_st_approx_match(iter, match);
@@ -870,9 +1158,7 @@ void dealloc_ea_st_approx_iter(
 ) {
     dealloc_internal_ea_st_approx_iter(iter->approx_iter);
     free(iter->approx_iter);
-    if (iter->has_inner) {
-        dealloc_ea_st_leaf_iter(iter->leaf_iter);
-    }
+    dealloc_ea_st_leaf_iter(iter->leaf_iter);
     free(iter->leaf_iter);
 }
 
@@ -882,39 +1168,29 @@ struct sa_lcp_frame {
     struct ea_suffix_tree_node *v;
     uint32_t left_depth;
     uint32_t node_depth;
-    struct sa_lcp_frame *next;
 };
-static struct sa_lcp_frame *new_lcp_frame(
-    struct ea_suffix_tree_node *v,
-    uint32_t left_depth,
-    uint32_t node_depth,
-    struct sa_lcp_frame *next
-) {
-    struct sa_lcp_frame *new = malloc(sizeof(struct sa_lcp_frame));
-    new->v = v;
-    new->left_depth = left_depth;
-    new->node_depth = node_depth;
-    new->next = next;
-    return new;
-}
 
 static void lcp_traverse(
     struct ea_suffix_tree *st,
     uint32_t *sa,
     uint32_t *lcp
 ) {
-    struct sa_lcp_frame *stack = new_lcp_frame(st->root, 0, 0, 0);
+    // Every node is pushed exactly once, so the stack
+    // can never be larger than the number of nodes.
+    uint32_t no_nodes = (uint32_t)(st->node_pool.next_node - st->node_pool.nodes);
+    struct sa_lcp_frame *stack = malloc(no_nodes * sizeof(*stack));
+    uint32_t used = 0;
     uint32_t idx = 0;
 
-    while (stack) {
-
-        struct sa_lcp_frame *frame = stack;
-        stack = stack->next;
+    stack[used++] = (struct sa_lcp_frame){ st->root, 0, 0 };
+    while (used > 0) {
+        struct sa_lcp_frame frame = stack[--used];
+        struct ea_suffix_tree_node *v = frame.v;
         
-        if (is_leaf(frame->v)) {
+        if (is_leaf(v)) {
             // Leaf
-            sa[idx] = frame->v->leaf_label;
-            lcp[idx] = frame->left_depth;
+            sa[idx] = v->leaf_label;
+            lcp[idx] = frame.left_depth;
             idx++;
             
         } else {
@@ -924,25 +1200,28 @@ static void lcp_traverse(
             // the LCP is relative to the last node in the previous
             // leaf in v's previous sibling.
             
-            uint32_t this_depth = frame->node_depth + ea_edge_length(frame->v);
+            uint32_t this_depth = frame.node_depth + ea_edge_length(v);
             
             uint32_t i = 0;
             struct ea_suffix_tree_node *first_child = 0;
             for ( ; i < st->alphabet_size; ++i) {
-                first_child = frame->v->children[i];
+                first_child = v->children[i];
                 if (first_child) break;
             }
             for (uint32_t j = st->alphabet_size; j - 1 > i; j--) {
-                struct ea_suffix_tree_node *child = frame->v->children[j - 1];
+                struct ea_suffix_tree_node *child = v->children[j - 1];
                 if (!child) continue;
-                stack = new_lcp_frame(child, this_depth, this_depth, stack);
+                stack[used++] = (struct sa_lcp_frame){
+                    child, this_depth, this_depth
+                };
             }
-
-            stack = new_lcp_frame(first_child, frame->left_depth, this_depth, stack);
+            stack[used++] = (struct sa_lcp_frame){
+                first_child, frame.left_depth, this_depth
+            };
         }
-        
-        free(frame);
     }
+    
+    free(stack);
 }
 
 void ea_st_compute_sa_and_lcp(
@@ -57,6 +57,16 @@ lcp_ea_suffix_tree(
     uint32_t *lcp
 );
 
+// See parallel_lcp_suffix_tree in suffix_tree.h
+struct ea_suffix_tree *
+parallel_lcp_ea_suffix_tree(
+    uint32_t alphabet_size,
+    const uint8_t *string,
+    uint32_t *sa,
+    uint32_t *lcp,
+    uint32_t no_threads
+);
+
 void annotate_ea_suffix_links(
     struct ea_suffix_tree *st
 );
@@ -65,6 +75,40 @@ void annotate_ea_suffix_links(
 void free_ea_suffix_tree(
     struct ea_suffix_tree *st
 );
+// Also frees the string; use it for trees you have read.
+void free_complete_ea_suffix_tree(
+    struct ea_suffix_tree *st
+);
+
+// Serialisation. The file format is the one from
+// suffix_tree.h, so you can write an edge array tree and read
+// it as a pointer based tree or the other way around. All the
+// letters in the string must be less than alphabet_size when
+// you read a tree, or you get MALFORMED_FILE.
+bool write_ea_suffix_tree(
+    FILE *f,
+    const struct ea_suffix_tree *st,
+    enum error_codes *err
+);
+bool write_ea_suffix_tree_fname(
+    const char *fname,
+    const struct ea_suffix_tree *st,
+    enum error_codes *err
+);
+struct ea_suffix_tree *
+read_ea_suffix_tree(
+    FILE *f,
+    uint32_t alphabet_size,
+    bool verify,
+    enum error_codes *err
+);
+struct ea_suffix_tree *
+read_ea_suffix_tree_fname(
+    const char *fname,
+    uint32_t alphabet_size,
+    bool verify,
+    enum error_codes *err
+);
 
 // Suffix array and LCP
 void ea_st_compute_sa_and_lcp(
@@ -73,10 +117,11 @@ void ea_st_compute_sa_and_lcp(
     uint32_t *lcp
 );
 
-// Iteration
+// Iteration. As for the other suffix trees, the stack is a
+// vector you can reuse with reset_ea_st_leaf_iter.
 struct ea_st_leaf_iter {
     struct ea_suffix_tree *st;
-    struct ea_st_leaf_iter_frame *stack;
+    struct pointer_vector stack;
 };
 struct ea_st_leaf_iter_result {
     struct ea_suffix_tree_node *leaf;
@@ -91,6 +136,10 @@ bool next_ea_st_leaf(
     struct ea_st_leaf_iter *iter,
     struct ea_st_leaf_iter_result *res
 );
+void reset_ea_st_leaf_iter(
+    struct ea_st_leaf_iter *iter,
+    struct ea_suffix_tree_node *node
+);
 void dealloc_ea_st_leaf_iter(
     struct ea_st_leaf_iter *iter
 );
@@ -118,6 +167,11 @@ bool next_ea_st_match(
     struct ea_st_search_iter *iter,
     struct ea_st_search_match *match
 );
+void reset_ea_st_search_iter(
+    struct ea_st_search_iter *iter,
+    struct ea_suffix_tree *st,
+    const uint8_t *p
+);
 void dealloc_ea_st_search_iter(
     struct ea_st_search_iter *iter
 );
@@ -125,7 +179,6 @@ void dealloc_ea_st_search_iter(
 
 
 struct ea_st_approx_frame {
-    struct ea_st_approx_frame *next;
     struct ea_suffix_tree_node *v;
     bool leading; // for avoiding leading deletions
     const uint8_t *x;
@@ -139,7 +192,11 @@ struct ea_st_approx_frame {
 
 struct internal_ea_st_approx_iter {
     struct ea_suffix_tree *st;
-    struct ea_st_approx_frame sentinel;
+    // The frames are a stack we grow as needed and reuse,
+    // so we don't allocate per frame.
+    struct ea_st_approx_frame *frames;
+    uint32_t no_frames;
+    uint32_t frames_size;
     char *full_cigar_buf;
     char *cigar_buf;
 };
@@ -169,7 +226,6 @@ struct ea_st_approx_match_iter {
     struct internal_ea_st_approx_iter *approx_iter;
     struct ea_st_leaf_iter *leaf_iter;
     bool outer;
-    bool has_inner;
 };
 struct ea_st_approx_match {
     struct ea_suffix_tree_node *root;
@@ -10,7 +10,11 @@ enum error_codes {
     
     // I/O
     CANNOT_OPEN_FILE,
+    CANNOT_WRITE_FILE,
     MALFORMED_FILE,
+    TRUNCATED_FILE,
+    CHECKSUM_MISMATCH,
+    UNSUPPORTED_FILE_VERSION,
     
     // Comparisons
     SUFFIX_ARRAYS_DIFFER,
@@ -0,0 +1,110 @@
+#include "generalised_suffix_array.h"
+#include "suffix_array_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+struct generalised_suffix_array *
+gsa_construction(
+    uint32_t no_strings,
+    const uint8_t **strings
+) {
+    assert(no_strings > 0);
+
+    struct generalised_suffix_array *gsa = malloc(sizeof(*gsa));
+    gsa->no_strings = no_strings;
+    gsa->string_starts = malloc((no_strings + 1) * sizeof(uint32_t));
+
+    uint32_t total = 0;
+    for (uint32_t k = 0; k < no_strings; ++k) {
+        gsa->string_starts[k] = total;
+        total += (uint32_t)strlen((char *)strings[k]) + 1;
+    }
+    gsa->string_starts[no_strings] = total;
+
+    init_rank_bitvector(&gsa->starts, total);
+    for (uint32_t k = 0; k < no_strings; ++k) {
+        set_bit(&gsa->starts, gsa->string_starts[k]);
+    }
+    build_rank_bitvector(&gsa->starts);
+
+    // SA-IS wants a dense alphabet, so we number the
+    // letters we actually see.
+    uint32_t letters[256] = { 0 };
+    for (uint32_t k = 0; k < no_strings; ++k) {
+        for (const uint8_t *s = strings[k]; *s; ++s)
+            letters[*s] = 1;
+    }
+    uint32_t no_letters = 0;
+    for (uint32_t a = 1; a < 256; ++a) {
+        if (letters[a]) letters[a] = ++no_letters;
+    }
+
+    // The concatenation the user sees has zeros between the
+    // strings. For sorting, we give string k < no_strings - 1
+    // the sentinel k + 1 and move the letters up above all the
+    // sentinels. The last string gets the real sentinel, 0.
+    uint8_t *concat = malloc(total);
+    uint32_t *x = malloc(total * sizeof(uint32_t));
+    uint32_t shift = no_strings - 1;
+    uint32_t i = 0;
+    for (uint32_t k = 0; k < no_strings; ++k) {
+        for (const uint8_t *s = strings[k]; *s; ++s, ++i) {
+            concat[i] = *s;
+            x[i] = letters[*s] + shift;
+        }
+        concat[i] = '\0';
+        x[i] = (k == no_strings - 1) ? 0 : k + 1;
+        i++;
+    }
+    assert(i == total);
+
+    struct suffix_array *sa = malloc(sizeof(struct suffix_array));
+    sa->string = concat;
+    sa->length = total;
+    sa->array = malloc(total * sizeof(*sa->array));
+    sa->inverse = 0;
+    sa->lcp = 0;
+    sa_is_sort_integers_(x, total - 1, no_letters + shift + 1, sa->array);
+    free(x);
+
+    gsa->sa = sa;
+    return gsa;
+}
+
+void free_generalised_suffix_array(
+    struct generalised_suffix_array *gsa
+) {
+    free_complete_suffix_array(gsa->sa);
+    free(gsa->string_starts);
+    dealloc_rank_bitvector(&gsa->starts);
+    free(gsa);
+}
+
+void init_gsa_match_iter(
+    struct gsa_match_iter *iter,
+    const uint8_t *pattern,
+    const struct generalised_suffix_array *gsa
+) {
+    iter->gsa = gsa;
+    init_sa_match_iter(&iter->sa_iter, pattern, gsa->sa);
+}
+
+bool next_gsa_match(
+    struct gsa_match_iter *iter,
+    struct gsa_match *match
+) {
+    struct sa_match sa_match;
+    if (!next_sa_match(&iter->sa_iter, &sa_match))
+        return false;
+    gsa_position(iter->gsa, sa_match.position,
+                 &match->string_index, &match->offset);
+    return true;
+}
+
+void dealloc_gsa_match_iter(
+    struct gsa_match_iter *iter
+) {
+    dealloc_sa_match_iter(&iter->sa_iter);
+}
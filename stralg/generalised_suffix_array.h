@@ -0,0 +1,87 @@
+#ifndef GENERALISED_SUFFIX_ARRAY_H
+#define GENERALISED_SUFFIX_ARRAY_H
+
+#include <suffix_array.h>
+#include <bitvectors.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * A generalised suffix array indexes a set of strings in
+ * one suffix array. The strings are concatenated with a zero
+ * byte after each of them, and the suffixes are sorted as if
+ * each of those zeros were a distinct sentinel, so no suffix
+ * comparison ever crosses from one string into the next.
+ *
+ * The underlying suffix array works with the usual search
+ * functions (init_sa_match_iter, sa_batch_search, ...)
+ * and with compute_lcp. Positions in it refer to the
+ * concatenated string; use gsa_position() to get the
+ * string and the offset within that string.
+ **/
+struct generalised_suffix_array {
+    struct suffix_array *sa;
+    uint32_t no_strings;
+    // Where each string starts in the concatenation. There is
+    // an extra entry at the end with the total length.
+    uint32_t *string_starts;
+    // One bit for each position in the concatenation, set
+    // where a string starts.
+    struct rank_bitvector starts;
+};
+
+// The strings do not need to be remapped, but if you remap
+// them you must remap patterns the same way. The strings are
+// copied, so you can free them after the construction.
+struct generalised_suffix_array *
+gsa_construction(
+    uint32_t no_strings,
+    const uint8_t **strings
+);
+// This frees the concatenated string as well.
+void free_generalised_suffix_array(
+    struct generalised_suffix_array *gsa
+);
+
+// The string a position belongs to. The zero after a string
+// belongs to that string.
+static inline uint32_t gsa_string_index(
+    const struct generalised_suffix_array *gsa,
+    uint32_t position
+) {
+    return bitvector_rank(&gsa->starts, position + 1) - 1;
+}
+static inline void gsa_position(
+    const struct generalised_suffix_array *gsa,
+    uint32_t position,
+    uint32_t *string_index,
+    uint32_t *offset
+) {
+    uint32_t idx = gsa_string_index(gsa, position);
+    *string_index = idx;
+    *offset = position - gsa->string_starts[idx];
+}
+
+struct gsa_match_iter {
+    const struct generalised_suffix_array *gsa;
+    struct sa_match_iter sa_iter;
+};
+struct gsa_match {
+    uint32_t string_index;
+    uint32_t offset;
+};
+void init_gsa_match_iter(
+    struct gsa_match_iter *iter,
+    const uint8_t *pattern,
+    const struct generalised_suffix_array *gsa
+);
+bool next_gsa_match(
+    struct gsa_match_iter *iter,
+    struct gsa_match *match
+);
+void dealloc_gsa_match_iter(
+    struct gsa_match_iter *iter
+);
+
+#endif
@@ -0,0 +1,139 @@
+#include "lce.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+/// MARK: Range minimum queries
+
+void init_rmq_table(
+    struct rmq_table *rmq,
+    const uint32_t *values,
+    uint32_t n
+) {
+    rmq->values = values;
+    rmq->n = n;
+    rmq->no_blocks = (n + RMQ_BLOCK_SIZE - 1) / RMQ_BLOCK_SIZE;
+    rmq->prefix_min = malloc((n ? n : 1) * sizeof(*rmq->prefix_min));
+    rmq->suffix_min = malloc((n ? n : 1) * sizeof(*rmq->suffix_min));
+
+    for (uint32_t b = 0; b < rmq->no_blocks; ++b) {
+        uint32_t start = b * RMQ_BLOCK_SIZE;
+        uint32_t end = start + RMQ_BLOCK_SIZE;
+        if (end > n) end = n;
+        rmq->prefix_min[start] = start;
+        for (uint32_t i = start + 1; i < end; ++i)
+            rmq->prefix_min[i] = rmq_min_index_(values, rmq->prefix_min[i - 1], i);
+        rmq->suffix_min[end - 1] = end - 1;
+        for (uint32_t i = end - 1; i > start; --i)
+            rmq->suffix_min[i - 1] = rmq_min_index_(values, i - 1, rmq->suffix_min[i]);
+    }
+
+    // Level zero is the block minima, and level k combines
+    // two overlapping ranges from level k - 1.
+    uint32_t levels = 1;
+    while ((1u << levels) <= rmq->no_blocks) levels++;
+    rmq->no_levels = levels;
+    size_t table_size = (size_t)levels * rmq->no_blocks;
+    rmq->table = malloc((table_size ? table_size : 1) * sizeof(*rmq->table));
+    for (uint32_t b = 0; b < rmq->no_blocks; ++b)
+        rmq->table[b] = rmq->prefix_min[
+            (b + 1) * RMQ_BLOCK_SIZE > n ? n - 1 : (b + 1) * RMQ_BLOCK_SIZE - 1
+        ];
+    for (uint32_t k = 1; k < levels; ++k) {
+        const uint32_t *prev = rmq->table + (size_t)(k - 1) * rmq->no_blocks;
+        uint32_t *level = rmq->table + (size_t)k * rmq->no_blocks;
+        uint32_t half = 1u << (k - 1);
+        for (uint32_t b = 0; b + 2 * half <= rmq->no_blocks; ++b)
+            level[b] = rmq_min_index_(values, prev[b], prev[b + half]);
+    }
+}
+
+void dealloc_rmq_table(
+    struct rmq_table *rmq
+) {
+    free(rmq->prefix_min);
+    free(rmq->suffix_min);
+    free(rmq->table);
+}
+
+/// MARK: Suffix tree LCA
+
+struct st_lca *
+alloc_st_lca(
+    const struct suffix_tree *st
+) {
+    assert(!st->pool.chunks || st->pool.chunks->used == 0);
+    uint32_t pool_size = (uint32_t)(st->pool.next_node - st->pool.nodes);
+
+    struct st_lca *lca = malloc(sizeof(struct st_lca));
+    lca->st = st;
+    lca->tour = malloc(2 * pool_size * sizeof(*lca->tour));
+    lca->depth = malloc(2 * pool_size * sizeof(*lca->depth));
+    lca->first = malloc(pool_size * sizeof(*lca->first));
+    lca->leaf_first = malloc(st->length * sizeof(*lca->leaf_first));
+
+    // We walk the tree through the parent and sibling
+    // pointers, so we don't need a stack. We emit a node when
+    // we enter it and every time we return to it from a child.
+    uint32_t t = 0;
+    uint32_t depth = 0;
+    const struct suffix_tree_node *v = st->root;
+    const struct suffix_tree_node *w = v->child;
+    lca->first[v - st->pool.nodes] = t;
+    lca->tour[t] = v;
+    lca->depth[t++] = 0;
+    for (;;) {
+        if (w) {
+            v = w;
+            depth += range_length(v->range);
+            lca->first[v - st->pool.nodes] = t;
+            if (!v->child) lca->leaf_first[v->leaf_label] = t;
+            lca->tour[t] = v;
+            lca->depth[t++] = depth;
+            w = v->child;
+        } else {
+            if (v == st->root) break;
+            w = v->sibling;
+            depth -= range_length(v->range);
+            v = v->parent;
+            lca->tour[t] = v;
+            lca->depth[t++] = depth;
+        }
+    }
+    lca->tour_length = t;
+
+    init_rmq_table(&lca->rmq, lca->depth, lca->tour_length);
+    return lca;
+}
+
+void free_st_lca(
+    struct st_lca *lca
+) {
+    dealloc_rmq_table(&lca->rmq);
+    free(lca->tour);
+    free(lca->depth);
+    free(lca->first);
+    free(lca->leaf_first);
+    free(lca);
+}
+
+/// MARK: Suffix array LCE
+
+struct sa_lce *
+alloc_sa_lce(
+    struct suffix_array *sa
+) {
+    compute_inverse(sa);
+    compute_lcp(sa);
+    struct sa_lce *lce = malloc(sizeof(struct sa_lce));
+    lce->sa = sa;
+    init_rmq_table(&lce->rmq, sa->lcp, sa->length);
+    return lce;
+}
+
+void free_sa_lce(
+    struct sa_lce *lce
+) {
+    dealloc_rmq_table(&lce->rmq);
+    free(lce);
+}
@@ -0,0 +1,181 @@
+#ifndef LCE_H
+#define LCE_H
+
+#include <suffix_tree.h>
+#include <suffix_array.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Range minimum queries.
+ *
+ * We split the values into blocks of RMQ_BLOCK_SIZE and keep
+ * a sparse table over the block minima together with prefix
+ * and suffix minima inside each block. A query that spans more
+ * than one block is then three table lookups, and a query
+ * inside a single block scans at most a block. The space is
+ * 2n + (n / RMQ_BLOCK_SIZE) log(n / RMQ_BLOCK_SIZE) words, on
+ * top of the values themselves, which we do not copy.
+ **/
+#define RMQ_BLOCK_SIZE 32
+struct rmq_table {
+    const uint32_t *values;
+    uint32_t n;
+    uint32_t no_blocks;
+    uint32_t no_levels;
+    uint32_t *prefix_min; // index of the minimum from the block start
+    uint32_t *suffix_min; // index of the minimum to the block end
+    uint32_t *table;      // level k, block b at table[k * no_blocks + b]
+};
+
+void init_rmq_table(
+    struct rmq_table *rmq,
+    const uint32_t *values,
+    uint32_t n
+);
+void dealloc_rmq_table(
+    struct rmq_table *rmq
+);
+
+static inline uint32_t rmq_min_index_(
+    const uint32_t *values,
+    uint32_t i,
+    uint32_t j
+) {
+    return values[j] < values[i] ? j : i;
+}
+
+// The position of the highest set bit. You must have x > 0.
+static inline uint32_t floor_log2(uint32_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 31 - (uint32_t)__builtin_clz(x);
+#else
+    uint32_t k = 0;
+    while (x >>= 1) k++;
+    return k;
+#endif
+}
+
+// The index of a minimal value in values[i..j], both ends
+// included. You must have i <= j < n.
+static inline uint32_t rmq_index(
+    const struct rmq_table *rmq,
+    uint32_t i,
+    uint32_t j
+) {
+    const uint32_t *values = rmq->values;
+    uint32_t bi = i / RMQ_BLOCK_SIZE, bj = j / RMQ_BLOCK_SIZE;
+    if (bi == bj) {
+        uint32_t best = i;
+        for (uint32_t k = i + 1; k <= j; ++k)
+            best = rmq_min_index_(values, best, k);
+        return best;
+    }
+    uint32_t best = rmq_min_index_(values, rmq->suffix_min[i], rmq->prefix_min[j]);
+    if (bj - bi > 1) {
+        uint32_t l = bi + 1, r = bj - 1;
+        uint32_t k = floor_log2(r - l + 1);
+        const uint32_t *level = rmq->table + (size_t)k * rmq->no_blocks;
+        best = rmq_min_index_(values, best, level[l]);
+        best = rmq_min_index_(values, best, level[r - (1u << k) + 1]);
+    }
+    return best;
+}
+
+
+/**
+ * Lowest common ancestors in suffix trees.
+ *
+ * We store the Euler tour of the tree with the string depth
+ * of each node we visit, and the first time we see each node.
+ * The lowest common ancestor of two nodes is the shallowest
+ * node on the tour between them, and since string depths grow
+ * strictly down the tree, that is also the node with the
+ * smallest string depth. The longest common extension of two
+ * suffixes is the string depth of the lowest common ancestor
+ * of their leaves.
+ *
+ * As for the child index, the tree's pool must be a single
+ * array. The structure points into the tree, so free it
+ * before you free the tree.
+ **/
+struct st_lca {
+    const struct suffix_tree *st;
+    uint32_t tour_length;
+    const struct suffix_tree_node **tour;
+    uint32_t *depth;      // string depth along the tour
+    uint32_t *first;      // first tour index, by pool index
+    uint32_t *leaf_first; // first tour index, by leaf label
+    struct rmq_table rmq;
+};
+
+struct st_lca *
+alloc_st_lca(
+    const struct suffix_tree *st
+);
+void free_st_lca(
+    struct st_lca *lca
+);
+
+static inline const struct suffix_tree_node *
+st_lca(
+    const struct st_lca *lca,
+    const struct suffix_tree_node *u,
+    const struct suffix_tree_node *v
+) {
+    uint32_t i = lca->first[u - lca->st->pool.nodes];
+    uint32_t j = lca->first[v - lca->st->pool.nodes];
+    if (i > j) { uint32_t tmp = i; i = j; j = tmp; }
+    return lca->tour[rmq_index(&lca->rmq, i, j)];
+}
+
+// The length of the longest common prefix of the suffixes
+// at i and j, not counting the sentinel.
+static inline uint32_t st_lce(
+    const struct st_lca *lca,
+    uint32_t i,
+    uint32_t j
+) {
+    if (i == j) return lca->st->length - 1 - i;
+    uint32_t a = lca->leaf_first[i], b = lca->leaf_first[j];
+    if (a > b) { uint32_t tmp = a; a = b; b = tmp; }
+    return lca->depth[rmq_index(&lca->rmq, a, b)];
+}
+
+
+/**
+ * Longest common extensions from a suffix array.
+ *
+ * With the inverse suffix array and the LCP array, the
+ * longest common extension of suffixes i and j is the
+ * smallest LCP value between their ranks. We compute the
+ * inverse and the LCP array if the suffix array doesn't
+ * have them already, and they stay with the suffix array.
+ **/
+struct sa_lce {
+    const struct suffix_array *sa;
+    struct rmq_table rmq;
+};
+
+struct sa_lce *
+alloc_sa_lce(
+    struct suffix_array *sa
+);
+void free_sa_lce(
+    struct sa_lce *lce
+);
+
+static inline uint32_t sa_lce(
+    const struct sa_lce *lce,
+    uint32_t i,
+    uint32_t j
+) {
+    if (i == j) return lce->sa->length - 1 - i;
+    uint32_t a = lce->sa->inverse[i], b = lce->sa->inverse[j];
+    if (a > b) { uint32_t tmp = a; a = b; b = tmp; }
+    return lce->sa->lcp[rmq_index(&lce->rmq, a + 1, b)];
+}
+
+#endif
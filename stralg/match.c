@@ -263,25 +263,10 @@ void dealloc_bmh_match_iter(
 }
 
 
-void init_bm_match_iter(
-    struct bm_match_iter *iter,
-    const uint8_t *x, uint32_t n,
+// The good suffix jumps, shared by the two Boyer-Moore iterators.
+static uint32_t *compute_bm_jump(
     const uint8_t *p, uint32_t m
 ) {
-    iter->j = 0;
-    iter->x = x; iter->n = n;
-    iter->p = p; iter->m = m;
-    for (uint32_t k = 0; k < 256; k++) {
-        iter->rightmost[k] = -1;
-        iter->rightmost_table[k] = 0;
-    }
-    for (uint32_t k = 0; k < m - 1; k++) {
-        iter->rightmost[p[k]] = k;
-        iter->rightmost_table[p[k]] =
-            new_index_link(k,
-                iter->rightmost_table[p[k]]);
-    }
-
     uint32_t jump1[m];
     uint32_t jump2[m];
 
@@ -289,13 +274,15 @@ void init_bm_match_iter(
         jump1[i] = 0;
     }
     uint32_t rZ[m];
-    compute_reverse_z_array(iter->p, m, rZ);
-    for (uint32_t i = 0; i < m; i++) {
+    compute_reverse_z_array(p, m, rZ);
+    // We skip the last index. It is p itself, not an earlier
+    // occurrence of a suffix, and would reset the jump for a
+    // mismatch at the last character to zero.
+    for (uint32_t i = 0; i + 1 < m; i++) {
         // we don't have to check if rZ[i] = 0.
         // There, we will always write into n-0-1,
         // i.e. the last character in the string.
-        // For the last index we set this to n - i - 1
-        // which is zero. When this jump is zero,
+        // Where no jump is set it stays zero, and
         // one of the other rules will be used.
         jump1[m - rZ[i] - 1] = m - i - 1;
     }
@@ -303,13 +290,36 @@ void init_bm_match_iter(
         jump2[i] = 0;
     }
     uint32_t ba[m];
-    compute_border_array(iter->p, m, ba);
+    compute_border_array(p, m, ba);
     
     // Combine the jump tables
-    iter->jump = malloc(m * sizeof(uint32_t));
+    uint32_t *jump = malloc(m * sizeof(uint32_t));
     for (uint32_t i = 0; i < m; ++i) {
-        iter->jump[i] = jump1[i] ? jump1[i] : jump2[i];
+        jump[i] = jump1[i] ? jump1[i] : jump2[i];
     }
+    return jump;
+}
+
+void init_bm_match_iter(
+    struct bm_match_iter *iter,
+    const uint8_t *x, uint32_t n,
+    const uint8_t *p, uint32_t m
+) {
+    iter->j = 0;
+    iter->x = x; iter->n = n;
+    iter->p = p; iter->m = m;
+    for (uint32_t k = 0; k < 256; k++) {
+        iter->rightmost[k] = -1;
+        iter->rightmost_table[k] = 0;
+    }
+    for (uint32_t k = 0; k < m - 1; k++) {
+        iter->rightmost[p[k]] = k;
+        iter->rightmost_table[p[k]] =
+            new_index_link(k,
+                iter->rightmost_table[p[k]]);
+    }
+
+    iter->jump = compute_bm_jump(p, m);
 }
 
 
@@ -358,3 +368,602 @@ void dealloc_bm_match_iter(
     free(iter->jump);
 }
 
+
+
+/// Flat bad character tables
+
+void init_bad_char_table(
+    struct bad_char_table *table,
+    const uint8_t *p, uint32_t m,
+    enum bad_char_layout layout
+) {
+    table->m = m;
+    table->rightmost = 0;
+    table->start = 0;
+    table->positions = 0;
+
+    // Like the lists, we only use positions up to m - 2.
+    uint32_t used = m > 0 ? m - 1 : 0;
+    uint32_t sigma = 1;
+    for (uint32_t a = 0; a < 256; ++a)
+        table->classes[a] = 0;
+    for (uint32_t k = 0; k < used; ++k)
+        if (!table->classes[p[k]]) table->classes[p[k]] = (uint8_t)sigma++;
+    table->sigma = sigma;
+
+    switch (layout) {
+        case BAD_CHAR_DENSE_LAYOUT:  table->dense = true; break;
+        case BAD_CHAR_SPARSE_LAYOUT: table->dense = false; break;
+        default:
+            table->dense = (size_t)m * sigma <= BAD_CHAR_DENSE_LIMIT;
+    }
+
+    if (table->dense) {
+        // Row i is row i - 1 with p[i - 1] moved up to i - 1.
+        table->rightmost = malloc(((size_t)m * sigma + 1) * sizeof(int32_t));
+        int32_t *row = table->rightmost;
+        for (uint32_t a = 0; a < sigma && m > 0; ++a)
+            row[a] = -1;
+        for (uint32_t i = 1; i < m; ++i) {
+            int32_t *next = row + sigma;
+            memcpy(next, row, sigma * sizeof(int32_t));
+            next[table->classes[p[i - 1]]] = (int32_t)(i - 1);
+            row = next;
+        }
+    } else {
+        table->start = calloc(sigma + 1, sizeof(uint32_t));
+        table->positions = malloc((used + 1) * sizeof(int32_t));
+        for (uint32_t k = 0; k < used; ++k)
+            table->start[table->classes[p[k]] + 1]++;
+        for (uint32_t a = 0; a < sigma; ++a)
+            table->start[a + 1] += table->start[a];
+        uint32_t fill[sigma];
+        memcpy(fill, table->start, sigma * sizeof(uint32_t));
+        for (uint32_t k = 0; k < used; ++k)
+            table->positions[fill[table->classes[p[k]]]++] = (int32_t)k;
+    }
+}
+
+void dealloc_bad_char_table(
+    struct bad_char_table *table
+) {
+    free(table->rightmost);
+    free(table->start);
+    free(table->positions);
+}
+
+#define FLAT_BMH_JUMP() \
+    MAX(i - bad_char_rightmost(&iter->table, x[j + i], i), \
+        (int32_t)m - iter->rightmost[x[j + m - 1]] - 1)
+
+void init_bmh_flat_match_iter(
+    struct bmh_flat_match_iter *iter,
+    const uint8_t *x, uint32_t n,
+    const uint8_t *p, uint32_t m
+) {
+    iter->j = 0;
+    iter->x = x; iter->n = n;
+    iter->p = p; iter->m = m;
+    for (uint32_t k = 0; k < 256; k++) {
+        iter->rightmost[k] = -1;
+    }
+    for (uint32_t k = 0; k + 1 < m; k++) {
+        iter->rightmost[p[k]] = k;
+    }
+    init_bad_char_table(&iter->table, p, m, BAD_CHAR_AUTO_LAYOUT);
+}
+
+bool next_bmh_flat_match(
+    struct bmh_flat_match_iter *iter,
+    struct match *match
+) {
+    const uint8_t *x = iter->x;
+    const uint8_t *p = iter->p;
+    uint32_t n = iter->n;
+    uint32_t m = iter->m;
+
+    if (m > n) return false;
+    if (m == 0) return false;
+
+    int32_t i = m - 1;
+    for (uint32_t j = iter->j; j < n - m + 1; j += FLAT_BMH_JUMP()) {
+        i = m - 1;
+        while (i > 0 && p[i] == x[j + i]) {
+            i--;
+        }
+        if (i == 0 && p[0] == x[j]) {
+            match->pos = j;
+            iter->j = j + FLAT_BMH_JUMP();
+            return true;
+        }
+    }
+    return false;
+}
+
+void dealloc_bmh_flat_match_iter(
+    struct bmh_flat_match_iter *iter
+) {
+    dealloc_bad_char_table(&iter->table);
+}
+
+#define FLAT_BM_JUMP() MAX(iter->jump[i], FLAT_BMH_JUMP())
+
+void init_bm_flat_match_iter(
+    struct bm_flat_match_iter *iter,
+    const uint8_t *x, uint32_t n,
+    const uint8_t *p, uint32_t m
+) {
+    iter->j = 0;
+    iter->x = x; iter->n = n;
+    iter->p = p; iter->m = m;
+    for (uint32_t k = 0; k < 256; k++) {
+        iter->rightmost[k] = -1;
+    }
+    for (uint32_t k = 0; k + 1 < m; k++) {
+        iter->rightmost[p[k]] = k;
+    }
+    init_bad_char_table(&iter->table, p, m, BAD_CHAR_AUTO_LAYOUT);
+    iter->jump = m > 0 ? compute_bm_jump(p, m) : 0;
+}
+
+bool next_bm_flat_match(
+    struct bm_flat_match_iter *iter,
+    struct match *match
+) {
+    const uint8_t *x = iter->x;
+    const uint8_t *p = iter->p;
+    uint32_t n = iter->n;
+    uint32_t m = iter->m;
+
+    if (m > n) return false;
+    if (m == 0) return false;
+
+    int32_t i = m - 1;
+    for (uint32_t j = iter->j; j < n - m + 1; j += FLAT_BM_JUMP()) {
+        i = m - 1;
+        while (i > 0 && p[i] == x[j + i]) {
+            i--;
+        }
+        if (i == 0 && p[0] == x[j]) {
+            match->pos = j;
+            iter->j = j + FLAT_BM_JUMP();
+            return true;
+        }
+    }
+    return false;
+}
+
+void dealloc_bm_flat_match_iter(
+    struct bm_flat_match_iter *iter
+) {
+    dealloc_bad_char_table(&iter->table);
+    free(iter->jump);
+}
+
+
+/// Boyer-Moore with the Galil rule
+
+void init_bm_galil_match_iter(
+    struct bm_galil_match_iter *iter,
+    const uint8_t *x, uint32_t n,
+    const uint8_t *p, uint32_t m
+) {
+    iter->j = 0;
+    iter->l = 0;
+    iter->x = x; iter->n = n;
+    iter->p = p; iter->m = m;
+    for (uint32_t k = 0; k < 256; k++) {
+        iter->rightmost[k] = -1;
+    }
+    for (uint32_t k = 0; k + 1 < m; k++) {
+        iter->rightmost[p[k]] = k;
+    }
+    init_bad_char_table(&iter->table, p, m, BAD_CHAR_AUTO_LAYOUT);
+    iter->jump = 0;
+    iter->period = 1;
+    if (m == 0) return;
+
+    // Where compute_bm_jump has no occurrence of the matched
+    // suffix, we shift the longest border of p that fits inside
+    // the matched suffix to the end of it.
+    iter->jump = compute_bm_jump(p, m);
+    uint32_t ba[m];
+    compute_border_array(p, m, ba);
+    // The matched suffix shrinks as i grows, so we only move
+    // down the border chain.
+    uint32_t b = ba[m - 1];
+    for (uint32_t i = 0; i < m; ++i) {
+        uint32_t matched = m - 1 - i;
+        while (b > matched) b = ba[b - 1];
+        if (!iter->jump[i]) iter->jump[i] = m - b;
+    }
+    iter->period = m - ba[m - 1];
+}
+
+bool next_bm_galil_match(
+    struct bm_galil_match_iter *iter,
+    struct match *match
+) {
+    const uint8_t *x = iter->x;
+    const uint8_t *p = iter->p;
+    uint32_t n = iter->n;
+    uint32_t m = iter->m;
+
+    if (m > n) return false;
+    if (m == 0) return false;
+
+    int32_t l = (int32_t)iter->l;
+    for (uint32_t j = iter->j; j < n - m + 1; ) {
+        int32_t i = m - 1;
+        while (i >= l && p[i] == x[j + i]) {
+            i--;
+        }
+        if (i < l) {
+            match->pos = j;
+            iter->j = j + iter->period;
+            iter->l = m - iter->period;
+            return true;
+        }
+        j += MAX(iter->jump[i], FLAT_BMH_JUMP());
+        l = 0;
+    }
+    iter->j = n - m + 1;
+    iter->l = 0;
+    return false;
+}
+
+void dealloc_bm_galil_match_iter(
+    struct bm_galil_match_iter *iter
+) {
+    dealloc_bad_char_table(&iter->table);
+    free(iter->jump);
+}
+
+
+/// SIMD filter
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_MATCH_X86
+#include <immintrin.h>
+#endif
+
+enum simd_match_level supported_simd_match_level(void)
+{
+#ifdef SIMD_MATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SIMD_MATCH_AVX2;
+    if (__builtin_cpu_supports("sse2")) return SIMD_MATCH_SSE2;
+#endif
+    return SIMD_MATCH_SCALAR;
+}
+
+void init_simd_match_iter_level(
+    struct simd_match_iter *iter,
+    const uint8_t *x, uint32_t n,
+    const uint8_t *p, uint32_t m,
+    enum simd_match_level level
+) {
+    iter->x = x; iter->n = n;
+    iter->p = p; iter->m = m;
+    enum simd_match_level supported = supported_simd_match_level();
+    iter->level = level < supported ? level : supported;
+    iter->j = 0;
+    iter->block = 0;
+    iter->mask = 0;
+}
+
+void init_simd_match_iter(
+    struct simd_match_iter *iter,
+    const uint8_t *x, uint32_t n,
+    const uint8_t *p, uint32_t m
+) {
+    init_simd_match_iter_level(iter, x, n, p, m, SIMD_MATCH_AVX2);
+}
+
+// You must have w != 0.
+static inline uint32_t trailing_zeros32(uint32_t w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (uint32_t)__builtin_ctz(w);
+#else
+    uint32_t n = 0;
+    for (; !(w & 1); w >>= 1) n++;
+    return n;
+#endif
+}
+
+// Verifies the candidates left in the mask. We already know
+// the first and the last letter match, but comparing the last
+// again is cheaper than special-casing m == 1.
+static inline bool next_simd_candidate(
+    struct simd_match_iter *iter,
+    struct match *match
+) {
+    while (iter->mask) {
+        uint32_t j = iter->block + trailing_zeros32(iter->mask);
+        iter->mask &= iter->mask - 1;
+        if (memcmp(iter->x + j + 1, iter->p + 1, iter->m - 1) == 0) {
+            match->pos = j;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Scalar search from iter->j; also the tail for the vector versions.
+static bool next_scalar_simd_match(
+    struct simd_match_iter *iter,
+    struct match *match
+) {
+    const uint8_t *x = iter->x;
+    const uint8_t *p = iter->p;
+    uint32_t n = iter->n, m = iter->m;
+    uint32_t last = n - m; // last start position
+
+    while (iter->j <= last) {
+        const uint8_t *hit = memchr(x + iter->j, p[0], last - iter->j + 1);
+        if (!hit) break;
+        uint32_t j = (uint32_t)(hit - x);
+        iter->j = j + 1;
+        if (x[j + m - 1] == p[m - 1] &&
+            memcmp(x + j + 1, p + 1, m - 1) == 0) {
+            match->pos = j;
+            return true;
+        }
+    }
+    iter->j = last + 1;
+    return false;
+}
+
+#ifdef SIMD_MATCH_X86
+
+// The block loads read x[j .. j + m - 1 + width), so we
+// only use them while that is inside the text.
+
+__attribute__((target("sse2")))
+static bool next_sse2_simd_match(
+    struct simd_match_iter *iter,
+    struct match *match
+) {
+    const uint8_t *x = iter->x;
+    uint32_t n = iter->n, m = iter->m;
+    const __m128i first = _mm_set1_epi8((char)iter->p[0]);
+    const __m128i last = _mm_set1_epi8((char)iter->p[m - 1]);
+
+    for (;;) {
+        if (next_simd_candidate(iter, match)) return true;
+        uint32_t j = iter->j;
+        uint32_t mask = 0;
+        for (; j + m - 1 + 16 <= n; j += 16) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(x + j));
+            __m128i b = _mm_loadu_si128((const __m128i *)(x + j + m - 1));
+            __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(a, first),
+                                       _mm_cmpeq_epi8(b, last));
+            mask = (uint32_t)_mm_movemask_epi8(eq);
+            if (mask) break;
+        }
+        if (!mask) {
+            iter->j = j;
+            return next_scalar_simd_match(iter, match);
+        }
+        iter->block = j;
+        iter->mask = mask;
+        iter->j = j + 16;
+    }
+}
+
+__attribute__((target("avx2")))
+static bool next_avx2_simd_match(
+    struct simd_match_iter *iter,
+    struct match *match
+) {
+    const uint8_t *x = iter->x;
+    uint32_t n = iter->n, m = iter->m;
+    const __m256i first = _mm256_set1_epi8((char)iter->p[0]);
+    const __m256i last = _mm256_set1_epi8((char)iter->p[m - 1]);
+
+    for (;;) {
+        if (next_simd_candidate(iter, match)) return true;
+        uint32_t j = iter->j;
+        uint32_t mask = 0;
+        for (; j + m - 1 + 32 <= n; j += 32) {
+            __m256i a = _mm256_loadu_si256((const __m256i *)(x + j));
+            __m256i b = _mm256_loadu_si256((const __m256i *)(x + j + m - 1));
+            __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+                                          _mm256_cmpeq_epi8(b, last));
+            mask = (uint32_t)_mm256_movemask_epi8(eq);
+            if (mask) break;
+        }
+        if (!mask) {
+            iter->j = j;
+            return next_scalar_simd_match(iter, match);
+        }
+        iter->block = j;
+        iter->mask = mask;
+        iter->j = j + 32;
+    }
+}
+
+#endif
+
+bool next_simd_match(
+    struct simd_match_iter *iter,
+    struct match *match
+) {
+    if (iter->m > iter->n) return false;
+    if (iter->m == 0) return false;
+
+    switch (iter->level) {
+#ifdef SIMD_MATCH_X86
+        case SIMD_MATCH_AVX2:
+            return next_avx2_simd_match(iter, match);
+        case SIMD_MATCH_SSE2:
+            return next_sse2_simd_match(iter, match);
+#endif
+        default:
+            return next_scalar_simd_match(iter, match);
+    }
+}
+
+void dealloc_simd_match_iter(
+    struct simd_match_iter *iter
+) {
+    // nothing to do here...
+}
+
+
+/// Shift-Or
+
+void init_shift_or_match_iter(
+    struct shift_or_match_iter *iter,
+    const uint8_t *x, uint32_t n,
+    const uint8_t *p, uint32_t m
+) {
+    iter->x = x; iter->n = n;
+    iter->p = p; iter->m = m;
+    uint32_t words = (m + BIT_PARALLEL_WORD - 1) / BIT_PARALLEL_WORD;
+    if (words == 0) words = 1;
+    iter->words = words;
+    iter->j = 0;
+
+    // A zero bit means the letter matches the pattern there. The
+    // bits past the end of the pattern stay one.
+    iter->masks = malloc(256 * words * sizeof(*iter->masks));
+    for (uint32_t k = 0; k < 256 * words; ++k)
+        iter->masks[k] = ~(uint64_t)0;
+    for (uint32_t i = 0; i < m; ++i)
+        iter->masks[p[i] * words + i / BIT_PARALLEL_WORD] &=
+            ~((uint64_t)1 << (i % BIT_PARALLEL_WORD));
+
+    iter->state = malloc(words * sizeof(*iter->state));
+    for (uint32_t w = 0; w < words; ++w)
+        iter->state[w] = ~(uint64_t)0;
+}
+
+bool next_shift_or_match(
+    struct shift_or_match_iter *iter,
+    struct match *match
+) {
+    const uint8_t *x = iter->x;
+    uint32_t n = iter->n, m = iter->m;
+
+    if (m > n) return false;
+    if (m == 0) return false;
+
+    uint32_t words = iter->words;
+    uint32_t top = words - 1;
+    uint64_t hit = (uint64_t)1 << ((m - 1) % BIT_PARALLEL_WORD);
+
+    if (words == 1) {
+        // The common case gets its own loop so the state
+        // can live in a register.
+        const uint64_t *masks = iter->masks;
+        uint64_t D = iter->state[0];
+        for (uint32_t j = iter->j; j < n; ++j) {
+            D = (D << 1) | masks[x[j]];
+            if (!(D & hit)) {
+                iter->state[0] = D;
+                iter->j = j + 1;
+                match->pos = j + 1 - m;
+                return true;
+            }
+        }
+        iter->state[0] = D;
+        iter->j = n;
+        return false;
+    }
+
+    uint64_t *D = iter->state;
+    for (uint32_t j = iter->j; j < n; ++j) {
+        const uint64_t *mask = iter->masks + x[j] * words;
+        for (uint32_t w = top; w > 0; --w)
+            D[w] = (D[w] << 1) | (D[w - 1] >> (BIT_PARALLEL_WORD - 1)) | mask[w];
+        D[0] = (D[0] << 1) | mask[0];
+        if (!(D[top] & hit)) {
+            iter->j = j + 1;
+            match->pos = j + 1 - m;
+            return true;
+        }
+    }
+    iter->j = n;
+    return false;
+}
+
+void dealloc_shift_or_match_iter(
+    struct shift_or_match_iter *iter
+) {
+    free(iter->masks);
+    free(iter->state);
+}
+
+
+/// BNDM
+
+void init_bndm_match_iter(
+    struct bndm_match_iter *iter,
+    const uint8_t *x, uint32_t n,
+    const uint8_t *p, uint32_t m
+) {
+    iter->x = x; iter->n = n;
+    iter->p = p; iter->m = m;
+    uint32_t k = m < BIT_PARALLEL_WORD ? m : BIT_PARALLEL_WORD;
+    iter->k = k;
+    iter->pos = 0;
+
+    // Bit k - 1 - i is set for the letter at p[i], so reading
+    // the window backwards shifts prefixes towards the top bit.
+    for (uint32_t a = 0; a < 256; ++a)
+        iter->masks[a] = 0;
+    for (uint32_t i = 0; i < k; ++i)
+        iter->masks[p[i]] |= (uint64_t)1 << (k - 1 - i);
+}
+
+bool next_bndm_match(
+    struct bndm_match_iter *iter,
+    struct match *match
+) {
+    const uint8_t *x = iter->x;
+    const uint8_t *p = iter->p;
+    uint32_t n = iter->n, m = iter->m, k = iter->k;
+
+    if (m > n) return false;
+    if (m == 0) return false;
+
+    const uint64_t *masks = iter->masks;
+    uint64_t top = (uint64_t)1 << (k - 1);
+    uint64_t all = k == BIT_PARALLEL_WORD ? ~(uint64_t)0 : (top << 1) - 1;
+
+    for (uint32_t pos = iter->pos; pos <= n - m; ) {
+        uint32_t j = k, last = k;
+        uint64_t D = all;
+        bool found = false;
+        while (D) {
+            D &= masks[x[pos + j - 1]];
+            j--;
+            if (D & top) {
+                if (j > 0) {
+                    last = j; // a prefix of the pattern starts here
+                } else {
+                    found = true;
+                    break;
+                }
+            }
+            D = (D << 1) & all;
+        }
+        // The automaton only saw the first k letters.
+        if (found && memcmp(x + pos + k, p + k, m - k) == 0) {
+            match->pos = pos;
+            iter->pos = pos + last;
+            return true;
+        }
+        pos += last;
+    }
+    iter->pos = n - m + 1;
+    return false;
+}
+
+void dealloc_bndm_match_iter(
+    struct bndm_match_iter *iter
+) {
+    // nothing to do here...
+}
@@ -107,5 +107,246 @@ void dealloc_bm_match_iter(
     struct bm_match_iter *iter
 );
 
+/**
+ * Flat tables for the extended bad character rule.
+ *
+ * The iterators above answer "where is the rightmost a to the
+ * left of i in p" by walking a linked list per letter. Here we
+ * precompute it. We map the letters in the pattern to classes
+ * 1..sigma - 1 (class 0 is everything else, which never occurs)
+ * and, if m * sigma is small enough (see BAD_CHAR_DENSE_LIMIT),
+ * store the answer for every position and class. Otherwise we
+ * keep the positions of each class in a sorted array, all of
+ * them in one block indexed by start, and binary search.
+ **/
+enum bad_char_layout {
+    BAD_CHAR_AUTO_LAYOUT,
+    BAD_CHAR_DENSE_LAYOUT,
+    BAD_CHAR_SPARSE_LAYOUT
+};
+#define BAD_CHAR_DENSE_LIMIT (1u << 20)
+
+struct bad_char_table {
+    uint32_t m;
+    uint32_t sigma;
+    uint8_t classes[256];
+    bool dense;
+    int32_t *rightmost;  // dense: rightmost[i * sigma + class]
+    uint32_t *start;     // sparse: class a at positions[start[a]..start[a+1])
+    int32_t *positions;
+};
+void init_bad_char_table(
+    struct bad_char_table *table,
+    const uint8_t *p, uint32_t m,
+    enum bad_char_layout layout
+);
+void dealloc_bad_char_table(
+    struct bad_char_table *table
+);
+
+// The rightmost position k < i with p[k] == a, or -1 if there
+// isn't one. Like the lists, we only include k < m - 1.
+static inline int32_t bad_char_rightmost(
+    const struct bad_char_table *table,
+    uint8_t a,
+    int32_t i
+) {
+    uint32_t cls = table->classes[a];
+    if (table->dense)
+        return table->rightmost[(size_t)i * table->sigma + cls];
+    const int32_t *positions = table->positions;
+    uint32_t lo = table->start[cls], hi = table->start[cls + 1];
+    while (lo < hi) { // first position >= i
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (positions[mid] < i) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo > table->start[cls] ? positions[lo - 1] : -1;
+}
+
+struct bmh_flat_match_iter {
+    const uint8_t *x; uint32_t n;
+    const uint8_t *p; uint32_t m;
+    int32_t rightmost[256];
+    struct bad_char_table table;
+    uint32_t j;
+};
+void init_bmh_flat_match_iter(
+    struct bmh_flat_match_iter *iter,
+    const uint8_t *x, uint32_t n,
+    const uint8_t *p, uint32_t m
+);
+bool next_bmh_flat_match(
+    struct bmh_flat_match_iter *iter,
+    struct match *match
+);
+void dealloc_bmh_flat_match_iter(
+    struct bmh_flat_match_iter *iter
+);
+
+struct bm_flat_match_iter {
+    const uint8_t *x; uint32_t n;
+    const uint8_t *p; uint32_t m;
+    int32_t rightmost[256];
+    struct bad_char_table table;
+    uint32_t *jump;
+    uint32_t j;
+};
+void init_bm_flat_match_iter(
+    struct bm_flat_match_iter *iter,
+    const uint8_t *x, uint32_t n,
+    const uint8_t *p, uint32_t m
+);
+bool next_bm_flat_match(
+    struct bm_flat_match_iter *iter,
+    struct match *match
+);
+void dealloc_bm_flat_match_iter(
+    struct bm_flat_match_iter *iter
+);
+
+/**
+ * Boyer-Moore with the Galil rule.
+ *
+ * This uses the full good suffix rule, including the shifts
+ * that align a prefix of p with the matched suffix, which the
+ * jump table in bm_match_iter leaves to the bad character
+ * rule. After an occurrence we shift by the period of p, and
+ * since we then know that the first m - period letters match,
+ * we only compare the rest. That makes the worst case linear,
+ * also on periodic texts, where plain BM is O(nm).
+ **/
+struct bm_galil_match_iter {
+    const uint8_t *x; uint32_t n;
+    const uint8_t *p; uint32_t m;
+    int32_t rightmost[256];
+    struct bad_char_table table;
+    uint32_t *jump;
+    uint32_t period;
+    uint32_t j;
+    uint32_t l; // p[0..l) is known to match at j
+};
+void init_bm_galil_match_iter(
+    struct bm_galil_match_iter *iter,
+    const uint8_t *x, uint32_t n,
+    const uint8_t *p, uint32_t m
+);
+bool next_bm_galil_match(
+    struct bm_galil_match_iter *iter,
+    struct match *match
+);
+void dealloc_bm_galil_match_iter(
+    struct bm_galil_match_iter *iter
+);
+
+/**
+ * Vectorised first-and-last-letter filter.
+ *
+ * For each block of 16 (SSE2) or 32 (AVX2) start positions we
+ * compare, in one go, the text against the first and the last
+ * letter of the pattern. Only positions where both agree are
+ * candidates, and we verify those with memcmp. We keep the
+ * candidates we haven't reported yet as a bit mask in the
+ * iterator. The tail of the text, where we cannot load a full
+ * block, and machines without the instructions use a scalar
+ * version that looks for the first letter with memchr.
+ *
+ * init_simd_match_iter picks the best level the CPU supports
+ * at runtime; use init_simd_match_iter_level if you want a
+ * specific one (we fall back to the best supported level if
+ * you ask for more than that).
+ **/
+enum simd_match_level {
+    SIMD_MATCH_SCALAR,
+    SIMD_MATCH_SSE2,
+    SIMD_MATCH_AVX2
+};
+enum simd_match_level supported_simd_match_level(void);
+
+struct simd_match_iter {
+    const uint8_t *x; uint32_t n;
+    const uint8_t *p; uint32_t m;
+    enum simd_match_level level;
+    uint32_t j;     // next position we haven't looked at
+    uint32_t block; // start of the block the mask refers to
+    uint32_t mask;  // candidates in the block we haven't verified
+};
+void init_simd_match_iter(
+    struct simd_match_iter *iter,
+    const uint8_t *x, uint32_t n,
+    const uint8_t *p, uint32_t m
+);
+void init_simd_match_iter_level(
+    struct simd_match_iter *iter,
+    const uint8_t *x, uint32_t n,
+    const uint8_t *p, uint32_t m,
+    enum simd_match_level level
+);
+bool next_simd_match(
+    struct simd_match_iter *iter,
+    struct match *match
+);
+void dealloc_simd_match_iter(
+    struct simd_match_iter *iter
+);
+
+/**
+ * Bit-parallel matchers.
+ *
+ * Shift-Or keeps, for each prefix of the pattern, a bit that is
+ * zero if the prefix ends at the current position in the text,
+ * and updates all of them with a shift and an or per letter. For
+ * patterns longer than 64 we keep the state in several words and
+ * carry the shift between them.
+ *
+ * BNDM reads windows of length m backwards and keeps the factors
+ * of the pattern that match the letters read so far, so it skips
+ * ahead like BMH but with shifts from the longest prefix seen.
+ * For patterns longer than 64 we run it on the first 64 letters
+ * and verify the rest of the pattern at each hit.
+ **/
+#define BIT_PARALLEL_WORD 64
+
+struct shift_or_match_iter {
+    const uint8_t *x; uint32_t n;
+    const uint8_t *p; uint32_t m;
+    uint32_t words;   // words per state
+    uint64_t *masks;  // masks[a * words + w] for letter a
+    uint64_t *state;
+    uint32_t j;       // next letter in x to read
+};
+void init_shift_or_match_iter(
+    struct shift_or_match_iter *iter,
+    const uint8_t *x, uint32_t n,
+    const uint8_t *p, uint32_t m
+);
+bool next_shift_or_match(
+    struct shift_or_match_iter *iter,
+    struct match *match
+);
+void dealloc_shift_or_match_iter(
+    struct shift_or_match_iter *iter
+);
+
+struct bndm_match_iter {
+    const uint8_t *x; uint32_t n;
+    const uint8_t *p; uint32_t m;
+    uint32_t k;       // the length we run the automaton on, min(m, 64)
+    uint64_t masks[256];
+    uint32_t pos;     // start of the next window
+};
+void init_bndm_match_iter(
+    struct bndm_match_iter *iter,
+    const uint8_t *x, uint32_t n,
+    const uint8_t *p, uint32_t m
+);
+bool next_bndm_match(
+    struct bndm_match_iter *iter,
+    struct match *match
+);
+void dealloc_bndm_match_iter(
+    struct bndm_match_iter *iter
+);
+
 
 #endif
@@ -186,7 +186,10 @@ read_remap_table(
     FILE *f
 ) {
     struct remap_table *remap_table = malloc(sizeof(struct remap_table));
-    fread(remap_table, sizeof(struct remap_table), 1, f);
+    if (fread(remap_table, sizeof(struct remap_table), 1, f) != 1) {
+        free(remap_table);
+        return 0;
+    }
     return remap_table;
 }
 
@@ -195,6 +198,7 @@ read_remap_table_fname(
     const char *fname
 ) {
     FILE *f = fopen(fname, "rb");
+    if (!f) return 0;
     struct remap_table *res = read_remap_table(f);
     fclose(f);
     return res;
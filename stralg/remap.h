@@ -85,7 +85,10 @@ uint32_t remap_string(
     uint8_t *input
 );
 
-// Serialisation -- FIXME: error handling!
+// Raw serialisation. The read functions give you a null
+// pointer if the file is too short, but there are no headers
+// or checksums here. Use the container functions in
+// serialise.h for index files you want to keep around.
 void write_remap_table(
     FILE *f,
     const struct remap_table *table
@@ -463,23 +463,12 @@ static void remap_LMS(
     SA[0] = n;
 }
 
-struct suffix_array *
-sa_is_construction(
-    uint8_t *remapped_string,
-    uint32_t alphabet_size
+void sa_is_sort_integers_(
+    uint32_t *x,
+    uint32_t n,
+    uint32_t alphabet_size,
+    uint32_t *result
 ) {
-    struct suffix_array *sa = allocate_sa_(remapped_string);
-    // we work with the string length without the sentinel
-    // in this algorithm
-    uint32_t n = sa->length - 1;
-    
-    // Create string of integers instead of bytes
-    uint32_t *s = malloc((n + 1) * sizeof(uint32_t));
-    for (uint32_t i = 0; i < n; ++i) {
-        s[i] = remapped_string[i];
-    }
-    s[n] = 0;
-    
     // Allocate all buffers
     uint32_t *SA = malloc(2 * (n + 1) * sizeof(uint32_t));
     uint32_t *names_buf = malloc(2 * (n + 1) * sizeof(uint32_t));
@@ -491,10 +480,10 @@ sa_is_construction(
     uint32_t *bucket_endpoints = malloc(2 * max_alphabet_size * sizeof(uint32_t));
     
     // Sort in buffer and then move the result to the suffix array
-    sort_SA(s, n, SA, names_buf,
+    sort_SA(x, n, SA, names_buf,
             summary_string, summary_offsets,
             buckets, bucket_endpoints, s_index, alphabet_size);
-    memcpy(sa->array, SA, (n + 1) * sizeof(uint32_t));
+    memcpy(result, SA, (n + 1) * sizeof(uint32_t));
     
     // Free all buffers
     free(bucket_endpoints);
@@ -502,7 +491,28 @@ sa_is_construction(
     free(s_index);
     free(summary_offsets);
     free(summary_string);
+    free(names_buf);
     free(SA);
+}
+
+struct suffix_array *
+sa_is_construction(
+    uint8_t *remapped_string,
+    uint32_t alphabet_size
+) {
+    struct suffix_array *sa = allocate_sa_(remapped_string);
+    // we work with the string length without the sentinel
+    // in this algorithm
+    uint32_t n = sa->length - 1;
+    
+    // Create string of integers instead of bytes
+    uint32_t *s = malloc((n + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; ++i) {
+        s[i] = remapped_string[i];
+    }
+    s[n] = 0;
+    
+    sa_is_sort_integers_(s, n, alphabet_size, sa->array);
     free(s);
     
     return sa;
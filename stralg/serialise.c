@@ -1,49 +1,236 @@
 
 #include "serialise.h"
+#include "suffix_array_internal.h"
 #include "string_utils.h"
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 
-void write_complete_bwt_info(
-    FILE *f,
+#define BWT_HEADER_TAG   CONTAINER_TAG('B','W','T','H')
+#define STRING_TAG       CONTAINER_TAG('S','T','R',' ')
+#define SUFFIX_ARRAY_TAG CONTAINER_TAG('S','A',' ',' ')
+#define REMAP_TABLE_TAG  CONTAINER_TAG('R','M','A','P')
+#define C_TABLE_TAG      CONTAINER_TAG('C','T','A','B')
+#define O_TABLE_TAG      CONTAINER_TAG('O','T','A','B')
+#define RO_TABLE_TAG     CONTAINER_TAG('R','O','T','B')
+
+// The first section tells us how large the rest are, so
+// we can check the sizes before we allocate anything.
+struct bwt_info_header {
+    uint32_t length; // string length including sentinel
+    uint32_t alphabet_size;
+    uint32_t has_ro_table;
+    uint32_t reserved;
+};
+
+void write_bwt_info_sections(
+    struct container_writer *w,
     const struct bwt_table *bwt_table
 ) {
     const struct suffix_array *sa = bwt_table->sa;
     const struct remap_table *remap_table = bwt_table->remap_table;
-    
-    write_string_len(f, sa->string, sa->length - 1);
-    write_suffix_array(f, sa);
-    write_remap_table(f, remap_table);
-    write_bwt_table(f, bwt_table);
+    uint32_t alphabet_size = remap_table->alphabet_size;
+    uint64_t o_table_length = (uint64_t)alphabet_size * (sa->length + 1);
+
+    struct bwt_info_header header;
+    memset(&header, 0, sizeof(header));
+    header.length = sa->length;
+    header.alphabet_size = alphabet_size;
+    header.has_ro_table = bwt_table->ro_table != 0;
+
+    write_container_section(w, BWT_HEADER_TAG, &header, sizeof(header));
+    write_container_section(w, STRING_TAG, sa->string, sa->length);
+    write_container_section(w, SUFFIX_ARRAY_TAG, sa->array,
+                            sa->length * sizeof(*sa->array));
+    write_container_section(w, REMAP_TABLE_TAG, remap_table,
+                            sizeof(*remap_table));
+    write_container_section(w, C_TABLE_TAG, bwt_table->c_table,
+                            alphabet_size * sizeof(*bwt_table->c_table));
+    write_container_section(w, O_TABLE_TAG, bwt_table->o_table,
+                            o_table_length * sizeof(*bwt_table->o_table));
+    if (bwt_table->ro_table) {
+        write_container_section(w, RO_TABLE_TAG, bwt_table->ro_table,
+                                o_table_length * sizeof(*bwt_table->ro_table));
+    }
+}
+
+static uint32_t **o_indices(
+    uint32_t *table,
+    uint32_t length,
+    uint32_t alphabet_size
+) {
+    uint32_t **indices = malloc(((size_t)length + 1) * sizeof(*indices));
+    if (!indices) return 0;
+    for (uint32_t i = 0; i < length + 1; i++) {
+        indices[i] = table + (uint64_t)i * alphabet_size;
+    }
+    return indices;
+}
+
+struct bwt_table *read_bwt_info_sections(
+    struct container_reader *r
+) {
+    struct bwt_info_header header;
+    if (!read_container_section(r, BWT_HEADER_TAG, &header, sizeof(header)))
+        return 0;
+    // The alphabet has to fit in the remap table, and we need
+    // length + 1 rows in the O tables.
+    if (header.length == 0 || header.length == UINT32_MAX ||
+        header.alphabet_size == 0 || header.alphabet_size > 256) {
+        r->error = MALFORMED_FILE;
+        return 0;
+    }
+    uint64_t o_table_length = (uint64_t)header.alphabet_size * (header.length + 1);
+    if (o_table_length > SIZE_MAX / sizeof(uint32_t)) {
+        r->error = MALFORMED_FILE;
+        return 0;
+    }
+
+    // Like the container reader, we report allocations we cannot
+    // make for sizes from the file as a malformed file.
+    uint8_t *string = malloc(header.length);
+    struct remap_table *remap_table = malloc(sizeof(*remap_table));
+    uint32_t *c_table = malloc(header.alphabet_size * sizeof(*c_table));
+    uint32_t *o_table = malloc(o_table_length * sizeof(*o_table));
+    uint32_t *ro_table = 0;
+    struct suffix_array *sa = 0;
+    struct bwt_table *bwt_table = 0;
+    if (!string || !remap_table || !c_table || !o_table) {
+        r->error = MALFORMED_FILE;
+        goto error;
+    }
+
+    if (!read_container_section(r, STRING_TAG, string, header.length))
+        goto error;
+    // The string must be zero-terminated and not contain any
+    // other zeros, or the suffix array will get the wrong length.
+    if (strnlen((char *)string, header.length) != header.length - 1) {
+        r->error = MALFORMED_FILE;
+        goto error;
+    }
+    sa = allocate_sa_(string);
+    if (!sa) {
+        r->error = MALFORMED_FILE;
+        goto error;
+    }
+    if (!read_container_section(r, SUFFIX_ARRAY_TAG, sa->array,
+                                sa->length * sizeof(*sa->array)))
+        goto error;
+    if (!read_container_section(r, REMAP_TABLE_TAG, remap_table,
+                                sizeof(*remap_table)))
+        goto error;
+    if (remap_table->alphabet_size != header.alphabet_size) {
+        r->error = MALFORMED_FILE;
+        goto error;
+    }
+    if (!read_container_section(r, C_TABLE_TAG, c_table,
+                                header.alphabet_size * sizeof(*c_table)))
+        goto error;
+    if (!read_container_section(r, O_TABLE_TAG, o_table,
+                                o_table_length * sizeof(*o_table)))
+        goto error;
+    if (header.has_ro_table) {
+        ro_table = malloc(o_table_length * sizeof(*ro_table));
+        if (!ro_table) {
+            r->error = MALFORMED_FILE;
+            goto error;
+        }
+        if (!read_container_section(r, RO_TABLE_TAG, ro_table,
+                                    o_table_length * sizeof(*ro_table)))
+            goto error;
+    }
+
+    bwt_table = malloc(sizeof(struct bwt_table));
+    if (!bwt_table) {
+        r->error = MALFORMED_FILE;
+        goto error;
+    }
+    bwt_table->sa = sa;
+    bwt_table->remap_table = remap_table;
+    bwt_table->c_table = c_table;
+    bwt_table->o_table = o_table;
+    bwt_table->o_indices = o_indices(o_table, sa->length, header.alphabet_size);
+    bwt_table->ro_table = ro_table;
+    bwt_table->ro_indices = ro_table ?
+        o_indices(ro_table, sa->length, header.alphabet_size) : 0;
+    if (!bwt_table->o_indices || (ro_table && !bwt_table->ro_indices)) {
+        free(bwt_table->o_indices);
+        free(bwt_table->ro_indices);
+        r->error = MALFORMED_FILE;
+        goto error;
+    }
+    return bwt_table;
+
+error:
+    free(bwt_table);
+    if (sa) free_suffix_array(sa);
+    free(string);
+    free(remap_table);
+    free(c_table);
+    free(o_table);
+    free(ro_table);
+    return 0;
+}
+
+bool write_complete_bwt_info(
+    FILE *f,
+    const struct bwt_table *bwt_table,
+    enum error_codes *err
+) {
+    struct container_writer w;
+    init_container_writer(&w, f, BWT_INFO_KIND);
+    write_bwt_info_sections(&w, bwt_table);
+    return finish_container(&w, err);
 }
 
-void write_complete_bwt_info_fname(
+bool write_complete_bwt_info_fname(
     const char *fname,
-    const struct bwt_table *bwt_table
+    const struct bwt_table *bwt_table,
+    enum error_codes *err
 ) {
     FILE *f = fopen(fname, "wb");
-    write_complete_bwt_info(f, bwt_table);
-    fclose(f);
+    if (!f) {
+        if (err) *err = CANNOT_OPEN_FILE;
+        return false;
+    }
+    bool ok = write_complete_bwt_info(f, bwt_table, err);
+    if (fclose(f) != 0 && ok) {
+        if (err) *err = CANNOT_WRITE_FILE;
+        ok = false;
+    }
+    return ok;
 }
 
 struct bwt_table *
 read_complete_bwt_info(
-    FILE *f
+    FILE *f,
+    bool verify,
+    enum error_codes *err
 ) {
-    uint32_t str_len;
-    uint8_t *str = read_string_len(f, &str_len);
-    struct suffix_array *sa = read_suffix_array(f, str);
-    struct remap_table *remap_table = read_remap_table(f);
-    struct bwt_table *bwt_table = read_bwt_table(f, sa, remap_table);
+    struct container_reader r;
+    struct bwt_table *bwt_table = 0;
+    if (init_container_reader(&r, f, BWT_INFO_KIND, verify))
+        bwt_table = read_bwt_info_sections(&r);
+    if (!finish_container_reader(&r, err) && bwt_table) {
+        completely_free_bwt_table(bwt_table);
+        bwt_table = 0;
+    }
     return bwt_table;
 }
 
 struct bwt_table *
 read_complete_bwt_info_fname(
-    const char *fname
+    const char *fname,
+    bool verify,
+    enum error_codes *err
 ) {
     FILE *f = fopen(fname, "rb");
-    struct bwt_table *res = read_complete_bwt_info(f);
+    if (!f) {
+        if (err) *err = CANNOT_OPEN_FILE;
+        return 0;
+    }
+    struct bwt_table *res = read_complete_bwt_info(f, verify, err);
     fclose(f);
     return res;
 }
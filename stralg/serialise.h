@@ -1,12 +1,14 @@
-
 #ifndef SERIALISE_H
 #define SERIALISE_H
 
 #include "remap.h"
 #include "suffix_array.h"
 #include "bwt.h"
+#include "container.h"
+#include "error.h"
 
 #include <stdio.h>
+#include <stdbool.h>
 
 // This file contains serialisation code that either
 // involves more than one data structure or none
@@ -14,22 +16,58 @@
 // serialiseation code is found in the implementation files
 // for the structures.
 
+#define BWT_INFO_KIND CONTAINER_TAG('B','W','T','I')
+
 /**
  * These serialisation functions will write all the data stored in the
  * table, including string, suffix array, remap table and the BWT
  * tables. It is everything you need for a BWT search when you load it
- * back in.
+ * back in. The data is written as a container (see container.h), with
+ * a checksum for each of the tables.
  **/
-void write_complete_bwt_info(FILE *f, const struct bwt_table *bwt_table);
-void write_complete_bwt_info_fname(const char *fname, const struct bwt_table *bwt_table);
+bool write_complete_bwt_info(
+    FILE *f,
+    const struct bwt_table *bwt_table,
+    enum error_codes *err
+);
+bool write_complete_bwt_info_fname(
+    const char *fname,
+    const struct bwt_table *bwt_table,
+    enum error_codes *err
+);
 
 /**
  * These functions will read everything needed to fill a bwt table, including
  * string, suffix array, remap table and bwt tables. Everything is allocated
  * by the function so you should use free_complete_bwt_table to free memory
  * after you are done with the tables.
+ *
+ * If verify is true, we check the checksums of all the tables. If
+ * the file is truncated, corrupted or not a BWT file, you get a null
+ * pointer back and the reason in err.
+ */
+struct bwt_table *read_complete_bwt_info(
+    FILE *f,
+    bool verify,
+    enum error_codes *err
+);
+struct bwt_table *read_complete_bwt_info_fname(
+    const char *fname,
+    bool verify,
+    enum error_codes *err
+);
+
+/**
+ * If you want to store the BWT information together with other
+ * data in the same container, you can write and read the
+ * sections yourself with these.
  */
-struct bwt_table *read_complete_bwt_info(FILE *f);
-struct bwt_table *read_complete_bwt_info_fname(const char *fname);
+void write_bwt_info_sections(
+    struct container_writer *w,
+    const struct bwt_table *bwt_table
+);
+struct bwt_table *read_bwt_info_sections(
+    struct container_reader *r
+);
 
 #endif
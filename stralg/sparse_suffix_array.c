@@ -0,0 +1,214 @@
+#include "sparse_suffix_array.h"
+#include "suffix_array_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/// MARK: Construction
+
+static struct sparse_suffix_array *
+alloc_sparse_sa(
+    uint8_t *string,
+    uint32_t no_suffixes
+) {
+    struct sparse_suffix_array *ssa = malloc(sizeof(struct sparse_suffix_array));
+    ssa->string = string;
+    ssa->length = (uint32_t)strlen((char *)string) + 1;
+    ssa->no_suffixes = no_suffixes;
+    ssa->array = malloc(no_suffixes * sizeof(*ssa->array));
+    return ssa;
+}
+
+// Letter d in block b, with zeros past the end of the
+// string (n is the length without the sentinel).
+static inline uint8_t block_letter(
+    const uint8_t *x, uint32_t n,
+    uint32_t stride, uint32_t b, uint32_t d
+) {
+    uint64_t i = (uint64_t)b * stride + d;
+    return (i < n) ? x[i] : 0;
+}
+
+static bool equal_blocks(
+    const uint8_t *x, uint32_t n,
+    uint32_t stride, uint32_t b1, uint32_t b2
+) {
+    for (uint32_t d = 0; d < stride; ++d) {
+        if (block_letter(x, n, stride, b1, d) != block_letter(x, n, stride, b2, d))
+            return false;
+    }
+    return true;
+}
+
+struct sparse_suffix_array *
+sparse_sa_stride_construction(
+    uint8_t *string,
+    uint32_t stride
+) {
+    assert(stride > 0);
+    uint32_t n = (uint32_t)strlen((char *)string);
+    uint32_t no_blocks = n / stride + (n % stride != 0);
+    struct sparse_suffix_array *ssa = alloc_sparse_sa(string, no_blocks);
+    if (no_blocks == 0) return ssa;
+
+    // Sort the blocks with an LSD radix sort, one letter at
+    // a time from the back. The string is zero-terminated and
+    // only the last block can contain zeros, so comparing
+    // blocks as if they were padded with zeros gives the same
+    // order as comparing the suffixes they start.
+    uint32_t *blocks = malloc(no_blocks * sizeof(*blocks));
+    uint32_t *buffer = malloc(no_blocks * sizeof(*buffer));
+    for (uint32_t b = 0; b < no_blocks; ++b)
+        blocks[b] = b;
+    uint32_t counts[256];
+    for (uint32_t d = stride; d > 0; --d) {
+        memset(counts, 0, sizeof(counts));
+        for (uint32_t b = 0; b < no_blocks; ++b)
+            counts[block_letter(string, n, stride, b, d - 1)]++;
+        uint32_t sum = 0;
+        for (uint32_t a = 0; a < 256; ++a) {
+            uint32_t count = counts[a];
+            counts[a] = sum;
+            sum += count;
+        }
+        for (uint32_t b = 0; b < no_blocks; ++b) {
+            uint32_t block = blocks[b];
+            buffer[counts[block_letter(string, n, stride, block, d - 1)]++] = block;
+        }
+        uint32_t *tmp = blocks; blocks = buffer; buffer = tmp;
+    }
+
+    // Name the blocks by rank. Equal blocks get the same
+    // name and the names are dense (starting at one since
+    // zero is the sentinel), as SA-IS wants them.
+    uint32_t *reduced = buffer; // we don't need the buffer any more
+    uint32_t name = 1;
+    reduced[blocks[0]] = name;
+    for (uint32_t i = 1; i < no_blocks; ++i) {
+        if (!equal_blocks(string, n, stride, blocks[i - 1], blocks[i]))
+            name++;
+        reduced[blocks[i]] = name;
+    }
+    free(blocks);
+
+    // The suffixes of the reduced string sort like the
+    // sampled suffixes of the original string.
+    reduced = realloc(reduced, (no_blocks + 1) * sizeof(*reduced));
+    reduced[no_blocks] = 0;
+    uint32_t *reduced_sa = malloc((no_blocks + 1) * sizeof(*reduced_sa));
+    sa_is_sort_integers_(reduced, no_blocks, name + 1, reduced_sa);
+    free(reduced);
+
+    // reduced_sa[0] is the sentinel, which we don't keep.
+    for (uint32_t i = 0; i < no_blocks; ++i)
+        ssa->array[i] = reduced_sa[i + 1] * stride;
+    free(reduced_sa);
+
+    return ssa;
+}
+
+static int cmp_positions(const void *a, const void *b)
+{
+    uint32_t i = *(const uint32_t *)a;
+    uint32_t j = *(const uint32_t *)b;
+    return (i > j) - (i < j);
+}
+
+static int cmp_suffixes(const void *a, const void *b)
+{
+    return strcmp(*(char **)a, *(char **)b);
+}
+
+struct sparse_suffix_array *
+sparse_sa_positions_construction(
+    uint8_t *string,
+    uint32_t no_positions,
+    const uint32_t *positions
+) {
+    uint32_t n = (uint32_t)strlen((char *)string);
+    struct sparse_suffix_array *ssa = alloc_sparse_sa(string, no_positions);
+
+    uint32_t m = 0;
+    for (uint32_t i = 0; i < no_positions; ++i) {
+        if (positions[i] < n)
+            ssa->array[m++] = positions[i];
+    }
+    // Remove duplicates. Sorting the integers first is
+    // cheaper than letting the string sort find them.
+    qsort(ssa->array, m, sizeof(*ssa->array), cmp_positions);
+    uint32_t unique = 0;
+    for (uint32_t i = 0; i < m; ++i) {
+        if (unique == 0 || ssa->array[unique - 1] != ssa->array[i])
+            ssa->array[unique++] = ssa->array[i];
+    }
+
+    // Sort pointers to the suffixes, like the qsort
+    // construction of full suffix arrays.
+    uint8_t **suffixes = malloc((unique ? unique : 1) * sizeof(*suffixes));
+    for (uint32_t i = 0; i < unique; ++i)
+        suffixes[i] = string + ssa->array[i];
+    qsort(suffixes, unique, sizeof(*suffixes), cmp_suffixes);
+    for (uint32_t i = 0; i < unique; ++i)
+        ssa->array[i] = (uint32_t)(suffixes[i] - string);
+    free(suffixes);
+
+    ssa->no_suffixes = unique;
+    if (unique < no_positions)
+        ssa->array = realloc(ssa->array, (unique ? unique : 1) * sizeof(*ssa->array));
+    return ssa;
+}
+
+void free_sparse_suffix_array(
+    struct sparse_suffix_array *ssa
+) {
+    free(ssa->array);
+    free(ssa);
+}
+
+/// MARK: Searching
+
+void init_sparse_sa_match_iter(
+    struct sparse_sa_match_iter *iter,
+    const uint8_t *pattern,
+    const struct sparse_suffix_array *ssa
+) {
+    const char *x = (const char *)ssa->string;
+    const uint32_t *array = ssa->array;
+    size_t m = strlen((char *)pattern);
+    iter->ssa = ssa;
+
+    uint32_t lo = 0, hi = ssa->no_suffixes;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (strncmp((char *)pattern, x + array[mid], m) <= 0) hi = mid;
+        else lo = mid + 1;
+    }
+    uint32_t L = lo;
+    hi = ssa->no_suffixes;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (strncmp((char *)pattern, x + array[mid], m) < 0) hi = mid;
+        else lo = mid + 1;
+    }
+
+    iter->L = L;
+    iter->R = lo;
+    iter->i = L;
+}
+
+bool next_sparse_sa_match(
+    struct sparse_sa_match_iter *iter,
+    struct sa_match *match
+) {
+    if (iter->i >= iter->R)
+        return false;
+    match->position = iter->ssa->array[iter->i++];
+    return true;
+}
+
+void dealloc_sparse_sa_match_iter(
+    struct sparse_sa_match_iter *iter
+) {
+    // nothing to be done here
+}
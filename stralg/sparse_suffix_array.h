@@ -0,0 +1,76 @@
+#ifndef SPARSE_SUFFIX_ARRAY_H
+#define SPARSE_SUFFIX_ARRAY_H
+
+#include <suffix_array.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * A sparse suffix array only contains a subset of the
+ * suffixes of a string, e.g. those that start at every k'th
+ * position or at a set of minimizer positions. The array is
+ * sorted like a normal suffix array, so we can search in it
+ * with binary search, but it only reports occurrences at
+ * the positions we sampled.
+ *
+ * The sentinel suffix is never included, and the string is
+ * not remapped, so you search with the original patterns.
+ **/
+struct sparse_suffix_array {
+    uint8_t *string;
+    uint32_t length; // of the string, including the sentinel
+    uint32_t no_suffixes;
+    uint32_t *array;
+};
+
+// Sorts the suffixes at positions 0, stride, 2*stride, ...
+// We rank the stride-length blocks of the string with a
+// radix sort and then sort the suffixes of the string of
+// block ranks with SA-IS, so the working space is
+// proportional to n / stride and not n.
+struct sparse_suffix_array *
+sparse_sa_stride_construction(
+    uint8_t *string,
+    uint32_t stride
+);
+// Sorts the suffixes at an arbitrary set of positions. The
+// positions don't have to be sorted, duplicates are removed,
+// and positions past the end of the string are ignored. This
+// is a comparison sort, so it is slow on strings with long
+// repeats.
+struct sparse_suffix_array *
+sparse_sa_positions_construction(
+    uint8_t *string,
+    uint32_t no_positions,
+    const uint32_t *positions
+);
+// This doesn't free the string.
+void free_sparse_suffix_array(
+    struct sparse_suffix_array *ssa
+);
+
+// Finds the sampled positions where the pattern occurs. We
+// compare the pattern directly against the string, so there
+// are no false positives. The matches come in suffix array
+// order, as sa_match values.
+struct sparse_sa_match_iter {
+    const struct sparse_suffix_array *ssa;
+    uint32_t L;
+    uint32_t R;
+    uint32_t i;
+};
+void init_sparse_sa_match_iter(
+    struct sparse_sa_match_iter *iter,
+    const uint8_t *pattern,
+    const struct sparse_suffix_array *ssa
+);
+bool next_sparse_sa_match(
+    struct sparse_sa_match_iter *iter,
+    struct sa_match *match
+);
+void dealloc_sparse_sa_match_iter(
+    struct sparse_sa_match_iter *iter
+);
+
+#endif
@@ -4,6 +4,7 @@
 #include <aho_corasick.h>
 #include <bwt.h>
 #include <cigar.h>
+#include <container.h>
 #include <edit_distance_generator.h>
 #include <error.h>
 #include <io.h>
@@ -12,11 +13,16 @@
 #include <serialise.h>
 #include <string_utils.h>
 #include <suffix_array.h>
+#include <generalised_suffix_array.h>
+#include <compressed_suffix_array.h>
+#include <sparse_suffix_array.h>
 #include <suffix_tree.h>
 #include <edge_array_suffix_tree.h>
+#include <lce.h>
 #include <trie.h>
 #include <vectors.h>
 #include <lists.h>
 #include <queues.h>
+#include <bitvectors.h>
 
 #endif
@@ -73,17 +73,22 @@ void write_string_fname(const char *fname, const uint8_t *str)
 uint8_t *read_string_len(FILE *f, uint32_t *len)
 {
     uint32_t str_len;
-    fread(&str_len, sizeof(uint32_t), 1, f);
-    *len = str_len;
+    if (fread(&str_len, sizeof(uint32_t), 1, f) != 1)
+        return 0;
     uint8_t *str = malloc(str_len + 1);
-    fread(str, 1, str_len, f);
+    if (fread(str, 1, str_len, f) != str_len) {
+        free(str);
+        return 0;
+    }
     str[str_len] = '\0';
+    *len = str_len;
     return str;
 }
 
 uint8_t *read_string_len_fname(const char *fname, uint32_t *len)
 {
     FILE *f = fopen(fname, "rb");
+    if (!f) return 0;
     uint8_t *str = read_string_len(f, len);
     fclose(f);
     return str;
@@ -77,7 +77,10 @@ void compute_lcp(struct suffix_array *sa)
         if (j == 0) continue;
         
         uint32_t k = sa->array[j - 1];
-        while (sa->string[k + l] == sa->string[i + l])
+        // Stopping at zero changes nothing for a normal
+        // string, but lets us treat zeros inside a string
+        // as distinct sentinels (see generalised_suffix_array.h).
+        while (sa->string[k + l] && sa->string[k + l] == sa->string[i + l])
             ++l;
         sa->lcp[j] = l;
         l = l > 0 ? l - 1 : 0;
@@ -232,6 +235,138 @@ void dealloc_sa_match_iter(struct sa_match_iter *iter)
     // nothing to be done here
 }
 
+/// MARK: Batched searching
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SA_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define SA_PREFETCH(addr)
+#endif
+
+// Number of binary searches we keep in flight at the same time.
+// It needs to be large enough to hide a memory access with
+// the work we do on the other searches.
+#define SA_BATCH_GROUP 16
+
+enum sa_batch_phase {
+    SA_BATCH_LOWER,
+    SA_BATCH_UPPER,
+    SA_BATCH_DONE
+};
+struct sa_batch_slot {
+    enum sa_batch_phase phase;
+    uint32_t query;
+    const uint8_t *pattern;
+    uint32_t m;
+    uint32_t lo, hi, mid;
+    const uint8_t *suffix;
+};
+
+static void start_batch_slot(
+    struct sa_batch_slot *slot,
+    struct suffix_array *sa,
+    uint32_t query,
+    const uint8_t *pattern
+) {
+    slot->phase = SA_BATCH_LOWER;
+    slot->query = query;
+    slot->pattern = pattern;
+    slot->m = (uint32_t)strlen((char *)pattern);
+    slot->lo = 0;
+    slot->hi = sa->length;
+}
+
+// Moves a slot to its next phase when its current binary
+// search is done. Returns false when the slot is finished.
+static bool advance_batch_slot(
+    struct sa_batch_slot *slot,
+    struct suffix_array *sa,
+    struct sa_interval *intervals
+) {
+    while (slot->lo >= slot->hi) {
+        switch (slot->phase) {
+            case SA_BATCH_LOWER:
+                intervals[slot->query].L = slot->lo;
+                slot->phase = SA_BATCH_UPPER;
+                slot->hi = sa->length;
+                break;
+            case SA_BATCH_UPPER:
+                intervals[slot->query].R = slot->lo;
+                slot->phase = SA_BATCH_DONE;
+                return false;
+            case SA_BATCH_DONE:
+                return false;
+        }
+    }
+    return true;
+}
+
+void sa_batch_search(
+    struct suffix_array *sa,
+    uint32_t no_patterns,
+    const uint8_t **patterns,
+    struct sa_interval *intervals
+) {
+    struct sa_batch_slot slots[SA_BATCH_GROUP];
+    uint32_t next_query = 0;
+    uint32_t active = 0;
+
+    // Fill the group
+    for (; active < SA_BATCH_GROUP && next_query < no_patterns; ++active) {
+        start_batch_slot(&slots[active], sa, next_query, patterns[next_query]);
+        next_query++;
+    }
+
+    while (active > 0) {
+        // First pass: pick the next probe for each search and
+        // prefetch the suffix array entry.
+        for (uint32_t s = 0; s < active; ++s) {
+            struct sa_batch_slot *slot = &slots[s];
+            slot->mid = slot->lo + (slot->hi - slot->lo) / 2;
+            SA_PREFETCH(sa->array + slot->mid);
+        }
+        // Second pass: by now the suffix array entries should
+        // have arrived, so we can prefetch the suffixes.
+        for (uint32_t s = 0; s < active; ++s) {
+            struct sa_batch_slot *slot = &slots[s];
+            slot->suffix = sa->string + sa->array[slot->mid];
+            SA_PREFETCH(slot->suffix);
+        }
+        // Third pass: compare and narrow the intervals. Finished
+        // searches are replaced by new queries, or if we are out
+        // of those, by the last active slot.
+        for (uint32_t s = 0; s < active; ) {
+            struct sa_batch_slot *slot = &slots[s];
+            int cmp = strncmp(
+                (char *)slot->pattern,
+                (char *)slot->suffix,
+                slot->m
+            );
+            bool go_left = (slot->phase == SA_BATCH_LOWER) ? cmp <= 0 : cmp < 0;
+            if (go_left) {
+                slot->hi = slot->mid;
+            } else {
+                slot->lo = slot->mid + 1;
+            }
+
+            if (advance_batch_slot(slot, sa, intervals)) {
+                ++s;
+                continue;
+            }
+            if (next_query < no_patterns) {
+                // The suffix array always contains the sentinel
+                // so a new search is never done before it starts.
+                assert(sa->length > 0);
+                start_batch_slot(slot, sa, next_query, patterns[next_query]);
+                next_query++;
+                ++s;
+            } else {
+                *slot = slots[--active];
+            }
+        }
+    }
+}
+
 
 /// MARK: IO
 
@@ -252,7 +387,10 @@ struct suffix_array *read_suffix_array(
     uint8_t *string
 ) {
     struct suffix_array *sa = allocate_sa_(string);
-    fread(sa->array, sizeof(*sa->array), sa->length, f);
+    if (fread(sa->array, sizeof(*sa->array), sa->length, f) != sa->length) {
+        free_suffix_array(sa);
+        return 0;
+    }
     return sa;
 }
 struct suffix_array *
@@ -261,6 +399,7 @@ read_suffix_array_fname(
     uint8_t *string
 ) {
     FILE *f = fopen(fname, "rb");
+    if (!f) return 0;
     struct suffix_array *sa = read_suffix_array(f, string);
     fclose(f);
     return sa;
@@ -93,6 +93,29 @@ void dealloc_sa_match_iter(
     struct sa_match_iter *iter
 );
 
+/**
+ * Batched searching. Each pattern gets the half-open
+ * interval [L,R) of suffix array indices whose suffixes
+ * start with the pattern (empty if L == R), so the hits
+ * are sa->array[L], ..., sa->array[R-1].
+ *
+ * The binary searches for a group of patterns are
+ * interleaved so we can prefetch the next suffix array
+ * entry and suffix for one pattern while we compare the
+ * others. Patterns must be remapped the same way as the
+ * suffix array string.
+ **/
+struct sa_interval {
+    uint32_t L;
+    uint32_t R;
+};
+void sa_batch_search(
+    struct suffix_array *sa,
+    uint32_t no_patterns,
+    const uint8_t **patterns,
+    struct sa_interval *intervals
+);
+
 void compute_inverse(
     struct suffix_array *sa
 );
@@ -105,7 +128,10 @@ void compute_lcp(
  * suffix array, not additional arrays. You need to
  * explicitly serialise those if you need them.
  **/
-// Serialisation -- FIXME: error handling!
+// Raw serialisation. The read functions give you a null
+// pointer if the file is too short, but there are no headers
+// or checksums here. Use the container functions in
+// serialise.h for index files you want to keep around.
 void write_suffix_array(
     FILE *f,
     const struct suffix_array *sa
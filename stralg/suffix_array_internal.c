@@ -8,9 +8,14 @@ struct suffix_array *allocate_sa_(uint8_t *string)
 {
     struct suffix_array *sa =
         malloc(sizeof(struct suffix_array));
+    if (!sa) return 0;
     sa->string = string;
     sa->length = (uint32_t)strlen((char *)string) + 1;
     sa->array = malloc(sa->length * sizeof(*sa->array));
+    if (!sa->array) {
+        free(sa);
+        return 0;
+    }
     
     sa->inverse = 0;
     sa->lcp = 0;
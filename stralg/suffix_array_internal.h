@@ -8,6 +8,17 @@
 
 struct suffix_array *allocate_sa_(uint8_t *x);
 
+// SA-IS on an integer string. The string x must have length
+// n + 1 with the (unique) sentinel 0 at x[n], and the letters
+// must be dense: all of 0, ..., alphabet_size - 1 must occur.
+// The n + 1 sorted suffixes are written to result.
+void sa_is_sort_integers_(
+    uint32_t *x,
+    uint32_t n,
+    uint32_t alphabet_size,
+    uint32_t *result
+);
+
 
 
 #endif
@@ -1,7 +1,10 @@
 #include "suffix_tree.h"
+#include "suffix_tree_internal.h"
 #include "cigar.h"
 
 #include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
 #include <string.h>
 #include <stdio.h>
 #include <assert.h>
@@ -207,6 +210,8 @@ alloc_suffix_tree(
     uint32_t pool_size = st->length == 1 ? 2 : (2 * st->length - 1);
     st->pool.nodes = malloc(pool_size * sizeof(struct suffix_tree_node));
     st->pool.next_node = st->pool.nodes;
+    st->pool.chunks = 0;
+    st->children = 0;
 
     st->root = new_node(st, 0, 0);
     st->root->parent = st->root;
@@ -255,21 +260,14 @@ static void append_child(
     w->parent = v;
 }
 
-static struct suffix_tree_node *
-lcp_insert(
+// Moves length_up letters up from the end of v's edge and
+// hangs w there, splitting an edge if we end up inside it.
+static void lcp_attach(
     struct suffix_tree *st,
-    uint32_t i,
-    uint32_t *sa,
-    uint32_t *lcp,
-    struct suffix_tree_node *v
+    struct suffix_tree_node *v,
+    uint32_t length_up,
+    struct suffix_tree_node *w
 ) {
-    struct suffix_tree_node *new_leaf =
-        new_node(st,
-                 st->string + sa[i] + lcp[i],
-                 st->string + st->length);
-    
-    new_leaf->leaf_label = sa[i];
-    uint32_t length_up = st->length - sa[i-1] - lcp[i];
     uint32_t v_edge_len = edge_length(v);
     
     while ((length_up >= v_edge_len)
@@ -279,15 +277,33 @@ lcp_insert(
         v_edge_len = edge_length(v);
     }
     if (length_up == 0) {
-        append_child(v, new_leaf);
+        append_child(v, w);
     } else {
         struct suffix_tree_node *u =
             split_edge(st, v, v->range.to - length_up);
-        // Append leaf to the new node
+        // Append w to the new node
         // (it has exactly one other child)
-        u->child->sibling = new_leaf;
-        new_leaf->parent = u;
+        u->child->sibling = w;
+        w->parent = u;
     }
+}
+
+static struct suffix_tree_node *
+lcp_insert(
+    struct suffix_tree *st,
+    uint32_t i,
+    uint32_t *sa,
+    uint32_t *lcp,
+    struct suffix_tree_node *v
+) {
+    struct suffix_tree_node *new_leaf =
+        new_node(st,
+                 st->string + sa[i] + lcp[i],
+                 st->string + st->length);
+    
+    new_leaf->leaf_label = sa[i];
+    uint32_t length_up = st->length - sa[i-1] - lcp[i];
+    lcp_attach(st, v, length_up, new_leaf);
     
     return new_leaf;
 }
@@ -315,6 +331,209 @@ lcp_suffix_tree(
     return st;
 }
 
+#pragma mark Parallel LCP construction
+
+static uint32_t max_bucket_size(
+    uint32_t n,
+    const uint32_t *lcp,
+    uint32_t q
+) {
+    uint32_t max = 0, start = 0;
+    for (uint32_t i = 1; i < n; ++i) {
+        if (lcp[i] < q) {
+            if (i - start > max) max = i - start;
+            start = i;
+        }
+    }
+    if (n - start > max) max = n - start;
+    return max;
+}
+
+void init_lcp_partition_(
+    struct lcp_partition_ *partition,
+    uint32_t n,
+    const uint32_t *lcp,
+    uint32_t no_threads
+) {
+    // We want the largest bucket to be a small fraction of
+    // the work per thread, but longer prefixes give us more
+    // buckets to stitch together, so we stop at the first
+    // q that gets there (or give up on highly repetitive
+    // strings).
+    uint32_t target = n / (8 * no_threads);
+    if (target == 0) target = 1;
+    static const uint32_t qs[] = { 1, 2, 3, 4, 6, 8, 12, 16 };
+    uint32_t q = 1;
+    for (uint32_t k = 0; k < sizeof(qs) / sizeof(*qs); ++k) {
+        q = qs[k];
+        if (max_bucket_size(n, lcp, q) <= target) break;
+    }
+    partition->q = q;
+
+    uint32_t no_buckets = 1;
+    for (uint32_t i = 1; i < n; ++i)
+        no_buckets += lcp[i] < q;
+    partition->no_buckets = no_buckets;
+    partition->buckets = malloc((no_buckets + 1) * sizeof(uint32_t));
+    uint32_t b = 0;
+    partition->buckets[b++] = 0;
+    for (uint32_t i = 1; i < n; ++i) {
+        if (lcp[i] < q) partition->buckets[b++] = i;
+    }
+    partition->buckets[b] = n;
+
+    partition->tasks = malloc((no_buckets + 1) * sizeof(uint32_t));
+    uint32_t t = 0, task_size = 0;
+    partition->tasks[t++] = 0;
+    for (b = 0; b < no_buckets; ++b) {
+        task_size += partition->buckets[b + 1] - partition->buckets[b];
+        if (task_size >= target && b + 1 < no_buckets) {
+            partition->tasks[t++] = b + 1;
+            task_size = 0;
+        }
+    }
+    partition->tasks[t] = no_buckets;
+    partition->no_tasks = t;
+}
+
+void dealloc_lcp_partition_(
+    struct lcp_partition_ *partition
+) {
+    free(partition->buckets);
+    free(partition->tasks);
+}
+
+struct lcp_build_data {
+    struct suffix_tree *st;
+    uint32_t *sa;
+    uint32_t *lcp;
+    const struct lcp_partition_ *partition;
+    struct suffix_tree_node **slices;
+    struct suffix_tree_node **tops;
+    atomic_uint next_task;
+};
+
+// Builds the subtree for a bucket under a temporary root.
+// The thread gets its own copy of the tree so new_node
+// takes nodes from the bucket's slice of the pool.
+static void lcp_build_bucket(
+    struct lcp_build_data *data,
+    uint32_t b
+) {
+    uint32_t L = data->partition->buckets[b];
+    uint32_t R = data->partition->buckets[b + 1];
+    uint32_t *sa = data->sa;
+
+    struct suffix_tree local = *data->st;
+    local.pool.next_node = data->slices[b];
+    struct suffix_tree_node root = {
+        .range = { 0, 0 }, .parent = &root
+    };
+    local.root = &root;
+
+    struct suffix_tree_node *v =
+        new_node(&local, local.string + sa[L],
+                 local.string + local.length);
+    v->leaf_label = sa[L];
+    root.child = v;
+    v->parent = &root;
+    for (uint32_t i = L + 1; i < R; ++i) {
+        v = lcp_insert(&local, i, sa, data->lcp, v);
+    }
+
+    // All the suffixes share their first letter, so there
+    // is a single node below the temporary root.
+    assert(root.child && !root.child->sibling);
+    data->tops[b] = root.child;
+}
+
+static void *lcp_build_worker(void *arg)
+{
+    struct lcp_build_data *data = arg;
+    const struct lcp_partition_ *partition = data->partition;
+    for (;;) {
+        uint32_t t = atomic_fetch_add(&data->next_task, 1);
+        if (t >= partition->no_tasks) break;
+        for (uint32_t b = partition->tasks[t]; b < partition->tasks[t + 1]; ++b)
+            lcp_build_bucket(data, b);
+    }
+    return 0;
+}
+
+struct suffix_tree *
+parallel_lcp_suffix_tree(
+    const uint8_t *string,
+    uint32_t *sa,
+    uint32_t *lcp,
+    uint32_t no_threads
+) {
+    uint32_t n = (uint32_t)strlen((char *)string) + 1;
+    if (no_threads < 2 || n < PARALLEL_LCP_MIN_LENGTH)
+        return lcp_suffix_tree(string, sa, lcp);
+
+    struct suffix_tree *st = alloc_suffix_tree(string);
+    struct lcp_partition_ partition;
+    init_lcp_partition_(&partition, n, lcp, no_threads);
+    uint32_t no_buckets = partition.no_buckets;
+
+    // A bucket with k suffixes needs at most 2k - 1 nodes.
+    // The nodes we need to stitch the buckets together go
+    // after the slices. There are at most no_buckets - 2 of
+    // them, since the root already has two children (the
+    // sentinel is a bucket of its own), so the whole thing
+    // fits in the 2n - 1 nodes we allocated.
+    struct suffix_tree_node **slices = malloc(no_buckets * sizeof(*slices));
+    struct suffix_tree_node **tops = malloc(no_buckets * sizeof(*tops));
+    struct suffix_tree_node *next = st->pool.next_node;
+    for (uint32_t b = 0; b < no_buckets; ++b) {
+        slices[b] = next;
+        next += 2 * (partition.buckets[b + 1] - partition.buckets[b]) - 1;
+    }
+
+    struct lcp_build_data data = {
+        .st = st, .sa = sa, .lcp = lcp,
+        .partition = &partition,
+        .slices = slices, .tops = tops
+    };
+    atomic_init(&data.next_task, 0);
+    pthread_t *threads = malloc(no_threads * sizeof(*threads));
+    uint32_t no_started = 0;
+    for (; no_started < no_threads; ++no_started) {
+        if (pthread_create(&threads[no_started], 0, lcp_build_worker, &data))
+            break;
+    }
+    // If we couldn't start any threads we do the work here.
+    if (no_started == 0) lcp_build_worker(&data);
+    for (uint32_t i = 0; i < no_started; ++i)
+        pthread_join(threads[i], 0);
+    free(threads);
+
+    // Now we hang the subtrees on the root, in the same
+    // way as we insert leaves in the sequential construction,
+    // except that the subtrees start at their bucket's
+    // depth instead of at the end of the string.
+    st->pool.next_node = next;
+    struct suffix_tree_node *v = tops[0];
+    st->root->child = v;
+    v->parent = st->root;
+    uint32_t v_depth = edge_length(v);
+    for (uint32_t b = 1; b < no_buckets; ++b) {
+        struct suffix_tree_node *w = tops[b];
+        uint32_t w_depth = edge_length(w);
+        uint32_t branch_depth = lcp[partition.buckets[b]];
+        w->range.from += branch_depth;
+        lcp_attach(st, v, v_depth - branch_depth, w);
+        v = w;
+        v_depth = w_depth;
+    }
+    assert(st->pool.next_node <= st->pool.nodes + 2 * n - 1);
+
+    free(slices);
+    free(tops);
+    dealloc_lcp_partition_(&partition);
+    return st;
+}
+
 #pragma mark McCreight's algorithm
 
 static struct suffix_tree_node *
@@ -457,16 +676,1017 @@ mccreight_suffix_tree(
 }
 
 
+#pragma mark Ukkonen online construction
+
+struct online_suffix_tree *
+alloc_online_suffix_tree(
+    uint32_t capacity
+) {
+    if (capacity < 16) capacity = 16;
+    struct online_suffix_tree *ost = malloc(sizeof(struct online_suffix_tree));
+    // We need room for the sentinel as well, and the rest
+    // of the buffer must be zero; see the header.
+    ost->buffer = calloc(capacity + 1, 1);
+    ost->capacity = capacity;
+    ost->length = 0;
+
+    struct suffix_tree *st = malloc(sizeof(struct suffix_tree));
+    st->string = ost->buffer;
+    st->length = 0;
+    ost->chunk_size = 2 * capacity + 2;
+    st->pool.nodes = malloc((ost->chunk_size + 1) * sizeof(struct suffix_tree_node));
+    st->pool.next_node = st->pool.nodes;
+    st->pool.chunks = alloc_pointer_vector(4);
+    st->children = 0;
+    ost->chunk_end = st->pool.nodes + ost->chunk_size;
+    ost->st = st;
+
+    st->root = new_node(st, 0, 0);
+    st->root->parent = st->root;
+    st->root->suffix_link = st->root;
+
+    ost->active_node = st->root;
+    ost->active_edge = 0;
+    ost->active_length = 0;
+    ost->remainder = 0;
+
+    return ost;
+}
+
+// An extension step creates at most two nodes. If the
+// current chunk cannot hold them, we start a new one and
+// leave the old nodes where they are. Chunks have room for
+// one node more than we use, and when we leave a chunk we
+// put a node without a parent there to mark its end. All
+// the nodes we have created have parents.
+static void reserve_online_nodes(
+    struct online_suffix_tree *ost
+) {
+    struct suffix_tree *st = ost->st;
+    if (ost->chunk_end - st->pool.next_node >= 2)
+        return;
+    st->pool.next_node->parent = 0;
+    pointer_vector_append(st->pool.chunks, (void *)st->pool.nodes);
+    ost->chunk_size *= 2;
+    st->pool.nodes = malloc((ost->chunk_size + 1) * sizeof(struct suffix_tree_node));
+    st->pool.next_node = st->pool.nodes;
+    ost->chunk_end = st->pool.nodes + ost->chunk_size;
+}
+
+static struct suffix_tree_node *
+retired_chunk_end(
+    struct suffix_tree_node *chunk
+) {
+    while (chunk->parent) ++chunk;
+    return chunk;
+}
+
+static void rebase_nodes(
+    struct online_suffix_tree *ost,
+    struct suffix_tree_node *from,
+    struct suffix_tree_node *to,
+    uintptr_t old_buffer
+) {
+    const uint8_t *leaf_end = ost->buffer + ost->capacity;
+    for (struct suffix_tree_node *v = from; v != to; ++v) {
+        if (v == ost->st->root) continue;
+        v->range.from = ost->buffer + ((uintptr_t)v->range.from - old_buffer);
+        if (is_leaf(v))
+            v->range.to = leaf_end;
+        else
+            v->range.to = ost->buffer + ((uintptr_t)v->range.to - old_buffer);
+    }
+}
+
+// Grows the text buffer. The edges point into the buffer, so
+// we have to move all of them along with it.
+static void grow_online_buffer(
+    struct online_suffix_tree *ost,
+    uint32_t min_capacity
+) {
+    uint32_t capacity = ost->capacity;
+    while (capacity < min_capacity)
+        capacity *= 2;
+
+    uintptr_t old_buffer = (uintptr_t)ost->buffer;
+    ost->buffer = realloc(ost->buffer, capacity + 1);
+    memset(ost->buffer + ost->capacity + 1, 0, capacity - ost->capacity);
+    ost->capacity = capacity;
+    ost->st->string = ost->buffer;
+
+    struct suffix_tree_node_pool *pool = &ost->st->pool;
+    for (uint32_t i = 0; i < pool->chunks->used; ++i) {
+        struct suffix_tree_node *chunk = pool->chunks->data[i];
+        struct suffix_tree_node *end = retired_chunk_end(chunk);
+        rebase_nodes(ost, chunk, end, old_buffer);
+    }
+    rebase_nodes(ost, pool->nodes, pool->next_node, old_buffer);
+}
+
+// While we build the tree, leaves end where the text ends.
+static inline uint32_t online_edge_length(
+    struct online_suffix_tree *ost,
+    struct suffix_tree_node *v
+) {
+    if (is_leaf(v))
+        return (uint32_t)(ost->buffer + ost->length - v->range.from);
+    else
+        return edge_length(v);
+}
+
+static struct suffix_tree_node *
+new_online_leaf(
+    struct online_suffix_tree *ost,
+    struct suffix_tree_node *parent,
+    uint32_t pos
+) {
+    struct suffix_tree *st = ost->st;
+    struct suffix_tree_node *leaf =
+        new_node(st, ost->buffer + pos, ost->buffer + ost->capacity);
+    leaf->leaf_label = pos - ost->remainder + 1;
+    insert_child(parent, leaf);
+    leaf->parent = parent;
+    return leaf;
+}
+
+static void ukkonen_extend(
+    struct online_suffix_tree *ost,
+    uint8_t a
+) {
+    struct suffix_tree *st = ost->st;
+    uint32_t pos = ost->length;
+    ost->buffer[pos] = a;
+    ost->length++;
+    ost->remainder++;
+
+    struct suffix_tree_node *last_new = 0;
+    while (ost->remainder > 0) {
+        reserve_online_nodes(ost);
+        if (ost->active_length == 0)
+            ost->active_edge = pos;
+
+        struct suffix_tree_node *v = ost->active_node;
+        struct suffix_tree_node *w =
+            find_outgoing_edge(v, ost->buffer + ost->active_edge);
+        if (!w) {
+            new_online_leaf(ost, v, pos);
+            if (last_new) {
+                last_new->suffix_link = v;
+                last_new = 0;
+            }
+        } else {
+            uint32_t len = online_edge_length(ost, w);
+            if (ost->active_length >= len) {
+                // walk down (skip/count)
+                ost->active_edge += len;
+                ost->active_length -= len;
+                ost->active_node = w;
+                continue;
+            }
+            if (w->range.from[ost->active_length] == a) {
+                // The suffix is already in the tree (implicitly),
+                // and so are all the shorter ones.
+                if (last_new && v != st->root) {
+                    last_new->suffix_link = v;
+                    last_new = 0;
+                }
+                ost->active_length++;
+                break;
+            }
+            struct suffix_tree_node *u =
+                split_edge(st, w, w->range.from + ost->active_length);
+            new_online_leaf(ost, u, pos);
+            if (last_new)
+                last_new->suffix_link = u;
+            last_new = u;
+        }
+
+        ost->remainder--;
+        if (ost->active_node == st->root && ost->active_length > 0) {
+            ost->active_length--;
+            ost->active_edge = pos - ost->remainder + 1;
+        } else if (ost->active_node != st->root) {
+            struct suffix_tree_node *link = ost->active_node->suffix_link;
+            ost->active_node = link ? link : st->root;
+        }
+    }
+    if (last_new && !last_new->suffix_link)
+        last_new->suffix_link = st->root;
+}
+
+void online_suffix_tree_append(
+    struct online_suffix_tree *ost,
+    const uint8_t *text,
+    uint32_t length
+) {
+    // Keep room for the sentinel
+    if (ost->length + length + 1 > ost->capacity)
+        grow_online_buffer(ost, ost->length + length + 1);
+    for (uint32_t i = 0; i < length; ++i) {
+        assert(text[i] != 0);
+        ukkonen_extend(ost, text[i]);
+    }
+    ost->st->length = ost->length;
+}
+
+static void finish_leaves(
+    struct online_suffix_tree *ost,
+    struct suffix_tree_node *from,
+    struct suffix_tree_node *to
+) {
+    const uint8_t *end = ost->buffer + ost->length;
+    for (struct suffix_tree_node *v = from; v != to; ++v) {
+        if (v != ost->st->root && is_leaf(v))
+            v->range.to = end;
+    }
+}
+
+static struct suffix_tree_node *
+move_chunk(
+    struct suffix_tree_node *to,
+    struct suffix_tree_node *from,
+    struct suffix_tree_node *end
+) {
+    for (struct suffix_tree_node *v = from; v != end; ++v, ++to) {
+        *to = *v;
+        // We are done with the old node, so we use its
+        // suffix link to remember where it went.
+        v->suffix_link = to;
+    }
+    return to;
+}
+
+static inline struct suffix_tree_node *
+moved(
+    struct suffix_tree_node *v
+) {
+    return v ? v->suffix_link : 0;
+}
+
+// Once the tree is finished, nodes no longer have to stay
+// put, so we move them all into a single array. Then the
+// finished tree looks like any other tree, and the functions
+// that need the whole pool work on it.
+static void compact_online_pool(
+    struct suffix_tree *st
+) {
+    struct suffix_tree_node_pool *pool = &st->pool;
+    uint32_t no_nodes = (uint32_t)(pool->next_node - pool->nodes);
+    for (uint32_t i = 0; i < pool->chunks->used; ++i) {
+        struct suffix_tree_node *chunk = pool->chunks->data[i];
+        no_nodes += (uint32_t)(retired_chunk_end(chunk) - chunk);
+    }
+
+    struct suffix_tree_node *nodes = malloc(no_nodes * sizeof(struct suffix_tree_node));
+    struct suffix_tree_node *next = nodes;
+    for (uint32_t i = 0; i < pool->chunks->used; ++i) {
+        struct suffix_tree_node *chunk = pool->chunks->data[i];
+        next = move_chunk(next, chunk, retired_chunk_end(chunk));
+    }
+    next = move_chunk(next, pool->nodes, pool->next_node);
+
+    for (struct suffix_tree_node *v = nodes; v != next; ++v) {
+        v->parent = moved(v->parent);
+        v->sibling = moved(v->sibling);
+        v->child = moved(v->child);
+        v->suffix_link = moved(v->suffix_link);
+    }
+    st->root = moved(st->root);
+
+    for (uint32_t i = 0; i < pool->chunks->used; ++i)
+        free(pool->chunks->data[i]);
+    free_pointer_vector(pool->chunks);
+    free(pool->nodes);
+    pool->nodes = nodes;
+    pool->next_node = next;
+    pool->chunks = 0;
+}
+
+struct suffix_tree *
+finish_online_suffix_tree(
+    struct online_suffix_tree *ost
+) {
+    // The sentinel is unique, so every suffix gets a leaf.
+    ukkonen_extend(ost, '\0');
+    assert(ost->remainder == 0);
+
+    struct suffix_tree *st = ost->st;
+    struct suffix_tree_node_pool *pool = &st->pool;
+    for (uint32_t i = 0; i < pool->chunks->used; ++i) {
+        struct suffix_tree_node *chunk = pool->chunks->data[i];
+        struct suffix_tree_node *end = retired_chunk_end(chunk);
+        finish_leaves(ost, chunk, end);
+    }
+    finish_leaves(ost, pool->nodes, pool->next_node);
+    st->length = ost->length;
+    compact_online_pool(st);
+
+    free(ost);
+    return st;
+}
+
+void free_online_suffix_tree(
+    struct online_suffix_tree *ost
+) {
+    free_complete_suffix_tree(ost->st);
+    free(ost);
+}
+
+void init_online_st_search_iter(
+    struct online_st_search_iter *iter,
+    const struct online_suffix_tree *ost,
+    const uint8_t *pattern
+) {
+    iter->ost = ost;
+    init_st_search_iter(&iter->tree_iter, ost->st, pattern);
+    // The last remainder suffixes don't have leaves yet, and
+    // they are all in the last remainder letters.
+    iter->pending_start = ost->length - ost->remainder;
+    uint32_t m = (uint32_t)strlen((char *)pattern);
+    if (m == 0) {
+        // KMP can't build a border array for an empty pattern,
+        // and an empty iterator never reports a match.
+        iter->pending_iter = (struct kmp_match_iter){ 0 };
+        return;
+    }
+    init_kmp_match_iter(&iter->pending_iter,
+                        ost->buffer + iter->pending_start, ost->remainder,
+                        pattern, m);
+}
+
+bool next_online_st_match(
+    struct online_st_search_iter *iter,
+    struct st_search_match *match
+) {
+    if (next_st_match(&iter->tree_iter, match))
+        return true;
+
+    struct match pending;
+    if (next_kmp_match(&iter->pending_iter, &pending)) {
+        match->pos = iter->pending_start + pending.pos;
+        return true;
+    }
+    return false;
+}
+
+void dealloc_online_st_search_iter(
+    struct online_st_search_iter *iter
+) {
+    dealloc_st_search_iter(&iter->tree_iter);
+    dealloc_kmp_match_iter(&iter->pending_iter);
+}
+
+
 #pragma mark free
 
 void free_suffix_tree(
     struct suffix_tree *st
 ) {
     // Do not free string; we are not managing it
+    st_free_child_index(st);
     free(st->pool.nodes);
+    if (st->pool.chunks) {
+        for (uint32_t i = 0; i < st->pool.chunks->used; ++i)
+            free(st->pool.chunks->data[i]);
+        free_pointer_vector(st->pool.chunks);
+    }
     free(st);
 }
 
+void free_complete_suffix_tree(
+    struct suffix_tree *st
+) {
+    free((uint8_t *)st->string);
+    free_suffix_tree(st);
+}
+
+
+#pragma mark Child index
+
+static inline uint32_t child_hash_size(uint32_t degree)
+{
+    uint32_t size = 16;
+    while (size < 2 * degree) size *= 2;
+    return size;
+}
+
+struct suffix_tree_node *
+st_find_child(
+    const struct suffix_tree *st,
+    struct suffix_tree_node *v,
+    uint8_t a
+) {
+    const struct st_child_index *index = st->children;
+    if (!index) {
+        struct suffix_tree_node *w = v->child;
+        while (w && *(w->range.from) != a)
+            w = w->sibling;
+        return w;
+    }
+
+    uint32_t id = (uint32_t)(v - st->pool.nodes);
+    uint32_t size = index->size[id];
+    const uint8_t *keys = index->keys + index->offset[id];
+    struct suffix_tree_node **children = index->children + index->offset[id];
+    if (size <= ST_CHILD_ARRAY_MAX) {
+        // The keys are sorted, but with this few a linear
+        // scan is as fast as anything.
+        for (uint32_t i = 0; i < size; ++i) {
+            if (keys[i] == a) return children[i];
+        }
+        return 0;
+    }
+    uint32_t mask = size - 1;
+    for (uint32_t i = a & mask; children[i]; i = (i + 1) & mask) {
+        if (keys[i] == a) return children[i];
+    }
+    return 0;
+}
+
+void st_free_child_index(
+    struct suffix_tree *st
+) {
+    struct st_child_index *index = st->children;
+    if (!index) return;
+    free(index->offset);
+    free(index->size);
+    free(index->keys);
+    free(index->children);
+    free(index);
+    st->children = 0;
+}
+
+void st_build_child_index(
+    struct suffix_tree *st
+) {
+    assert(!st->pool.chunks || st->pool.chunks->used == 0);
+    st_free_child_index(st);
+
+    struct st_child_index *index = malloc(sizeof(struct st_child_index));
+    uint32_t no_nodes = (uint32_t)(st->pool.next_node - st->pool.nodes);
+    index->no_nodes = no_nodes;
+    index->offset = malloc(no_nodes * sizeof(*index->offset));
+    index->size = calloc(no_nodes, sizeof(*index->size));
+
+    // First we find the table sizes...
+    struct pointer_vector stack;
+    init_pointer_vector(&stack, 64);
+    size_t no_entries = 0;
+    pointer_vector_append(&stack, (void *)st->root);
+    while (stack.used > 0) {
+        struct suffix_tree_node *v = stack.data[--stack.used];
+        uint32_t degree = 0;
+        for (struct suffix_tree_node *w = v->child; w; w = w->sibling) {
+            degree++;
+            if (w->child) pointer_vector_append(&stack, (void *)w);
+        }
+        uint32_t size =
+            degree <= ST_CHILD_ARRAY_MAX ? degree : child_hash_size(degree);
+        uint32_t id = (uint32_t)(v - st->pool.nodes);
+        index->offset[id] = (uint32_t)no_entries;
+        index->size[id] = (uint16_t)size;
+        no_entries += size;
+    }
+
+    // ...then we fill them in.
+    index->no_entries = no_entries;
+    index->keys = malloc(no_entries ? no_entries : 1);
+    index->children = calloc(no_entries ? no_entries : 1, sizeof(*index->children));
+    pointer_vector_append(&stack, (void *)st->root);
+    while (stack.used > 0) {
+        struct suffix_tree_node *v = stack.data[--stack.used];
+        uint32_t id = (uint32_t)(v - st->pool.nodes);
+        uint32_t size = index->size[id];
+        uint8_t *keys = index->keys + index->offset[id];
+        struct suffix_tree_node **children = index->children + index->offset[id];
+        uint32_t i = 0, mask = size - 1;
+        for (struct suffix_tree_node *w = v->child; w; w = w->sibling) {
+            uint8_t a = *(w->range.from);
+            if (w->child) pointer_vector_append(&stack, (void *)w);
+            if (size <= ST_CHILD_ARRAY_MAX) {
+                // The sibling list is sorted, but as signed
+                // chars, so we sort the keys ourselves.
+                uint32_t j = i++;
+                for (; j > 0 && keys[j - 1] > a; --j) {
+                    keys[j] = keys[j - 1];
+                    children[j] = children[j - 1];
+                }
+                keys[j] = a;
+                children[j] = w;
+            } else {
+                uint32_t j = a & mask;
+                while (children[j]) j = (j + 1) & mask;
+                keys[j] = a;
+                children[j] = w;
+            }
+        }
+    }
+    dealloc_pointer_vector(&stack);
+
+    st->children = index;
+}
+
+size_t st_child_index_bytes(
+    const struct suffix_tree *st
+) {
+    const struct st_child_index *index = st->children;
+    if (!index) return 0;
+    return sizeof(*index)
+        + index->no_nodes * (sizeof(*index->offset) + sizeof(*index->size))
+        + index->no_entries * (sizeof(*index->keys) + sizeof(*index->children));
+}
+
+
+#pragma mark Layout
+
+// Gives the nodes new positions, in the order we want them,
+// and returns the number of nodes in the tree.
+static uint32_t layout_order(
+    struct suffix_tree *st,
+    enum st_layout layout,
+    uint32_t *new_index
+) {
+    struct suffix_tree_node *nodes = st->pool.nodes;
+    struct pointer_vector stack;
+    init_pointer_vector(&stack, 64);
+    uint32_t next = 0;
+
+    switch (layout) {
+        case ST_LAYOUT_PREORDER:
+            pointer_vector_append(&stack, (void *)st->root);
+            while (stack.used > 0) {
+                struct suffix_tree_node *v = stack.data[--stack.used];
+                new_index[v - nodes] = next++;
+                // siblings first, so we get to the child first
+                if (v != st->root && v->sibling)
+                    pointer_vector_append(&stack, (void *)v->sibling);
+                if (v->child)
+                    pointer_vector_append(&stack, (void *)v->child);
+            }
+            break;
+
+        case ST_LAYOUT_FAMILIES:
+            new_index[st->root - nodes] = next++;
+            pointer_vector_append(&stack, (void *)st->root);
+            while (stack.used > 0) {
+                struct suffix_tree_node *v = stack.data[--stack.used];
+                uint32_t first = stack.used;
+                for (struct suffix_tree_node *w = v->child; w; w = w->sibling) {
+                    new_index[w - nodes] = next++;
+                    if (w->child)
+                        pointer_vector_append(&stack, (void *)w);
+                }
+                // Reverse the children we pushed, so we
+                // handle the first child's family next.
+                for (uint32_t i = first, j = stack.used; i + 1 < j; ++i, --j) {
+                    void *tmp = stack.data[i];
+                    stack.data[i] = stack.data[j - 1];
+                    stack.data[j - 1] = tmp;
+                }
+            }
+            break;
+    }
+
+    dealloc_pointer_vector(&stack);
+    return next;
+}
+
+void st_relayout(
+    struct suffix_tree *st,
+    enum st_layout layout
+) {
+    assert(!st->pool.chunks || st->pool.chunks->used == 0);
+    struct suffix_tree_node *old_nodes = st->pool.nodes;
+    uint32_t pool_size = (uint32_t)(st->pool.next_node - old_nodes);
+
+    // Nodes that aren't in the tree (the parallel
+    // construction leaves gaps in the pool) don't get a
+    // new position, so this also compacts the pool.
+    uint32_t *new_index = malloc(pool_size * sizeof(*new_index));
+    uint32_t no_nodes = layout_order(st, layout, new_index);
+
+    struct suffix_tree_node *new_nodes =
+        malloc(no_nodes * sizeof(struct suffix_tree_node));
+#define MOVE(p) ((p) ? new_nodes + new_index[(p) - old_nodes] : 0)
+    struct pointer_vector stack;
+    init_pointer_vector(&stack, 64);
+    pointer_vector_append(&stack, (void *)st->root);
+    while (stack.used > 0) {
+        struct suffix_tree_node *v = stack.data[--stack.used];
+        for (struct suffix_tree_node *w = v->child; w; w = w->sibling)
+            pointer_vector_append(&stack, (void *)w);
+
+        struct suffix_tree_node *u = new_nodes + new_index[v - old_nodes];
+        *u = *v;
+        u->parent = MOVE(v->parent);
+        u->child = MOVE(v->child);
+        u->sibling = MOVE(v->sibling);
+        u->suffix_link = MOVE(v->suffix_link);
+    }
+#undef MOVE
+    dealloc_pointer_vector(&stack);
+
+    st->root = new_nodes + new_index[st->root - old_nodes];
+    st->pool.nodes = new_nodes;
+    st->pool.next_node = new_nodes + no_nodes;
+    free(old_nodes);
+    free(new_index);
+
+    if (st->children)
+        st_build_child_index(st);
+}
+
+
+#pragma mark Serialisation
+
+#define ST_HEADER_TAG CONTAINER_TAG('S','T','H','D')
+#define ST_STRING_TAG CONTAINER_TAG('S','T','R',' ')
+#define ST_NODES_TAG  CONTAINER_TAG('S','T','N','D')
+
+struct st_file_header {
+    uint32_t length; // including the sentinel
+    uint32_t no_nodes;
+    uint32_t reserved[2];
+};
+
+bool write_st_file_(
+    FILE *f,
+    const uint8_t *string,
+    uint32_t length,
+    uint32_t no_nodes,
+    const struct st_file_node *nodes,
+    enum error_codes *err
+) {
+    struct st_file_header header;
+    memset(&header, 0, sizeof(header));
+    header.length = length;
+    header.no_nodes = no_nodes;
+
+    struct container_writer w;
+    init_container_writer(&w, f, SUFFIX_TREE_KIND);
+    write_container_section(&w, ST_HEADER_TAG, &header, sizeof(header));
+    write_container_section(&w, ST_STRING_TAG, string, length);
+    write_container_section(&w, ST_NODES_TAG, nodes,
+                            (uint64_t)no_nodes * sizeof(*nodes));
+    return finish_container(&w, err);
+}
+
+static bool valid_st_file_header(
+    const struct st_file_header *header
+) {
+    // A tree has at least the root and the sentinel leaf,
+    // and at most 2n - 1 nodes (or two for the empty string).
+    uint64_t max_nodes = header->length == 1 ? 2 : 2 * (uint64_t)header->length - 1;
+    return header->length > 0
+        && header->no_nodes >= 2
+        && header->no_nodes <= max_nodes;
+}
+
+static bool valid_st_file_string(
+    const uint8_t *string,
+    uint32_t length
+) {
+    // zero terminated and no other zeros
+    return strnlen((const char *)string, length) == length - 1;
+}
+
+// Checks that the nodes form a tree rooted in node zero,
+// with edges inside the string and leaves labelled by
+// suffixes. We don't check that it is the suffix tree of
+// the string; the checksums take care of that.
+static bool valid_st_file_nodes(
+    uint32_t length,
+    uint32_t no_nodes,
+    const struct st_file_node *nodes
+) {
+    for (uint32_t i = 0; i < no_nodes; ++i) {
+        const struct st_file_node *v = &nodes[i];
+        if (v->from > v->to || v->to > length) return false;
+        if (v->parent >= no_nodes) return false;
+        if (v->child != ST_FILE_NIL && v->child >= no_nodes) return false;
+        if (v->sibling != ST_FILE_NIL && v->sibling >= no_nodes) return false;
+        if (v->suffix_link != ST_FILE_NIL && v->suffix_link >= no_nodes) return false;
+        if (v->child == ST_FILE_NIL && v->leaf_label >= length) return false;
+    }
+    if (nodes[0].parent != 0 || nodes[0].child == ST_FILE_NIL)
+        return false;
+
+    // Every node must be reached exactly once, and only
+    // from its parent; that rules out cycles.
+    bool ok = true;
+    uint8_t *seen = calloc(no_nodes, 1);
+    struct index_vector stack;
+    init_index_vector(&stack, 64);
+    seen[0] = 1;
+    index_vector_append(&stack, 0);
+    while (ok && stack.used > 0) {
+        uint32_t v = stack.data[--stack.used];
+        for (uint32_t w = nodes[v].child; w != ST_FILE_NIL; w = nodes[w].sibling) {
+            if (seen[w] || nodes[w].parent != v || nodes[w].from == nodes[w].to) {
+                ok = false;
+                break;
+            }
+            seen[w] = 1;
+            index_vector_append(&stack, w);
+        }
+    }
+    dealloc_index_vector(&stack);
+    free(seen);
+    return ok;
+}
+
+bool read_st_file_(
+    FILE *f,
+    bool verify,
+    uint8_t **string,
+    uint32_t *length,
+    uint32_t *no_nodes,
+    struct st_file_node **nodes,
+    enum error_codes *err
+) {
+    struct container_reader r;
+    struct st_file_header header;
+    uint8_t *s = 0;
+    struct st_file_node *n = 0;
+
+    if (!init_container_reader(&r, f, SUFFIX_TREE_KIND, verify))
+        goto done;
+    if (!read_container_section(&r, ST_HEADER_TAG, &header, sizeof(header)))
+        goto done;
+    if (!valid_st_file_header(&header)) {
+        r.error = MALFORMED_FILE;
+        goto done;
+    }
+    s = malloc(header.length);
+    if (!read_container_section(&r, ST_STRING_TAG, s, header.length))
+        goto done;
+    if (!valid_st_file_string(s, header.length)) {
+        r.error = MALFORMED_FILE;
+        goto done;
+    }
+    n = malloc(header.no_nodes * sizeof(*n));
+    if (!read_container_section(&r, ST_NODES_TAG, n,
+                                (uint64_t)header.no_nodes * sizeof(*n)))
+        goto done;
+    if (!valid_st_file_nodes(header.length, header.no_nodes, n)) {
+        r.error = MALFORMED_FILE;
+        goto done;
+    }
+
+done:
+    if (!finish_container_reader(&r, err)) {
+        free(s);
+        free(n);
+        return false;
+    }
+    *string = s;
+    *length = header.length;
+    *no_nodes = header.no_nodes;
+    *nodes = n;
+    return true;
+}
+
+static struct st_file_node *
+st_file_nodes(
+    const struct suffix_tree *st,
+    uint32_t *no_nodes
+) {
+    assert(!st->pool.chunks || st->pool.chunks->used == 0);
+    struct suffix_tree_node *pool = st->pool.nodes;
+    uint32_t pool_size = (uint32_t)(st->pool.next_node - pool);
+    uint32_t *index = malloc(pool_size * sizeof(*index));
+    *no_nodes = layout_order((struct suffix_tree *)st, ST_LAYOUT_FAMILIES, index);
+#define INDEX(p) ((p) ? index[(p) - pool] : ST_FILE_NIL)
+
+    struct st_file_node *nodes = malloc(*no_nodes * sizeof(*nodes));
+    struct pointer_vector stack;
+    init_pointer_vector(&stack, 64);
+    pointer_vector_append(&stack, (void *)st->root);
+    while (stack.used > 0) {
+        struct suffix_tree_node *v = stack.data[--stack.used];
+        for (struct suffix_tree_node *w = v->child; w; w = w->sibling)
+            pointer_vector_append(&stack, (void *)w);
+
+        struct st_file_node *u = &nodes[index[v - pool]];
+        memset(u, 0, sizeof(*u));
+        if (v != st->root) {
+            u->from = (uint32_t)(v->range.from - st->string);
+            u->to = (uint32_t)(v->range.to - st->string);
+        }
+        u->leaf_label = v->child ? 0 : v->leaf_label;
+        u->parent = INDEX(v->parent);
+        u->child = INDEX(v->child);
+        u->sibling = v == st->root ? ST_FILE_NIL : INDEX(v->sibling);
+        u->suffix_link = INDEX(v->suffix_link);
+    }
+#undef INDEX
+    dealloc_pointer_vector(&stack);
+    free(index);
+    return nodes;
+}
+
+bool write_suffix_tree(
+    FILE *f,
+    const struct suffix_tree *st,
+    enum error_codes *err
+) {
+    uint32_t no_nodes;
+    struct st_file_node *nodes = st_file_nodes(st, &no_nodes);
+    bool ok = write_st_file_(f, st->string, st->length, no_nodes, nodes, err);
+    free(nodes);
+    return ok;
+}
+
+bool write_suffix_tree_fname(
+    const char *fname,
+    const struct suffix_tree *st,
+    enum error_codes *err
+) {
+    FILE *f = fopen(fname, "wb");
+    if (!f) {
+        if (err) *err = CANNOT_OPEN_FILE;
+        return false;
+    }
+    bool ok = write_suffix_tree(f, st, err);
+    if (fclose(f) != 0 && ok) {
+        if (err) *err = CANNOT_WRITE_FILE;
+        ok = false;
+    }
+    return ok;
+}
+
+struct suffix_tree *
+read_suffix_tree(
+    FILE *f,
+    bool verify,
+    enum error_codes *err
+) {
+    uint8_t *string;
+    uint32_t length, no_nodes;
+    struct st_file_node *file_nodes;
+    if (!read_st_file_(f, verify, &string, &length, &no_nodes, &file_nodes, err))
+        return 0;
+
+    struct suffix_tree *st = malloc(sizeof(struct suffix_tree));
+    st->string = string;
+    st->length = length;
+    st->pool.nodes = malloc(no_nodes * sizeof(struct suffix_tree_node));
+    st->pool.next_node = st->pool.nodes + no_nodes;
+    st->pool.chunks = 0;
+    st->children = 0;
+    st->root = st->pool.nodes;
+
+    struct suffix_tree_node *nodes = st->pool.nodes;
+#define NODE(i) ((i) == ST_FILE_NIL ? 0 : nodes + (i))
+    for (uint32_t i = 0; i < no_nodes; ++i) {
+        const struct st_file_node *u = &file_nodes[i];
+        struct suffix_tree_node *v = &nodes[i];
+        v->leaf_label = u->leaf_label;
+        v->range.from = (i == 0) ? 0 : string + u->from;
+        v->range.to = (i == 0) ? 0 : string + u->to;
+        v->parent = NODE(u->parent);
+        v->child = NODE(u->child);
+        v->sibling = NODE(u->sibling);
+        v->suffix_link = NODE(u->suffix_link);
+    }
+#undef NODE
+    free(file_nodes);
+    return st;
+}
+
+struct suffix_tree *
+read_suffix_tree_fname(
+    const char *fname,
+    bool verify,
+    enum error_codes *err
+) {
+    FILE *f = fopen(fname, "rb");
+    if (!f) {
+        if (err) *err = CANNOT_OPEN_FILE;
+        return 0;
+    }
+    struct suffix_tree *st = read_suffix_tree(f, verify, err);
+    fclose(f);
+    return st;
+}
+
+struct mapped_suffix_tree *
+map_suffix_tree_fname(
+    const char *fname,
+    bool verify,
+    enum error_codes *err
+) {
+    struct mapped_suffix_tree *mst = malloc(sizeof(struct mapped_suffix_tree));
+    if (!map_container_fname(&mst->map, fname, SUFFIX_TREE_KIND, verify, err)) {
+        free(mst);
+        return 0;
+    }
+
+    uint64_t header_size, string_size, nodes_size;
+    const struct st_file_header *header =
+        container_map_section(&mst->map, ST_HEADER_TAG, &header_size);
+    mst->string = container_map_section(&mst->map, ST_STRING_TAG, &string_size);
+    mst->nodes = container_map_section(&mst->map, ST_NODES_TAG, &nodes_size);
+    bool ok = header && mst->string && mst->nodes
+        && header_size == sizeof(*header)
+        && valid_st_file_header(header)
+        && string_size == header->length
+        && nodes_size == (uint64_t)header->no_nodes * sizeof(*mst->nodes);
+    if (ok) {
+        mst->length = header->length;
+        mst->no_nodes = header->no_nodes;
+        // The sentinel is what stops the searches, so we
+        // always check that it is there.
+        ok = mst->string[mst->length - 1] == '\0';
+    }
+    if (ok && verify) {
+        ok = valid_st_file_string(mst->string, mst->length)
+            && valid_st_file_nodes(mst->length, mst->no_nodes, mst->nodes);
+    }
+    if (!ok) {
+        if (err) *err = MALFORMED_FILE;
+        unmap_suffix_tree(mst);
+        return 0;
+    }
+    return mst;
+}
+
+void unmap_suffix_tree(
+    struct mapped_suffix_tree *mst
+) {
+    unmap_container(&mst->map);
+    free(mst);
+}
+
+uint32_t mapped_st_search(
+    const struct mapped_suffix_tree *mst,
+    const uint8_t *p
+) {
+    const struct st_file_node *nodes = mst->nodes;
+    const uint8_t *x = mst->string;
+    uint32_t v = 0;
+    while (*p) {
+        uint32_t w = nodes[v].child;
+        while (w != ST_FILE_NIL && x[nodes[w].from] != *p)
+            w = nodes[w].sibling;
+        if (w == ST_FILE_NIL) return ST_FILE_NIL;
+
+        for (uint32_t s = nodes[w].from; s < nodes[w].to; ++s, ++p) {
+            if (*p == '\0') return w;    // end of the pattern
+            if (x[s] != *p) return ST_FILE_NIL; // mismatch
+        }
+        v = w;
+    }
+    return v;
+}
+
+void init_mapped_st_search_iter(
+    struct mapped_st_search_iter *iter,
+    const struct mapped_suffix_tree *mst,
+    const uint8_t *pattern
+) {
+    iter->mst = mst;
+    init_index_vector(&iter->stack, 16);
+    reset_mapped_st_search_iter(iter, pattern);
+}
+
+void reset_mapped_st_search_iter(
+    struct mapped_st_search_iter *iter,
+    const uint8_t *pattern
+) {
+    iter->start = mapped_st_search(iter->mst, pattern);
+    iter->stack.used = 0;
+    if (iter->start != ST_FILE_NIL)
+        index_vector_append(&iter->stack, iter->start);
+}
+
+bool next_mapped_st_match(
+    struct mapped_st_search_iter *iter,
+    struct st_search_match *match
+) {
+    const struct st_file_node *nodes = iter->mst->nodes;
+    struct index_vector *stack = &iter->stack;
+    while (stack->used > 0) {
+        uint32_t v = stack->data[--stack->used];
+        // sibling before child, as for the other leaf iterators
+        if (v != iter->start && nodes[v].sibling != ST_FILE_NIL)
+            index_vector_append(stack, nodes[v].sibling);
+        if (nodes[v].child != ST_FILE_NIL) {
+            index_vector_append(stack, nodes[v].child);
+        } else {
+            match->pos = nodes[v].leaf_label;
+            return true;
+        }
+    }
+    return false;
+}
+
+void dealloc_mapped_st_search_iter(
+    struct mapped_st_search_iter *iter
+) {
+    dealloc_index_vector(&iter->stack);
+}
+
 
 #pragma mark API
 
@@ -525,65 +1745,46 @@ void get_path_string(
 
 /// Iteration
 
-struct st_leaf_iter_frame {
-    struct st_leaf_iter_frame *next;
-    struct suffix_tree_node *node;
-};
-static struct st_leaf_iter_frame *
-new_frame(struct suffix_tree_node *node)
-{
-    struct st_leaf_iter_frame *frame =
-        malloc(sizeof(struct st_leaf_iter_frame));
-    frame->node = node;
-    frame->next = 0;
-    return frame;
-}
-
 void init_st_leaf_iter(
     struct st_leaf_iter *iter,
     struct suffix_tree *st,
     struct suffix_tree_node *node
 ) {
-    if (node) iter->stack = new_frame(node);
-    else iter->stack = 0;
+    init_pointer_vector(&iter->stack, 16);
+    reset_st_leaf_iter(iter, node);
 }
 
-static void reverse_push(
+void reset_st_leaf_iter(
     struct st_leaf_iter *iter,
-    struct suffix_tree_node *child
+    struct suffix_tree_node *node
 ) {
-    if (child->sibling) reverse_push(iter, child->sibling);
-    struct st_leaf_iter_frame *child_frame = new_frame(child);
-    child_frame->next = iter->stack;
-    iter->stack = child_frame;
+    iter->start = node;
+    iter->stack.used = 0;
+    if (node) pointer_vector_append(&iter->stack, (void *)node);
 }
 
 bool next_st_leaf(
     struct st_leaf_iter *iter,
     struct st_leaf_iter_result *res
 ) {
-    struct st_leaf_iter_frame *frame = iter->stack;
-    while (frame) {
-        // pop the frame
-        iter->stack = frame->next;
-        struct suffix_tree_node *node = frame->node;
+    struct pointer_vector *stack = &iter->stack;
+    while (stack->used > 0) {
+        struct suffix_tree_node *node = stack->data[--stack->used];
+        
+        // We push the sibling before the child, so we see
+        // the child's subtree first. That gives us an in-order
+        // depth-first traversal without reversing the
+        // sibling lists. The start node's siblings are
+        // not part of its subtree.
+        if (node != iter->start && node->sibling)
+            pointer_vector_append(stack, (void *)node->sibling);
         
         if (node->child) {
-            // we have to push in reverse order to get
-            // an in-order depth-first traversal
-            reverse_push(iter, node->child);
-            
+            pointer_vector_append(stack, (void *)node->child);
         } else {
-            // leaf
-            // clean up and return result
-            free(frame);
             res->leaf = node;
             return true;
         }
-        
-        // get rid of the frame and pop the next
-        free(frame);
-        frame = iter->stack;
     }
     return false;
 }
@@ -591,12 +1792,7 @@ bool next_st_leaf(
 void dealloc_st_leaf_iter(
     struct st_leaf_iter *iter
 ) {
-    struct st_leaf_iter_frame *frame = iter->stack;
-    while (frame) {
-        struct st_leaf_iter_frame *next = frame->next;
-        free(frame);
-        frame = next;
-    }
+    dealloc_pointer_vector(&iter->stack);
 }
 
 // Searching
@@ -610,16 +1806,9 @@ st_search_internal(
         // we are searching from an empty string, so we must
         // already be at the right node.
         return v;
-    
-    // find child that matches *x
-    struct suffix_tree_node *w = v->child;
-    while (w) {
-        // We might be able to exploit that the lists are sorted
-        // but it requires lookups in the string, so it might not be
-        // worthwhile.
-        if (*(w->range.from) == *p) break;
-        w = w->sibling;
-    }
+    
+    // find child that matches *x
+    struct suffix_tree_node *w = st_find_child(st, v, *p);
     if (!w) return 0; // the pattern is not here.
 
     // we have an edge to follow!
@@ -651,6 +1840,14 @@ void init_st_search_iter(
     init_st_leaf_iter(&iter->leaf_iter, st, match);
 }
 
+void reset_st_search_iter(
+    struct st_search_iter *iter,
+    struct suffix_tree *st,
+    const uint8_t *p
+) {
+    reset_st_leaf_iter(&iter->leaf_iter, st_search(st, p));
+}
+
 bool next_st_match(
     struct st_search_iter *iter,
     struct st_search_match *match
@@ -670,6 +1867,214 @@ void dealloc_st_search_iter(
 
 
 
+#pragma mark Matching statistics
+
+void init_st_ms_iter(
+    struct st_ms_iter *iter,
+    const struct suffix_tree *st,
+    const uint8_t *query
+) {
+    iter->st = st;
+    iter->query = query;
+    iter->i = 0;
+    iter->v = st->root;
+    iter->v_depth = 0;
+    iter->w = 0;
+    iter->k = 0;
+}
+
+bool next_st_ms(
+    struct st_ms_iter *iter,
+    struct st_matching_statistic *ms
+) {
+    const struct suffix_tree *st = iter->st;
+    const uint8_t *x = iter->query + iter->i;
+    if (*x == '\0') return false;
+
+    struct suffix_tree_node *v = iter->v;
+    uint32_t d = iter->v_depth;
+    struct suffix_tree_node *w = iter->w;
+    uint32_t k = iter->k;
+
+    if (iter->i > 0) {
+        // We know that x[0, d + k - 1) is in the tree, and we
+        // get to it through the suffix link of v. From there we
+        // only need to count the letters we pass, as in
+        // McCreight's fast scan.
+        uint32_t r;
+        if (d + k == 0) {
+            r = 0;
+        } else if (v == st->root) {
+            r = k - 1;
+        } else {
+            v = v->suffix_link;
+            d--;
+            r = k;
+        }
+        w = 0; k = 0;
+        while (r > 0) {
+            w = st_find_child(st, v, x[d]);
+            uint32_t n = edge_length(w);
+            if (n > r) {
+                k = r;
+                break;
+            }
+            v = w; w = 0;
+            d += n;
+            r -= n;
+        }
+    }
+
+    // Now extend the match one letter at a time. We never get
+    // through a leaf edge, since the query doesn't have the
+    // sentinel, so v is always an inner node.
+    for (;;) {
+        if (!w) {
+            if (x[d] == '\0') break;
+            w = st_find_child(st, v, x[d]);
+            if (!w) break;
+            k = 0;
+        }
+        uint32_t n = edge_length(w);
+        const uint8_t *s = w->range.from;
+        const uint8_t *y = x + d;
+        while (k < n && y[k] && s[k] == y[k])
+            k++;
+        if (k < n) break;
+        v = w; w = 0;
+        d += k; k = 0;
+    }
+    if (w && k == 0) w = 0;
+
+    ms->pos = iter->i;
+    ms->length = d + k;
+    ms->node = w ? w : v;
+    ms->depth = w ? d + edge_length(w) : d;
+
+    iter->v = v;
+    iter->v_depth = d;
+    iter->w = w;
+    iter->k = k;
+    iter->i++;
+    return true;
+}
+
+void dealloc_st_ms_iter(
+    struct st_ms_iter *iter
+) {
+    // nothing to be done here
+}
+
+void init_st_smem_iter(
+    struct st_smem_iter *iter,
+    const struct suffix_tree *st,
+    const uint8_t *query,
+    uint32_t min_length
+) {
+    init_st_ms_iter(&iter->ms_iter, st, query);
+    iter->min_length = min_length ? min_length : 1;
+    iter->prev_length = 0;
+}
+
+bool next_st_smem(
+    struct st_smem_iter *iter,
+    struct st_matching_statistic *smem
+) {
+    while (next_st_ms(&iter->ms_iter, smem)) {
+        // The match at i - 1 contains the match at i exactly
+        // when it is one longer.
+        bool contained = smem->pos > 0 && iter->prev_length == smem->length + 1;
+        iter->prev_length = smem->length;
+        if (!contained && smem->length >= iter->min_length)
+            return true;
+    }
+    return false;
+}
+
+void dealloc_st_smem_iter(
+    struct st_smem_iter *iter
+) {
+    dealloc_st_ms_iter(&iter->ms_iter);
+}
+
+void init_st_mem_iter(
+    struct st_mem_iter *iter,
+    const struct suffix_tree *st,
+    const uint8_t *query,
+    uint32_t min_length
+) {
+    init_st_ms_iter(&iter->ms_iter, st, query);
+    iter->min_length = min_length ? min_length : 1;
+    iter->node = 0;
+    iter->node_depth = 0;
+    iter->length = 0;
+    init_pointer_vector(&iter->stack, 16);
+}
+
+bool next_st_mem(
+    struct st_mem_iter *iter,
+    struct st_mem *mem
+) {
+    const struct suffix_tree *st = iter->ms_iter.st;
+    const uint8_t *query = iter->ms_iter.query;
+    struct pointer_vector *stack = &iter->stack;
+
+    for (;;) {
+        while (stack->used > 0) {
+            struct suffix_tree_node *v = stack->data[--stack->used];
+            if (v->child) {
+                for (struct suffix_tree_node *w = v->child; w; w = w->sibling)
+                    pointer_vector_append(stack, (void *)w);
+                continue;
+            }
+            // Only report the occurrences we cannot extend
+            // to the left.
+            uint32_t i = iter->ms.pos, j = v->leaf_label;
+            if (i == 0 || j == 0 || st->string[j - 1] != query[i - 1]) {
+                mem->query_pos = i;
+                mem->string_pos = j;
+                mem->length = iter->length;
+                return true;
+            }
+        }
+
+        // The leaves that branch off above the current node
+        // match exactly as deep as the parent.
+        struct suffix_tree_node *v = iter->node;
+        if (v && v != st->root) {
+            uint32_t depth = iter->node_depth - edge_length(v);
+            if (depth >= iter->min_length) {
+                struct suffix_tree_node *parent = v->parent;
+                for (struct suffix_tree_node *w = parent->child; w; w = w->sibling)
+                    if (w != v) pointer_vector_append(stack, (void *)w);
+                iter->node = parent;
+                iter->node_depth = depth;
+                iter->length = depth;
+                continue;
+            }
+        }
+
+        // On to the next query position
+        do {
+            if (!next_st_ms(&iter->ms_iter, &iter->ms))
+                return false;
+        } while (iter->ms.length < iter->min_length);
+        iter->node = iter->ms.node;
+        iter->node_depth = iter->ms.depth;
+        iter->length = iter->ms.length;
+        pointer_vector_append(stack, (void *)iter->node);
+    }
+}
+
+void dealloc_st_mem_iter(
+    struct st_mem_iter *iter
+) {
+    dealloc_st_ms_iter(&iter->ms_iter);
+    dealloc_pointer_vector(&iter->stack);
+}
+
+
+
 #pragma mark Approximative
 
 struct collect_nodes_data {
@@ -797,10 +2202,12 @@ void init_st_approx_iter(
 ) {
     iter->st = st;
     
-    uint32_t n = (uint32_t)strlen((char *)pattern);
+    // A script has at most m + edits operations, and the CIGAR
+    // at most two characters per operation.
+    uint32_t n = (uint32_t)strlen((char *)pattern) + (edits > 0 ? edits : 0);
     struct collect_nodes_data data;
     data.iter = iter;
-    data.edits_start = data.edits = malloc(2*n + 1);
+    data.edits_start = data.edits = malloc(n + 1);
     data.cigar_buffer = malloc(2*n + 1);
 
     init_pointer_vector(&iter->nodes, 10);
@@ -810,11 +2217,9 @@ void init_st_approx_iter(
                         st->root->range.from, st->root->range.to,
                         pattern, data.edits, edits, 0);
     
-    // We only initialise this to make resource management
-    // easier. We keep this iterator initialised at all
-    // time except when we dealloc it and immidately initialise
-    // it again.
-    init_st_leaf_iter(&iter->leaf_iter, st, st->root);
+    // We reuse this iterator for all the hits, so we
+    // initialise it here and reset it for each tree.
+    init_st_leaf_iter(&iter->leaf_iter, st, 0);
     
     free(data.edits_start);
     free(data.cigar_buffer);
@@ -830,10 +2235,9 @@ bool next_st_approx_match(struct st_approx_match_iter *iter,
         if (iter->current_tree_index == iter->nodes.used) {
             return false;
         }
-        dealloc_st_leaf_iter(&iter->leaf_iter);
-        init_st_leaf_iter(&iter->leaf_iter, iter->st,
-                          pointer_vector_get(&iter->nodes,
-                                             iter->current_tree_index));
+        reset_st_leaf_iter(&iter->leaf_iter,
+                           pointer_vector_get(&iter->nodes,
+                                              iter->current_tree_index));
         iter->processing_tree = true;
         return next_st_approx_match(iter, match);
     } else {
@@ -868,83 +2272,324 @@ void dealloc_st_approx_iter(
 }
 
 
+// Banded approximate search
+
+static inline uint32_t *
+banded_column(
+    struct st_banded_approx_iter *iter,
+    uint32_t d
+) {
+    return iter->columns + (size_t)d * (iter->m + 1);
+}
+
+// Cells we haven't computed are more than edits away.
+static inline uint32_t banded_cell(
+    struct st_banded_approx_iter *iter,
+    uint32_t d,
+    uint32_t r
+) {
+    return (iter->first[d] <= r && r < iter->rows[d])
+        ? banded_column(iter, d)[r] : iter->edits + 1;
+}
 
+// Computes column d from column d - 1 and the letter a.
+// Returns false if no row is within the edit bound.
+static bool compute_banded_column(
+    struct st_banded_approx_iter *iter,
+    uint32_t d,
+    uint8_t a
+) {
+    const uint8_t *p = iter->pattern;
+    uint32_t m = iter->m;
+    uint32_t inf = iter->edits + 1;
+    const uint32_t *prev = banded_column(iter, d - 1);
+    uint32_t prev_first = iter->first[d - 1];
+    uint32_t prev_rows = iter->rows[d - 1];
+    uint32_t *col = banded_column(iter, d);
+
+    // Above row prev_first, and below row prev_rows, the
+    // diagonal and the deletion come from cells that are out
+    // of the band. We never delete the first letters in the
+    // string, so row zero is always out.
+    uint32_t r = prev_first > 0 ? prev_first : 1;
+    uint32_t limit = prev_rows < m ? prev_rows : m;
+    uint32_t above = inf;
+    for (; r <= limit; ++r) {
+        uint32_t best = (r - 1 >= prev_first ? prev[r - 1] : inf) + (p[r - 1] != a);
+        uint32_t del = (r < prev_rows ? prev[r] : inf) + 1;
+        uint32_t ins = above + 1;
+        if (del < best) best = del;
+        if (ins < best) best = ins;
+        col[r] = above = best < inf ? best : inf;
+    }
+    // but insertions can still take us further down.
+    for (; r <= m && above < iter->edits; ++r)
+        col[r] = above = above + 1;
+
+    uint32_t lo = prev_first > 0 ? prev_first : 1;
+    while (lo < r && col[lo] > iter->edits) lo++;
+    while (r > lo && col[r - 1] > iter->edits) r--;
+    iter->first[d] = lo;
+    iter->rows[d] = r;
+    return r > lo;
+}
 
+// The cost of aligning the whole pattern to the d letters
+// without ending in a deletion.
+static uint32_t banded_end_cost(
+    struct st_banded_approx_iter *iter,
+    uint32_t d,
+    uint8_t a
+) {
+    uint32_t m = iter->m;
+    uint32_t ins = banded_cell(iter, d, m - 1) + 1;
+    if (d == 0) return ins;
+    uint32_t diag = banded_cell(iter, d - 1, m - 1) + (iter->pattern[m - 1] != a);
+    return diag < ins ? diag : ins;
+}
 
-/// Build suffix array and LCP
-struct sa_lcp_frame {
-    struct suffix_tree_node *v;
-    uint32_t left_depth;
-    uint32_t node_depth;
-    struct sa_lcp_frame *next;
-};
-static struct sa_lcp_frame *new_lcp_frame(
+static void push_banded_frame(
+    struct st_banded_approx_iter *iter,
     struct suffix_tree_node *v,
-    uint32_t left_depth,
-    uint32_t node_depth,
-    struct sa_lcp_frame *next
+    uint32_t depth
 ) {
-    struct sa_lcp_frame *new = malloc(sizeof(struct sa_lcp_frame));
-    new->v = v;
-    new->left_depth = left_depth;
-    new->node_depth = node_depth;
-    new->next = next;
-    return new;
+    if (iter->no_frames == iter->frames_size) {
+        iter->frames_size *= 2;
+        iter->frames = realloc(iter->frames,
+                               iter->frames_size * sizeof(*iter->frames));
+    }
+    iter->frames[iter->no_frames++] = (struct st_banded_approx_frame){ v, depth };
 }
 
-static struct sa_lcp_frame *
-lcp_stack_push_reverse(
+static void set_banded_hit(
+    struct st_banded_approx_iter *iter,
     struct suffix_tree_node *v,
-    uint32_t left_depth,
-    uint32_t node_depth,
-    struct sa_lcp_frame *stack
+    const uint8_t *end,
+    uint32_t depth,
+    uint32_t edits
+) {
+    iter->in_leaves = true;
+    iter->hit_node = v;
+    iter->hit_text = end - depth;
+    iter->hit_depth = depth;
+    iter->hit_edits = edits;
+    reset_st_leaf_iter(&iter->leaf_iter, v);
+}
+
+void init_st_banded_approx_iter(
+    struct st_banded_approx_iter *iter,
+    struct suffix_tree *st,
+    const uint8_t *pattern,
+    uint32_t edits
+) {
+    iter->st = st;
+    iter->edits = edits;
+    iter->columns = 0;
+    iter->first = 0;
+    iter->rows = 0;
+    iter->columns_size = 0;
+    iter->edit_ops = 0;
+    iter->frames_size = 16;
+    iter->frames = malloc(iter->frames_size * sizeof(*iter->frames));
+    init_st_leaf_iter(&iter->leaf_iter, st, 0);
+    reset_st_banded_approx_iter(iter, pattern);
+}
+
+void reset_st_banded_approx_iter(
+    struct st_banded_approx_iter *iter,
+    const uint8_t *pattern
+) {
+    uint32_t m = (uint32_t)strlen((char *)pattern);
+    iter->pattern = pattern;
+    iter->m = m;
+    // No match is longer than m + edits, so neither is a path
+    // where a column still has a row within the band.
+    iter->max_depth = m + iter->edits;
+    size_t needed = (size_t)(iter->max_depth + 1) * (m + 1);
+    if (needed > iter->columns_size) {
+        iter->columns_size = (uint32_t)needed;
+        iter->columns = realloc(iter->columns, needed * sizeof(*iter->columns));
+        iter->first = realloc(iter->first, (iter->max_depth + 1) * sizeof(*iter->first));
+        iter->rows = realloc(iter->rows, (iter->max_depth + 1) * sizeof(*iter->rows));
+        iter->edit_ops = realloc(iter->edit_ops, 2 * iter->max_depth + 1);
+    }
+
+    uint32_t *col = banded_column(iter, 0);
+    uint32_t r = 0;
+    for (; r <= m && r <= iter->edits; ++r)
+        col[r] = r;
+    iter->first[0] = 0;
+    iter->rows[0] = r;
+
+    iter->no_frames = 0;
+    iter->in_edge = false;
+    iter->in_leaves = false;
+    for (struct suffix_tree_node *w = iter->st->root->child; w; w = w->sibling)
+        push_banded_frame(iter, w, 0);
+    // If we can delete the whole pattern, it matches the empty
+    // string everywhere.
+    if (m <= iter->edits)
+        set_banded_hit(iter, iter->st->root, iter->st->string, 0, m);
+}
+
+bool next_st_banded_approx_match(
+    struct st_banded_approx_iter *iter,
+    struct st_banded_approx_match *match
+) {
+    for (;;) {
+        if (iter->in_leaves) {
+            struct st_leaf_iter_result res;
+            if (next_st_leaf(&iter->leaf_iter, &res)) {
+                match->root = iter->hit_node;
+                match->match_depth = iter->hit_depth;
+                match->match_label = res.leaf->leaf_label;
+                match->edits = iter->hit_edits;
+                return true;
+            }
+            iter->in_leaves = false;
+        }
+
+        if (iter->in_edge) {
+            struct suffix_tree_node *v = iter->v;
+            const uint8_t *end = v->range.to;
+            // We stop at the sentinel; it doesn't match anything.
+            while (iter->x != end && *iter->x) {
+                uint32_t d = iter->depth + 1;
+                uint8_t a = *iter->x;
+                if (d > iter->max_depth || !compute_banded_column(iter, d, a)) {
+                    // Out of the band, so we skip the rest of
+                    // the edge and everything below it.
+                    iter->in_edge = false;
+                    break;
+                }
+                iter->x++;
+                iter->depth = d;
+                if (iter->rows[d] == iter->m + 1) {
+                    uint32_t cost = banded_end_cost(iter, d, a);
+                    if (cost <= iter->edits) {
+                        set_banded_hit(iter, v, iter->x, d, cost);
+                        break;
+                    }
+                }
+            }
+            if (iter->in_leaves) continue;
+            if (iter->in_edge) {
+                iter->in_edge = false;
+                if (iter->x == end) {
+                    for (struct suffix_tree_node *w = v->child; w; w = w->sibling)
+                        push_banded_frame(iter, w, iter->depth);
+                }
+            }
+            continue;
+        }
+
+        if (iter->no_frames == 0)
+            return false;
+        struct st_banded_approx_frame frame = iter->frames[--iter->no_frames];
+        iter->in_edge = true;
+        iter->v = frame.v;
+        iter->x = frame.v->range.from;
+        iter->depth = frame.depth;
+    }
+}
+
+const char *st_banded_approx_cigar(
+    struct st_banded_approx_iter *iter,
+    char *buffer
 ) {
-    if (v->sibling) {
-        stack = lcp_stack_push_reverse(v->sibling, left_depth, node_depth, stack);
+    const uint8_t *p = iter->pattern;
+    const uint8_t *x = iter->hit_text;
+    uint32_t r = iter->m, d = iter->hit_depth;
+    uint32_t target = iter->hit_edits;
+    char *ops = iter->edit_ops + 2 * iter->max_depth;
+    *ops = '\0';
+
+    // The last operation isn't a deletion, so we pick it the
+    // same way as banded_end_cost did.
+    bool first = true;
+    while (r > 0 || d > 0) {
+        uint32_t cell = first ? target : banded_cell(iter, d, r);
+        if (r > 0 && d > 0 &&
+            banded_cell(iter, d - 1, r - 1) + (p[r - 1] != x[d - 1]) == cell) {
+            *--ops = 'M'; r--; d--;
+        } else if (r > 0 && banded_cell(iter, d, r - 1) + 1 == cell) {
+            *--ops = 'I'; r--;
+        } else {
+            assert(!first && d > 0);
+            *--ops = 'D'; d--;
+        }
+        first = false;
     }
-    return new_lcp_frame(v, left_depth, node_depth, stack);
+    edits_to_cigar(buffer, ops);
+    return buffer;
+}
+
+void dealloc_st_banded_approx_iter(
+    struct st_banded_approx_iter *iter
+) {
+    free(iter->columns);
+    free(iter->first);
+    free(iter->rows);
+    free(iter->frames);
+    free(iter->edit_ops);
+    dealloc_st_leaf_iter(&iter->leaf_iter);
 }
 
+
+
+
+
+/// Build suffix array and LCP
+struct sa_lcp_frame {
+    struct suffix_tree_node *v;
+    uint32_t left_depth;
+    uint32_t node_depth; // the depth of v's parent
+};
+
 static void lcp_traverse(
     struct suffix_tree *st,
     uint32_t *sa,
     uint32_t *lcp
 ) {
-    struct sa_lcp_frame *stack = new_lcp_frame(st->root, 0, 0, 0);
+    // Every node is pushed exactly once, so the stack
+    // can never be larger than the number of nodes, and
+    // there are fewer than 2n of those.
+    uint32_t no_nodes = 2 * st->length;
+    struct sa_lcp_frame *stack = malloc(no_nodes * sizeof(*stack));
+    uint32_t used = 0;
     uint32_t idx = 0;
 
-    while (stack) {
-
-        struct sa_lcp_frame *frame = stack;
-        stack = stack->next;
+    stack[used++] = (struct sa_lcp_frame){ st->root, 0, 0 };
+    while (used > 0) {
+        struct sa_lcp_frame frame = stack[--used];
+        struct suffix_tree_node *v = frame.v;
         
-        if (is_leaf(frame->v)) {
-            // Leaf
-            sa[idx] = frame->v->leaf_label;
-            lcp[idx] = frame->left_depth;
+        // The siblings go on the stack before the children so
+        // we handle the children first. The first child should
+        // be treated differently than the rest; it has a
+        // different branch depth because the LCP is relative to
+        // the last node in the previous leaf in v's previous
+        // sibling. The siblings, however, have the parent as
+        // their branch point.
+        if (v != st->root && v->sibling) {
+            stack[used++] = (struct sa_lcp_frame){
+                v->sibling, frame.node_depth, frame.node_depth
+            };
+        }
+        
+        if (is_leaf(v)) {
+            sa[idx] = v->leaf_label;
+            lcp[idx] = frame.left_depth;
             idx++;
-            
         } else {
-            // Inner node
-            // The first child should be treated differently than
-            // the rest; it has a different branch depth because
-            // the LCP is relative to the last node in the previous
-            // leaf in v's previous sibling.
-            
-            uint32_t this_depth = frame->node_depth + edge_length(frame->v);
-            
-            assert(frame->v->child); // it must be an inner node
-            if (frame->v->child->sibling) {
-                stack = lcp_stack_push_reverse(frame->v->child->sibling,
-                                               this_depth, this_depth, stack);
-            }
-            // first child
-            struct suffix_tree_node *first_child = frame->v->child;
-            stack = new_lcp_frame(first_child, frame->left_depth, this_depth, stack);
+            uint32_t this_depth = frame.node_depth + edge_length(v);
+            stack[used++] = (struct sa_lcp_frame){
+                v->child, frame.left_depth, this_depth
+            };
         }
-        
-        free(frame);
     }
+    
+    free(stack);
 }
 
 void st_compute_sa_and_lcp(
@@ -960,6 +2605,478 @@ void st_compute_sa_and_lcp(
 
 
 
+#pragma mark Compact suffix trees
+
+// Construction needs parent pointers and suffix links, but we
+// don't keep them in the tree, so they live here.
+struct cst_construction {
+    struct compact_suffix_tree *st;
+    uint32_t *parent;
+    uint32_t *suffix_link;
+};
+
+static void
+init_cst_construction(
+    struct cst_construction *b,
+    const uint8_t *string,
+    bool with_links
+) {
+    struct compact_suffix_tree *st = malloc(sizeof(struct compact_suffix_tree));
+    st->string = string;
+    st->length = (uint32_t)strlen((char *)string) + 1;
+    assert(st->length < CST_LEAF_BIT);
+
+    // There are at most n - 1 inner nodes (but we need one
+    // for the root if the string is empty).
+    uint32_t capacity = st->length;
+    st->depth = malloc(capacity * sizeof(*st->depth));
+    st->pos = malloc(capacity * sizeof(*st->pos));
+    st->child = malloc(capacity * sizeof(*st->child));
+    st->sibling = malloc(capacity * sizeof(*st->sibling));
+    st->leaf_sibling = malloc(st->length * sizeof(*st->leaf_sibling));
+
+    // The root
+    st->no_inner_nodes = 1;
+    st->depth[0] = 0;
+    st->pos[0] = 0;
+    st->child[0] = CST_NIL;
+    st->sibling[0] = CST_NIL;
+
+    b->st = st;
+    if (with_links) {
+        b->parent = malloc(capacity * sizeof(*b->parent));
+        b->suffix_link = malloc(capacity * sizeof(*b->suffix_link));
+        b->parent[0] = 0;
+        b->suffix_link[0] = 0;
+    } else {
+        b->parent = b->suffix_link = 0;
+    }
+}
+
+static struct compact_suffix_tree *
+finish_cst_construction(
+    struct cst_construction *b
+) {
+    free(b->parent);
+    free(b->suffix_link);
+
+    // Give back the inner nodes we didn't use
+    struct compact_suffix_tree *st = b->st;
+    size_t size = st->no_inner_nodes * sizeof(uint32_t);
+    st->depth = realloc(st->depth, size);
+    st->pos = realloc(st->pos, size);
+    st->child = realloc(st->child, size);
+    st->sibling = realloc(st->sibling, size);
+    return st;
+}
+
+static uint32_t
+new_cst_inner_node(
+    struct cst_construction *b,
+    uint32_t depth,
+    uint32_t pos
+) {
+    struct compact_suffix_tree *st = b->st;
+    uint32_t v = st->no_inner_nodes++;
+    st->depth[v] = depth;
+    st->pos[v] = pos;
+    st->child[v] = CST_NIL;
+    st->sibling[v] = CST_NIL;
+    if (b->parent) {
+        b->parent[v] = CST_NIL;
+        b->suffix_link[v] = CST_NIL;
+    }
+    return v;
+}
+
+static inline void set_cst_sibling(
+    struct compact_suffix_tree *st,
+    uint32_t v,
+    uint32_t sibling
+) {
+    if (cst_is_leaf(v)) st->leaf_sibling[cst_leaf_label(v)] = sibling;
+    else st->sibling[v] = sibling;
+}
+
+// The first letter on the edge into v, when v's parent
+// has depth d.
+static inline uint8_t cst_out_letter(
+    const struct compact_suffix_tree *st,
+    uint32_t v,
+    uint32_t d
+) {
+    return st->string[cst_pos(st, v) + d];
+}
+
+// Children are sorted, so we can stop when we have
+// passed the letter.
+static uint32_t
+find_cst_child(
+    const struct compact_suffix_tree *st,
+    uint32_t v,
+    uint32_t d,
+    uint8_t a
+) {
+    uint32_t w = st->child[v];
+    while (w != CST_NIL) {
+        uint8_t b = cst_out_letter(st, w, d);
+        if (b == a) return w;
+        if (b > a) return CST_NIL;
+        w = cst_sibling(st, w);
+    }
+    return CST_NIL;
+}
+
+static void
+insert_cst_child(
+    struct compact_suffix_tree *st,
+    uint32_t v,
+    uint32_t child
+) {
+    uint32_t d = st->depth[v];
+    uint8_t a = cst_out_letter(st, child, d);
+    uint32_t prev = CST_NIL, w = st->child[v];
+    while (w != CST_NIL && cst_out_letter(st, w, d) < a) {
+        prev = w;
+        w = cst_sibling(st, w);
+    }
+    set_cst_sibling(st, child, w);
+    if (prev == CST_NIL) st->child[v] = child;
+    else set_cst_sibling(st, prev, child);
+}
+
+// Splits the edge from v to its child w at depth d and
+// returns the new node.
+static uint32_t
+split_cst_edge(
+    struct cst_construction *b,
+    uint32_t v,
+    uint32_t w,
+    uint32_t d
+) {
+    struct compact_suffix_tree *st = b->st;
+    assert(st->depth[v] < d && d < cst_depth(st, w));
+
+    uint32_t u = new_cst_inner_node(b, d, cst_pos(st, w));
+    // u takes w's place in v's list of children; they have
+    // the same first letter so the list stays sorted.
+    uint32_t prev = CST_NIL, x = st->child[v];
+    while (x != w) {
+        prev = x;
+        x = cst_sibling(st, x);
+    }
+    if (prev == CST_NIL) st->child[v] = u;
+    else set_cst_sibling(st, prev, u);
+    st->sibling[u] = cst_sibling(st, w);
+    set_cst_sibling(st, w, CST_NIL);
+    st->child[u] = w;
+
+    b->parent[u] = v;
+    if (!cst_is_leaf(w)) b->parent[w] = u;
+    return u;
+}
+
+// Inserts suffix i below v, whose path is a prefix of the
+// suffix. Returns the node the new leaf hangs from.
+static uint32_t
+cst_naive_insert(
+    struct cst_construction *b,
+    uint32_t v,
+    uint32_t i
+) {
+    struct compact_suffix_tree *st = b->st;
+    const uint8_t *x = st->string;
+    uint32_t d = st->depth[v];
+    for (;;) {
+        uint32_t w = find_cst_child(st, v, d, x[i + d]);
+        if (w == CST_NIL) {
+            insert_cst_child(st, v, cst_leaf(i));
+            return v;
+        }
+        // The sentinel is unique, so we always find a
+        // mismatch before we get to the end of a leaf.
+        uint32_t p = cst_pos(st, w);
+        uint32_t dw = cst_depth(st, w);
+        uint32_t k = d + 1;
+        while (k < dw && x[p + k] == x[i + k])
+            ++k;
+        if (k < dw) {
+            uint32_t u = split_cst_edge(b, v, w, k);
+            insert_cst_child(st, u, cst_leaf(i));
+            return u;
+        }
+        v = w;
+        d = dw;
+    }
+}
+
+// Finds (or creates) the node at depth target on the path
+// of the suffix at i, starting from v. We know that the path
+// is in the tree, so we only look at the first letter on
+// each edge.
+static uint32_t
+cst_fast_scan(
+    struct cst_construction *b,
+    uint32_t v,
+    uint32_t i,
+    uint32_t target
+) {
+    struct compact_suffix_tree *st = b->st;
+    uint32_t d = st->depth[v];
+    while (d < target) {
+        uint32_t w = find_cst_child(st, v, d, st->string[i + d]);
+        assert(w != CST_NIL);
+        uint32_t dw = cst_depth(st, w);
+        if (dw == target) return w;
+        if (dw > target) return split_cst_edge(b, v, w, target);
+        v = w;
+        d = dw;
+    }
+    return v;
+}
+
+static uint32_t
+cst_suffix_search(
+    struct cst_construction *b,
+    uint32_t v
+) {
+    if (b->suffix_link[v] != CST_NIL)
+        return b->suffix_link[v];
+    uint32_t p = b->parent[v];
+    uint32_t from = (p == 0) ? 0 : b->suffix_link[p];
+    return cst_fast_scan(b, from, b->st->pos[v] + 1, b->st->depth[v] - 1);
+}
+
+struct compact_suffix_tree *
+mccreight_compact_suffix_tree(
+    const uint8_t *string
+) {
+    struct cst_construction b;
+    init_cst_construction(&b, string, true);
+    struct compact_suffix_tree *st = b.st;
+
+    st->child[0] = cst_leaf(0);
+    st->leaf_sibling[0] = CST_NIL;
+
+    uint32_t head = 0;
+    for (uint32_t i = 1; i < st->length; ++i) {
+        uint32_t w = cst_suffix_search(&b, head);
+        b.suffix_link[head] = w;
+        head = cst_naive_insert(&b, w, i);
+    }
+
+    return finish_cst_construction(&b);
+}
+
+struct compact_suffix_tree *
+lcp_compact_suffix_tree(
+    const uint8_t *string,
+    uint32_t *sa,
+    uint32_t *lcp
+) {
+    struct cst_construction b;
+    init_cst_construction(&b, string, false);
+    struct compact_suffix_tree *st = b.st;
+
+    // The right-most path in the tree, with the last two
+    // children of each node so we can append new children
+    // and replace the last one when we split its edge.
+    struct cst_frame {
+        uint32_t node;
+        uint32_t last;
+        uint32_t prev_last;
+    };
+    struct cst_frame *stack = malloc((st->length + 1) * sizeof(*stack));
+    uint32_t top = 0;
+
+    uint32_t leaf = cst_leaf(sa[0]);
+    st->child[0] = leaf;
+    st->leaf_sibling[sa[0]] = CST_NIL;
+    stack[0] = (struct cst_frame){ 0, leaf, CST_NIL };
+
+    for (uint32_t i = 1; i < st->length; ++i) {
+        uint32_t l = lcp[i];
+        leaf = cst_leaf(sa[i]);
+        st->leaf_sibling[sa[i]] = CST_NIL;
+
+        while (st->depth[stack[top].node] > l)
+            top--;
+        struct cst_frame *frame = &stack[top];
+
+        if (st->depth[frame->node] == l) {
+            set_cst_sibling(st, frame->last, leaf);
+            frame->prev_last = frame->last;
+            frame->last = leaf;
+        } else {
+            // We need a new node between the top and its last child
+            uint32_t w = frame->last;
+            uint32_t u = new_cst_inner_node(&b, l, cst_pos(st, w));
+            if (frame->prev_last == CST_NIL) st->child[frame->node] = u;
+            else set_cst_sibling(st, frame->prev_last, u);
+            frame->last = u;
+            st->child[u] = w;
+            set_cst_sibling(st, w, leaf);
+            stack[++top] = (struct cst_frame){ u, leaf, w };
+        }
+    }
+    free(stack);
+
+    return finish_cst_construction(&b);
+}
+
+void free_compact_suffix_tree(
+    struct compact_suffix_tree *st
+) {
+    // Do not free string; we are not managing it
+    free(st->depth);
+    free(st->pos);
+    free(st->child);
+    free(st->sibling);
+    free(st->leaf_sibling);
+    free(st);
+}
+
+size_t cst_bytes(
+    const struct compact_suffix_tree *st
+) {
+    return sizeof(*st)
+        + 4 * st->no_inner_nodes * sizeof(uint32_t)
+        + st->length * sizeof(uint32_t);
+}
+
+void cst_compute_sa_and_lcp(
+    const struct compact_suffix_tree *st,
+    uint32_t *sa,
+    uint32_t *lcp
+) {
+    // An explicit stack. We push a node's next sibling before
+    // its first child, so the stack never holds more than one
+    // node per level plus the one we are looking at.
+    struct cst_lcp_frame {
+        uint32_t node;
+        uint32_t left_depth;
+        uint32_t parent_depth;
+    };
+    struct cst_lcp_frame *stack =
+        malloc((st->no_inner_nodes + 2) * sizeof(*stack));
+    uint32_t used = 0;
+    uint32_t idx = 0;
+
+    stack[used++] = (struct cst_lcp_frame){ 0, 0, 0 };
+    while (used > 0) {
+        struct cst_lcp_frame frame = stack[--used];
+        uint32_t v = frame.node;
+        if (v != 0) {
+            uint32_t sibling = cst_sibling(st, v);
+            if (sibling != CST_NIL)
+                stack[used++] = (struct cst_lcp_frame){
+                    sibling, frame.parent_depth, frame.parent_depth
+                };
+        }
+        if (cst_is_leaf(v)) {
+            sa[idx] = cst_leaf_label(v);
+            lcp[idx] = frame.left_depth;
+            idx++;
+        } else {
+            stack[used++] = (struct cst_lcp_frame){
+                st->child[v], frame.left_depth, st->depth[v]
+            };
+        }
+    }
+    assert(idx == st->length);
+    free(stack);
+}
+
+uint32_t cst_search(
+    const struct compact_suffix_tree *st,
+    const uint8_t *p
+) {
+    const uint8_t *x = st->string;
+    uint32_t v = 0, d = 0;
+    while (p[d]) {
+        uint32_t w = find_cst_child(st, v, d, p[d]);
+        if (w == CST_NIL) return CST_NIL;
+        uint32_t pos = cst_pos(st, w);
+        uint32_t dw = cst_depth(st, w);
+        for (uint32_t k = d + 1; k < dw; ++k) {
+            if (p[k] == '\0') return w; // end of the pattern
+            if (x[pos + k] != p[k]) return CST_NIL; // mismatch
+        }
+        v = w;
+        d = dw;
+    }
+    return v;
+}
+
+void init_cst_leaf_iter(
+    struct cst_leaf_iter *iter,
+    const struct compact_suffix_tree *st,
+    uint32_t node
+) {
+    iter->st = st;
+    iter->start = node;
+    init_index_vector(&iter->stack, 16);
+    if (node != CST_NIL)
+        index_vector_append(&iter->stack, node);
+}
+
+bool next_cst_leaf(
+    struct cst_leaf_iter *iter,
+    struct cst_leaf_iter_result *res
+) {
+    const struct compact_suffix_tree *st = iter->st;
+    struct index_vector *stack = &iter->stack;
+    while (stack->used > 0) {
+        uint32_t v = stack->data[--stack->used];
+        // Sibling first, so we see the child first
+        if (v != iter->start) {
+            uint32_t sibling = cst_sibling(st, v);
+            if (sibling != CST_NIL)
+                index_vector_append(stack, sibling);
+        }
+        if (cst_is_leaf(v)) {
+            res->leaf_label = cst_leaf_label(v);
+            return true;
+        }
+        index_vector_append(stack, st->child[v]);
+    }
+    return false;
+}
+
+void dealloc_cst_leaf_iter(
+    struct cst_leaf_iter *iter
+) {
+    dealloc_index_vector(&iter->stack);
+}
+
+void init_cst_search_iter(
+    struct cst_search_iter *iter,
+    const struct compact_suffix_tree *st,
+    const uint8_t *pattern
+) {
+    init_cst_leaf_iter(&iter->leaf_iter, st, cst_search(st, pattern));
+}
+
+bool next_cst_match(
+    struct cst_search_iter *iter,
+    struct st_search_match *match
+) {
+    struct cst_leaf_iter_result res;
+    if (!next_cst_leaf(&iter->leaf_iter, &res))
+        return false;
+    match->pos = res.leaf_label;
+    return true;
+}
+
+void dealloc_cst_search_iter(
+    struct cst_search_iter *iter
+) {
+    dealloc_cst_leaf_iter(&iter->leaf_iter);
+}
+
+
+
+
 #pragma mark IO
 
 static void print_out_edges(
@@ -4,6 +4,9 @@
 
 #include <vectors.h>
 #include <string_utils.h>
+#include <container.h>
+#include <error.h>
+#include <match.h>
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -36,12 +39,49 @@ static inline uint32_t edge_length(
 struct suffix_tree_node_pool {
     struct suffix_tree_node *nodes;
     struct suffix_tree_node *next_node;
+    // Trees built online allocate nodes in chunks so nodes
+    // never move. The chunks before the current one are
+    // kept here until the tree is finished. It is null for
+    // the other trees.
+    struct pointer_vector *chunks;
 };
+
+/**
+ * Child index. The children of a node are a linked list,
+ * so finding the edge for a letter takes time proportional
+ * to the number of children. That is fine for DNA but not
+ * for byte alphabets. You can build an index over the
+ * children after you have built the tree, and then the
+ * searches use that instead. Nodes with at most
+ * ST_CHILD_ARRAY_MAX children get a sorted array of
+ * first letters, and nodes with more get an open addressing
+ * hash table, so the index uses memory proportional to the
+ * number of edges.
+ *
+ * The tables are indexed by the nodes' positions in the
+ * pool. If you change the tree, you must build the index
+ * again.
+ **/
+#define ST_CHILD_ARRAY_MAX 8
+struct st_child_index {
+    uint32_t no_nodes;
+    // per node in the pool: where its table starts and
+    // either the number of children (if it is at most
+    // ST_CHILD_ARRAY_MAX) or the size of the hash table.
+    uint32_t *offset;
+    uint16_t *size;
+    // The tables. Empty hash slots have null children.
+    size_t no_entries;
+    uint8_t *keys;
+    struct suffix_tree_node **children;
+};
+
 struct suffix_tree {
     const uint8_t *string;
     uint32_t length;
     struct suffix_tree_node *root;
     struct suffix_tree_node_pool pool;
+    struct st_child_index *children; // optional
 };
 
 struct suffix_tree *
@@ -59,6 +99,22 @@ lcp_suffix_tree(
     uint32_t *lcp
 );
 
+// Builds the tree from the suffix array and LCP array
+// using several threads. We split the suffix array into
+// buckets of suffixes that share a prefix, build the
+// subtrees for the buckets in parallel, and then connect
+// them at the top of the tree. The tree is the same as the
+// one you get from lcp_suffix_tree. For short strings, or
+// with a single thread, it just calls lcp_suffix_tree.
+#define PARALLEL_LCP_MIN_LENGTH (1 << 14)
+struct suffix_tree *
+parallel_lcp_suffix_tree(
+    const uint8_t *string,
+    uint32_t *sa,
+    uint32_t *lcp,
+    uint32_t no_threads
+);
+
 void annotate_suffix_links(
     struct suffix_tree *st
 );
@@ -67,6 +123,60 @@ void annotate_suffix_links(
 void free_suffix_tree(
     struct suffix_tree *st
 );
+// This function, however, also frees the string.
+void free_complete_suffix_tree(
+    struct suffix_tree *st
+);
+
+// Builds (or rebuilds) the child index. It only works
+// when the pool is a single array, so for trees built online
+// you must finish the tree first. The index is freed with
+// the tree.
+void st_build_child_index(
+    struct suffix_tree *st
+);
+void st_free_child_index(
+    struct suffix_tree *st
+);
+// The memory used by the index
+size_t st_child_index_bytes(
+    const struct suffix_tree *st
+);
+// The child of v whose edge starts with a, or null. This
+// uses the index if there is one.
+struct suffix_tree_node *
+st_find_child(
+    const struct suffix_tree *st,
+    struct suffix_tree_node *v,
+    uint8_t a
+);
+
+// Node layout. The constructions leave the nodes in the
+// pool in the order they created them, so a search jumps
+// all over memory. After you have built the tree you can
+// copy the nodes into an order that keeps the nodes a
+// search visits closer together:
+//
+//  - ST_LAYOUT_PREORDER puts each node just before its
+//    subtree, so the first child follows its parent.
+//  - ST_LAYOUT_FAMILIES puts all the children of a node
+//    next to each other (so scanning the sibling list is
+//    a linear scan), with the families in depth-first
+//    order so a node's children are close to the node.
+//
+// All node pointers into the tree, including those you
+// have kept yourself, are invalid afterwards. The parent,
+// child, sibling and suffix link pointers are updated, and
+// so is the child index if there is one. Like the child
+// index, this only works if the pool is a single array.
+enum st_layout {
+    ST_LAYOUT_PREORDER,
+    ST_LAYOUT_FAMILIES
+};
+void st_relayout(
+    struct suffix_tree *st,
+    enum st_layout layout
+);
 
 // Suffix array and LCP
 void st_compute_sa_and_lcp(
@@ -75,9 +185,14 @@ void st_compute_sa_and_lcp(
     uint32_t *lcp
 );
 
-// Iteration
+// Iteration. The iterator keeps its stack in a vector, so
+// it doesn't allocate once the stack has grown large enough.
+// If you iterate over many subtrees, use reset_st_leaf_iter
+// to reuse the stack instead of deallocating and initialising
+// a new iterator.
 struct st_leaf_iter {
-    struct st_leaf_iter_frame *stack;
+    struct suffix_tree_node *start;
+    struct pointer_vector stack;
 };
 struct st_leaf_iter_result {
     struct suffix_tree_node *leaf;
@@ -92,6 +207,10 @@ bool next_st_leaf(
     struct st_leaf_iter *iter,
     struct st_leaf_iter_result *res
 );
+void reset_st_leaf_iter(
+    struct st_leaf_iter *iter,
+    struct suffix_tree_node *node
+);
 void dealloc_st_leaf_iter(
     struct st_leaf_iter *iter
 );
@@ -119,10 +238,123 @@ bool next_st_match(
     struct st_search_iter *iter,
     struct st_search_match *match
 );
+// Search for a new pattern, reusing the iterator's stack.
+void reset_st_search_iter(
+    struct st_search_iter *iter,
+    struct suffix_tree *st,
+    const uint8_t *p
+);
 void dealloc_st_search_iter(
     struct st_search_iter *iter
 );
 
+/**
+ * Matching statistics and maximal exact matches.
+ *
+ * For position i in a query, the matching statistic is the
+ * length of the longest prefix of query[i..] that occurs in
+ * the string, together with the node at or below the end of
+ * that prefix; the leaves below the node are the places it
+ * occurs. We compute them left to right and use suffix links
+ * to get from one position to the next instead of searching
+ * from the root, so a query of length m takes O(m) time for a
+ * fixed alphabet.
+ *
+ * The inner nodes must have suffix links. McCreight's
+ * algorithm gives you those; for the other constructions, call
+ * annotate_suffix_links first. The query is zero-terminated,
+ * like the patterns for st_search.
+ **/
+struct st_matching_statistic {
+    uint32_t pos;    // in the query
+    uint32_t length; // of the longest match at pos
+    struct suffix_tree_node *node; // the root when length is zero
+    uint32_t depth;  // string depth of node, at least length
+};
+struct st_ms_iter {
+    const struct suffix_tree *st;
+    const uint8_t *query;
+    uint32_t i;
+    // The match for the previous position ends k letters down
+    // the edge to w below v (and w is null when k is zero).
+    struct suffix_tree_node *v;
+    uint32_t v_depth;
+    struct suffix_tree_node *w;
+    uint32_t k;
+};
+void init_st_ms_iter(
+    struct st_ms_iter *iter,
+    const struct suffix_tree *st,
+    const uint8_t *query
+);
+bool next_st_ms(
+    struct st_ms_iter *iter,
+    struct st_matching_statistic *ms
+);
+void dealloc_st_ms_iter(
+    struct st_ms_iter *iter
+);
+
+// Super-maximal exact matches: the matches of at least
+// min_length that are not contained in a longer match in
+// the query. They are the matching statistics where the
+// previous statistic is not one longer, and every leaf below
+// the node is an occurrence that is maximal in both
+// directions.
+struct st_smem_iter {
+    struct st_ms_iter ms_iter;
+    uint32_t min_length;
+    uint32_t prev_length;
+};
+void init_st_smem_iter(
+    struct st_smem_iter *iter,
+    const struct suffix_tree *st,
+    const uint8_t *query,
+    uint32_t min_length
+);
+bool next_st_smem(
+    struct st_smem_iter *iter,
+    struct st_matching_statistic *smem
+);
+void dealloc_st_smem_iter(
+    struct st_smem_iter *iter
+);
+
+// All maximal exact matches of at least min_length, as pairs
+// of positions. For each query position we report the leaves
+// below the matching statistic's node, and then walk up the
+// tree and report the leaves that branch off at shallower
+// depths, for as long as the depth is at least min_length.
+// We skip the occurrences that extend to the left. A
+// min_length of zero is treated as one.
+struct st_mem {
+    uint32_t query_pos;
+    uint32_t string_pos;
+    uint32_t length;
+};
+struct st_mem_iter {
+    struct st_ms_iter ms_iter;
+    uint32_t min_length;
+    struct st_matching_statistic ms; // the current query position
+    struct suffix_tree_node *node;   // whose leaves we report
+    uint32_t node_depth;
+    uint32_t length;                 // of the matches below node
+    struct pointer_vector stack;
+};
+void init_st_mem_iter(
+    struct st_mem_iter *iter,
+    const struct suffix_tree *st,
+    const uint8_t *query,
+    uint32_t min_length
+);
+bool next_st_mem(
+    struct st_mem_iter *iter,
+    struct st_mem *mem
+);
+void dealloc_st_mem_iter(
+    struct st_mem_iter *iter
+);
+
 
 
 struct st_approx_match_iter {
@@ -158,6 +390,95 @@ void dealloc_st_approx_iter(
     struct st_approx_match_iter *iter
 );
 
+/**
+ * Banded approximate search.
+ *
+ * This iterator finds the same matches as st_approx_match_iter,
+ * but it computes edit distance columns along the edges instead
+ * of enumerating edit scripts. We only keep the rows of a column
+ * that are within the edit bound (Ukkonen's cut-off), and we
+ * leave an edge, and the subtree below it, as soon as no row is.
+ *
+ * Each pair of a position and a match length is reported once,
+ * with the smallest number of edits, where st_approx_match_iter
+ * reports it once per edit script. As there, a match doesn't
+ * start or end with a deletion in the string. We only compute
+ * the CIGAR if you ask for it, and since we get it from the
+ * columns of the current match, it is only valid until the
+ * next call to next_st_banded_approx_match.
+ *
+ * The iterator does all its allocations in init, and
+ * reset_st_banded_approx_iter reuses them for a new pattern.
+ **/
+struct st_banded_approx_match {
+    struct suffix_tree_node *root;
+    uint32_t match_depth; // the length of the match in the string
+    uint32_t match_label;
+    uint32_t edits;
+};
+struct st_banded_approx_frame {
+    struct suffix_tree_node *v;
+    uint32_t depth; // the string depth of v's parent
+};
+struct st_banded_approx_iter {
+    struct suffix_tree *st;
+    const uint8_t *pattern;
+    uint32_t m;
+    uint32_t edits;
+
+    // Column d has the edit distances between prefixes of the
+    // pattern and the d first letters on the current path. Only
+    // rows first[d] to rows[d] (not included) are there; the
+    // rest are more than edits.
+    uint32_t *columns;
+    uint32_t *first;
+    uint32_t *rows;
+    uint32_t max_depth;
+    uint32_t columns_size; // allocated columns
+
+    struct st_banded_approx_frame *frames;
+    uint32_t no_frames;
+    uint32_t frames_size;
+
+    // The edge we are on
+    bool in_edge;
+    struct suffix_tree_node *v;
+    const uint8_t *x;
+    uint32_t depth;
+
+    // The match whose leaves we are reporting
+    bool in_leaves;
+    struct st_leaf_iter leaf_iter;
+    struct suffix_tree_node *hit_node;
+    const uint8_t *hit_text; // the string along the path
+    uint32_t hit_depth;
+    uint32_t hit_edits;
+    char *edit_ops;
+};
+void init_st_banded_approx_iter(
+    struct st_banded_approx_iter *iter,
+    struct suffix_tree *st,
+    const uint8_t *pattern,
+    uint32_t edits
+);
+bool next_st_banded_approx_match(
+    struct st_banded_approx_iter *iter,
+    struct st_banded_approx_match *match
+);
+// The CIGAR of the last match. The buffer needs room for
+// 2 * (m + edits) + 1 characters. Returns the buffer.
+const char *st_banded_approx_cigar(
+    struct st_banded_approx_iter *iter,
+    char *buffer
+);
+void reset_st_banded_approx_iter(
+    struct st_banded_approx_iter *iter,
+    const uint8_t *pattern
+);
+void dealloc_st_banded_approx_iter(
+    struct st_banded_approx_iter *iter
+);
+
 
 uint32_t get_string_depth(
     struct suffix_tree *st,
@@ -188,5 +509,333 @@ void st_print_dot_name(
 );
 
 
+/**
+ * Serialisation. Trees are written as containers (see
+ * container.h) with the string and an array of nodes that
+ * refer to the string and to each other by offsets and
+ * indices instead of pointers. The root is node zero, and
+ * the nodes are in the ST_LAYOUT_FAMILIES order.
+ *
+ * Both kinds of trees use the same format, so you can write
+ * a pointer based tree and read it as an edge array tree or
+ * the other way around. When you read a tree you get a copy
+ * of the string as well, so free it with
+ * free_complete_suffix_tree. As for the child index and
+ * the relayout, the pool must be a single array.
+ *
+ * You can also memory map the file and search in it
+ * directly, without reading anything first.
+ **/
+#define SUFFIX_TREE_KIND CONTAINER_TAG('S','T','R','E')
+#define ST_FILE_NIL UINT32_MAX
+struct st_file_node {
+    uint32_t leaf_label; // only meaningful for leaves
+    uint32_t from;       // the edge label is string[from,to)
+    uint32_t to;
+    uint32_t parent;
+    uint32_t child;      // ST_FILE_NIL for leaves
+    uint32_t sibling;
+    uint32_t suffix_link;
+    uint32_t reserved;
+};
+
+bool write_suffix_tree(
+    FILE *f,
+    const struct suffix_tree *st,
+    enum error_codes *err
+);
+bool write_suffix_tree_fname(
+    const char *fname,
+    const struct suffix_tree *st,
+    enum error_codes *err
+);
+struct suffix_tree *
+read_suffix_tree(
+    FILE *f,
+    bool verify,
+    enum error_codes *err
+);
+struct suffix_tree *
+read_suffix_tree_fname(
+    const char *fname,
+    bool verify,
+    enum error_codes *err
+);
+
+struct mapped_suffix_tree {
+    struct container_map map;
+    const uint8_t *string;
+    uint32_t length;
+    uint32_t no_nodes;
+    const struct st_file_node *nodes;
+};
+// If verify is false we only check the structure of the
+// container, not the tree, so only map files you trust.
+struct mapped_suffix_tree *
+map_suffix_tree_fname(
+    const char *fname,
+    bool verify,
+    enum error_codes *err
+);
+void unmap_suffix_tree(
+    struct mapped_suffix_tree *mst
+);
+// Returns the node at or below the end of the pattern's
+// path, or ST_FILE_NIL if the pattern is not in the string.
+uint32_t mapped_st_search(
+    const struct mapped_suffix_tree *mst,
+    const uint8_t *pattern
+);
+
+struct mapped_st_search_iter {
+    const struct mapped_suffix_tree *mst;
+    uint32_t start;
+    struct index_vector stack;
+};
+void init_mapped_st_search_iter(
+    struct mapped_st_search_iter *iter,
+    const struct mapped_suffix_tree *mst,
+    const uint8_t *pattern
+);
+bool next_mapped_st_match(
+    struct mapped_st_search_iter *iter,
+    struct st_search_match *match
+);
+void reset_mapped_st_search_iter(
+    struct mapped_st_search_iter *iter,
+    const uint8_t *pattern
+);
+void dealloc_mapped_st_search_iter(
+    struct mapped_st_search_iter *iter
+);
+
+
+/**
+ * Online construction (Ukkonen's algorithm).
+ *
+ * You can append text in chunks and search in the tree
+ * between appends. The tree owns a copy of the text. The
+ * text cannot contain zeros; we add the sentinel when you
+ * finish the tree.
+ *
+ * While we are building the tree, the leaves' edges end at
+ * the end of the text buffer and the buffer is zero padded
+ * after the text, so st_search works on ost->st. Nodes are
+ * allocated in chunks and never move, so node pointers stay
+ * valid across appends. Edge ranges point into the text
+ * buffer, and they are updated if the buffer has to grow.
+ * Until you finish it, you should only search in the tree.
+ *
+ * Before the tree is finished, the shortest suffixes are
+ * only implicitly in the tree and do not have leaves yet.
+ * There can be many of them (after a^n all n are pending),
+ * but they are all suffixes of the last remainder letters of
+ * the text, so the online search iterator runs KMP over those
+ * letters. A search costs O(m + remainder) on top of the tree
+ * search, and it reports all occurrences in the text seen so
+ * far.
+ **/
+struct online_suffix_tree {
+    struct suffix_tree *st;
+    uint8_t *buffer;
+    uint32_t capacity; // of the buffer, not counting padding
+    uint32_t length;   // of the text so far
+    struct suffix_tree_node *chunk_end;
+    uint32_t chunk_size;
+
+    // Ukkonen's active point and the number of suffixes
+    // that don't have leaves yet
+    struct suffix_tree_node *active_node;
+    uint32_t active_edge;
+    uint32_t active_length;
+    uint32_t remainder;
+};
+
+// The capacity is only a hint. If you know the length of
+// the text, the tree doesn't have to grow.
+struct online_suffix_tree *
+alloc_online_suffix_tree(
+    uint32_t capacity
+);
+void online_suffix_tree_append(
+    struct online_suffix_tree *ost,
+    const uint8_t *text,
+    uint32_t length
+);
+// Adds the sentinel and gives you the complete suffix
+// tree. The nodes are moved into a single array, so node
+// pointers from before are invalid. The online tree is
+// freed, and the suffix tree owns the string, so free it
+// with free_complete_suffix_tree.
+struct suffix_tree *
+finish_online_suffix_tree(
+    struct online_suffix_tree *ost
+);
+// Only use this if you don't finish the tree.
+void free_online_suffix_tree(
+    struct online_suffix_tree *ost
+);
+
+struct online_st_search_iter {
+    const struct online_suffix_tree *ost;
+    struct st_search_iter tree_iter;
+    struct kmp_match_iter pending_iter;
+    uint32_t pending_start; // the first suffix without a leaf
+};
+void init_online_st_search_iter(
+    struct online_st_search_iter *iter,
+    const struct online_suffix_tree *ost,
+    const uint8_t *pattern
+);
+bool next_online_st_match(
+    struct online_st_search_iter *iter,
+    struct st_search_match *match
+);
+void dealloc_online_st_search_iter(
+    struct online_st_search_iter *iter
+);
+
+
+/**
+ * Compact suffix trees.
+ *
+ * The pointer based tree uses 56 bytes per node and
+ * allocates 2n nodes, which is too much for large
+ * strings. The compact tree refers to nodes by 32-bit
+ * indices and keeps the node data in separate arrays.
+ *
+ * Inner nodes are numbered from 0 (the root) and have a
+ * string depth, a position where a suffix in their subtree
+ * starts, a first child and a next sibling. The label on the
+ * edge into an inner node v with parent p is
+ * string[pos(v) + depth(p), pos(v) + depth(v)). Leaves are
+ * not stored at all, except for their sibling. A leaf is the
+ * index of its label with CST_LEAF_BIT set, its position is
+ * its label and its depth is the length of its suffix.
+ *
+ * That comes to 16 bytes per inner node and 4 per leaf,
+ * so at most 20 bytes per character. Parent pointers and
+ * suffix links are only used during construction.
+ *
+ * Children are sorted, so leaves come out in suffix array
+ * order when we traverse the tree.
+ **/
+#define CST_LEAF_BIT 0x80000000u
+#define CST_NIL      UINT32_MAX
+
+struct compact_suffix_tree {
+    const uint8_t *string;
+    uint32_t length; // including the sentinel
+    uint32_t no_inner_nodes;
+    uint32_t *depth;
+    uint32_t *pos;
+    uint32_t *child;
+    uint32_t *sibling;
+    uint32_t *leaf_sibling;
+};
+
+static inline bool cst_is_leaf(uint32_t v) {
+    return v & CST_LEAF_BIT;
+}
+static inline uint32_t cst_leaf(uint32_t label) {
+    return label | CST_LEAF_BIT;
+}
+static inline uint32_t cst_leaf_label(uint32_t v) {
+    return v & ~CST_LEAF_BIT;
+}
+static inline uint32_t cst_depth(
+    const struct compact_suffix_tree *st,
+    uint32_t v
+) {
+    return cst_is_leaf(v) ? st->length - cst_leaf_label(v) : st->depth[v];
+}
+static inline uint32_t cst_pos(
+    const struct compact_suffix_tree *st,
+    uint32_t v
+) {
+    return cst_is_leaf(v) ? cst_leaf_label(v) : st->pos[v];
+}
+static inline uint32_t cst_child(
+    const struct compact_suffix_tree *st,
+    uint32_t v
+) {
+    return cst_is_leaf(v) ? CST_NIL : st->child[v];
+}
+static inline uint32_t cst_sibling(
+    const struct compact_suffix_tree *st,
+    uint32_t v
+) {
+    return cst_is_leaf(v) ? st->leaf_sibling[cst_leaf_label(v)] : st->sibling[v];
+}
+
+struct compact_suffix_tree *
+mccreight_compact_suffix_tree(
+    const uint8_t *string
+);
+struct compact_suffix_tree *
+lcp_compact_suffix_tree(
+    const uint8_t *string,
+    uint32_t *sa,
+    uint32_t *lcp
+);
+void free_compact_suffix_tree(
+    struct compact_suffix_tree *st
+);
+// The memory used by the tree, not counting the string
+size_t cst_bytes(
+    const struct compact_suffix_tree *st
+);
+
+void cst_compute_sa_and_lcp(
+    const struct compact_suffix_tree *st,
+    uint32_t *sa,
+    uint32_t *lcp
+);
+
+// Returns the node at or below the end of the pattern's
+// path, or CST_NIL if the pattern is not in the string.
+uint32_t cst_search(
+    const struct compact_suffix_tree *st,
+    const uint8_t *pattern
+);
+
+struct cst_leaf_iter {
+    const struct compact_suffix_tree *st;
+    uint32_t start;
+    struct index_vector stack;
+};
+struct cst_leaf_iter_result {
+    uint32_t leaf_label;
+};
+void init_cst_leaf_iter(
+    struct cst_leaf_iter *iter,
+    const struct compact_suffix_tree *st,
+    uint32_t node
+);
+bool next_cst_leaf(
+    struct cst_leaf_iter *iter,
+    struct cst_leaf_iter_result *res
+);
+void dealloc_cst_leaf_iter(
+    struct cst_leaf_iter *iter
+);
+
+struct cst_search_iter {
+    struct cst_leaf_iter leaf_iter;
+};
+void init_cst_search_iter(
+    struct cst_search_iter *iter,
+    const struct compact_suffix_tree *st,
+    const uint8_t *pattern
+);
+bool next_cst_match(
+    struct cst_search_iter *iter,
+    struct st_search_match *match
+);
+void dealloc_cst_search_iter(
+    struct cst_search_iter *iter
+);
+
+
 
 #endif
@@ -0,0 +1,63 @@
+#ifndef SUFFIX_TREE_INTERNAL_H
+#define SUFFIX_TREE_INTERNAL_H
+
+#include <error.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// This is not a public interface. It might change
+// at any time, so don't use it. All the names
+// end in an underscore to minimise the risk
+// of name clashes with a user's code.
+
+// For the parallel LCP constructions. A bucket is a run of
+// the suffix array where all suffixes share their first q
+// letters, i.e. the LCP is at least q inside the bucket and
+// less than q at its start. Each bucket is a subtree we can
+// build on its own. Tasks are runs of buckets that the
+// threads pick up; we make several per thread so the load
+// evens out.
+struct lcp_partition_ {
+    uint32_t q;
+    uint32_t no_buckets;
+    uint32_t *buckets; // bucket starts, and n at the end
+    uint32_t no_tasks;
+    uint32_t *tasks;   // task starts (bucket indices), and no_buckets at the end
+};
+void init_lcp_partition_(
+    struct lcp_partition_ *partition,
+    uint32_t n,
+    const uint32_t *lcp,
+    uint32_t no_threads
+);
+void dealloc_lcp_partition_(
+    struct lcp_partition_ *partition
+);
+
+// The suffix tree file format is shared between the pointer
+// and the edge array trees. They convert their nodes to
+// file nodes and these functions do the rest. The reader
+// checks that the nodes are consistent with each other and
+// with the string, and gives you a copy of the string.
+struct st_file_node;
+bool write_st_file_(
+    FILE *f,
+    const uint8_t *string,
+    uint32_t length,
+    uint32_t no_nodes,
+    const struct st_file_node *nodes,
+    enum error_codes *err
+);
+bool read_st_file_(
+    FILE *f,
+    bool verify,
+    uint8_t **string,
+    uint32_t *length,
+    uint32_t *no_nodes,
+    struct st_file_node **nodes,
+    enum error_codes *err
+);
+
+#endif
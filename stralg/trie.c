@@ -29,16 +29,40 @@ void init_trie(
 void dealloc_trie(
     struct trie *trie
 ) {
-    // depth first traversal freeing the trie.
-    if (trie->children) free_trie(trie->children);
-    if (trie->sibling) free_trie(trie->sibling);
-    
-    /* the output list is a linked list, but there is at most
-     a link per string label and that is associated with the
-     trie node with that label. We don't need to handle the
-     rest of the output list since those will be handled
-     when their corresponding trie nodes are deleted.
-     */
+    // We free the children and siblings of trie, but not trie
+    // itself. We keep the nodes we still need to free in a
+    // list, linked through the sibling pointers, and put the
+    // children of a node in front of the list when we free
+    // it, so we never recurse however deep or wide the trie is.
+    struct trie *list = trie->children;
+    if (list) {
+        struct trie *last = list;
+        while (last->sibling) last = last->sibling;
+        last->sibling = trie->sibling;
+    } else {
+        list = trie->sibling;
+    }
+    while (list) {
+        struct trie *v = list;
+        list = v->sibling;
+        if (v->children) {
+            struct trie *last = v->children;
+            while (last->sibling) last = last->sibling;
+            last->sibling = list;
+            list = v->children;
+        }
+        /* the output list is a linked list, but there is at most
+         a link per string label and that is associated with the
+         trie node with that label. We don't need to handle the
+         rest of the output list since those will be handled
+         when their corresponding trie nodes are deleted.
+         */
+        if (v->output && v->string_label >= 0) {
+            free(v->output);
+        }
+        free(v);
+    }
+
     if (trie->output && trie->string_label >= 0) {
         free(trie->output);
     }
@@ -306,3 +330,164 @@ void trie_print_dot_fname(
     trie_print_dot(trie, f);
     fclose(f);
 }
+
+/// MARK: Compact tries
+
+static void grow_compact_trie(
+    struct compact_trie *trie,
+    uint32_t size
+) {
+    trie->size = size;
+    trie->in_edge_label = realloc(trie->in_edge_label, size * sizeof(*trie->in_edge_label));
+    trie->string_label = realloc(trie->string_label, size * sizeof(*trie->string_label));
+    trie->parent = realloc(trie->parent, size * sizeof(*trie->parent));
+    trie->children = realloc(trie->children, size * sizeof(*trie->children));
+    trie->sibling = realloc(trie->sibling, size * sizeof(*trie->sibling));
+}
+
+static uint32_t new_compact_trie_node(
+    struct compact_trie *trie,
+    uint32_t parent,
+    uint8_t label
+) {
+    if (trie->no_nodes == trie->size) {
+        assert(trie->size < TRIE_NO_NODE / 2);
+        grow_compact_trie(trie, 2 * trie->size);
+    }
+    uint32_t v = trie->no_nodes++;
+    trie->in_edge_label[v] = label;
+    trie->string_label[v] = -1;
+    trie->parent[v] = parent;
+    trie->children[v] = TRIE_NO_NODE;
+    trie->sibling[v] = TRIE_NO_NODE;
+    return v;
+}
+
+struct compact_trie *alloc_compact_trie(void)
+{
+    struct compact_trie *trie = malloc(sizeof(struct compact_trie));
+    trie->no_nodes = 0;
+    trie->in_edge_label = 0;
+    trie->string_label = 0;
+    trie->parent = 0;
+    trie->children = 0;
+    trie->sibling = 0;
+    grow_compact_trie(trie, 256);
+    new_compact_trie_node(trie, TRIE_NO_NODE, '\0'); // the root
+    return trie;
+}
+
+void free_compact_trie(
+    struct compact_trie *trie
+) {
+    free(trie->in_edge_label);
+    free(trie->string_label);
+    free(trie->parent);
+    free(trie->children);
+    free(trie->sibling);
+    free(trie);
+}
+
+uint32_t compact_trie_out_link(
+    const struct compact_trie *trie,
+    uint32_t v,
+    uint8_t label
+) {
+    for (uint32_t w = trie->children[v]; w != TRIE_NO_NODE; w = trie->sibling[w]) {
+        if (trie->in_edge_label[w] == label)
+            return w;
+    }
+    return TRIE_NO_NODE;
+}
+
+uint32_t get_compact_trie_node(
+    const struct compact_trie *trie,
+    const uint8_t *str
+) {
+    uint32_t v = 0;
+    for (; *str && v != TRIE_NO_NODE; str++)
+        v = compact_trie_out_link(trie, v, *str);
+    return v;
+}
+
+void add_string_to_compact_trie(
+    struct compact_trie *trie,
+    const uint8_t *str,
+    int string_label
+) {
+    assert(str && strlen((char*)str) > 0);
+
+    uint32_t v = 0;
+    while (*str) {
+        uint32_t w = compact_trie_out_link(trie, v, *str);
+        if (w == TRIE_NO_NODE) break;
+        v = w;
+        str++;
+    }
+    // The first new node goes in front of the siblings,
+    // as in add_string_to_trie, the rest are single children.
+    if (*str) {
+        uint32_t w = new_compact_trie_node(trie, v, *str++);
+        trie->sibling[w] = trie->children[v];
+        trie->children[v] = w;
+        v = w;
+    }
+    for (; *str; str++) {
+        uint32_t w = new_compact_trie_node(trie, v, *str);
+        trie->children[v] = w;
+        v = w;
+    }
+
+    // we only allow this when the string wasn't already inserted!
+    assert(trie->string_label[v] < 0);
+    trie->string_label[v] = string_label;
+}
+
+struct compact_trie *build_compact_trie(
+    const uint8_t **patterns,
+    uint32_t no_patterns
+) {
+    struct compact_trie *trie = alloc_compact_trie();
+
+    // The path to the previous pattern, path[d] at depth d.
+    uint32_t path_size = 64;
+    uint32_t *path = malloc(path_size * sizeof(*path));
+    uint32_t path_length = 0; // the depth of the previous pattern
+    path[0] = 0;
+    const uint8_t *prev = (const uint8_t *)"";
+
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        const uint8_t *p = patterns[i];
+        assert(p[0] != '\0');
+        uint32_t lcp = 0;
+        while (p[lcp] && p[lcp] == prev[lcp]) lcp++;
+        // sorted and unique
+        assert(prev[lcp] < p[lcp]);
+
+        // If the previous pattern continued below the branch
+        // point, its node there is the last child, since the
+        // patterns are sorted, so the new node is its sibling.
+        uint32_t v = path[lcp];
+        uint32_t left = (lcp < path_length) ? path[lcp + 1] : TRIE_NO_NODE;
+        uint32_t d = lcp;
+        for (const uint8_t *s = p + lcp; *s; ++s, ++d) {
+            uint32_t w = new_compact_trie_node(trie, v, *s);
+            if (left != TRIE_NO_NODE) trie->sibling[left] = w;
+            else trie->children[v] = w;
+            left = TRIE_NO_NODE;
+            if (d + 1 >= path_size) {
+                path_size *= 2;
+                path = realloc(path, path_size * sizeof(*path));
+            }
+            path[d + 1] = v = w;
+        }
+        trie->string_label[v] = (int)i;
+        path_length = d;
+        prev = p;
+    }
+
+    free(path);
+    // We don't need the room for more nodes.
+    grow_compact_trie(trie, trie->no_nodes);
+    return trie;
+}
@@ -75,4 +75,89 @@ void trie_print_dot_fname(
 );
 
 
+
+/**
+ Compact tries.
+ 
+ A struct trie allocates every node on its own and links
+ them with pointers, which is slow to build and wastes a lot
+ of memory when you have millions of patterns. Here, the
+ nodes live in arrays, one per field, and refer to each other
+ by 32-bit indices, so a node takes 17 bytes instead of
+ sizeof(struct trie) plus the malloc overhead. Node zero is
+ the root.
+ 
+ There are no failure links; compile the trie into an
+ ac_automaton to search with it.
+ **/
+#define TRIE_NO_NODE UINT32_MAX
+
+struct compact_trie {
+    uint32_t no_nodes;
+    uint32_t size; // the number of nodes we have room for
+    uint8_t *in_edge_label;
+    int *string_label;
+    uint32_t *parent;
+    uint32_t *children; // the first child
+    uint32_t *sibling;
+};
+
+struct compact_trie *alloc_compact_trie(void);
+void free_compact_trie(
+    struct compact_trie *trie
+);
+
+// Adds a string in the same way as add_string_to_trie,
+// and with the same restrictions.
+void add_string_to_compact_trie(
+    struct compact_trie *trie,
+    const uint8_t *str,
+    int string_label
+);
+
+/**
+ Build a compact trie from sorted patterns.
+ 
+ The patterns must be sorted (as by strcmp) and unique. We
+ insert them in one pass, where each pattern shares the path
+ to its longest common prefix with the previous one, so we
+ never search for children. Pattern i gets string label i,
+ and children are sorted by their labels. The nodes end up in
+ depth first order.
+ */
+struct compact_trie *build_compact_trie(
+    const uint8_t **patterns,
+    uint32_t no_patterns
+);
+
+uint32_t compact_trie_out_link(
+    const struct compact_trie *trie,
+    uint32_t v,
+    uint8_t label
+);
+// Returns TRIE_NO_NODE if the string is not in the trie.
+uint32_t get_compact_trie_node(
+    const struct compact_trie *trie,
+    const uint8_t *str
+);
+static inline bool string_in_compact_trie(
+    const struct compact_trie *trie,
+    const uint8_t *str
+) {
+    uint32_t v = get_compact_trie_node(trie, str);
+    return v != TRIE_NO_NODE && trie->string_label[v] >= 0;
+}
+
+// The number of bytes the trie uses for its nodes.
+static inline size_t compact_trie_memory(
+    const struct compact_trie *trie
+) {
+    return (size_t)trie->size * (
+        sizeof(*trie->in_edge_label) + sizeof(*trie->string_label) +
+        sizeof(*trie->parent) + sizeof(*trie->children) +
+        sizeof(*trie->sibling)
+    );
+}
+
+
 #endif // TRIE_H
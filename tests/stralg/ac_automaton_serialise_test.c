@@ -0,0 +1,256 @@
+#include <aho_corasick.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+
+static uint8_t *load_file(const char *fname, long *size)
+{
+    FILE *f = fopen(fname, "rb");
+    assert(f);
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    rewind(f);
+    uint8_t *data = malloc(*size);
+    size_t read = fread(data, 1, *size, f);
+    assert(read == (size_t)*size);
+    fclose(f);
+    return data;
+}
+
+static void store_file(const char *fname, const uint8_t *data, long size)
+{
+    FILE *f = fopen(fname, "wb");
+    assert(f);
+    fwrite(data, 1, size, f);
+    fclose(f);
+}
+
+static struct ac_automaton *build_automaton(
+    const char *alphabet,
+    uint32_t no_patterns,
+    uint32_t max_length,
+    enum ac_layout layout
+) {
+    uint32_t k = (uint32_t)strlen(alphabet);
+    struct compact_trie *trie = alloc_compact_trie();
+    uint8_t *p = malloc(max_length + 1);
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        uint32_t m = 1 + rand() % max_length;
+        for (uint32_t j = 0; j < m; ++j)
+            p[j] = alphabet[rand() % k];
+        p[m] = '\0';
+        if (string_in_compact_trie(trie, p)) continue;
+        add_string_to_compact_trie(trie, p, (int)i);
+    }
+    free(p);
+    struct ac_automaton *ac = alloc_ac_automaton_from_compact_trie(trie, layout);
+    free_compact_trie(trie);
+    return ac;
+}
+
+static void check_same_automaton(
+    const struct ac_automaton *ac,
+    const struct ac_automaton *other
+) {
+    assert(other->no_states == ac->no_states);
+    assert(other->alphabet_size == ac->alphabet_size);
+    assert(other->max_length == ac->max_length);
+    assert(other->dense == ac->dense);
+    assert(memcmp(other->classes, ac->classes, 256) == 0);
+    uint32_t n = ac->no_states;
+    uint32_t no_outputs = ac->output_start[n];
+    assert(memcmp(other->output_start, ac->output_start, (n + 1) * sizeof(uint32_t)) == 0);
+    assert(no_outputs == 0 ||
+           memcmp(other->outputs, ac->outputs, no_outputs * sizeof(struct ac_output)) == 0);
+    size_t no_transitions = ac->dense ? (size_t)n * ac->alphabet_size : ac->alphabet_size;
+    assert(memcmp(other->transitions, ac->transitions, no_transitions * sizeof(uint32_t)) == 0);
+    if (!ac->dense) {
+        assert(memcmp(other->failure, ac->failure, n * sizeof(uint32_t)) == 0);
+        assert(memcmp(other->edge_start, ac->edge_start, (n + 1) * sizeof(uint32_t)) == 0);
+        assert(n == 1 || memcmp(other->edge_class, ac->edge_class, n - 1) == 0);
+    }
+}
+
+static void check_same_matches(
+    const struct ac_automaton *ac,
+    const struct ac_automaton *other,
+    const char *alphabet
+) {
+    uint32_t k = (uint32_t)strlen(alphabet);
+    uint32_t n = 1000;
+    uint8_t *x = malloc(n + 1);
+    for (uint32_t i = 0; i < n; ++i)
+        x[i] = alphabet[rand() % k];
+    x[n] = '\0';
+
+    struct ac_automaton_iter iter, other_iter;
+    struct ac_match match, other_match;
+    init_ac_automaton_iter(&iter, ac, x, n);
+    init_ac_automaton_iter(&other_iter, other, x, n);
+    for (;;) {
+        bool more = next_ac_automaton_match(&iter, &match);
+        bool other_more = next_ac_automaton_match(&other_iter, &other_match);
+        assert(other_more == more);
+        if (!more) break;
+        assert(match.string_label == other_match.string_label);
+        assert(match.index == other_match.index);
+    }
+    dealloc_ac_automaton_iter(&iter);
+    dealloc_ac_automaton_iter(&other_iter);
+    free(x);
+}
+
+static void test_automaton(struct ac_automaton *ac, const char *alphabet, const char *fname)
+{
+    enum error_codes err;
+    bool ok = write_ac_automaton_fname(fname, ac, &err);
+    assert(ok);
+    assert(err == NO_ERROR);
+
+    for (uint32_t verify = 0; verify < 2; ++verify) {
+        struct ac_automaton *other = read_ac_automaton_fname(fname, verify, &err);
+        assert(other);
+        assert(err == NO_ERROR);
+        assert(!other->map);
+        check_same_automaton(ac, other);
+        check_same_matches(ac, other, alphabet);
+        free_ac_automaton(other);
+
+        other = map_ac_automaton_fname(fname, verify, &err);
+        assert(other);
+        assert(err == NO_ERROR);
+        assert(other->map);
+        check_same_automaton(ac, other);
+        check_same_matches(ac, other, alphabet);
+        free_ac_automaton(other);
+    }
+}
+
+// Reading or mapping a damaged file must fail; we return the
+// error. The calls are outside the asserts so they also run
+// when NDEBUG is defined.
+static enum error_codes read_damaged(const char *fname, bool verify)
+{
+    enum error_codes err;
+    struct ac_automaton *ac = read_ac_automaton_fname(fname, verify, &err);
+    assert(!ac);
+    if (ac) free_ac_automaton(ac);
+    return err;
+}
+
+static enum error_codes map_damaged(const char *fname, bool verify)
+{
+    enum error_codes err;
+    struct ac_automaton *ac = map_ac_automaton_fname(fname, verify, &err);
+    assert(!ac);
+    if (ac) free_ac_automaton(ac);
+    return err;
+}
+
+static void test_damaged_files(const char *fname)
+{
+    struct ac_automaton *ac = build_automaton("acgt", 20, 6, AC_SPARSE_LAYOUT);
+    enum error_codes err;
+    bool ok = write_ac_automaton_fname(fname, ac, &err);
+    assert(ok);
+    uint32_t n = ac->no_states;
+    free_ac_automaton(ac);
+
+    // Find the arrays in the file through the map.
+    ac = map_ac_automaton_fname(fname, true, &err);
+    assert(ac);
+    long transitions_offset = (long)((const uint8_t *)ac->transitions - ac->map->data);
+    long failure_offset = (long)((const uint8_t *)ac->failure - ac->map->data);
+    free_ac_automaton(ac);
+
+    long size;
+    uint8_t *data = load_file(fname, &size);
+
+    // Truncated anywhere
+    for (long cut = 0; cut < size; cut += 1 + size / 50) {
+        store_file(fname, data, cut);
+        err = read_damaged(fname, true);
+        assert(err == TRUNCATED_FILE);
+        err = map_damaged(fname, false);
+        assert(err != NO_ERROR);
+    }
+
+    // A transition to a state that isn't there. With the
+    // checksums we see that the file is damaged, and without
+    // them that the automaton doesn't make sense.
+    uint32_t *transitions = (uint32_t *)(data + transitions_offset);
+    uint32_t transition = transitions[1];
+    transitions[1] = n;
+    store_file(fname, data, size);
+    err = read_damaged(fname, true);
+    assert(err == CHECKSUM_MISMATCH);
+    err = map_damaged(fname, true);
+    assert(err == CHECKSUM_MISMATCH);
+    err = read_damaged(fname, false);
+    assert(err == MALFORMED_FILE);
+    transitions[1] = transition;
+
+    // A failure link that doesn't get closer to the root,
+    // so the sparse scan would loop forever.
+    uint32_t *failure = (uint32_t *)(data + failure_offset);
+    uint32_t link = failure[n - 1];
+    failure[n - 1] = n - 1;
+    store_file(fname, data, size);
+    err = read_damaged(fname, false);
+    assert(err == MALFORMED_FILE);
+    failure[n - 1] = link;
+
+    // Not an automaton container
+    data[16] ^= 0xff; // the kind
+    store_file(fname, data, size);
+    err = read_damaged(fname, true);
+    assert(err == MALFORMED_FILE);
+    err = map_damaged(fname, false);
+    assert(err == MALFORMED_FILE);
+    data[16] ^= 0xff;
+
+    // And back to the original
+    store_file(fname, data, size);
+    ac = read_ac_automaton_fname(fname, false, &err);
+    assert(ac);
+    free_ac_automaton(ac);
+    free(data);
+
+    err = read_damaged("/does/not/exist", true);
+    assert(err == CANNOT_OPEN_FILE);
+    err = map_damaged("/does/not/exist", true);
+    assert(err == CANNOT_OPEN_FILE);
+}
+
+int main(int argc, const char **argv)
+{
+    char fname[] = "/tmp/temp.XXXXXX";
+    int fd = mkstemp(fname);
+    assert(fd >= 0);
+    close(fd);
+
+    enum ac_layout layouts[] = { AC_DENSE_LAYOUT, AC_SPARSE_LAYOUT };
+    for (uint32_t l = 0; l < 2; ++l) {
+        // no patterns at all
+        struct ac_automaton *ac = build_automaton("a", 0, 1, layouts[l]);
+        test_automaton(ac, "ab", fname);
+        free_ac_automaton(ac);
+
+        for (uint32_t rep = 0; rep < 5; ++rep) {
+            ac = build_automaton("acgt", 50, 10, layouts[l]);
+            test_automaton(ac, "acgt", fname);
+            free_ac_automaton(ac);
+            ac = build_automaton("abcdefghijklmnopqrstuvwxyz", 100, 6, layouts[l]);
+            test_automaton(ac, "abcdefghijklmnopqrstuvwxyz", fname);
+            free_ac_automaton(ac);
+        }
+    }
+
+    test_damaged_files(fname);
+    remove(fname);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,261 @@
+#include <aho_corasick.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+struct collected {
+    const struct ac_match *expected;
+    uint32_t no_matches;
+};
+
+static void collect(const struct ac_match *match, void *data)
+{
+    struct collected *c = data;
+    assert(match->string_label == c->expected[c->no_matches].string_label);
+    assert(match->index == c->expected[c->no_matches].index);
+    c->no_matches++;
+}
+
+static void check_matches(
+    uint8_t **patterns,
+    uint32_t no_patterns,
+    const uint8_t *x,
+    uint32_t n
+) {
+    uint32_t *lengths = malloc(no_patterns * sizeof(*lengths));
+    struct trie *trie = alloc_trie();
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        lengths[i] = (uint32_t)strlen((char *)patterns[i]);
+        add_string_to_trie(trie, patterns[i], (int)i);
+    }
+
+    // The matches from the trie iterator
+    uint32_t no_expected = 0, size = 16;
+    struct ac_match *expected = malloc(size * sizeof(*expected));
+    struct ac_iter iter;
+    struct ac_match match;
+    init_ac_iter(&iter, x, n, lengths, trie);
+    while (next_ac_match(&iter, &match)) {
+        if (no_expected == size) {
+            size *= 2;
+            expected = realloc(expected, size * sizeof(*expected));
+        }
+        expected[no_expected++] = match;
+    }
+    dealloc_ac_iter(&iter);
+
+    enum ac_layout layouts[] = {
+        AC_AUTO_LAYOUT, AC_DENSE_LAYOUT, AC_SPARSE_LAYOUT
+    };
+    for (uint32_t l = 0; l < 3; ++l) {
+        struct ac_automaton *ac = alloc_ac_automaton(trie, layouts[l]);
+        assert(layouts[l] != AC_DENSE_LAYOUT || ac->dense);
+        assert(layouts[l] != AC_SPARSE_LAYOUT || !ac->dense);
+
+        struct ac_automaton_iter ac_iter;
+        init_ac_automaton_iter(&ac_iter, ac, x, n);
+        uint32_t i = 0;
+        while (next_ac_automaton_match(&ac_iter, &match)) {
+            // same matches, in the same order
+            assert(i < no_expected);
+            assert(match.string_label == expected[i].string_label);
+            assert(match.index == expected[i].index);
+            uint32_t length = lengths[match.string_label];
+            assert(strncmp((char *)x + match.index,
+                           (char *)patterns[match.string_label],
+                           length) == 0);
+            i++;
+        }
+        assert(i == no_expected);
+        dealloc_ac_automaton_iter(&ac_iter);
+
+        // In bulk, with buffers of different sizes.
+        struct ac_match buffer[7];
+        for (uint32_t max = 1; max <= 7; max += 3) {
+            init_ac_automaton_iter(&ac_iter, ac, x, n);
+            i = 0;
+            uint32_t got;
+            while ((got = next_ac_automaton_matches(&ac_iter, buffer, max))) {
+                assert(got <= max);
+                for (uint32_t b = 0; b < got; ++b, ++i) {
+                    assert(i < no_expected);
+                    assert(buffer[b].string_label == expected[i].string_label);
+                    assert(buffer[b].index == expected[i].index);
+                }
+            }
+            assert(i == no_expected);
+            dealloc_ac_automaton_iter(&ac_iter);
+        }
+
+        // As a stream, in chunks of random sizes, including
+        // empty chunks. We start close to 2^32 so global
+        // positions overflow 32 bits.
+        uint64_t start = (1ull << 32) - 5;
+        struct ac_stream stream;
+        struct ac_stream_match stream_match;
+        init_ac_stream(&stream, ac);
+        stream.offset = start;
+        i = 0;
+        for (uint32_t pos = 0; pos < n; ) {
+            uint32_t chunk = (rand() % 4) ? rand() % 8 : rand() % 100;
+            if (chunk > n - pos) chunk = n - pos;
+            feed_ac_stream(&stream, x + pos, chunk);
+            while (next_ac_stream_match(&stream, &stream_match)) {
+                assert(i < no_expected);
+                assert(stream_match.string_label == expected[i].string_label);
+                assert(stream_match.index == start + expected[i].index);
+                // matches end in the current chunk
+                assert(stream_match.index + lengths[stream_match.string_label]
+                       > start + pos);
+                i++;
+            }
+            pos += chunk;
+        }
+        assert(i == no_expected);
+        reset_ac_stream(&stream);
+        assert(stream.offset == 0);
+        dealloc_ac_stream(&stream);
+
+        struct collected collected = { expected, 0 };
+        ac_automaton_scan(ac, x, n, collect, &collected);
+        assert(collected.no_matches == no_expected);
+        free_ac_automaton(ac);
+    }
+
+    free(expected);
+    free_trie(trie);
+    free(lengths);
+}
+
+static void test_random(
+    const char *alphabet,
+    uint32_t no_patterns,
+    uint32_t max_length,
+    uint32_t n
+) {
+    uint32_t k = (uint32_t)strlen(alphabet);
+    uint8_t **patterns = malloc(no_patterns * sizeof(*patterns));
+    uint32_t no_unique = 0;
+    while (no_unique < no_patterns) {
+        uint32_t m = 1 + rand() % max_length;
+        uint8_t *p = malloc(m + 1);
+        for (uint32_t i = 0; i < m; ++i)
+            p[i] = alphabet[rand() % k];
+        p[m] = '\0';
+        // the trie wants unique patterns
+        bool seen = false;
+        for (uint32_t i = 0; i < no_unique && !seen; ++i)
+            seen = strcmp((char *)p, (char *)patterns[i]) == 0;
+        if (seen) free(p);
+        else patterns[no_unique++] = p;
+    }
+
+    // The text also has letters that are not in any pattern.
+    uint8_t *x = malloc(n + 1);
+    for (uint32_t i = 0; i < n; ++i)
+        x[i] = (rand() % 20) ? alphabet[rand() % k] : 'X';
+    x[n] = '\0';
+
+    check_matches(patterns, no_patterns, x, n);
+
+    free(x);
+    for (uint32_t i = 0; i < no_patterns; ++i)
+        free(patterns[i]);
+    free(patterns);
+}
+
+// The text is long enough that we actually split it, and
+// the alphabet small enough that matches cross the pieces.
+static void test_parallel(void)
+{
+    uint32_t no_patterns = 100;
+    uint32_t n = 3 * PARALLEL_AC_MIN_LENGTH + 17;
+    struct trie *trie = alloc_trie();
+    uint8_t p[31];
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        uint32_t m = 1 + rand() % 30;
+        for (uint32_t k = 0; k < m; ++k)
+            p[k] = "ab"[rand() % 2];
+        p[m] = '\0';
+        struct trie *v = get_trie_node(trie, p);
+        if (v && v->string_label >= 0) continue;
+        add_string_to_trie(trie, p, (int)i);
+    }
+    uint8_t *x = malloc(n + 1);
+    for (uint32_t i = 0; i < n; ++i)
+        x[i] = "ab"[rand() % 2];
+    x[n] = '\0';
+
+    struct ac_automaton *ac = alloc_ac_automaton(trie, AC_AUTO_LAYOUT);
+    uint32_t no_expected = 0, size = 1024;
+    struct ac_match *expected = malloc(size * sizeof(*expected));
+    struct ac_automaton_iter iter;
+    struct ac_match match;
+    init_ac_automaton_iter(&iter, ac, x, n);
+    while (next_ac_automaton_match(&iter, &match)) {
+        if (no_expected == size) {
+            size *= 2;
+            expected = realloc(expected, size * sizeof(*expected));
+        }
+        expected[no_expected++] = match;
+    }
+    dealloc_ac_automaton_iter(&iter);
+
+    uint32_t threads[] = { 1, 2, 3, 8 };
+    uint32_t lengths[] = { n, PARALLEL_AC_MIN_LENGTH - 1, 100 };
+    for (uint32_t t = 0; t < 4; ++t) {
+        for (uint32_t l = 0; l < 3; ++l) {
+            uint32_t m = lengths[l];
+            uint32_t no_matches;
+            struct ac_match *matches =
+                parallel_ac_scan(ac, x, m, threads[t], &no_matches);
+            uint32_t i = 0;
+            for (; i < no_expected && expected[i].index + 30 < m; ++i) {
+                assert(matches[i].string_label == expected[i].string_label);
+                assert(matches[i].index == expected[i].index);
+            }
+            assert(no_matches >= i);
+            if (m == n) assert(no_matches == no_expected);
+            free(matches);
+        }
+    }
+
+    free(expected);
+    free_ac_automaton(ac);
+    free_trie(trie);
+    free(x);
+}
+
+int main(int argc, const char **argv)
+{
+    uint8_t *patterns[] = {
+        (uint8_t *)"ababc",
+        (uint8_t *)"aba",
+        (uint8_t *)"b",
+        (uint8_t *)"bab"
+    };
+    const uint8_t *text = (uint8_t *)"abababcbab";
+    check_matches(patterns, 4, text, (uint32_t)strlen((char *)text));
+
+    // Patterns that are suffixes of each other have
+    // overlapping output sets.
+    uint8_t *runs[] = {
+        (uint8_t *)"a", (uint8_t *)"aa", (uint8_t *)"aaa",
+        (uint8_t *)"aaaa", (uint8_t *)"baaa"
+    };
+    text = (uint8_t *)"aaaaabaaaaa";
+    check_matches(runs, 5, text, (uint32_t)strlen((char *)text));
+
+    for (uint32_t rep = 0; rep < 10; ++rep) {
+        test_random("ab", 5, 4, 200);
+        test_random("acgt", 50, 8, 1000);
+        test_random("acgt", 200, 20, 2000);
+        test_random("abcdefghijklmnopqrstuvwxyz", 100, 5, 2000);
+    }
+
+    test_parallel();
+
+    return EXIT_SUCCESS;
+}
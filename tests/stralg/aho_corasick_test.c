@@ -55,6 +55,24 @@ int main(int argc, char * argv[])
     }
     dealloc_ac_iter(&iter);
 
+    // A long text without hits. The iterator used to recurse
+    // once per letter, which overflowed the stack in debug builds.
+    uint32_t n = 20000000;
+    uint8_t *long_text = malloc(n + 1);
+    memset(long_text, 'c', n);
+    long_text[n] = '\0';
+    long_text[n - 1] = 'b';
+    init_ac_iter(&iter, long_text, n, pattern_lengths, patterns_trie);
+    uint32_t no_hits = 0;
+    while (next_ac_match(&iter, &match)) {
+        assert(match.string_label == 2);
+        assert(match.index == n - 1);
+        no_hits++;
+    }
+    assert(no_hits == 1);
+    dealloc_ac_iter(&iter);
+    free(long_text);
+
     free_trie(patterns_trie);
 
     return EXIT_SUCCESS;
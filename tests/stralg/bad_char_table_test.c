@@ -0,0 +1,42 @@
+#include <match.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+static void check_table(const uint8_t *p, uint32_t m)
+{
+    enum bad_char_layout layouts[] = {
+        BAD_CHAR_DENSE_LAYOUT, BAD_CHAR_SPARSE_LAYOUT
+    };
+    for (uint32_t l = 0; l < 2; ++l) {
+        struct bad_char_table table;
+        init_bad_char_table(&table, p, m, layouts[l]);
+        for (uint32_t i = 0; i < m; ++i) {
+            for (uint32_t a = 0; a < 256; ++a) {
+                int32_t expected = -1;
+                for (uint32_t k = 0; k < i && k + 1 < m; ++k)
+                    if (p[k] == a) expected = (int32_t)k;
+                assert(bad_char_rightmost(&table, (uint8_t)a, (int32_t)i) == expected);
+            }
+        }
+        dealloc_bad_char_table(&table);
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    check_table((uint8_t *)"", 0);
+    check_table((uint8_t *)"a", 1);
+    check_table((uint8_t *)"mississippi", 11);
+    uint8_t p[100];
+    for (uint32_t q = 0; q < 50; ++q) {
+        uint32_t m = 1 + rand() % 100;
+        for (uint32_t i = 0; i < m; ++i)
+            p[i] = q % 2 ? "acgt"[rand() % 4] : 1 + rand() % 255;
+        check_table(p, m);
+    }
+
+    return EXIT_SUCCESS;
+}
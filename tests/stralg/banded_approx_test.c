@@ -0,0 +1,127 @@
+#include <suffix_tree.h>
+#include <cigar.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+
+// Counts the edits in an alignment of the pattern against x
+// and checks that it uses all of the pattern and exactly
+// length letters of x.
+static uint32_t alignment_edits(
+    const char *cigar,
+    const uint8_t *p, uint32_t m,
+    const uint8_t *x, uint32_t length
+) {
+    uint32_t edits = 0, i = 0, j = 0;
+    while (*cigar) {
+        uint32_t count = (uint32_t)strtoul(cigar, (char **)&cigar, 10);
+        char op = *cigar++;
+        for (uint32_t k = 0; k < count; ++k) {
+            switch (op) {
+                case 'M': edits += p[i++] != x[j++]; break;
+                case 'I': edits++; i++; break;
+                case 'D': edits++; j++; break;
+                default: assert(false);
+            }
+        }
+    }
+    assert(i == m);
+    assert(j == length);
+    return edits;
+}
+
+static void check_pattern(
+    struct suffix_tree *st,
+    struct st_banded_approx_iter *banded,
+    const uint8_t *p,
+    uint32_t edits
+) {
+    uint32_t n = st->length - 1; // without the sentinel
+    uint32_t m = (uint32_t)strlen((char *)p);
+    uint32_t width = m + edits + 1;
+    int *best = malloc((size_t)st->length * width * sizeof(*best));
+    for (size_t i = 0; i < (size_t)st->length * width; ++i)
+        best[i] = INT_MAX;
+
+    // The best number of edits for each position and length,
+    // from the scripts the old iterator enumerates. It can
+    // substitute the sentinel, which we don't want.
+    struct st_approx_match_iter iter;
+    struct st_approx_match match;
+    init_st_approx_iter(&iter, st, p, (int)edits);
+    uint32_t expected = 0;
+    while (next_st_approx_match(&iter, &match)) {
+        if (match.match_label + match.match_depth > n) continue;
+        int e = (int)alignment_edits(match.cigar, p, m,
+                                     st->string + match.match_label,
+                                     match.match_depth);
+        int *b = &best[(size_t)match.match_label * width + match.match_depth];
+        if (*b == INT_MAX) expected++;
+        if (e < *b) *b = e;
+    }
+    dealloc_st_approx_iter(&iter);
+
+    reset_st_banded_approx_iter(banded, p);
+    struct st_banded_approx_match bmatch;
+    char *cigar = malloc(2 * (m + edits) + 1);
+    uint32_t found = 0;
+    while (next_st_banded_approx_match(banded, &bmatch)) {
+        assert(bmatch.match_depth < width);
+        int *b = &best[(size_t)bmatch.match_label * width + bmatch.match_depth];
+        assert(*b != INT_MAX);         // the old iterator has it
+        assert(*b == (int)bmatch.edits); // with the same edits
+        *b = -1;                       // and only once
+        found++;
+
+        st_banded_approx_cigar(banded, cigar);
+        assert(alignment_edits(cigar, p, m,
+                               st->string + bmatch.match_label,
+                               bmatch.match_depth) == bmatch.edits);
+    }
+    assert(found == expected);
+
+    free(cigar);
+    free(best);
+}
+
+static void test_string(const uint8_t *x, const char *alphabet)
+{
+    struct suffix_tree *st = naive_suffix_tree(x);
+    uint32_t k = (uint32_t)strlen(alphabet);
+    uint8_t p[9];
+    for (uint32_t edits = 0; edits <= 2; ++edits) {
+        struct st_banded_approx_iter iter;
+        init_st_banded_approx_iter(&iter, st, (uint8_t *)"", edits);
+        for (uint32_t q = 0; q < 20; ++q) {
+            uint32_t m = rand() % 8;
+            for (uint32_t i = 0; i < m; ++i)
+                p[i] = alphabet[rand() % k];
+            p[m] = '\0';
+            check_pattern(st, &iter, p, edits);
+        }
+        dealloc_st_banded_approx_iter(&iter);
+    }
+    free_suffix_tree(st);
+}
+
+int main(int argc, const char **argv)
+{
+    test_string((uint8_t *)"mississippi", "imps");
+    test_string((uint8_t *)"aaaaaaaaaaaaaaaa", "ab");
+    test_string((uint8_t *)"a", "ab");
+
+    uint32_t n = 200;
+    uint8_t *x = malloc(n + 1);
+    for (uint32_t rep = 0; rep < 4; ++rep) {
+        for (uint32_t i = 0; i < n; ++i)
+            x[i] = "acgt"[rand() % (rep + 1)];
+        x[n] = '\0';
+        test_string(x, "acgt");
+    }
+    free(x);
+
+    return EXIT_SUCCESS;
+}
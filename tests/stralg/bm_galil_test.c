@@ -0,0 +1,85 @@
+#include <match.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+// Repeats of a short unit with a few mutations, like the
+// satellite repeats where the Galil rule matters. Patterns from
+// the repeat occur at every period, so after each occurrence
+// we shift by the period and skip the known prefix.
+static void test_periodic(uint32_t n, uint32_t unit, uint32_t mutations)
+{
+    uint8_t *x = malloc(n);
+    uint8_t u[unit];
+    for (uint32_t i = 0; i < unit; ++i)
+        u[i] = "acgt"[rand() % 4];
+    for (uint32_t i = 0; i < n; ++i)
+        x[i] = u[i % unit];
+    for (uint32_t k = 0; k < mutations; ++k)
+        x[rand() % n] = "acgt"[rand() % 4];
+
+    uint8_t p[100];
+    for (uint32_t q = 0; q < 50; ++q) {
+        uint32_t m = 1 + rand() % 100;
+        if (m > n) m = n;
+        for (uint32_t i = 0; i < m; ++i)
+            p[i] = u[(q + i) % unit];
+        if (rand() % 2) p[rand() % m] = "acgt"[rand() % 4];
+
+        struct bm_galil_match_iter iter;
+        struct match match;
+        init_bm_galil_match_iter(&iter, x, n, p, m);
+        for (uint32_t j = 0; j + m <= n; ++j) {
+            if (memcmp(x + j, p, m) != 0) continue;
+            assert(next_bm_galil_match(&iter, &match));
+            assert(match.pos == j);
+        }
+        assert(!next_bm_galil_match(&iter, &match));
+        dealloc_bm_galil_match_iter(&iter);
+    }
+    free(x);
+}
+
+// On a mismatch at the last letter, the good suffix jump moves
+// the rightmost earlier letter that differs from it into place.
+// The last index used to reset this jump to zero.
+static void check_last_jump(const uint8_t *p)
+{
+    uint32_t m = (uint32_t)strlen((char *)p);
+    uint32_t expected = 0;
+    for (uint32_t k = 0; k + 1 < m; ++k)
+        if (p[k] != p[m - 1]) expected = m - 1 - k;
+
+    struct bm_match_iter iter;
+    init_bm_match_iter(&iter, p, m, p, m);
+    assert(iter.jump[m - 1] == expected);
+    dealloc_bm_match_iter(&iter);
+}
+
+int main(int argc, const char **argv)
+{
+    check_last_jump((uint8_t *)"issi");
+    check_last_jump((uint8_t *)"abcd");
+    check_last_jump((uint8_t *)"abab");
+    check_last_jump((uint8_t *)"aaab");
+    check_last_jump((uint8_t *)"aaaa"); // no such letter, so zero
+    check_last_jump((uint8_t *)"a");
+    uint8_t p[21];
+    for (uint32_t q = 0; q < 100; ++q) {
+        uint32_t m = 1 + rand() % 20;
+        for (uint32_t i = 0; i < m; ++i)
+            p[i] = "ab"[rand() % 2];
+        p[m] = '\0';
+        check_last_jump(p);
+    }
+
+    uint32_t units[] = { 1, 2, 3, 7, 20 };
+    for (uint32_t u = 0; u < sizeof(units) / sizeof(*units); ++u) {
+        test_periodic(1000, units[u], 0);
+        test_periodic(1000, units[u], 5);
+    }
+
+    return EXIT_SUCCESS;
+}
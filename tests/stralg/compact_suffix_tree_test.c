@@ -0,0 +1,109 @@
+
+#include <suffix_tree.h>
+#include <suffix_array.h>
+#include <string_utils.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+static void check_sa_and_lcp(
+    struct compact_suffix_tree *cst,
+    const uint32_t *sa,
+    const uint32_t *lcp
+) {
+    uint32_t n = cst->length;
+    uint32_t *other_sa = malloc(n * sizeof(*other_sa));
+    uint32_t *other_lcp = malloc(n * sizeof(*other_lcp));
+    cst_compute_sa_and_lcp(cst, other_sa, other_lcp);
+    for (uint32_t i = 0; i < n; ++i) {
+        assert(sa[i] == other_sa[i]);
+        assert(lcp[i] == other_lcp[i]);
+    }
+    free(other_sa);
+    free(other_lcp);
+
+    // All inner nodes but the root must branch
+    assert(cst->no_inner_nodes <= (n > 1 ? n - 1 : 1));
+    assert(cst_bytes(cst) <= sizeof(*cst) + 20 * n);
+}
+
+// The compact tree must report the same positions, in the
+// same order, as the suffix array. (We don't compare with
+// the pointer based tree because it orders letters as
+// signed chars).
+static void check_search(
+    struct suffix_array *sa,
+    struct compact_suffix_tree *cst,
+    const uint8_t *pattern
+) {
+    struct sa_interval interval;
+    sa_batch_search(sa, 1, &pattern, &interval);
+    struct cst_search_iter iter;
+    struct st_search_match match;
+    init_cst_search_iter(&iter, cst, pattern);
+    for (uint32_t i = interval.L; i < interval.R; ++i) {
+        assert(next_cst_match(&iter, &match));
+        assert(match.pos == sa->array[i]);
+    }
+    assert(!next_cst_match(&iter, &match));
+    dealloc_cst_search_iter(&iter);
+}
+
+static void test_string(uint8_t *string)
+{
+    struct suffix_array *sa = qsort_sa_construction(string);
+    compute_lcp(sa);
+    uint32_t n = sa->length;
+
+    struct compact_suffix_tree *mccreight = mccreight_compact_suffix_tree(string);
+    struct compact_suffix_tree *from_lcp =
+        lcp_compact_suffix_tree(string, sa->array, sa->lcp);
+    assert(mccreight->length == n);
+    assert(mccreight->no_inner_nodes == from_lcp->no_inner_nodes);
+    check_sa_and_lcp(mccreight, sa->array, sa->lcp);
+    check_sa_and_lcp(from_lcp, sa->array, sa->lcp);
+
+    for (uint32_t i = 0; i < n - 1; i += 1 + n / 200) {
+        for (uint32_t m = 1; m <= 6 && i + m < n; ++m) {
+            uint8_t *p = str_copy_n(string + i, m);
+            check_search(sa, mccreight, p);
+            check_search(sa, from_lcp, p);
+            free(p);
+        }
+        // Whole suffixes end in leaves
+        check_search(sa, mccreight, string + i);
+    }
+    check_search(sa, mccreight, (uint8_t *)"");
+    check_search(sa, mccreight, (uint8_t *)"xyzzy");
+    assert(cst_search(mccreight, (uint8_t *)"xyzzy") == CST_NIL);
+
+    free_compact_suffix_tree(mccreight);
+    free_compact_suffix_tree(from_lcp);
+    free_suffix_array(sa);
+}
+
+int main(int argc, const char **argv)
+{
+    test_string((uint8_t *)"mississippi");
+    test_string((uint8_t *)"aaaaaaaaaaaaaaaa");
+    test_string((uint8_t *)"abababababababab");
+    test_string((uint8_t *)"a");
+    test_string((uint8_t *)"");
+
+    uint32_t n = 5000;
+    uint8_t *x = malloc(n + 1);
+    for (uint32_t rep = 0; rep < 4; ++rep) {
+        for (uint32_t i = 0; i < n; ++i)
+            x[i] = "acgt"[rand() % (rep + 1)];
+        x[n] = '\0';
+        test_string(x);
+    }
+    for (uint32_t i = 0; i < n; ++i)
+        x[i] = 1 + rand() % 255;
+    test_string(x);
+    free(x);
+
+    return EXIT_SUCCESS;
+}
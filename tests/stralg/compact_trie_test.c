@@ -0,0 +1,183 @@
+#include <trie.h>
+#include <aho_corasick.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+static int cmp_strings(const void *a, const void *b)
+{
+    return strcmp(*(const char **)a, *(const char **)b);
+}
+
+static void extract_label(
+    const struct compact_trie *trie,
+    uint32_t v,
+    char *buffer
+) {
+    uint32_t i = 0;
+    for (; v != 0; v = trie->parent[v])
+        buffer[i++] = (char)trie->in_edge_label[v];
+    buffer[i] = '\0';
+    for (uint32_t j = 0; j < i / 2; ++j) {
+        char tmp = buffer[j];
+        buffer[j] = buffer[i - 1 - j];
+        buffer[i - 1 - j] = tmp;
+    }
+}
+
+static void check_structure(const struct compact_trie *trie)
+{
+    for (uint32_t v = 0; v < trie->no_nodes; ++v) {
+        uint32_t prev = TRIE_NO_NODE;
+        for (uint32_t w = trie->children[v]; w != TRIE_NO_NODE; w = trie->sibling[w]) {
+            assert(w < trie->no_nodes);
+            assert(trie->parent[w] == v);
+            if (prev != TRIE_NO_NODE)
+                assert(trie->in_edge_label[prev] != trie->in_edge_label[w]);
+            prev = w;
+        }
+    }
+}
+
+static void test_patterns(
+    const char *alphabet,
+    uint32_t no_patterns,
+    uint32_t max_length
+) {
+    uint32_t k = (uint32_t)strlen(alphabet);
+    char **patterns = malloc(no_patterns * sizeof(*patterns));
+    struct trie *ptrie = alloc_trie();
+    struct compact_trie *incremental = alloc_compact_trie();
+    uint32_t no_unique = 0;
+    while (no_unique < no_patterns) {
+        uint32_t m = 1 + rand() % max_length;
+        char *p = malloc(m + 1);
+        for (uint32_t i = 0; i < m; ++i)
+            p[i] = alphabet[rand() % k];
+        p[m] = '\0';
+        if (string_in_trie(ptrie, (uint8_t *)p)) {
+            free(p);
+            continue;
+        }
+        add_string_to_trie(ptrie, (uint8_t *)p, (int)no_unique);
+        add_string_to_compact_trie(incremental, (uint8_t *)p, (int)no_unique);
+        patterns[no_unique++] = p;
+    }
+    check_structure(incremental);
+
+    char **sorted = malloc(no_patterns * sizeof(*sorted));
+    memcpy(sorted, patterns, no_patterns * sizeof(*sorted));
+    qsort(sorted, no_patterns, sizeof(*sorted), cmp_strings);
+    struct compact_trie *bulk =
+        build_compact_trie((const uint8_t **)sorted, no_patterns);
+    check_structure(bulk);
+    assert(bulk->no_nodes == incremental->no_nodes);
+    assert(bulk->size == bulk->no_nodes);
+
+    // Bulk children come sorted, and the nodes in depth first
+    // order, so a child comes right after its parent.
+    for (uint32_t v = 0; v < bulk->no_nodes; ++v) {
+        uint32_t w = bulk->children[v];
+        if (w == TRIE_NO_NODE) continue;
+        assert(w == v + 1);
+        for (; bulk->sibling[w] != TRIE_NO_NODE; w = bulk->sibling[w])
+            assert(bulk->in_edge_label[w] < bulk->in_edge_label[bulk->sibling[w]]);
+    }
+
+    char buffer[64];
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        uint32_t v = get_compact_trie_node(incremental, (uint8_t *)patterns[i]);
+        assert(v != TRIE_NO_NODE);
+        assert(incremental->string_label[v] == (int)i);
+        extract_label(incremental, v, buffer);
+        assert(strcmp(buffer, patterns[i]) == 0);
+
+        v = get_compact_trie_node(bulk, (uint8_t *)sorted[i]);
+        assert(v != TRIE_NO_NODE);
+        assert(bulk->string_label[v] == (int)i);
+        extract_label(bulk, v, buffer);
+        assert(strcmp(buffer, sorted[i]) == 0);
+    }
+
+    // Random strings are in all three tries or in none.
+    for (uint32_t q = 0; q < 1000; ++q) {
+        uint32_t m = 1 + rand() % max_length;
+        for (uint32_t i = 0; i < m; ++i)
+            buffer[i] = alphabet[rand() % k];
+        buffer[m] = '\0';
+        bool expected = string_in_trie(ptrie, (uint8_t *)buffer);
+        assert(string_in_compact_trie(incremental, (uint8_t *)buffer) == expected);
+        assert(string_in_compact_trie(bulk, (uint8_t *)buffer) == expected);
+    }
+
+    // The automata find the same matches. The bulk trie
+    // has the labels of the sorted patterns.
+    uint32_t n = 2000;
+    uint8_t *x = malloc(n + 1);
+    for (uint32_t i = 0; i < n; ++i)
+        x[i] = (uint8_t)alphabet[rand() % k];
+    x[n] = '\0';
+    struct ac_automaton *acs[] = {
+        alloc_ac_automaton(ptrie, AC_AUTO_LAYOUT),
+        alloc_ac_automaton_from_compact_trie(incremental, AC_DENSE_LAYOUT),
+        alloc_ac_automaton_from_compact_trie(bulk, AC_SPARSE_LAYOUT)
+    };
+    struct ac_automaton_iter iters[3];
+    for (uint32_t a = 0; a < 3; ++a)
+        init_ac_automaton_iter(&iters[a], acs[a], x, n);
+    struct ac_match matches[3];
+    for (;;) {
+        bool more = next_ac_automaton_match(&iters[0], &matches[0]);
+        assert(next_ac_automaton_match(&iters[1], &matches[1]) == more);
+        assert(next_ac_automaton_match(&iters[2], &matches[2]) == more);
+        if (!more) break;
+        assert(matches[1].string_label == matches[0].string_label);
+        assert(matches[1].index == matches[0].index);
+        assert(strcmp(sorted[matches[2].string_label],
+                      patterns[matches[0].string_label]) == 0);
+        assert(matches[2].index == matches[0].index);
+    }
+    for (uint32_t a = 0; a < 3; ++a) {
+        dealloc_ac_automaton_iter(&iters[a]);
+        free_ac_automaton(acs[a]);
+    }
+    free(x);
+
+    free_compact_trie(bulk);
+    free_compact_trie(incremental);
+    free_trie(ptrie);
+    for (uint32_t i = 0; i < no_patterns; ++i)
+        free(patterns[i]);
+    free(patterns);
+    free(sorted);
+}
+
+int main(int argc, const char **argv)
+{
+    // An empty bulk trie is just the root.
+    struct compact_trie *trie = build_compact_trie(0, 0);
+    assert(trie->no_nodes == 1);
+    assert(!string_in_compact_trie(trie, (uint8_t *)"a"));
+    free_compact_trie(trie);
+
+    // One pattern that is a prefix of the next.
+    const uint8_t *prefixes[] = {
+        (uint8_t *)"ab", (uint8_t *)"abc", (uint8_t *)"abd", (uint8_t *)"b"
+    };
+    trie = build_compact_trie(prefixes, 4);
+    assert(trie->no_nodes == 6);
+    for (uint32_t i = 0; i < 4; ++i)
+        assert(string_in_compact_trie(trie, prefixes[i]));
+    assert(!string_in_compact_trie(trie, (uint8_t *)"a"));
+    free_compact_trie(trie);
+
+    for (uint32_t rep = 0; rep < 10; ++rep) {
+        test_patterns("ab", 20, 6);
+        test_patterns("acgt", 300, 12);
+        test_patterns("abcdefghijklmnopqrstuvwxyz", 200, 8);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+
+#include <compressed_suffix_array.h>
+#include <suffix_array.h>
+#include <remap.h>
+#include <string_utils.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+
+static void test_access(
+    struct suffix_array *sa,
+    struct compressed_suffix_array *csa
+) {
+    compute_inverse(sa);
+    for (uint32_t i = 0; i < sa->length; ++i) {
+        uint32_t pos = sa->array[i] + 1;
+        if (pos == sa->length) pos = 0;
+        assert(csa_psi(csa, i) == sa->inverse[pos]);
+        assert(csa_row_letter(csa, i) == sa->string[sa->array[i]]);
+        assert(csa_lookup(csa, i) == sa->array[i]);
+    }
+}
+
+static void test_search(
+    struct suffix_array *sa,
+    struct compressed_suffix_array *csa,
+    const uint8_t *pattern
+) {
+    struct sa_interval interval;
+    sa_batch_search(sa, 1, &pattern, &interval);
+
+    struct csa_match_iter iter;
+    struct sa_match match;
+    init_csa_match_iter(&iter, pattern, csa);
+    assert(iter.L == interval.L);
+    assert(iter.R == interval.R);
+    uint32_t i = interval.L;
+    while (next_csa_match(&iter, &match)) {
+        assert(match.position == sa->array[i]);
+        i++;
+    }
+    assert(i == interval.R);
+    dealloc_csa_match_iter(&iter);
+}
+
+static void test_string(
+    uint8_t *string,
+    uint32_t alphabet_size,
+    uint32_t sample_rate
+) {
+    struct suffix_array *sa = sa_is_construction(string, alphabet_size);
+    struct compressed_suffix_array *csa =
+        csa_construction(sa, alphabet_size, sample_rate);
+    assert(sa->inverse == 0); // the construction should clean up
+
+    test_access(sa, csa);
+
+    uint32_t n = sa->length - 1;
+    for (uint32_t i = 0; i < n; ++i) {
+        for (uint32_t m = 1; m <= 6 && i + m <= n; ++m) {
+            uint8_t *p = str_copy_n(string + i, m);
+            test_search(sa, csa, p);
+            free(p);
+        }
+    }
+    // A pattern that isn't in the string
+    uint8_t missing[] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0 };
+    test_search(sa, csa, missing);
+
+    free_compressed_suffix_array(csa);
+    free_suffix_array(sa);
+}
+
+int main(int argc, const char **argv)
+{
+    uint8_t *string = (uint8_t *)"mississippi";
+    uint8_t remapped[strlen((char *)string) + 1];
+    uint32_t alphabet_size = remap_string(remapped, string);
+    for (uint32_t s = 1; s <= 4; ++s) {
+        test_string(remapped, alphabet_size, s);
+    }
+
+    // Unmapped, so the alphabet is all bytes
+    test_string((uint8_t *)"ababacabacabbacab", 256, 3);
+
+    // Random strings over a small alphabet, long enough to
+    // span many Psi blocks.
+    uint32_t n = 2000;
+    uint8_t *x = malloc(n + 1);
+    for (uint32_t rep = 0; rep < 3; ++rep) {
+        for (uint32_t i = 0; i < n; ++i)
+            x[i] = 1 + rand() % 4;
+        x[n] = 0;
+        test_string(x, 5, 1 + rep * 7);
+    }
+    // and over bytes
+    for (uint32_t i = 0; i < n; ++i)
+        x[i] = 1 + rand() % 255;
+    x[n] = 0;
+    test_string(x, 256, 16);
+    free(x);
+
+    return EXIT_SUCCESS;
+}
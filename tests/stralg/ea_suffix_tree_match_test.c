@@ -116,6 +116,23 @@ static void test_suffix_tree_match(struct index_vector *naive_matches,
     
     free_index_vector(st_matches);
     
+    // Reusing the iterator for several searches must
+    // give us the same matches.
+    st_matches = alloc_index_vector(100);
+    init_ea_st_search_iter(&search_iter, st, not_here);
+    reset_ea_st_search_iter(&search_iter, st, pattern);
+    while (next_ea_st_match(&search_iter, &search_match)) {
+        index_vector_append(st_matches, search_match.pos);
+    }
+    reset_ea_st_search_iter(&search_iter, st, not_here);
+    assert(!next_ea_st_match(&search_iter, &search_match));
+    reset_ea_st_search_iter(&search_iter, st, pattern);
+    assert(next_ea_st_match(&search_iter, &search_match));
+    dealloc_ea_st_search_iter(&search_iter);
+    
+    sort_index_vector(st_matches);
+    assert(index_vector_equal(naive_matches, st_matches));
+    free_index_vector(st_matches);
 }
 
 static void test_matching(const uint8_t *pattern, uint8_t *string) {
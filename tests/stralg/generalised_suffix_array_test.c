@@ -0,0 +1,144 @@
+
+#include <generalised_suffix_array.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+
+static void test_order(struct generalised_suffix_array *gsa)
+{
+    // Suffixes compare as if each zero was a unique sentinel,
+    // so strcmp gives the order except when the suffixes are
+    // identical up to their sentinels. Then the sentinel of the
+    // last string comes first and the others come in order.
+    struct suffix_array *sa = gsa->sa;
+    for (uint32_t i = 1; i < sa->length; ++i) {
+        uint32_t a = sa->array[i-1], b = sa->array[i];
+        int cmp = strcmp((char *)sa->string + a, (char *)sa->string + b);
+        assert(cmp <= 0);
+        if (cmp == 0) {
+            uint32_t last = gsa->no_strings - 1;
+            uint32_t sa_idx = gsa_string_index(gsa, a);
+            uint32_t sb_idx = gsa_string_index(gsa, b);
+            assert(sa_idx != sb_idx);
+            assert(sa_idx == last || (sb_idx != last && sa_idx < sb_idx));
+        }
+    }
+}
+
+static void test_positions(
+    struct generalised_suffix_array *gsa,
+    uint32_t no_strings,
+    const uint8_t **strings
+) {
+    uint32_t pos = 0;
+    for (uint32_t k = 0; k < no_strings; ++k) {
+        uint32_t n = (uint32_t)strlen((char *)strings[k]);
+        for (uint32_t i = 0; i <= n; ++i, ++pos) {
+            uint32_t idx, offset;
+            gsa_position(gsa, pos, &idx, &offset);
+            assert(idx == k);
+            assert(offset == i);
+            assert(gsa->sa->string[pos] == strings[k][i]);
+        }
+    }
+    assert(pos == gsa->sa->length);
+}
+
+static uint32_t count_occurrences(
+    uint32_t no_strings,
+    const uint8_t **strings,
+    const uint8_t *pattern
+) {
+    uint32_t m = (uint32_t)strlen((char *)pattern);
+    uint32_t count = 0;
+    for (uint32_t k = 0; k < no_strings; ++k) {
+        uint32_t n = (uint32_t)strlen((char *)strings[k]);
+        for (uint32_t i = 0; i + m <= n; ++i) {
+            if (strncmp((char *)strings[k] + i, (char *)pattern, m) == 0)
+                count++;
+        }
+    }
+    return count;
+}
+
+static void test_search(
+    struct generalised_suffix_array *gsa,
+    uint32_t no_strings,
+    const uint8_t **strings,
+    const uint8_t *pattern
+) {
+    uint32_t m = (uint32_t)strlen((char *)pattern);
+    struct gsa_match_iter iter;
+    struct gsa_match match;
+    uint32_t count = 0;
+    init_gsa_match_iter(&iter, pattern, gsa);
+    while (next_gsa_match(&iter, &match)) {
+        assert(match.string_index < no_strings);
+        const uint8_t *x = strings[match.string_index];
+        assert(strlen((char *)x) >= match.offset + m);
+        assert(strncmp((char *)x + match.offset, (char *)pattern, m) == 0);
+        count++;
+    }
+    dealloc_gsa_match_iter(&iter);
+    assert(count == count_occurrences(no_strings, strings, pattern));
+}
+
+static void test_lcp(struct generalised_suffix_array *gsa)
+{
+    struct suffix_array *sa = gsa->sa;
+    compute_lcp(sa);
+    assert(sa->lcp[0] == 0);
+    for (uint32_t i = 1; i < sa->length; ++i) {
+        const uint8_t *a = sa->string + sa->array[i-1];
+        const uint8_t *b = sa->string + sa->array[i];
+        uint32_t l = 0;
+        while (a[l] && a[l] == b[l]) ++l;
+        assert(sa->lcp[i] == l);
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    const uint8_t *strings[] = {
+        (const uint8_t *)"mississippi",
+        (const uint8_t *)"",
+        (const uint8_t *)"ississ",
+        (const uint8_t *)"sip",
+        (const uint8_t *)"mississippi",
+        (const uint8_t *)"pi"
+    };
+    uint32_t no_strings = sizeof(strings) / sizeof(*strings);
+
+    struct generalised_suffix_array *gsa = gsa_construction(no_strings, strings);
+    print_suffix_array(gsa->sa);
+
+    test_order(gsa);
+    test_positions(gsa, no_strings, strings);
+    test_lcp(gsa);
+
+    const char *patterns[] = {
+        "i", "s", "p", "ss", "issi", "sip", "pi", "ippi", "mississippi",
+        "x", "pix", "mississippis", "sipi"
+    };
+    uint32_t no_patterns = sizeof(patterns) / sizeof(*patterns);
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        test_search(gsa, no_strings, strings, (const uint8_t *)patterns[i]);
+    }
+    free_generalised_suffix_array(gsa);
+
+    // A single string should give us the usual suffix array
+    const uint8_t *single[] = { (const uint8_t *)"ababacabac" };
+    gsa = gsa_construction(1, single);
+    struct suffix_array *sa = qsort_sa_construction((uint8_t *)single[0]);
+    assert(gsa->sa->length == sa->length);
+    for (uint32_t i = 0; i < sa->length; ++i) {
+        assert(gsa->sa->array[i] == sa->array[i]);
+    }
+    free_suffix_array(sa);
+    free_generalised_suffix_array(gsa);
+
+    return EXIT_SUCCESS;
+}
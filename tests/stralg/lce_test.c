@@ -0,0 +1,113 @@
+#include <lce.h>
+#include <suffix_tree.h>
+#include <suffix_array.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+static void test_rmq(uint32_t n)
+{
+    uint32_t *values = malloc((n ? n : 1) * sizeof(*values));
+    for (uint32_t i = 0; i < n; ++i)
+        values[i] = rand() % 100;
+    struct rmq_table rmq;
+    init_rmq_table(&rmq, values, n);
+
+    uint32_t no_queries = n < 100 ? n * n : 10000;
+    for (uint32_t q = 0; q < no_queries; ++q) {
+        uint32_t i = rand() % n, j = rand() % n;
+        if (i > j) { uint32_t tmp = i; i = j; j = tmp; }
+        uint32_t min = values[i];
+        for (uint32_t k = i; k <= j; ++k)
+            if (values[k] < min) min = values[k];
+        uint32_t k = rmq_index(&rmq, i, j);
+        assert(i <= k && k <= j);
+        assert(values[k] == min);
+    }
+
+    dealloc_rmq_table(&rmq);
+    free(values);
+}
+
+static uint32_t naive_lce(const uint8_t *x, uint32_t i, uint32_t j)
+{
+    uint32_t l = 0;
+    while (x[i + l] && x[i + l] == x[j + l]) l++;
+    return l;
+}
+
+static bool is_ancestor(
+    const struct suffix_tree_node *u,
+    const struct suffix_tree_node *v
+) {
+    for (;;) {
+        if (u == v) return true;
+        if (v->parent == v) return false;
+        v = v->parent;
+    }
+}
+
+static const struct suffix_tree_node *
+naive_lca(
+    const struct suffix_tree_node *u,
+    const struct suffix_tree_node *v
+) {
+    while (!is_ancestor(u, v))
+        u = u->parent;
+    return u;
+}
+
+static void test_string(const uint8_t *x)
+{
+    struct suffix_tree *st = mccreight_suffix_tree(x);
+    struct suffix_array *sa = qsort_sa_construction((uint8_t *)x);
+    struct st_lca *lca = alloc_st_lca(st);
+    struct sa_lce *lce = alloc_sa_lce(sa);
+    uint32_t n = st->length; // including the sentinel
+
+    for (uint32_t i = 0; i < n; ++i) {
+        for (uint32_t j = 0; j < n; j += 1 + n / 50) {
+            uint32_t expected = naive_lce(x, i, j);
+            assert(st_lce(lca, i, j) == expected);
+            assert(sa_lce(lce, i, j) == expected);
+        }
+    }
+
+    uint32_t no_nodes = (uint32_t)(st->pool.next_node - st->pool.nodes);
+    for (uint32_t q = 0; q < 1000; ++q) {
+        const struct suffix_tree_node *u = st->pool.nodes + rand() % no_nodes;
+        const struct suffix_tree_node *v = st->pool.nodes + rand() % no_nodes;
+        assert(st_lca(lca, u, v) == naive_lca(u, v));
+    }
+
+    free_st_lca(lca);
+    free_sa_lce(lce);
+    free_suffix_array(sa);
+    free_suffix_tree(st);
+}
+
+int main(int argc, const char **argv)
+{
+    uint32_t sizes[] = { 1, 2, 31, 32, 33, 64, 65, 1000, 5000 };
+    for (uint32_t k = 0; k < sizeof(sizes) / sizeof(*sizes); ++k)
+        test_rmq(sizes[k]);
+
+    test_string((uint8_t *)"mississippi");
+    test_string((uint8_t *)"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");
+    test_string((uint8_t *)"a");
+    test_string((uint8_t *)"");
+
+    uint32_t n = 2000;
+    uint8_t *x = malloc(n + 1);
+    for (uint32_t rep = 0; rep < 4; ++rep) {
+        for (uint32_t i = 0; i < n; ++i)
+            x[i] = "acgt"[rand() % (rep + 1)];
+        x[n] = '\0';
+        test_string(x);
+    }
+    free(x);
+
+    return EXIT_SUCCESS;
+}
@@ -284,6 +284,12 @@ static void simple_exact_matchers(struct index_vector *naive,
     struct index_vector kmp;    init_index_vector(&kmp, 10);
     struct index_vector bmh;    init_index_vector(&bmh, 10);
     struct index_vector bm;     init_index_vector(&bm, 10);
+    struct index_vector simd;   init_index_vector(&simd, 10);
+    struct index_vector shift_or; init_index_vector(&shift_or, 10);
+    struct index_vector bndm;   init_index_vector(&bndm, 10);
+    struct index_vector bmh_flat; init_index_vector(&bmh_flat, 10);
+    struct index_vector bm_flat; init_index_vector(&bm_flat, 10);
+    struct index_vector bm_galil; init_index_vector(&bm_galil, 10);
     
     struct index_vector real_naive; init_index_vector(&real_naive, 10);
     
@@ -374,6 +380,66 @@ static void simple_exact_matchers(struct index_vector *naive,
               (iter_dealloc_func)dealloc_bm_match_iter,
               &bm
               );
+    printf("SIMD filter.\n");
+    struct simd_match_iter simd_iter;
+    iter_test(
+              string, pattern,
+              &simd_iter,
+              (iter_init_func)init_simd_match_iter,
+              (iteration_func)next_simd_match,
+              (iter_dealloc_func)dealloc_simd_match_iter,
+              &simd
+              );
+    printf("Shift-Or algorithm.\n");
+    struct shift_or_match_iter shift_or_iter;
+    iter_test(
+              string, pattern,
+              &shift_or_iter,
+              (iter_init_func)init_shift_or_match_iter,
+              (iteration_func)next_shift_or_match,
+              (iter_dealloc_func)dealloc_shift_or_match_iter,
+              &shift_or
+              );
+    printf("BNDM algorithm.\n");
+    struct bndm_match_iter bndm_iter;
+    iter_test(
+              string, pattern,
+              &bndm_iter,
+              (iter_init_func)init_bndm_match_iter,
+              (iteration_func)next_bndm_match,
+              (iter_dealloc_func)dealloc_bndm_match_iter,
+              &bndm
+              );
+    printf("BMH algorithm with a flat table.\n");
+    struct bmh_flat_match_iter bmh_flat_iter;
+    iter_test(
+              string, pattern,
+              &bmh_flat_iter,
+              (iter_init_func)init_bmh_flat_match_iter,
+              (iteration_func)next_bmh_flat_match,
+              (iter_dealloc_func)dealloc_bmh_flat_match_iter,
+              &bmh_flat
+              );
+    printf("BM algorithm with a flat table.\n");
+    struct bm_flat_match_iter bm_flat_iter;
+    iter_test(
+              string, pattern,
+              &bm_flat_iter,
+              (iter_init_func)init_bm_flat_match_iter,
+              (iteration_func)next_bm_flat_match,
+              (iter_dealloc_func)dealloc_bm_flat_match_iter,
+              &bm_flat
+              );
+    printf("BM algorithm with the Galil rule.\n");
+    struct bm_galil_match_iter bm_galil_iter;
+    iter_test(
+              string, pattern,
+              &bm_galil_iter,
+              (iter_init_func)init_bm_galil_match_iter,
+              (iteration_func)next_bm_galil_match,
+              (iter_dealloc_func)dealloc_bm_galil_match_iter,
+              &bm_galil
+              );
 
     printf("NAIVE =====================================\n");
     for (uint32_t i = 0; i < naive->used; ++i) {
@@ -391,11 +457,23 @@ static void simple_exact_matchers(struct index_vector *naive,
     assert(index_vector_equal(naive, &kmp));
     assert(index_vector_equal(naive, &bmh));
     assert(index_vector_equal(naive, &bm));
+    assert(index_vector_equal(naive, &simd));
+    assert(index_vector_equal(naive, &shift_or));
+    assert(index_vector_equal(naive, &bndm));
+    assert(index_vector_equal(naive, &bmh_flat));
+    assert(index_vector_equal(naive, &bm_flat));
+    assert(index_vector_equal(naive, &bm_galil));
     
     dealloc_index_vector(&border);
     dealloc_index_vector(&kmp);
     dealloc_index_vector(&bmh);
     dealloc_index_vector(&bm);
+    dealloc_index_vector(&simd);
+    dealloc_index_vector(&shift_or);
+    dealloc_index_vector(&bndm);
+    dealloc_index_vector(&bmh_flat);
+    dealloc_index_vector(&bm_flat);
+    dealloc_index_vector(&bm_galil);
 }
 
 bool suffix_array_equal(struct suffix_array *sa1,
@@ -663,6 +741,67 @@ static void match_test(const uint8_t *pattern, uint8_t *string)
 
 
 
+// Random texts with patterns that are half from the text, so
+// we get hits, and half random. The text lengths are around the
+// SIMD block sizes so we also test the tails.
+static void random_pattern_test(const uint8_t *x, uint32_t n, uint32_t m)
+{
+    uint8_t p[m + 1];
+    if (m <= n && rand() % 2) {
+        memcpy(p, x + rand() % (n - m + 1), m);
+    } else {
+        for (uint32_t i = 0; i < m; ++i)
+            p[i] = "acgt"[rand() % 4];
+    }
+    p[m] = '\0';
+
+    struct index_vector naive; init_index_vector(&naive, 10);
+    struct naive_match_iter naive_iter;
+    iter_test(
+              x, p,
+              &naive_iter,
+              (iter_init_func)init_naive_match_iter,
+              (iteration_func)next_naive_match,
+              (iter_dealloc_func)dealloc_naive_match_iter,
+              &naive
+              );
+    simple_exact_matchers(&naive, p, x);
+    dealloc_index_vector(&naive);
+}
+
+static void random_match_tests(void)
+{
+    uint32_t sizes[] = { 1, 15, 16, 17, 31, 32, 33, 64, 100, 1000 };
+    uint32_t no_sizes = sizeof(sizes) / sizeof(*sizes);
+    for (uint32_t s = 0; s < no_sizes; ++s) {
+        uint32_t n = sizes[s];
+        uint8_t x[n + 1];
+        for (uint32_t rep = 0; rep < 4; ++rep) {
+            for (uint32_t i = 0; i < n; ++i)
+                x[i] = "acgt"[rand() % (rep + 1)];
+            x[n] = '\0';
+            for (uint32_t q = 0; q < 10; ++q)
+                random_pattern_test(x, n, 1 + rand() % 40);
+        }
+    }
+
+    // Patterns on both sides of one and two 64-bit words
+    // for the bit-parallel matchers.
+    uint32_t lengths[] = { 63, 64, 65, 128, 129 };
+    uint32_t no_lengths = sizeof(lengths) / sizeof(*lengths);
+    uint32_t n = 1000;
+    uint8_t x[n + 1];
+    for (uint32_t rep = 0; rep < 4; ++rep) {
+        for (uint32_t i = 0; i < n; ++i)
+            x[i] = "acgt"[rand() % (rep + 1)];
+        x[n] = '\0';
+        for (uint32_t l = 0; l < no_lengths; ++l)
+            for (uint32_t q = 0; q < 4; ++q)
+                random_pattern_test(x, n, lengths[l]);
+    }
+}
+
+
 int main(int argc, char * argv[])
 {
     if (argc == 3) {
@@ -702,6 +841,7 @@ int main(int argc, char * argv[])
                 match_test((uint8_t *)patterns[i], (uint8_t *)strings[j]);
             }
         }
+        random_match_tests();
 
     }
     
@@ -0,0 +1,201 @@
+#include <suffix_tree.h>
+#include <suffix_array.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+static uint32_t extension(
+    const uint8_t *x,
+    const uint8_t *y
+) {
+    uint32_t l = 0;
+    while (x[l] && y[l] && x[l] == y[l]) l++;
+    return l;
+}
+
+static uint32_t naive_ms(
+    const uint8_t *x, uint32_t n,
+    const uint8_t *y
+) {
+    uint32_t best = 0;
+    for (uint32_t j = 0; j < n; ++j) {
+        uint32_t l = extension(x + j, y);
+        if (l > best) best = l;
+    }
+    return best;
+}
+
+static uint32_t count_leaves(struct suffix_tree *st, struct suffix_tree_node *v)
+{
+    uint32_t count = 0;
+    struct st_leaf_iter iter;
+    struct st_leaf_iter_result res;
+    init_st_leaf_iter(&iter, st, v);
+    while (next_st_leaf(&iter, &res)) count++;
+    dealloc_st_leaf_iter(&iter);
+    return count;
+}
+
+static uint32_t count_occurrences(
+    const uint8_t *x, uint32_t n,
+    const uint8_t *p, uint32_t m
+) {
+    uint32_t count = 0;
+    for (uint32_t j = 0; j + m <= n; ++j)
+        if (strncmp((char *)x + j, (char *)p, m) == 0) count++;
+    return count;
+}
+
+static int cmp_mems(const void *a, const void *b)
+{
+    const struct st_mem *x = a, *y = b;
+    if (x->query_pos != y->query_pos)
+        return (x->query_pos > y->query_pos) - (x->query_pos < y->query_pos);
+    return (x->string_pos > y->string_pos) - (x->string_pos < y->string_pos);
+}
+
+static void check_query(
+    struct suffix_tree *st,
+    const uint8_t *query,
+    uint32_t min_length
+) {
+    const uint8_t *x = st->string;
+    uint32_t n = st->length - 1;
+    uint32_t m = (uint32_t)strlen((char *)query);
+    uint32_t *ms = malloc((m + 1) * sizeof(*ms));
+    // The iterators treat zero as one.
+    uint32_t min = min_length ? min_length : 1;
+
+    struct st_ms_iter ms_iter;
+    struct st_matching_statistic stat;
+    init_st_ms_iter(&ms_iter, st, query);
+    uint32_t i = 0;
+    while (next_st_ms(&ms_iter, &stat)) {
+        assert(stat.pos == i);
+        ms[i] = naive_ms(x, n, query + i);
+        assert(stat.length == ms[i]);
+        assert(stat.depth >= stat.length);
+        // The node must cover exactly the occurrences.
+        if (stat.length > 0) {
+            assert(count_leaves(st, stat.node) ==
+                   count_occurrences(x, n, query + i, stat.length));
+        } else {
+            assert(stat.node == st->root);
+        }
+        i++;
+    }
+    assert(i == m);
+    dealloc_st_ms_iter(&ms_iter);
+
+    // SMEMs
+    struct st_smem_iter smem_iter;
+    init_st_smem_iter(&smem_iter, st, query, min_length);
+    uint32_t expected_pos = 0;
+    while (next_st_smem(&smem_iter, &stat)) {
+        for (; expected_pos < stat.pos; ++expected_pos) {
+            bool smem = ms[expected_pos] >= min
+                && (expected_pos == 0 || ms[expected_pos - 1] <= ms[expected_pos]);
+            assert(!smem);
+        }
+        assert(stat.length == ms[stat.pos]);
+        assert(stat.length >= min);
+        assert(stat.pos == 0 || ms[stat.pos - 1] <= stat.length);
+        expected_pos = stat.pos + 1;
+    }
+    dealloc_st_smem_iter(&smem_iter);
+
+    // MEMs against all pairs of positions
+    uint32_t no_expected = 0, size = 16;
+    struct st_mem *expected = malloc(size * sizeof(*expected));
+    for (uint32_t q = 0; q < m; ++q) {
+        for (uint32_t j = 0; j < n; ++j) {
+            if (q > 0 && j > 0 && x[j - 1] == query[q - 1]) continue;
+            uint32_t l = extension(x + j, query + q);
+            if (l < min) continue;
+            if (no_expected == size) {
+                size *= 2;
+                expected = realloc(expected, size * sizeof(*expected));
+            }
+            expected[no_expected++] = (struct st_mem){ q, j, l };
+        }
+    }
+    uint32_t no_mems = 0;
+    struct st_mem *mems = malloc((no_expected + 1) * sizeof(*mems));
+    struct st_mem_iter mem_iter;
+    struct st_mem mem;
+    init_st_mem_iter(&mem_iter, st, query, min_length);
+    while (next_st_mem(&mem_iter, &mem)) {
+        assert(no_mems < no_expected);
+        mems[no_mems++] = mem;
+    }
+    dealloc_st_mem_iter(&mem_iter);
+    assert(no_mems == no_expected);
+    qsort(mems, no_mems, sizeof(*mems), cmp_mems);
+    qsort(expected, no_expected, sizeof(*expected), cmp_mems);
+    for (uint32_t k = 0; k < no_mems; ++k) {
+        assert(mems[k].query_pos == expected[k].query_pos);
+        assert(mems[k].string_pos == expected[k].string_pos);
+        assert(mems[k].length == expected[k].length);
+    }
+
+    free(mems);
+    free(expected);
+    free(ms);
+}
+
+static void test_string(const uint8_t *x, uint32_t no_queries)
+{
+    uint32_t n = (uint32_t)strlen((char *)x);
+    struct suffix_tree *trees[3];
+    trees[0] = mccreight_suffix_tree(x);
+    trees[1] = naive_suffix_tree(x);
+    annotate_suffix_links(trees[1]);
+    struct suffix_array *sa = qsort_sa_construction((uint8_t *)x);
+    compute_lcp(sa);
+    trees[2] = lcp_suffix_tree(x, sa->array, sa->lcp);
+    annotate_suffix_links(trees[2]);
+
+    uint8_t *query = malloc(101);
+    for (uint32_t q = 0; q < no_queries; ++q) {
+        // Pieces of the string with mutations, so we get
+        // both long matches and mismatches.
+        uint32_t m = 1 + rand() % 100;
+        for (uint32_t i = 0; i < m; ++i) {
+            if (n > 0 && rand() % 10)
+                query[i] = x[(q * 7 + i) % n];
+            else
+                query[i] = "acgt"[rand() % 4];
+        }
+        query[m] = '\0';
+        uint32_t min_length = rand() % 6;
+        for (uint32_t t = 0; t < 3; ++t)
+            check_query(trees[t], query, min_length);
+    }
+    free(query);
+
+    for (uint32_t t = 0; t < 3; ++t)
+        free_suffix_tree(trees[t]);
+    free_suffix_array(sa);
+}
+
+int main(int argc, const char **argv)
+{
+    test_string((uint8_t *)"mississippi", 20);
+    test_string((uint8_t *)"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", 20);
+    test_string((uint8_t *)"a", 5);
+    test_string((uint8_t *)"", 5);
+
+    uint32_t n = 300;
+    uint8_t *x = malloc(n + 1);
+    for (uint32_t rep = 0; rep < 4; ++rep) {
+        for (uint32_t i = 0; i < n; ++i)
+            x[i] = "acgt"[rand() % (rep + 1)];
+        x[n] = '\0';
+        test_string(x, 30);
+    }
+    free(x);
+
+    return EXIT_SUCCESS;
+}
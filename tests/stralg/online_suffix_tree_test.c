@@ -0,0 +1,147 @@
+#include <suffix_tree.h>
+#include <string_utils.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+static int cmp_positions(const void *a, const void *b)
+{
+    uint32_t i = *(const uint32_t *)a;
+    uint32_t j = *(const uint32_t *)b;
+    return (i > j) - (i < j);
+}
+
+// The online iterator must find the same positions as
+// naive matching in the text we have appended so far.
+static void check_search(
+    struct online_suffix_tree *ost,
+    const uint8_t *text,
+    uint32_t n,
+    const uint8_t *pattern
+) {
+    uint32_t m = (uint32_t)strlen((char *)pattern);
+    uint32_t *hits = malloc((n + 1) * sizeof(*hits));
+    uint32_t no_hits = 0;
+    struct online_st_search_iter iter;
+    struct st_search_match match;
+    init_online_st_search_iter(&iter, ost, pattern);
+    while (next_online_st_match(&iter, &match)) {
+        assert(no_hits <= n);
+        hits[no_hits++] = match.pos;
+    }
+    dealloc_online_st_search_iter(&iter);
+    qsort(hits, no_hits, sizeof(*hits), cmp_positions);
+
+    uint32_t k = 0;
+    for (uint32_t j = 0; j + m <= n; ++j) {
+        if (strncmp((char *)text + j, (char *)pattern, m) == 0) {
+            assert(k < no_hits);
+            assert(hits[k] == j);
+            k++;
+        }
+    }
+    assert(k == no_hits);
+    free(hits);
+}
+
+static void check_complete_tree(
+    struct suffix_tree *st,
+    const uint8_t *string
+) {
+    struct suffix_tree *expected = mccreight_suffix_tree(string);
+    assert(st->length == expected->length);
+    assert(strcmp((char *)st->string, (char *)string) == 0);
+
+    uint32_t n = st->length;
+    uint32_t *sa = malloc(n * sizeof(*sa));
+    uint32_t *lcp = malloc(n * sizeof(*lcp));
+    uint32_t *expected_sa = malloc(n * sizeof(*expected_sa));
+    uint32_t *expected_lcp = malloc(n * sizeof(*expected_lcp));
+    st_compute_sa_and_lcp(st, sa, lcp);
+    st_compute_sa_and_lcp(expected, expected_sa, expected_lcp);
+    for (uint32_t i = 0; i < n; ++i) {
+        assert(sa[i] == expected_sa[i]);
+        assert(lcp[i] == expected_lcp[i]);
+    }
+
+    // The finished tree is a single array, even when the
+    // pool grew, so we can index it and move it around.
+    assert(st->pool.chunks == 0);
+    st_build_child_index(st);
+    st_relayout(st, ST_LAYOUT_FAMILIES);
+    st_compute_sa_and_lcp(st, sa, lcp);
+    for (uint32_t i = 0; i < n; ++i) {
+        assert(sa[i] == expected_sa[i]);
+        assert(lcp[i] == expected_lcp[i]);
+    }
+    free(sa); free(lcp);
+    free(expected_sa); free(expected_lcp);
+    free_suffix_tree(expected);
+}
+
+// Appends the string in random chunks and searches after
+// each chunk. The small capacity forces the buffer and the
+// node pool to grow while we build the tree.
+static void test_string(
+    const uint8_t *string,
+    uint32_t capacity
+) {
+    uint32_t n = (uint32_t)strlen((char *)string);
+    struct online_suffix_tree *ost = alloc_online_suffix_tree(capacity);
+
+    uint32_t i = 0;
+    while (i < n) {
+        uint32_t chunk = 1 + rand() % 50;
+        if (i + chunk > n) chunk = n - i;
+        online_suffix_tree_append(ost, string + i, chunk);
+        i += chunk;
+
+        for (uint32_t j = 0; j < i; j += 1 + i / 10) {
+            for (uint32_t m = 1; m <= 5 && j + m <= i; ++m) {
+                uint8_t *p = str_copy_n(string + j, m);
+                check_search(ost, string, i, p);
+                free(p);
+            }
+        }
+        check_search(ost, string, i, (uint8_t *)"xyzzy");
+    }
+
+    struct suffix_tree *st = finish_online_suffix_tree(ost);
+    check_complete_tree(st, string);
+    free_complete_suffix_tree(st);
+}
+
+int main(int argc, const char **argv)
+{
+    test_string((uint8_t *)"mississippi", 0);
+    test_string((uint8_t *)"aaaaaaaaaaaaaaaa", 0);
+    test_string((uint8_t *)"abababababababab", 0);
+    test_string((uint8_t *)"abcabxabcd", 100);
+    test_string((uint8_t *)"a", 0);
+    test_string((uint8_t *)"", 0);
+
+    // We can free the tree without finishing it.
+    struct online_suffix_tree *ost = alloc_online_suffix_tree(0);
+    online_suffix_tree_append(ost, (uint8_t *)"banana", 6);
+    check_search(ost, (uint8_t *)"banana", 6, (uint8_t *)"ana");
+    free_online_suffix_tree(ost);
+
+    uint32_t n = 3000;
+    uint8_t *x = malloc(n + 1);
+    for (uint32_t rep = 0; rep < 4; ++rep) {
+        for (uint32_t i = 0; i < n; ++i)
+            x[i] = "acgt"[rand() % (rep + 1)];
+        x[n] = '\0';
+        test_string(x, rep * 1000);
+    }
+    // Stick to 7-bit letters; the pointer tree sorts
+    // children as signed chars.
+    for (uint32_t i = 0; i < n; ++i)
+        x[i] = 1 + rand() % 127;
+    test_string(x, n + 1);
+    free(x);
+
+    return EXIT_SUCCESS;
+}
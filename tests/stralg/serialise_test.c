@@ -10,6 +10,200 @@
 // zero-terminated so I use strnlen instead.
 #define MAX_STRLEN 1000000
 
+static void test_xxh64(void)
+{
+    // Reference values from the xxHash implementation
+    assert(xxh64("", 0, 0) == 0xEF46DB3751D8E999ULL);
+    assert(xxh64("a", 1, 0) == 0xD24EC4F1A98C6E5BULL);
+    assert(xxh64("abc", 3, 0) == 0x44BC2CF5AD770999ULL);
+    
+    // Streaming in odd-sized pieces must give the same as
+    // hashing everything in one go.
+    uint8_t data[1000];
+    for (uint32_t i = 0; i < sizeof(data); ++i)
+        data[i] = (uint8_t)(i * 31 + 7);
+    uint64_t expected = xxh64(data, sizeof(data), 42);
+    struct xxh64_state state;
+    init_xxh64(&state, 42);
+    for (uint32_t i = 0; i < sizeof(data); ) {
+        uint32_t chunk = 1 + i % 37;
+        if (i + chunk > sizeof(data)) chunk = sizeof(data) - i;
+        update_xxh64(&state, data + i, chunk);
+        i += chunk;
+    }
+    assert(digest_xxh64(&state) == expected);
+}
+
+static void test_container(void)
+{
+    FILE *f = tmpfile();
+    uint32_t kind = CONTAINER_TAG('T','E','S','T');
+    uint32_t numbers[] = { 1, 2, 3, 4, 5, 6, 7 };
+    const char *text = "hello, world";
+    
+    struct container_writer w;
+    init_container_writer(&w, f, kind);
+    write_container_section(&w, CONTAINER_TAG('N','U','M','S'),
+                            numbers, sizeof(numbers));
+    // a section written in pieces
+    begin_container_section(&w, CONTAINER_TAG('T','E','X','T'), strlen(text));
+    write_container_data(&w, text, 5);
+    write_container_data(&w, text + 5, strlen(text) - 5);
+    end_container_section(&w);
+    enum error_codes err;
+    // The calls go outside the asserts so they also run
+    // when NDEBUG is defined.
+    bool ok = finish_container(&w, &err);
+    assert(ok);
+    
+    rewind(f);
+    struct container_reader r;
+    ok = init_container_reader(&r, f, kind, true);
+    assert(ok);
+    uint32_t other_numbers[7];
+    ok = read_container_section(&r, CONTAINER_TAG('N','U','M','S'),
+                                other_numbers, sizeof(other_numbers));
+    assert(ok);
+    assert(memcmp(numbers, other_numbers, sizeof(numbers)) == 0);
+    uint64_t size;
+    char *other_text = read_container_section_alloc(&r, CONTAINER_TAG('T','E','X','T'), &size);
+    assert(size == strlen(text));
+    assert(strncmp(text, other_text, size) == 0);
+    free(other_text);
+    ok = finish_container_reader(&r, &err);
+    assert(ok);
+    assert(err == NO_ERROR);
+    
+    // Asking for the wrong kind or the wrong tag is an error
+    rewind(f);
+    ok = init_container_reader(&r, f, CONTAINER_TAG('O','T','H','R'), true);
+    assert(!ok);
+    ok = finish_container_reader(&r, &err);
+    assert(!ok);
+    assert(err == MALFORMED_FILE);
+    rewind(f);
+    init_container_reader(&r, f, kind, true);
+    ok = read_container_section(&r, CONTAINER_TAG('T','E','X','T'),
+                                other_numbers, sizeof(other_numbers));
+    assert(!ok);
+    ok = finish_container_reader(&r, &err);
+    assert(!ok);
+    assert(err == MALFORMED_FILE);
+    
+    fclose(f);
+}
+
+static uint8_t *load_file(const char *fname, long *size)
+{
+    FILE *f = fopen(fname, "rb");
+    assert(f);
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    rewind(f);
+    uint8_t *data = malloc(*size);
+    size_t read = fread(data, 1, *size, f);
+    assert(read == (size_t)*size);
+    fclose(f);
+    return data;
+}
+
+static void store_file(const char *fname, const uint8_t *data, long size)
+{
+    FILE *f = fopen(fname, "wb");
+    assert(f);
+    fwrite(data, 1, size, f);
+    fclose(f);
+}
+
+// Reading a damaged file must fail; we return the error.
+static enum error_codes read_damaged(const char *fname)
+{
+    enum error_codes err;
+    struct bwt_table *table = read_complete_bwt_info_fname(fname, true, &err);
+    assert(!table);
+    if (table) completely_free_bwt_table(table);
+    return err;
+}
+
+static void test_damaged_files(const char *fname)
+{
+    long size;
+    uint8_t *data = load_file(fname, &size);
+    enum error_codes err;
+    
+    // Truncated anywhere
+    for (long cut = 0; cut < size; cut += 1 + size / 50) {
+        store_file(fname, data, cut);
+        err = read_damaged(fname);
+        assert(err == TRUNCATED_FILE);
+    }
+    
+    // Flip a bit in the last section's data (the header and
+    // the first sections are 16-byte aligned so byte 200 is
+    // data for any reasonably sized table).
+    data[200] ^= 0x10;
+    store_file(fname, data, size);
+    err = read_damaged(fname);
+    assert(err == CHECKSUM_MISMATCH);
+    data[200] ^= 0x10;
+    
+    // Not a container
+    data[0] = 'X';
+    store_file(fname, data, size);
+    err = read_damaged(fname);
+    assert(err == MALFORMED_FILE);
+    data[0] = 'S';
+    
+    // A newer version than we know
+    data[8] = CONTAINER_VERSION + 1;
+    store_file(fname, data, size);
+    err = read_damaged(fname);
+    assert(err == UNSUPPORTED_FILE_VERSION);
+    
+    free(data);
+    
+    err = read_damaged("/does/not/exist");
+    assert(err == CANNOT_OPEN_FILE);
+}
+
+// Headers with sizes we must reject before we allocate
+// anything. The header is four 32-bit words: length,
+// alphabet size, whether there is an RO table, and padding.
+static void test_bad_headers(void)
+{
+    uint32_t headers[][4] = {
+        { 0, 4, 0, 0 },
+        { 10, 0, 0, 0 },
+        { 10, 257, 0, 0 },
+        { UINT32_MAX, 4, 0, 0 },
+        { UINT32_MAX - 1, 256, 1, 0 }, // 2^40 entries in the O table
+    };
+    for (uint32_t h = 0; h < sizeof(headers) / sizeof(*headers); ++h) {
+        FILE *f = tmpfile();
+        struct container_writer w;
+        init_container_writer(&w, f, BWT_INFO_KIND);
+        write_container_section(&w, CONTAINER_TAG('B','W','T','H'),
+                                headers[h], sizeof(headers[h]));
+        enum error_codes err;
+        bool ok = finish_container(&w, &err);
+        assert(ok);
+
+        rewind(f);
+        struct container_reader r;
+        ok = init_container_reader(&r, f, BWT_INFO_KIND, true);
+        assert(ok);
+        struct bwt_table *table = read_bwt_info_sections(&r);
+        assert(!table);
+        ok = finish_container_reader(&r, &err);
+        assert(!ok);
+        // The last size is possible on a 64-bit machine, and
+        // then either the allocation or the missing sections
+        // give us the error.
+        if (h < 4) assert(err == MALFORMED_FILE);
+        fclose(f);
+    }
+}
+
 static void test_complete_bwt(void)
 {
     uint8_t *str = (uint8_t *)"acgtadtadadfasdfing";
@@ -28,8 +222,13 @@ static void test_complete_bwt(void)
     char fname[strnlen(temp_template, MAX_STRLEN) + 1];
     strcpy(fname, temp_template);
     mkstemp(fname);
-    write_complete_bwt_info_fname(fname, &bwt_table);
-    struct bwt_table *other_table = read_complete_bwt_info_fname(fname);
+    enum error_codes err;
+    bool ok = write_complete_bwt_info_fname(fname, &bwt_table, &err);
+    assert(ok);
+    assert(err == NO_ERROR);
+    struct bwt_table *other_table = read_complete_bwt_info_fname(fname, true, &err);
+    assert(other_table);
+    assert(err == NO_ERROR);
     
     assert(strnlen((char *)bwt_table.sa->string, MAX_STRLEN) + 1 == bwt_table.sa->length);
     assert(strnlen((char *)other_table->sa->string, MAX_STRLEN) + 1 == other_table->sa->length);
@@ -37,6 +236,10 @@ static void test_complete_bwt(void)
     assert(equivalent_bwt_tables(&bwt_table, other_table));
     
     completely_free_bwt_table(other_table);
+    
+    test_damaged_files(fname);
+    remove(fname);
+    
     dealloc_bwt_table(&bwt_table);
     free_suffix_array(sa);
     dealloc_remap_table(&remap_table);
@@ -44,7 +247,10 @@ static void test_complete_bwt(void)
 
 int main(int argc, const char **argv)
 {
+    test_xxh64();
+    test_container();
     test_complete_bwt();
+    test_bad_headers();
     
     return EXIT_SUCCESS;
 }
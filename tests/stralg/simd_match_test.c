@@ -0,0 +1,69 @@
+#include <match.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+// The random texts in match_test use the best level, so here
+// we force each level and look at the ends of the blocks.
+
+// In a^n, a^m occurs everywhere, so we get candidates in
+// every lane of every block and in the scalar tail.
+static void check_all_positions(
+    enum simd_match_level level,
+    const uint8_t *x, uint32_t n,
+    uint32_t m
+) {
+    struct simd_match_iter iter;
+    struct match match;
+    init_simd_match_iter_level(&iter, x, n, x, m, level);
+    for (uint32_t j = 0; j + m <= n; ++j) {
+        assert(next_simd_match(&iter, &match));
+        assert(match.pos == j);
+    }
+    assert(!next_simd_match(&iter, &match));
+    assert(!next_simd_match(&iter, &match)); // and it stays done
+    dealloc_simd_match_iter(&iter);
+}
+
+// A single occurrence at the very end of the text, after
+// letters that match the first and last letter but not the
+// middle, so the verification has to reject them.
+static void check_last_position(
+    enum simd_match_level level,
+    uint32_t n
+) {
+    uint8_t x[n];
+    for (uint32_t i = 0; i < n; ++i)
+        x[i] = 'a';
+    const uint8_t p[] = "aba";
+    x[n - 2] = 'b';
+    struct simd_match_iter iter;
+    struct match match;
+    init_simd_match_iter_level(&iter, x, n, p, 3, level);
+    assert(next_simd_match(&iter, &match));
+    assert(match.pos == n - 3);
+    assert(!next_simd_match(&iter, &match));
+    dealloc_simd_match_iter(&iter);
+}
+
+int main(int argc, const char **argv)
+{
+    printf("Supported level: %d\n", supported_simd_match_level());
+
+    uint32_t sizes[] = { 15, 16, 17, 31, 32, 33 };
+    uint32_t no_sizes = sizeof(sizes) / sizeof(*sizes);
+    uint8_t x[40];
+    memset(x, 'a', sizeof(x));
+    for (int level = SIMD_MATCH_SCALAR; level <= SIMD_MATCH_AVX2; ++level) {
+        for (uint32_t s = 0; s < no_sizes; ++s) {
+            uint32_t n = sizes[s];
+            for (uint32_t m = 1; m <= n; ++m)
+                check_all_positions(level, x, n, m);
+            check_last_position(level, n);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+
+#include <sparse_suffix_array.h>
+#include <suffix_array.h>
+#include <string_utils.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+
+// The sparse suffix array must be the full suffix array
+// with everything but the sampled positions removed.
+static void check_sparse_sa(
+    struct suffix_array *sa,
+    struct sparse_suffix_array *ssa,
+    const bool *sampled
+) {
+    uint32_t j = 0;
+    for (uint32_t i = 0; i < sa->length; ++i) {
+        if (sampled[sa->array[i]]) {
+            assert(j < ssa->no_suffixes);
+            assert(ssa->array[j] == sa->array[i]);
+            j++;
+        }
+    }
+    assert(j == ssa->no_suffixes);
+}
+
+static void check_search(
+    struct suffix_array *sa,
+    struct sparse_suffix_array *ssa,
+    const bool *sampled,
+    const uint8_t *pattern
+) {
+    struct sa_interval interval;
+    sa_batch_search(sa, 1, &pattern, &interval);
+
+    struct sparse_sa_match_iter iter;
+    struct sa_match match;
+    init_sparse_sa_match_iter(&iter, pattern, ssa);
+    for (uint32_t i = interval.L; i < interval.R; ++i) {
+        if (!sampled[sa->array[i]]) continue;
+        assert(next_sparse_sa_match(&iter, &match));
+        assert(match.position == sa->array[i]);
+    }
+    assert(!next_sparse_sa_match(&iter, &match));
+    dealloc_sparse_sa_match_iter(&iter);
+}
+
+static void check_string(
+    uint8_t *string,
+    struct sparse_suffix_array *ssa,
+    const bool *sampled
+) {
+    struct suffix_array *sa = qsort_sa_construction(string);
+    check_sparse_sa(sa, ssa, sampled);
+
+    uint32_t n = sa->length - 1;
+    for (uint32_t i = 0; i < n; i += 1 + n / 100) {
+        for (uint32_t m = 1; m <= 5 && i + m <= n; ++m) {
+            uint8_t *p = str_copy_n(string + i, m);
+            check_search(sa, ssa, sampled, p);
+            free(p);
+        }
+    }
+    check_search(sa, ssa, sampled, (uint8_t *)"xxxxxxxxxx");
+    free_suffix_array(sa);
+}
+
+static void test_stride(uint8_t *string, uint32_t stride)
+{
+    uint32_t n = (uint32_t)strlen((char *)string);
+    bool sampled[n + 1];
+    for (uint32_t i = 0; i <= n; ++i)
+        sampled[i] = i < n && i % stride == 0;
+
+    struct sparse_suffix_array *ssa = sparse_sa_stride_construction(string, stride);
+    assert(ssa->no_suffixes == (n + stride - 1) / stride);
+    check_string(string, ssa, sampled);
+    free_sparse_suffix_array(ssa);
+}
+
+static void test_positions(uint8_t *string, uint32_t no_positions)
+{
+    uint32_t n = (uint32_t)strlen((char *)string);
+    bool sampled[n + 1];
+    memset(sampled, 0, sizeof(sampled));
+    uint32_t positions[no_positions];
+    for (uint32_t i = 0; i < no_positions; ++i) {
+        // some out of range and some duplicates
+        positions[i] = rand() % (n + 3);
+        if (positions[i] < n) sampled[positions[i]] = true;
+    }
+
+    struct sparse_suffix_array *ssa =
+        sparse_sa_positions_construction(string, no_positions, positions);
+    check_string(string, ssa, sampled);
+    free_sparse_suffix_array(ssa);
+}
+
+int main(int argc, const char **argv)
+{
+    uint8_t *strings[] = {
+        (uint8_t *)"mississippi",
+        (uint8_t *)"aaaaaaaaaaaaaaaaaaaa",
+        (uint8_t *)"abababababababababa",
+        (uint8_t *)"acgtacgttgacacgtatgcgcgatatatcgcgcatat",
+        (uint8_t *)"a",
+        (uint8_t *)""
+    };
+    for (uint32_t i = 0; i < sizeof(strings) / sizeof(*strings); ++i) {
+        for (uint32_t stride = 1; stride <= 7; ++stride)
+            test_stride(strings[i], stride);
+        test_positions(strings[i], 5);
+    }
+
+    uint32_t n = 3000;
+    uint8_t *x = malloc(n + 1);
+    for (uint32_t rep = 0; rep < 3; ++rep) {
+        for (uint32_t i = 0; i < n; ++i)
+            x[i] = "acgt"[rand() % (rep + 2)];
+        x[n] = 0;
+        test_stride(x, 3);
+        test_stride(x, 10);
+        test_positions(x, 500);
+    }
+    free(x);
+
+    return EXIT_SUCCESS;
+}
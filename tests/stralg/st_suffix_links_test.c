@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 // DEBUG
 #if 0
@@ -56,6 +57,72 @@ static void check_suffix_tree_annotation(const uint8_t *string)
 
 }
 
+// Moving the nodes around must not change the tree, and
+// it must keep the suffix links.
+static void check_relayout(const uint8_t *string, enum st_layout layout)
+{
+    struct suffix_tree *st = mccreight_suffix_tree(string);
+    annotate_suffix_links(st); // McCreight doesn't link the leaves
+    uint32_t n = st->length;
+    uint32_t sa[n], lcp[n], sa2[n], lcp2[n];
+    st_compute_sa_and_lcp(st, sa, lcp);
+
+    st_relayout(st, layout);
+    assert(st->root == st->pool.nodes);
+    st_compute_sa_and_lcp(st, sa2, lcp2);
+    for (uint32_t i = 0; i < n; ++i) {
+        assert(sa[i] == sa2[i]);
+        assert(lcp[i] == lcp2[i]);
+    }
+    compare_suffix_path_labels(st, st->root);
+
+    // The children of the root are next to each other
+    // in the family layout
+    if (layout == ST_LAYOUT_FAMILIES) {
+        struct suffix_tree_node *w = st->root->child;
+        for (uint32_t i = 1; w; ++i, w = w->sibling)
+            assert(w == st->pool.nodes + i);
+    } else {
+        assert(st->root->child == st->pool.nodes + 1);
+    }
+
+    // The child index follows the nodes
+    st_build_child_index(st);
+    st_relayout(st, layout);
+    struct st_search_iter iter;
+    struct st_search_match match;
+    init_st_search_iter(&iter, st, (uint8_t *)"");
+    for (uint32_t i = 0; i < n; ++i) {
+        // Suffixes can end inside the tree, so we look for
+        // the leaf below where the search ends.
+        bool found = false;
+        reset_st_search_iter(&iter, st, string + i);
+        while (next_st_match(&iter, &match))
+            found |= match.pos == i;
+        assert(found);
+    }
+    dealloc_st_search_iter(&iter);
+
+    free_suffix_tree(st);
+}
+
+static void test_relayout(void)
+{
+    const char *strings[] = {
+        "mississippi", "aaaaaaaaaaaaa", "abababababab", "abbabb", ""
+    };
+    for (uint32_t i = 0; i < sizeof(strings) / sizeof(*strings); ++i) {
+        check_relayout((uint8_t *)strings[i], ST_LAYOUT_PREORDER);
+        check_relayout((uint8_t *)strings[i], ST_LAYOUT_FAMILIES);
+    }
+    uint32_t n = 2000;
+    uint8_t x[n + 1];
+    for (uint32_t i = 0; i < n; ++i)
+        x[i] = "acgt"[rand() % 4];
+    x[n] = '\0';
+    check_relayout(x, ST_LAYOUT_PREORDER);
+    check_relayout(x, ST_LAYOUT_FAMILIES);
+}
 
 int main(int argc, const char **argv)
 {
@@ -63,6 +130,8 @@ int main(int argc, const char **argv)
     check_suffix_tree_annotation((uint8_t *)"aaaaaaaaaaaaa");
     check_suffix_tree_annotation((uint8_t *)"abababababab");
     check_suffix_tree_annotation((uint8_t *)"abbabb");
+
+    test_relayout();
     
     return EXIT_SUCCESS;
 }
@@ -125,6 +125,51 @@ static void test_search(struct suffix_array *sa)
     assert(idx1 == 1);
 }
 
+static void test_batch_search(struct suffix_array *sa)
+{
+    // All substrings up to length four, plus some that
+    // do not occur in the string.
+    const char *missing[] = { "aa", "ad", "x", "0", "cc", "abacabacx" };
+    uint32_t no_missing = sizeof(missing) / sizeof(*missing);
+    uint32_t n = sa->length - 1;
+    uint32_t no_patterns = no_missing + 1;
+    const uint8_t *patterns[no_missing + 4 * n + 1];
+    uint8_t buffer[4 * n][5];
+
+    patterns[0] = (const uint8_t *)""; // the empty pattern matches everywhere
+    for (uint32_t i = 0; i < no_missing; ++i)
+        patterns[no_patterns - no_missing + i] = (const uint8_t *)missing[i];
+    for (uint32_t i = 0; i < n; ++i) {
+        for (uint32_t m = 1; m <= 4 && i + m <= n; ++m) {
+            uint8_t *p = buffer[4 * i + m - 1];
+            strncpy((char *)p, (char *)sa->string + i, m);
+            p[m] = '\0';
+            patterns[no_patterns++] = p;
+        }
+    }
+
+    struct sa_interval intervals[no_patterns];
+    sa_batch_search(sa, no_patterns, patterns, intervals);
+
+    assert(intervals[0].L == 0);
+    assert(intervals[0].R == sa->length);
+    for (uint32_t i = 1; i < no_patterns; ++i) {
+        const uint8_t *p = patterns[i];
+        uint32_t m = (uint32_t)strlen((char *)p);
+        assert(intervals[i].L == lower_bound_search(sa, p));
+        assert(intervals[i].L <= intervals[i].R);
+        for (uint32_t j = intervals[i].L; j < intervals[i].R; ++j) {
+            assert(strncmp((char *)p, (char *)sa->string + sa->array[j], m) == 0);
+        }
+        uint32_t count = 0;
+        for (uint32_t j = 0; j < sa->length; ++j) {
+            if (strncmp((char *)p, (char *)sa->string + j, m) == 0)
+                count++;
+        }
+        assert(intervals[i].R - intervals[i].L == count);
+        if (i > no_missing) assert(count > 0);
+    }
+}
 
 static void test_inverse(struct suffix_array *sa)
 {
@@ -176,6 +221,7 @@ static void test_sa(struct suffix_array *sa, uint8_t *string)
     test_inverse(sa);
     test_lcp(sa);
     test_search(sa);
+    test_batch_search(sa);
     
     print_suffix_array(sa);
     
@@ -105,6 +105,23 @@ static void test_suffix_tree_match(struct index_vector *naive_matches,
     
     free_index_vector(st_matches);
     
+    // Reusing the iterator for several searches must
+    // give us the same matches.
+    st_matches = alloc_index_vector(100);
+    init_st_search_iter(&search_iter, st, not_here);
+    reset_st_search_iter(&search_iter, st, pattern);
+    while (next_st_match(&search_iter, &search_match)) {
+        index_vector_append(st_matches, search_match.pos);
+    }
+    reset_st_search_iter(&search_iter, st, not_here);
+    assert(!next_st_match(&search_iter, &search_match));
+    reset_st_search_iter(&search_iter, st, pattern);
+    assert(next_st_match(&search_iter, &search_match));
+    dealloc_st_search_iter(&search_iter);
+    
+    sort_index_vector(st_matches);
+    assert(index_vector_equal(naive_matches, st_matches));
+    free_index_vector(st_matches);
 }
 
 static void test_matching(const uint8_t *pattern, uint8_t *string) {
@@ -144,6 +161,71 @@ static void test_matching(const uint8_t *pattern, uint8_t *string) {
 }
 
 
+// The child index must not change what we find.
+static void check_child_index(struct suffix_tree *st)
+{
+    uint32_t n = st->length;
+    uint32_t no_patterns = 500;
+    uint8_t **patterns = malloc(no_patterns * sizeof(*patterns));
+    struct suffix_tree_node **expected = malloc(no_patterns * sizeof(*expected));
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        uint32_t m = 1 + rand() % 8;
+        uint32_t j = rand() % n;
+        if (j + m >= n) m = n - 1 - j;
+        patterns[i] = str_copy_n(st->string + j, m);
+        if (i % 5 == 0 && m > 0)
+            patterns[i][m - 1] = 1 + rand() % 255; // probably a miss
+        expected[i] = st_search(st, patterns[i]);
+    }
+
+    st_build_child_index(st);
+    assert(st_child_index_bytes(st) > 0);
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        assert(st_search(st, patterns[i]) == expected[i]);
+    }
+    for (uint32_t a = 0; a < 256; ++a) {
+        struct suffix_tree_node *w = st->root->child;
+        while (w && *w->range.from != a) w = w->sibling;
+        assert(st_find_child(st, st->root, (uint8_t)a) == w);
+    }
+    // building it again replaces the old index
+    st_build_child_index(st);
+    for (uint32_t i = 0; i < no_patterns; ++i) {
+        assert(st_search(st, patterns[i]) == expected[i]);
+    }
+    st_free_child_index(st);
+    assert(st->children == 0);
+    st_build_child_index(st); // free_suffix_tree frees this one
+
+    for (uint32_t i = 0; i < no_patterns; ++i)
+        free(patterns[i]);
+    free(patterns);
+    free(expected);
+}
+
+static void test_child_index(void)
+{
+    uint32_t n = 20000;
+    uint8_t *x = malloc(n + 1);
+    x[n] = '\0';
+    for (uint32_t k = 0; k < 3; ++k) {
+        for (uint32_t i = 0; i < n; ++i)
+            x[i] = (k == 0) ? "acgt"[rand() % 4] :
+                   (k == 1) ? 1 + rand() % 255 :
+                              1 + rand() % 20;
+        struct suffix_tree *st = mccreight_suffix_tree(x);
+        check_child_index(st);
+        free_suffix_tree(st);
+
+        struct online_suffix_tree *ost = alloc_online_suffix_tree(n + 1);
+        online_suffix_tree_append(ost, x, n);
+        st = finish_online_suffix_tree(ost);
+        check_child_index(st);
+        free_complete_suffix_tree(st);
+    }
+    free(x);
+}
+
 int main(int argc, const char **argv)
 {
     if (argc == 3) {
@@ -182,6 +264,8 @@ int main(int argc, const char **argv)
             }
         }
 
+        test_child_index();
+
     }
 
     return EXIT_SUCCESS;
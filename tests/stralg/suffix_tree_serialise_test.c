@@ -0,0 +1,329 @@
+#include <suffix_tree.h>
+#include <edge_array_suffix_tree.h>
+#include <string_utils.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+
+static int cmp_positions(const void *a, const void *b)
+{
+    uint32_t i = *(const uint32_t *)a;
+    uint32_t j = *(const uint32_t *)b;
+    return (i > j) - (i < j);
+}
+
+static uint8_t *load_file(const char *fname, long *size)
+{
+    FILE *f = fopen(fname, "rb");
+    assert(f);
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    rewind(f);
+    uint8_t *data = malloc(*size);
+    size_t read = fread(data, 1, *size, f);
+    assert(read == (size_t)*size);
+    fclose(f);
+    return data;
+}
+
+static void store_file(const char *fname, const uint8_t *data, long size)
+{
+    FILE *f = fopen(fname, "wb");
+    assert(f);
+    fwrite(data, 1, size, f);
+    fclose(f);
+}
+
+static void check_sa_and_lcp(
+    uint32_t n,
+    const uint32_t *expected_sa,
+    const uint32_t *expected_lcp,
+    const uint32_t *sa,
+    const uint32_t *lcp
+) {
+    for (uint32_t i = 0; i < n; ++i) {
+        assert(sa[i] == expected_sa[i]);
+        assert(lcp[i] == expected_lcp[i]);
+    }
+}
+
+static uint32_t node_depth(struct suffix_tree_node *v)
+{
+    uint32_t depth = 0;
+    while (v->parent != v) {
+        depth += edge_length(v);
+        v = v->parent;
+    }
+    return depth;
+}
+
+// The suffix link of a node at depth d goes to a node at
+// depth d - 1, so this catches links that point to the
+// wrong node after reading.
+static void check_suffix_links(struct suffix_tree *st)
+{
+    for (struct suffix_tree_node *v = st->pool.nodes; v < st->pool.next_node; ++v) {
+        if (v == st->root || !v->suffix_link) continue;
+        assert(node_depth(v->suffix_link) + 1 == node_depth(v));
+    }
+}
+
+// The mapped tree must find the same positions as naive
+// matching.
+// Reading or mapping a damaged file must fail; we return the
+// error. The calls are outside the asserts so they also run
+// when NDEBUG is defined.
+static enum error_codes read_damaged(const char *fname, bool verify)
+{
+    enum error_codes err;
+    struct suffix_tree *st = read_suffix_tree_fname(fname, verify, &err);
+    assert(!st);
+    if (st) free_complete_suffix_tree(st);
+    return err;
+}
+
+static enum error_codes read_ea_damaged(const char *fname, uint32_t alphabet_size)
+{
+    enum error_codes err;
+    struct ea_suffix_tree *st =
+        read_ea_suffix_tree_fname(fname, alphabet_size, true, &err);
+    assert(!st);
+    if (st) free_complete_ea_suffix_tree(st);
+    return err;
+}
+
+static enum error_codes map_damaged(const char *fname, bool verify)
+{
+    enum error_codes err;
+    struct mapped_suffix_tree *mst = map_suffix_tree_fname(fname, verify, &err);
+    assert(!mst);
+    if (mst) unmap_suffix_tree(mst);
+    return err;
+}
+
+static void check_mapped_search(
+    const struct mapped_suffix_tree *mst,
+    const uint8_t *string
+) {
+    uint32_t n = mst->length - 1;
+    uint32_t *hits = malloc((n + 1) * sizeof(*hits));
+    struct mapped_st_search_iter iter;
+    struct st_search_match match;
+    init_mapped_st_search_iter(&iter, mst, (uint8_t *)"");
+
+    for (uint32_t j = 0; j < n; j += 1 + n / 20) {
+        for (uint32_t m = 1; m <= 6 && j + m <= n; ++m) {
+            uint8_t *p = str_copy_n((uint8_t *)string + j, m);
+            uint32_t v = mapped_st_search(mst, p);
+            assert(v != ST_FILE_NIL);
+
+            uint32_t no_hits = 0;
+            reset_mapped_st_search_iter(&iter, p);
+            while (next_mapped_st_match(&iter, &match)) {
+                assert(no_hits < n);
+                hits[no_hits++] = match.pos;
+            }
+            qsort(hits, no_hits, sizeof(*hits), cmp_positions);
+            uint32_t k = 0;
+            for (uint32_t i = 0; i + m <= n; ++i) {
+                if (strncmp((char *)string + i, (char *)p, m) == 0) {
+                    assert(k < no_hits);
+                    assert(hits[k] == i);
+                    k++;
+                }
+            }
+            assert(k == no_hits);
+            free(p);
+        }
+    }
+
+    uint8_t *missing = (uint8_t *)"xyzzy";
+    uint32_t v = mapped_st_search(mst, missing);
+    assert(v == ST_FILE_NIL);
+    reset_mapped_st_search_iter(&iter, missing);
+    bool found = next_mapped_st_match(&iter, &match);
+    assert(!found);
+
+    // The empty pattern matches everywhere, including the
+    // sentinel.
+    uint32_t no_hits = 0;
+    reset_mapped_st_search_iter(&iter, (uint8_t *)"");
+    while (next_mapped_st_match(&iter, &match))
+        no_hits++;
+    assert(no_hits == n + 1);
+
+    dealloc_mapped_st_search_iter(&iter);
+    free(hits);
+}
+
+static void test_string(const uint8_t *string, const char *fname)
+{
+    struct suffix_tree *st = mccreight_suffix_tree(string);
+    uint32_t n = st->length;
+    uint32_t *expected_sa = malloc(n * sizeof(*expected_sa));
+    uint32_t *expected_lcp = malloc(n * sizeof(*expected_lcp));
+    uint32_t *sa = malloc(n * sizeof(*sa));
+    uint32_t *lcp = malloc(n * sizeof(*lcp));
+    st_compute_sa_and_lcp(st, expected_sa, expected_lcp);
+
+    enum error_codes err;
+    bool ok = write_suffix_tree_fname(fname, st, &err);
+    assert(ok);
+    assert(err == NO_ERROR);
+
+    // pointer -> pointer
+    struct suffix_tree *other = read_suffix_tree_fname(fname, true, &err);
+    assert(other);
+    assert(err == NO_ERROR);
+    assert(other->length == n);
+    assert(strcmp((char *)other->string, (char *)string) == 0);
+    st_compute_sa_and_lcp(other, sa, lcp);
+    check_sa_and_lcp(n, expected_sa, expected_lcp, sa, lcp);
+    check_suffix_links(other);
+    free_complete_suffix_tree(other);
+
+    // pointer -> edge arrays
+    struct ea_suffix_tree *east = read_ea_suffix_tree_fname(fname, 128, true, &err);
+    assert(east);
+    assert(err == NO_ERROR);
+    ea_st_compute_sa_and_lcp(east, sa, lcp);
+    check_sa_and_lcp(n, expected_sa, expected_lcp, sa, lcp);
+
+    // edge arrays -> pointer
+    ok = write_ea_suffix_tree_fname(fname, east, &err);
+    assert(ok);
+    assert(err == NO_ERROR);
+    free_complete_ea_suffix_tree(east);
+    other = read_suffix_tree_fname(fname, true, &err);
+    assert(other);
+    st_compute_sa_and_lcp(other, sa, lcp);
+    check_sa_and_lcp(n, expected_sa, expected_lcp, sa, lcp);
+    check_suffix_links(other);
+    free_complete_suffix_tree(other);
+
+    // A letter outside the alphabet
+    if (n > 1) {
+        err = read_ea_damaged(fname, 2);
+        assert(err == MALFORMED_FILE);
+    }
+
+    struct mapped_suffix_tree *mst = map_suffix_tree_fname(fname, true, &err);
+    assert(mst);
+    assert(err == NO_ERROR);
+    assert(mst->length == n);
+    check_mapped_search(mst, string);
+    unmap_suffix_tree(mst);
+
+    free(expected_sa);
+    free(expected_lcp);
+    free(sa);
+    free(lcp);
+    free_suffix_tree(st);
+}
+
+static void test_damaged_files(const char *fname)
+{
+    uint8_t *string = (uint8_t *)"mississippi";
+    struct suffix_tree *st = mccreight_suffix_tree(string);
+    enum error_codes err;
+    bool ok = write_suffix_tree_fname(fname, st, &err);
+    assert(ok);
+    free_suffix_tree(st);
+
+    // Find the nodes in the file through the map.
+    struct mapped_suffix_tree *mst = map_suffix_tree_fname(fname, true, &err);
+    assert(mst);
+    long nodes_offset = (long)((const uint8_t *)mst->nodes - mst->map.data);
+    uint32_t no_nodes = mst->no_nodes;
+    unmap_suffix_tree(mst);
+
+    long size;
+    uint8_t *data = load_file(fname, &size);
+
+    // Truncated anywhere
+    for (long cut = 0; cut < size; cut += 1 + size / 50) {
+        store_file(fname, data, cut);
+        err = read_damaged(fname, true);
+        assert(err == TRUNCATED_FILE);
+        err = map_damaged(fname, false);
+        assert(err != NO_ERROR);
+    }
+
+    // A node pointing outside the tree. With the checksums
+    // we see that the file is damaged, and without them the
+    // tree doesn't make sense.
+    struct st_file_node *nodes = (struct st_file_node *)(data + nodes_offset);
+    uint32_t parent = nodes[1].parent;
+    nodes[1].parent = no_nodes;
+    store_file(fname, data, size);
+    err = read_damaged(fname, true);
+    assert(err == CHECKSUM_MISMATCH);
+    err = read_ea_damaged(fname, 128);
+    assert(err == CHECKSUM_MISMATCH);
+    err = map_damaged(fname, true);
+    assert(err == CHECKSUM_MISMATCH);
+    err = read_damaged(fname, false);
+    assert(err == MALFORMED_FILE);
+
+    // A cycle: the root's first child is its own sibling
+    nodes[1].parent = parent;
+    uint32_t sibling = nodes[1].sibling;
+    nodes[1].sibling = 1;
+    store_file(fname, data, size);
+    err = read_damaged(fname, false);
+    assert(err == MALFORMED_FILE);
+    nodes[1].sibling = sibling;
+
+    // Not a suffix tree container
+    data[16] ^= 0xff; // the kind
+    store_file(fname, data, size);
+    err = read_damaged(fname, true);
+    assert(err == MALFORMED_FILE);
+    err = map_damaged(fname, false);
+    assert(err == MALFORMED_FILE);
+    data[16] ^= 0xff;
+
+    // And back to the original
+    store_file(fname, data, size);
+    st = read_suffix_tree_fname(fname, false, &err);
+    assert(st);
+    free_complete_suffix_tree(st);
+    free(data);
+
+    err = read_damaged("/does/not/exist", true);
+    assert(err == CANNOT_OPEN_FILE);
+    err = map_damaged("/does/not/exist", true);
+    assert(err == CANNOT_OPEN_FILE);
+}
+
+int main(int argc, const char **argv)
+{
+    char fname[] = "/tmp/temp.XXXXXX";
+    int fd = mkstemp(fname);
+    assert(fd >= 0);
+    close(fd);
+
+    test_string((uint8_t *)"mississippi", fname);
+    test_string((uint8_t *)"aaaaaaaaaaaaaaaa", fname);
+    test_string((uint8_t *)"abcabxabcd", fname);
+    test_string((uint8_t *)"a", fname);
+    test_string((uint8_t *)"", fname);
+
+    uint32_t n = 2000;
+    uint8_t *x = malloc(n + 1);
+    for (uint32_t rep = 0; rep < 4; ++rep) {
+        for (uint32_t i = 0; i < n; ++i)
+            x[i] = "acgt"[rand() % (rep + 1)];
+        x[n] = '\0';
+        test_string(x, fname);
+    }
+    free(x);
+
+    test_damaged_files(fname);
+    remove(fname);
+
+    return EXIT_SUCCESS;
+}
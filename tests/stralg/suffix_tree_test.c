@@ -2,6 +2,7 @@
 #include <vectors.h>
 #include <suffix_tree.h>
 #include <cigar.h>
+#include <suffix_array.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -120,6 +121,61 @@ static void check_suffix_tree(struct suffix_tree *st)
 }
 
 
+// The parallel construction must give us the same tree as
+// the sequential one. The strings must be long enough that
+// we don't just fall back to the sequential algorithm.
+static void check_parallel(uint8_t *x)
+{
+    struct suffix_array *sa = skew_sa_construction(x);
+    compute_lcp(sa);
+    struct suffix_tree *expected = lcp_suffix_tree(x, sa->array, sa->lcp);
+    struct suffix_tree *st = parallel_lcp_suffix_tree(x, sa->array, sa->lcp, 4);
+    check_nodes(st, st->root);
+    check_parent_pointers(st->root);
+
+    uint32_t n = st->length;
+    assert(n == expected->length);
+    uint32_t *st_sa = malloc(n * sizeof(*st_sa));
+    uint32_t *st_lcp = malloc(n * sizeof(*st_lcp));
+    st_compute_sa_and_lcp(st, st_sa, st_lcp);
+    for (uint32_t i = 0; i < n; ++i) {
+        assert(st_sa[i] == sa->array[i]);
+        assert(st_lcp[i] == sa->lcp[i]);
+    }
+    st_compute_sa_and_lcp(expected, st_sa, st_lcp);
+    for (uint32_t i = 0; i < n; ++i) {
+        assert(st_sa[i] == sa->array[i]);
+    }
+    free(st_sa);
+    free(st_lcp);
+
+    free_suffix_tree(expected);
+    free_suffix_tree(st);
+    free_suffix_array(sa);
+}
+
+static void test_parallel(void)
+{
+    uint32_t n = PARALLEL_LCP_MIN_LENGTH + 5000;
+    uint8_t *x = malloc(n + 1);
+    x[n] = '\0';
+    for (uint32_t i = 0; i < n; ++i)
+        x[i] = "acgt"[rand() % 4];
+    check_parallel(x);
+    for (uint32_t i = 0; i < n; ++i)
+        x[i] = 1 + rand() % 127;
+    check_parallel(x);
+    // The buckets can't be balanced here
+    for (uint32_t i = 0; i < n; ++i)
+        x[i] = 'a';
+    check_parallel(x);
+    for (uint32_t i = 0; i < n; ++i)
+        x[i] = "ab"[(i / 7) % 2];
+    check_parallel(x);
+    free(x);
+}
+
+
 int main(int argc, const char **argv)
 {
     const uint8_t *string = (uint8_t *)"mississippi";
@@ -177,5 +233,7 @@ int main(int argc, const char **argv)
     free_suffix_tree(st);
 
     
+    test_parallel();
+
     return EXIT_SUCCESS;
 }
@@ -126,5 +126,21 @@ int main(int argc, char * argv[])
     
     free_trie(trie);
     
+    // A deep trie with many siblings. Freeing it used to
+    // recurse to the depth plus the number of siblings.
+    trie = alloc_trie();
+    uint32_t n = 1000000;
+    uint8_t *long_string = malloc(n + 1);
+    memset(long_string, 'a', n);
+    long_string[n] = '\0';
+    add_string_to_trie(trie, long_string, 0);
+    for (uint32_t i = 1; i < 200; ++i) {
+        uint8_t short_string[] = { 'b', (uint8_t)(i + 32), '\0' };
+        add_string_to_trie(trie, short_string, (int)i);
+    }
+    compute_failure_links(trie);
+    free_trie(trie);
+    free(long_string);
+    
     return EXIT_SUCCESS;
 }
@@ -13,6 +13,10 @@
 
 static const char *suffix = "bwttables";
 
+#define READMAPPER_KIND  CONTAINER_TAG('B','W','R','M')
+#define NO_RECORDS_TAG   CONTAINER_TAG('N','R','E','C')
+#define RECORD_NAME_TAG  CONTAINER_TAG('N','A','M','E')
+
 static void preprocess(const char *fasta_fname)
 {
     enum error_codes err;
@@ -45,8 +49,12 @@ static void preprocess(const char *fasta_fname)
         exit(EXIT_FAILURE);
     }
     
+    struct container_writer writer;
+    init_container_writer(&writer, outfile, READMAPPER_KIND);
+    
     uint32_t no_records = number_of_fasta_records(fasta_records);
-    fwrite(&no_records, sizeof(no_records), 1, outfile);
+    write_container_section(&writer, NO_RECORDS_TAG,
+                            &no_records, sizeof(no_records));
     
     struct fasta_iter iter;
     struct fasta_record rec;
@@ -54,15 +62,20 @@ static void preprocess(const char *fasta_fname)
     while (next_fasta_record(&iter, &rec)) {
         fprintf(stderr, "Serialising record %s\n", rec.name);
         fprintf(stderr, "Length: %u\n", rec.seq_len);
-        write_string(outfile, (uint8_t*)rec.name);
+        write_container_section(&writer, RECORD_NAME_TAG,
+                                rec.name, strlen(rec.name) + 1);
         struct bwt_table *table = build_complete_table(rec.seq, true);
-        write_complete_bwt_info(outfile, table);
+        write_bwt_info_sections(&writer, table);
         completely_free_bwt_table(table);
         fprintf(stderr, "Done\n");
     }
     dealloc_fasta_iter(&iter);
     
-    fclose(outfile);
+    if (!finish_container(&writer, &err) || fclose(outfile) != 0) {
+        fprintf(stderr, "Could not write preprocessed tables to %s\n",
+                preprocessed_fname);
+        exit(EXIT_FAILURE);
+    }
     free_fasta_records(fasta_records);
 }
 
@@ -101,14 +114,38 @@ static struct string_table *read_string_tables(const char *fasta_fname)
     fprintf(stderr, "reading preprocessed data.\n");
     
     struct string_table *tables = 0;
-    uint32_t no_records;
-    fread(&no_records, sizeof(no_records), 1, infile);
+    struct container_reader reader;
+    enum error_codes err;
+    uint32_t no_records = 0;
+    if (init_container_reader(&reader, infile, READMAPPER_KIND, true))
+        read_container_section(&reader, NO_RECORDS_TAG,
+                               &no_records, sizeof(no_records));
     for (uint32_t i = 0; i < no_records; ++i) {
-        char *name = (char *)read_string(infile);
+        uint64_t name_len;
+        char *name = read_container_section_alloc(&reader, RECORD_NAME_TAG,
+                                                  &name_len);
+        if (!name) break;
+        // We wrote the names with their terminating zero, so an
+        // empty or unterminated one means the file is damaged.
+        if (name_len == 0 || name[name_len - 1] != '\0') {
+            reader.error = MALFORMED_FILE;
+            free(name);
+            break;
+        }
         fprintf(stderr, "%s\n", name);
-        struct bwt_table *bwt_table = read_complete_bwt_info(infile);
+        struct bwt_table *bwt_table = read_bwt_info_sections(&reader);
+        if (!bwt_table) {
+            free(name);
+            break;
+        }
         tables = new_string_table(name, bwt_table, tables);
     }
+    if (!finish_container_reader(&reader, &err)) {
+        fprintf(stderr, "The preprocessed tables in %s are damaged (error %d). "
+                "Run the preprocessing again.\n", preprocessed_fname, err);
+        exit(EXIT_FAILURE);
+    }
+    fclose(infile);
     fprintf(stderr, "done.\n");
     
     return tables;
@@ -25,6 +25,11 @@ static void print_help(const char *progname)
     printf("\t     - border: The border array linear time algorithm.\n");
     printf("\t     - kmp: The Knuth-Morris-Pratt linear time algorithm.\n");
     printf("\t     - bmh: The Boyer-Moore-Horspool array linear time algorithm.\n");
+    printf("\t     - bm: The Boyer-Moore algorithm.\n");
+    printf("\t     - bm-galil: Boyer-Moore with the Galil rule, linear in the worst case.\n");
+    printf("\t     - simd: First and last letter filter using SSE2/AVX2 when available.\n");
+    printf("\t     - shift-or: The bit-parallel Shift-Or algorithm.\n");
+    printf("\t     - bndm: Backward nondeterministic DAWG matching.\n");
     printf("\n\n");
 }
 
@@ -186,6 +191,141 @@ static void map_bmh(const uint8_t *edit_str, const char *edit_cigar,
     dealloc_bmh_match_iter(&iter);
 }
 
+static void map_bm(const uint8_t *edit_str, const char *edit_cigar,
+                   struct fastq_record *fastq_record, struct fasta_record *fasta_record)
+{
+    uint32_t readlen = strlen((char *)edit_str);
+    struct bm_match_iter iter;
+    init_bm_match_iter(&iter,
+                       fasta_record->seq,
+                       fasta_record->seq_len,
+                       edit_str,
+                       readlen);
+    
+    struct match match;
+    while (next_bm_match(&iter, &match)) {
+        print_sam_line(
+                       stdout,
+                       fastq_record->name,
+                       fasta_record->name,
+                       match.pos + 1,
+                       edit_cigar,
+                       fastq_record->sequence,
+                       fastq_record->quality
+                       );
+    }
+    
+    dealloc_bm_match_iter(&iter);
+}
+
+static void map_bm_galil(const uint8_t *edit_str, const char *edit_cigar,
+                         struct fastq_record *fastq_record, struct fasta_record *fasta_record)
+{
+    uint32_t readlen = strlen((char *)edit_str);
+    struct bm_galil_match_iter iter;
+    init_bm_galil_match_iter(&iter,
+                             fasta_record->seq,
+                             fasta_record->seq_len,
+                             edit_str,
+                             readlen);
+    
+    struct match match;
+    while (next_bm_galil_match(&iter, &match)) {
+        print_sam_line(
+                       stdout,
+                       fastq_record->name,
+                       fasta_record->name,
+                       match.pos + 1,
+                       edit_cigar,
+                       fastq_record->sequence,
+                       fastq_record->quality
+                       );
+    }
+    
+    dealloc_bm_galil_match_iter(&iter);
+}
+
+static void map_simd(const uint8_t *edit_str, const char *edit_cigar,
+                     struct fastq_record *fastq_record, struct fasta_record *fasta_record)
+{
+    uint32_t readlen = strlen((char *)edit_str);
+    struct simd_match_iter iter;
+    init_simd_match_iter(&iter,
+                         fasta_record->seq,
+                         fasta_record->seq_len,
+                         edit_str,
+                         readlen);
+    
+    struct match match;
+    while (next_simd_match(&iter, &match)) {
+        print_sam_line(
+                       stdout,
+                       fastq_record->name,
+                       fasta_record->name,
+                       match.pos + 1,
+                       edit_cigar,
+                       fastq_record->sequence,
+                       fastq_record->quality
+                       );
+    }
+    
+    dealloc_simd_match_iter(&iter);
+}
+
+static void map_shift_or(const uint8_t *edit_str, const char *edit_cigar,
+                         struct fastq_record *fastq_record, struct fasta_record *fasta_record)
+{
+    uint32_t readlen = strlen((char *)edit_str);
+    struct shift_or_match_iter iter;
+    init_shift_or_match_iter(&iter,
+                             fasta_record->seq,
+                             fasta_record->seq_len,
+                             edit_str,
+                             readlen);
+    
+    struct match match;
+    while (next_shift_or_match(&iter, &match)) {
+        print_sam_line(
+                       stdout,
+                       fastq_record->name,
+                       fasta_record->name,
+                       match.pos + 1,
+                       edit_cigar,
+                       fastq_record->sequence,
+                       fastq_record->quality
+                       );
+    }
+    
+    dealloc_shift_or_match_iter(&iter);
+}
+
+static void map_bndm(const uint8_t *edit_str, const char *edit_cigar,
+                     struct fastq_record *fastq_record, struct fasta_record *fasta_record)
+{
+    uint32_t readlen = strlen((char *)edit_str);
+    struct bndm_match_iter iter;
+    init_bndm_match_iter(&iter,
+                         fasta_record->seq,
+                         fasta_record->seq_len,
+                         edit_str,
+                         readlen);
+    
+    struct match match;
+    while (next_bndm_match(&iter, &match)) {
+        print_sam_line(
+                       stdout,
+                       fastq_record->name,
+                       fasta_record->name,
+                       match.pos + 1,
+                       edit_cigar,
+                       fastq_record->sequence,
+                       fastq_record->quality
+                       );
+    }
+    
+    dealloc_bndm_match_iter(&iter);
+}
+
 int main(int argc, char **argv)
 {
     const char *progname = argv[0];
@@ -277,6 +417,26 @@ int main(int argc, char **argv)
         map(fasta_records, &fastq_iter, edits, map_bmh);
 
         
+    } else if (strcmp(algorithm, "bm") == 0) {
+        map(fasta_records, &fastq_iter, edits, map_bm);
+
+        
+    } else if (strcmp(algorithm, "bm-galil") == 0) {
+        map(fasta_records, &fastq_iter, edits, map_bm_galil);
+
+        
+    } else if (strcmp(algorithm, "simd") == 0) {
+        map(fasta_records, &fastq_iter, edits, map_simd);
+
+        
+    } else if (strcmp(algorithm, "shift-or") == 0) {
+        map(fasta_records, &fastq_iter, edits, map_shift_or);
+
+        
+    } else if (strcmp(algorithm, "bndm") == 0) {
+        map(fasta_records, &fastq_iter, edits, map_bndm);
+
+        
     } else {
         printf("Invalid algorithm option: %s\n", algorithm);
         free_fasta_records(fasta_records);